@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Minimal benchmark harness in the spirit of Google Benchmark, with JSON output.
+ *
+ * A benchmark is a function that repeats the measured operation while state.keepRunning()
+ * returns true. The runner raises the iteration count until a run lasts at least the
+ * minimum time, then reports time per operation and, from the declared work per operation,
+ * GFLOP/s and GB/s.
+ */
+
+namespace bench
+{
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Keeps a value (and the computation producing it) from being optimized away.
+	 */
+	template <typename T>
+	inline void doNotOptimize(const T &value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void *sink;
+		sink = &value;
+#endif
+	}
+
+	/**
+	 * @brief Timing state of one run: the iteration budget and the measured time.
+	 */
+	class State
+	{
+	private:
+		std::size_t m_iterations;
+		std::size_t m_remaining;
+		Clock::time_point m_start;
+		double m_elapsed = 0;
+		bool m_started = false;
+
+	public:
+		explicit State(std::size_t iterations) : m_iterations(iterations), m_remaining(iterations) {}
+
+		/**
+		 * @brief Starts the timer on the first call and stops it after the last iteration.
+		 *
+		 * @return True while iterations remain.
+		 */
+		bool keepRunning()
+		{
+			if (!m_started)
+			{
+				m_started = true;
+				m_start = Clock::now();
+			}
+			if (m_remaining == 0)
+			{
+				pauseTiming();
+				return false;
+			}
+			m_remaining--;
+			return true;
+		}
+
+		/**
+		 * @brief Excludes the following work (setup, undo) from the measurement.
+		 */
+		void pauseTiming()
+		{
+			m_elapsed += std::chrono::duration<double>(Clock::now() - m_start).count();
+		}
+
+		/**
+		 * @brief Resumes measuring after pauseTiming().
+		 */
+		void resumeTiming()
+		{
+			m_start = Clock::now();
+		}
+
+		std::size_t iterations() const
+		{
+			return m_iterations;
+		}
+
+		/**
+		 * @brief Measured seconds over all iterations.
+		 */
+		double elapsed() const
+		{
+			return m_elapsed;
+		}
+	};
+
+	/**
+	 * @brief A registered benchmark: what it measures and how much work one operation does.
+	 */
+	struct Benchmark
+	{
+		std::string op;
+		std::string type;
+		int size;
+		double flops;
+		double bytes;
+		std::function<void(State &)> fn;
+
+		std::string name() const
+		{
+			return op + "/" + type + "/" + std::to_string(size);
+		}
+	};
+
+	/**
+	 * @brief Measurement of one benchmark.
+	 */
+	struct Result
+	{
+		const Benchmark *benchmark;
+		std::size_t iterations;
+		double nsPerOp;
+	};
+
+	/**
+	 * @brief Runs a benchmark, growing the iteration count until one run takes minTime seconds.
+	 */
+	inline Result run(const Benchmark &benchmark, double minTime)
+	{
+		std::size_t iterations = 1;
+		for (;;)
+		{
+			State state(iterations);
+			benchmark.fn(state);
+			const double elapsed = state.elapsed();
+			if (elapsed >= minTime || iterations >= (std::size_t(1) << 30))
+			{
+				return Result{&benchmark, iterations, elapsed * 1e9 / iterations};
+			}
+			// Aim 20% past the target, growing at most tenfold per step
+			const double perIteration = std::max(elapsed / iterations, 1e-9);
+			const double wanted = std::ceil(minTime * 1.2 / perIteration);
+			iterations = static_cast<std::size_t>(std::min(wanted, iterations * 10.0));
+			iterations = std::max<std::size_t>(iterations, 2);
+		}
+	}
+
+	/**
+	 * @brief Writes the results as one JSON document.
+	 *
+	 * @param os The output stream.
+	 * @param context Key/value pairs describing the machine and build.
+	 * @param results The measurements.
+	 */
+	inline void writeJson(std::ostream &os, const std::vector<std::pair<std::string, std::string>> &context, const std::vector<Result> &results)
+	{
+		auto number = [](double value)
+		{
+			if (!std::isfinite(value))
+			{
+				return std::string("null");
+			}
+			char buffer[32];
+			std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+			return std::string(buffer);
+		};
+
+		os << "{\n  \"context\": {\n";
+		for (std::size_t k = 0; k < context.size(); k++)
+		{
+			os << "    \"" << context[k].first << "\": \"" << context[k].second << "\"" << (k + 1 < context.size() ? "," : "") << "\n";
+		}
+		os << "  },\n  \"benchmarks\": [\n";
+		for (std::size_t k = 0; k < results.size(); k++)
+		{
+			const Result &r = results[k];
+			const Benchmark &b = *r.benchmark;
+			os << "    {\"name\": \"" << b.name() << "\", \"op\": \"" << b.op << "\", \"type\": \"" << b.type
+			   << "\", \"size\": " << b.size << ", \"iterations\": " << r.iterations
+			   << ", \"ns_per_op\": " << number(r.nsPerOp)
+			   << ", \"gflops\": " << number(b.flops > 0 ? b.flops / r.nsPerOp : 0.0)
+			   << ", \"gbps\": " << number(b.bytes > 0 ? b.bytes / r.nsPerOp : 0.0) << "}"
+			   << (k + 1 < results.size() ? "," : "") << "\n";
+		}
+		os << "  ]\n}\n";
+	}
+
+	/**
+	 * @brief Formats the current local time as ISO 8601.
+	 */
+	inline std::string now()
+	{
+		std::time_t t = std::time(nullptr);
+		char buffer[32];
+		std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", std::localtime(&t));
+		return buffer;
+	}
+}
@@ -0,0 +1,743 @@
+#include "../inc/matrix.hpp"
+#include "../inc/matrixbatch.hpp"
+#include "../inc/mixedprecision.hpp"
+#include "../inc/reduction.hpp"
+#include "../inc/squarematrix.hpp"
+#include "../inc/structuredmatrix.hpp"
+#include "../inc/textio.hpp"
+#include "benchmark.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Performance suite for the Matrix library.
+ *
+ * Every operation is measured for int, float and double on n x n matrices, n = 4, 8, ..., 8192,
+ * and reported as JSON: ns_per_op, plus gflops (arithmetic operations per nanosecond; integer
+ * operations count the same) and gbps (minimum bytes an operation must touch per nanosecond).
+ *
+ * Usage: matrix_bench [--filter=TEXT] [--min-size=N] [--max-size=N] [--min-time=SECONDS] [--out=FILE] [--profile=FILE] [--list]
+ *
+ * --profile writes the library's operation profile (see profile.hpp) of the whole run; it
+ * needs a build with MG_PROFILE on, which also slows every measured operation slightly.
+ */
+
+namespace
+{
+    struct Options
+    {
+        std::string filter;
+        int minSize = 4;
+        int maxSize = 8192;
+        double minTime = 0.2;
+        std::string out;
+        std::string profile;
+        bool list = false;
+    };
+
+    template <typename T>
+    const char *typeName();
+
+    template <>
+    const char *typeName<int>() { return "int"; }
+
+    template <>
+    const char *typeName<float>() { return "float"; }
+
+    template <>
+    const char *typeName<double>() { return "double"; }
+
+    template <typename T>
+    mg::Matrix<T> sample(int n, int seed)
+    {
+        mg::Matrix<T> m(n, n);
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                m(i, j) = static_cast<T>((i * 7 + j * 13 + seed) % 17);
+            }
+        }
+        return m;
+    }
+
+    /*
+     * Well-conditioned input for determinant(): diagonally dominant for LU. Integer Bareiss
+     * elimination gets L * U, with L and U the all-ones unit lower and upper triangles
+     * (element (i, j) = min(i, j) + 1), with rows 2k and 2k + 1 swapped. It is dense and not
+     * triangular, so the O(n^2) triangular shortcut does not apply. Its determinant is +-1,
+     * and every minor the elimination meets stays below n, so nothing overflows.
+     */
+    template <typename T>
+    mg::SquareMatrix<T> determinantInput(int n)
+    {
+        mg::SquareMatrix<T> m(n, T());
+        for (int i = 0; i < n; i++)
+        {
+            if (std::is_integral<T>::value)
+            {
+                const int row = (i ^ 1) < n ? i ^ 1 : i;
+                for (int j = 0; j < n; j++)
+                {
+                    m(i, j) = static_cast<T>(std::min(row, j) + 1);
+                }
+                continue;
+            }
+            for (int j = 0; j <= i; j++)
+            {
+                m(i, j) = static_cast<T>((i * 7 + j * 13) % 17) / 17;
+                m(j, i) = static_cast<T>((i * 5 + j * 3) % 11) / 11;
+            }
+            m(i, i) = static_cast<T>(n);
+        }
+        return m;
+    }
+
+    /*
+     * The elements of an n x n sample regrouped as n * n / 16 4 x 4 matrices, with the diagonal
+     * raised so that every matrix is invertible.
+     */
+    template <typename T>
+    mg::MatrixBatch<T> sampleBatch(int n, int seed)
+    {
+        const int count = std::max(1, n * n / 16);
+        mg::MatrixBatch<T> batch(count, 4, 4);
+        for (int b = 0; b < count; b++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    batch(b, i, j) = static_cast<T>((b * 5 + i * 7 + j * 13 + seed) % 17 + (i == j ? 17 : 0));
+                }
+            }
+        }
+        return batch;
+    }
+
+    template <typename T>
+    void addBenchmarks(std::vector<bench::Benchmark> &benchmarks, int n)
+    {
+        const double elems = static_cast<double>(n) * n;
+        const double bytes = elems * sizeof(T);
+        const double cube = elems * n;
+        auto add = [&](const char *op, double flops, double traffic, std::function<void(bench::State &)> fn)
+        {
+            benchmarks.push_back(bench::Benchmark{op, typeName<T>(), n, flops, traffic, std::move(fn)});
+        };
+
+        add("construct", 0, bytes, [n](bench::State &state)
+            {
+                while (state.keepRunning())
+                {
+                    mg::Matrix<T> m(n, n, T(1));
+                    bench::doNotOptimize(m.data());
+                } });
+
+        add("construct_pool", 0, bytes, [n](bench::State &state)
+            {
+                mg::MatrixResourceScope scope(mg::sharedPool());
+                while (state.keepRunning())
+                {
+                    mg::Matrix<T> m(n, n, T(1));
+                    bench::doNotOptimize(m.data());
+                } });
+
+        add("construct_arena", 0, bytes, [n](bench::State &state)
+            {
+                mg::MatrixResourceScope scope(mg::threadArena());
+                while (state.keepRunning())
+                {
+                    {
+                        mg::Matrix<T> m(n, n, T(1));
+                        bench::doNotOptimize(m.data());
+                    }
+                    mg::threadArena().reset();
+                } });
+
+        add("random_uniform", 0, bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> m(n, n);
+                std::uint64_t seed = 1;
+                while (state.keepRunning())
+                {
+                    m.setRandomValues(T(0), T(100), seed++);
+                    bench::doNotOptimize(m.data());
+                } });
+
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            add("random_normal", 0, bytes, [n](bench::State &state)
+                {
+                    mg::Matrix<T> m(n, n);
+                    std::uint64_t seed = 1;
+                    while (state.keepRunning())
+                    {
+                        m.setNormalValues(T(0), T(1), seed++);
+                        bench::doNotOptimize(m.data());
+                    } });
+        }
+
+        add("element_access", 0, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    T sum = T();
+                    for (int i = 0; i < n; i++)
+                    {
+                        for (int j = 0; j < n; j++)
+                        {
+                            sum += a(i, j);
+                        }
+                    }
+                    bench::doNotOptimize(sum);
+                } });
+
+        add("element_access_checked", 0, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    T sum = T();
+                    for (int i = 0; i < n; i++)
+                    {
+                        for (int j = 0; j < n; j++)
+                        {
+                            sum += a.at(i, j);
+                        }
+                    }
+                    bench::doNotOptimize(sum);
+                } });
+
+        add("add", elems, 3 * bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1), b = sample<T>(n, 2);
+                mg::Matrix<T> c(n, n);
+                while (state.keepRunning())
+                {
+                    c = a + b;
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("subtract", elems, 3 * bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1), b = sample<T>(n, 2);
+                mg::Matrix<T> c(n, n);
+                while (state.keepRunning())
+                {
+                    c = a - b;
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("scale", elems, 2 * bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                mg::Matrix<T> c(n, n);
+                while (state.keepRunning())
+                {
+                    c = a * T(3);
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("multiply", 2 * cube, 3 * bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1), b = sample<T>(n, 2);
+                mg::Matrix<T> c(n, n);
+                while (state.keepRunning())
+                {
+                    c = a * b;
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("multiply_classic", 2 * cube, 3 * bytes, [n](bench::State &state)
+            {
+                const mg::SquareMatrix<T> a(sample<T>(n, 1)), b(sample<T>(n, 2));
+                while (state.keepRunning())
+                {
+                    mg::SquareMatrix<T> c = a.multiply(b, mg::MultiplyAlgorithm::Classic);
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("multiply_strassen", 2 * cube, 3 * bytes, [n](bench::State &state)
+            {
+                const mg::SquareMatrix<T> a(sample<T>(n, 1)), b(sample<T>(n, 2));
+                while (state.keepRunning())
+                {
+                    mg::SquareMatrix<T> c = a.multiply(b, mg::MultiplyAlgorithm::Strassen);
+                    bench::doNotOptimize(c.data());
+                } });
+
+        if constexpr (std::is_same<T, float>::value)
+        {
+            // 16-bit storage, float accumulation: half the bytes of multiply/float
+            add("multiply_half", 2 * cube, 3 * elems * sizeof(mg::half), [n](bench::State &state)
+                {
+                    const mg::Matrix<mg::half> a = mg::convertMatrix<mg::half>(sample<T>(n, 1)), b = mg::convertMatrix<mg::half>(sample<T>(n, 2));
+                    mg::Matrix<mg::half> c(n, n);
+                    while (state.keepRunning())
+                    {
+                        c = a * b;
+                        bench::doNotOptimize(c.data());
+                    } });
+
+            add("multiply_bfloat16", 2 * cube, 3 * elems * sizeof(mg::bfloat16), [n](bench::State &state)
+                {
+                    const mg::Matrix<mg::bfloat16> a = mg::convertMatrix<mg::bfloat16>(sample<T>(n, 1)), b = mg::convertMatrix<mg::bfloat16>(sample<T>(n, 2));
+                    mg::Matrix<mg::bfloat16> c(n, n);
+                    while (state.keepRunning())
+                    {
+                        c = a * b;
+                        bench::doNotOptimize(c.data());
+                    } });
+        }
+
+        if constexpr (std::is_integral<T>::value)
+        {
+            // int8 operands, exact int32 result
+            add("multiply_int8", 2 * cube, elems * (2 + sizeof(std::int32_t)), [n](bench::State &state)
+                {
+                    const mg::Matrix<std::int8_t> a = mg::convertMatrix<std::int8_t>(sample<T>(n, 1)), b = mg::convertMatrix<std::int8_t>(sample<T>(n, 2));
+                    while (state.keepRunning())
+                    {
+                        mg::Matrix<std::int32_t> c = mg::mixedMultiply<std::int32_t>(a, b);
+                        bench::doNotOptimize(c.data());
+                    } });
+        }
+
+        // n * n / 16 independent 4 x 4 matrices, interleaved across the batch
+        add("batch_multiply", 2 * elems * 4, 3 * bytes, [n](bench::State &state)
+            {
+                const mg::MatrixBatch<T> a = sampleBatch<T>(n, 1), b = sampleBatch<T>(n, 2);
+                while (state.keepRunning())
+                {
+                    mg::MatrixBatch<T> c = a * b;
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("batch_determinant", elems * 4, bytes, [n](bench::State &state)
+            {
+                const mg::MatrixBatch<T> a = sampleBatch<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    std::vector<T> d = a.determinants();
+                    bench::doNotOptimize(d.data());
+                } });
+
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            add("batch_solve", elems * 8, 2 * bytes, [n](bench::State &state)
+                {
+                    const mg::BatchLU<T> lu = sampleBatch<T>(n, 1).lu();
+                    const mg::MatrixBatch<T> b = sampleBatch<T>(n, 2);
+                    while (state.keepRunning())
+                    {
+                        mg::MatrixBatch<T> x = lu.solve(b);
+                        bench::doNotOptimize(x.data());
+                    } });
+        }
+
+        add("add_assign", elems, 3 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const mg::Matrix<T> b = sample<T>(n, 2);
+                while (state.keepRunning())
+                {
+                    a += b;
+                    bench::doNotOptimize(a.data());
+                } });
+
+        add("subtract_assign", elems, 3 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const mg::Matrix<T> b = sample<T>(n, 2);
+                while (state.keepRunning())
+                {
+                    a -= b;
+                    bench::doNotOptimize(a.data());
+                } });
+
+        add("scale_assign", elems, 2 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    a *= T(1);
+                    bench::doNotOptimize(a.data());
+                } });
+
+        add("multiply_assign", 2 * cube, 3 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const mg::Matrix<T> identity = mg::SquareMatrix<T>::identity(n); // keeps the values bounded
+                while (state.keepRunning())
+                {
+                    a *= identity;
+                    bench::doNotOptimize(a.data());
+                } });
+
+        add("sum", elems, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    auto s = mg::sum(a);
+                    bench::doNotOptimize(s);
+                } });
+
+        add("col_sums", elems, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    auto sums = mg::colSums(a);
+                    bench::doNotOptimize(sums.data());
+                } });
+
+        add("frobenius_norm", 2 * elems, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    auto norm = mg::frobeniusNorm(a);
+                    bench::doNotOptimize(norm);
+                } });
+
+        add("transpose", 0, 2 * bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                mg::Matrix<T> c(n, n);
+                while (state.keepRunning())
+                {
+                    c = a.transpose();
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("transpose_in_place", 0, 2 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    a.transposeInPlace();
+                    bench::doNotOptimize(a.data());
+                } });
+
+        add("determinant", 2 * cube / 3, bytes, [n](bench::State &state)
+            {
+                const mg::SquareMatrix<T> a = determinantInput<T>(n);
+                while (state.keepRunning())
+                {
+                    T det = a.determinant();
+                    bench::doNotOptimize(det);
+                } });
+
+        add("diagonal_multiply", elems, 2 * bytes, [n](bench::State &state)
+            {
+                const mg::DiagonalMatrix<T> d(n, T(1));
+                const mg::Matrix<T> b = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    mg::Matrix<T> c = d * b;
+                    bench::doNotOptimize(c.data());
+                } });
+
+        add("syrk", cube, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                mg::SymmetricMatrix<T> c(n);
+                while (state.keepRunning())
+                {
+                    c.rankUpdate(a, T(1), T(0));
+                    bench::doNotOptimize(c.data());
+                } });
+
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            add("triangular_solve", cube, 2 * bytes, [n](bench::State &state)
+                {
+                    const mg::TriangularMatrix<T> l(determinantInput<T>(n), mg::Triangle::Lower);
+                    const mg::Matrix<T> b = sample<T>(n, 1);
+                    while (state.keepRunning())
+                    {
+                        mg::Matrix<T> x = l.solve(b);
+                        bench::doNotOptimize(x.data());
+                    } });
+
+            // Tridiagonal: the common case of banded systems
+            add("banded_solve", elems * 10, 2 * bytes, [n](bench::State &state)
+                {
+                    const mg::BandedMatrix<T> a(determinantInput<T>(n), 1, 1);
+                    const mg::Matrix<T> b = sample<T>(n, 1);
+                    while (state.keepRunning())
+                    {
+                        mg::Matrix<T> x = a.solve(b);
+                        bench::doNotOptimize(x.data());
+                    } });
+        }
+
+        add("add_row", 0, bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const std::vector<T> row(n, T(1));
+                while (state.keepRunning())
+                {
+                    a.addRow(n / 2, row);
+                    state.pauseTiming();
+                    a.removeRow(n / 2);
+                    state.resumeTiming();
+                } });
+
+        add("remove_row", 0, bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const std::vector<T> row(n, T(1));
+                while (state.keepRunning())
+                {
+                    a.removeRow(n / 2);
+                    state.pauseTiming();
+                    a.addRow(n / 2, row);
+                    state.resumeTiming();
+                } });
+
+        add("add_col", 0, 2 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const std::vector<T> col(n, T(1));
+                while (state.keepRunning())
+                {
+                    a.addCol(n / 2, col);
+                    state.pauseTiming();
+                    a.removeCol(n / 2);
+                    state.resumeTiming();
+                } });
+
+        add("remove_col", 0, 2 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const std::vector<T> col(n, T(1));
+                while (state.keepRunning())
+                {
+                    a.removeCol(n / 2);
+                    state.pauseTiming();
+                    a.addCol(n / 2, col);
+                    state.resumeTiming();
+                } });
+
+        add("append_cols", 0, 2 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const mg::Matrix<T> block = sample<T>(n, 2);
+                const int k = std::max(1, n / 8);
+                std::vector<int> added(k);
+                for (int j = 0; j < k; j++)
+                {
+                    added[j] = n + j;
+                }
+                while (state.keepRunning())
+                {
+                    a.appendCols(block.block(0, 0, n, k));
+                    state.pauseTiming();
+                    a.eraseCols(added);
+                    state.resumeTiming();
+                } });
+
+        add("erase_cols", 0, 2 * bytes, [n](bench::State &state)
+            {
+                mg::Matrix<T> a = sample<T>(n, 1);
+                const mg::Matrix<T> block = sample<T>(n, 2);
+                const int k = std::max(1, n / 8);
+                std::vector<int> positions(k), erased(k);
+                for (int j = 0; j < k; j++)
+                {
+                    positions[j] = j * n / k;
+                    erased[j] = positions[j] + j; // Where column j of the block ends up
+                }
+                a.insertCols(positions, block.block(0, 0, n, k));
+                while (state.keepRunning())
+                {
+                    a.eraseCols(erased);
+                    state.pauseTiming();
+                    a.insertCols(positions, block.block(0, 0, n, k));
+                    state.resumeTiming();
+                } });
+
+        add("format_csv", 0, bytes, [n](bench::State &state)
+            {
+                const mg::Matrix<T> a = sample<T>(n, 1);
+                while (state.keepRunning())
+                {
+                    std::string text = mg::formatText(a, mg::TextFormat::csv());
+                    bench::doNotOptimize(text.data());
+                } });
+
+        add("parse_csv", 0, bytes, [n](bench::State &state)
+            {
+                const std::string text = mg::formatText(sample<T>(n, 1), mg::TextFormat::csv());
+                while (state.keepRunning())
+                {
+                    mg::Matrix<T> a = mg::parseText<T>(text, mg::TextFormat::csv());
+                    bench::doNotOptimize(a.data());
+                } });
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int k = 1; k < argc; k++)
+        {
+            const std::string arg = argv[k];
+            auto value = [&](const char *prefix) -> const char *
+            {
+                const std::string p(prefix);
+                return arg.compare(0, p.size(), p) == 0 ? argv[k] + p.size() : nullptr;
+            };
+            if (const char *v = value("--filter="))
+            {
+                options.filter = v;
+            }
+            else if (const char *v = value("--min-size="))
+            {
+                options.minSize = std::atoi(v);
+            }
+            else if (const char *v = value("--max-size="))
+            {
+                options.maxSize = std::atoi(v);
+            }
+            else if (const char *v = value("--min-time="))
+            {
+                options.minTime = std::atof(v);
+            }
+            else if (const char *v = value("--out="))
+            {
+                options.out = v;
+            }
+            else if (const char *v = value("--profile="))
+            {
+                options.profile = v;
+            }
+            else if (arg == "--list")
+            {
+                options.list = true;
+            }
+            else
+            {
+                std::cerr << "Usage: " << argv[0] << " [--filter=TEXT] [--min-size=N] [--max-size=N] [--min-time=SECONDS] [--out=FILE] [--profile=FILE] [--list]" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char *isaName(mg::simd::Isa isa)
+    {
+        switch (isa)
+        {
+        case mg::simd::Isa::AVX512:
+            return "avx512";
+        case mg::simd::Isa::AVX2:
+            return "avx2";
+        case mg::simd::Isa::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+    if (!options.profile.empty() && !mg::PROFILE)
+    {
+        std::cerr << "--profile needs a build with MG_PROFILE on" << std::endl;
+        return 2;
+    }
+
+    std::vector<bench::Benchmark> benchmarks;
+    for (int n = 4; n <= 8192; n *= 2)
+    {
+        if (n < options.minSize || n > options.maxSize)
+        {
+            continue;
+        }
+        addBenchmarks<int>(benchmarks, n);
+        addBenchmarks<float>(benchmarks, n);
+        addBenchmarks<double>(benchmarks, n);
+    }
+    std::vector<const bench::Benchmark *> selected;
+    for (const auto &b : benchmarks)
+    {
+        if (b.name().find(options.filter) != std::string::npos)
+        {
+            selected.push_back(&b);
+        }
+    }
+
+    if (options.list)
+    {
+        for (const auto *b : selected)
+        {
+            std::cout << b->name() << '\n';
+        }
+        return 0;
+    }
+
+    std::vector<bench::Result> results;
+    for (const auto *b : selected)
+    {
+        std::cerr << b->name() << "..." << std::flush;
+        results.push_back(bench::run(*b, options.minTime));
+        std::cerr << " " << results.back().nsPerOp << " ns/op" << std::endl;
+    }
+
+    const std::vector<std::pair<std::string, std::string>> context = {
+        {"date", bench::now()},
+        {"threads", std::to_string(mg::ThreadPool::global().concurrency())},
+        {"isa", isaName(mg::simd::activeIsa())},
+#ifdef MG_GEMM_AVX2
+        {"gemm_kernel", "avx2"},
+#else
+        {"gemm_kernel", "generic"},
+#endif
+#ifdef __VERSION__
+        {"compiler", __VERSION__},
+#endif
+        {"min_time", std::to_string(options.minTime)},
+        {"profile", mg::PROFILE ? "on" : "off"}};
+
+    if (!options.profile.empty())
+    {
+        std::ofstream file(options.profile);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << options.profile << std::endl;
+            return 1;
+        }
+        mg::profile::writeJson(file);
+    }
+
+    if (options.out.empty())
+    {
+        bench::writeJson(std::cout, context, results);
+    }
+    else
+    {
+        std::ofstream file(options.out);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << options.out << std::endl;
+            return 1;
+        }
+        bench::writeJson(file, context, results);
+    }
+    return 0;
+}
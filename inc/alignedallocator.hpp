@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/**
+ * @brief Allocator handing out over-aligned memory for matrix buffers.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Alignment in bytes of every matrix buffer (one cache line, enough for 512-bit vector loads).
+	 */
+	constexpr std::size_t MATRIX_ALIGNMENT = 64;
+
+	/**
+	 * @brief Standard-conforming allocator returning memory aligned to at least Alignment bytes.
+	 *
+	 * @tparam T The type of the allocated elements.
+	 * @tparam Alignment Requested alignment in bytes.
+	 */
+	template <typename T, std::size_t Alignment = MATRIX_ALIGNMENT>
+	class AlignedAllocator
+	{
+	public:
+		using value_type = T;
+
+		/**
+		 * @brief Effective alignment, never weaker than the natural alignment of T.
+		 */
+		static constexpr std::size_t alignment = Alignment > alignof(T) ? Alignment : alignof(T);
+
+		template <typename U>
+		struct rebind
+		{
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		AlignedAllocator() noexcept = default;
+
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+		/**
+		 * @brief Allocates uninitialized storage for n elements.
+		 *
+		 * @param n Number of elements.
+		 * @return Pointer to the aligned storage.
+		 * @throws std::bad_alloc If the allocation fails.
+		 */
+		T *allocate(std::size_t n)
+		{
+			return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+		}
+
+		/**
+		 * @brief Releases storage obtained from allocate().
+		 *
+		 * @param p Pointer returned by allocate().
+		 * @param n Number of elements passed to allocate().
+		 */
+		void deallocate(T *p, std::size_t n) noexcept
+		{
+			::operator delete(p, n * sizeof(T), std::align_val_t(alignment));
+		}
+
+		template <typename U>
+		bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept
+		{
+			return true;
+		}
+
+		template <typename U>
+		bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept
+		{
+			return false;
+		}
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdexcept>
+
+/**
+ * @brief Bounds-checking policy for element access.
+ *
+ * at() always checks its indices and coeff() / coeffRef() never do. operator() checks them
+ * when MG_BOUNDS_CHECK is non-zero, which by default follows the build: on unless NDEBUG is
+ * defined. Define MG_BOUNDS_CHECK to 0 or 1 before including the library to override it; the
+ * value must be the same in every translation unit of a program.
+ */
+
+#ifndef MG_BOUNDS_CHECK
+#ifdef NDEBUG
+#define MG_BOUNDS_CHECK 0
+#else
+#define MG_BOUNDS_CHECK 1
+#endif
+#endif
+
+namespace mg
+{
+	/**
+	 * @brief Whether operator() checks its indices in this build.
+	 */
+	constexpr bool BOUNDS_CHECK = MG_BOUNDS_CHECK != 0;
+
+	namespace detail
+	{
+		/**
+		 * @brief Throws unless (i, j) lies inside a rows x cols matrix.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		constexpr void checkIndex(int i, int j, int rows, int cols)
+		{
+			if (i >= rows || j >= cols || i < 0 || j < 0)
+			{
+				throw std::out_of_range("Matrix indices out of bounds");
+			}
+		}
+
+		/**
+		 * @brief Throws unless k indexes a vector of the given size.
+		 *
+		 * @throws std::out_of_range If the index is out of bounds.
+		 */
+		constexpr void checkIndex(int k, int size)
+		{
+			if (k >= size || k < 0)
+			{
+				throw std::out_of_range("Out of bounds");
+			}
+		}
+	}
+}
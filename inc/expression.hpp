@@ -0,0 +1,441 @@
+#pragma once
+
+#include <stdexcept>
+#include <type_traits>
+#include "simd.hpp"
+
+/**
+ * @brief Expression templates for lazy, fused evaluation of Matrix arithmetic.
+ *
+ * operator+, operator-, scalar operator*, matrix operator* and transpose() return lightweight
+ * nodes instead of matrices. A node is evaluated when it is assigned to (or used to construct)
+ * a Matrix: element-wise chains run as a single fused loop with no intermediate matrices, and
+ * a product added to another term (A * B + C) becomes one GEMM accumulating into the result.
+ *
+ * Nodes refer to Matrix operands by reference and copy views (which are just a pointer and
+ * dimensions). Assign them to a Matrix before the operands go out of scope; storing one with
+ * auto is only safe while the operands live.
+ */
+
+namespace mg
+{
+	template <typename T>
+	class Matrix;
+
+	template <typename T>
+	class MatrixView;
+
+	template <typename T>
+	class RowView;
+
+	template <typename T>
+	class ColView;
+
+	/**
+	 * @brief A rectangular block of a matrix is viewed like any other strided window.
+	 */
+	template <typename T>
+	using BlockView = MatrixView<T>;
+
+	template <typename E>
+	class TransposeExpr;
+
+	/**
+	 * @brief CRTP base of everything that can appear in a matrix expression, Matrix included.
+	 *
+	 * Every expression type E provides value_type, getRows(), getCols(), coeff(i, j) (unchecked
+	 * element read), references(begin, end) (whether any operand storage overlaps that address
+	 * range), prepare() and the compile-time flags isLeaf (operand is strided storage reachable
+	 * through data() and getStride()) and elementwise (coeff(i, j) only reads operand element (i, j)).
+	 *
+	 * @tparam E The concrete expression type.
+	 */
+	template <typename E>
+	class MatrixExpr
+	{
+	public:
+		/**
+		 * @brief Downcasts to the concrete expression.
+		 *
+		 * @return Reference to the derived object.
+		 */
+		const E &self() const
+		{
+			return static_cast<const E &>(*this);
+		}
+
+		/**
+		 * @brief Transposes the matrix.
+		 *
+		 * @return A lazy expression for the transposed matrix.
+		 */
+		TransposeExpr<E> transpose() const
+		{
+			return TransposeExpr<E>(self());
+		}
+	};
+
+	/**
+	 * @brief How an expression node stores an operand: matrices by reference, views and nodes by value.
+	 */
+	template <typename E>
+	struct ExprOperand
+	{
+		using type = typename std::conditional<E::isLeaf, const E &, const E>::type;
+	};
+
+	template <typename T>
+	struct ExprOperand<MatrixView<T>>
+	{
+		using type = const MatrixView<T>;
+	};
+
+	/**
+	 * @brief Element-wise combination of two expressions of equal size.
+	 *
+	 * @tparam L Left operand type.
+	 * @tparam R Right operand type.
+	 * @tparam Op One of simd::AddOp, simd::SubOp.
+	 */
+	template <typename L, typename R, typename Op>
+	class BinaryExpr : public MatrixExpr<BinaryExpr<L, R, Op>>
+	{
+	private:
+		typename ExprOperand<L>::type m_lhs;
+		typename ExprOperand<R>::type m_rhs;
+
+	public:
+		using value_type = typename L::value_type;
+		using lhs_type = L;
+		using rhs_type = R;
+		using op_type = Op;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = L::elementwise && R::elementwise;
+
+		BinaryExpr(const L &lhs, const R &rhs) : m_lhs(lhs), m_rhs(rhs) {}
+
+		int getRows() const { return m_lhs.getRows(); }
+		int getCols() const { return m_lhs.getCols(); }
+		const L &lhs() const { return m_lhs; }
+		const R &rhs() const { return m_rhs; }
+
+		value_type coeff(int i, int j) const
+		{
+			value_type result;
+			Op::apply(result, m_lhs.coeff(i, j), m_rhs.coeff(i, j));
+			return result;
+		}
+
+		bool references(const void *begin, const void *end) const
+		{
+			return m_lhs.references(begin, end) || m_rhs.references(begin, end);
+		}
+
+		void prepare() const
+		{
+			m_lhs.prepare();
+			m_rhs.prepare();
+		}
+	};
+
+	/**
+	 * @brief Element-wise combination of an expression with a scalar.
+	 *
+	 * @tparam E Expression operand type.
+	 * @tparam Op Operation applied as Op(element, scalar).
+	 */
+	template <typename E, typename Op>
+	class ScalarExpr : public MatrixExpr<ScalarExpr<E, Op>>
+	{
+	public:
+		using value_type = typename E::value_type;
+		using operand_type = E;
+		using op_type = Op;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = E::elementwise;
+
+	private:
+		typename ExprOperand<E>::type m_expr;
+		value_type m_scalar;
+
+	public:
+		ScalarExpr(const E &expr, const value_type &scalar) : m_expr(expr), m_scalar(scalar) {}
+
+		int getRows() const { return m_expr.getRows(); }
+		int getCols() const { return m_expr.getCols(); }
+		const E &operand() const { return m_expr; }
+		const value_type &scalar() const { return m_scalar; }
+
+		value_type coeff(int i, int j) const
+		{
+			value_type result;
+			Op::apply(result, m_expr.coeff(i, j), m_scalar);
+			return result;
+		}
+
+		bool references(const void *begin, const void *end) const
+		{
+			return m_expr.references(begin, end);
+		}
+
+		void prepare() const
+		{
+			m_expr.prepare();
+		}
+	};
+
+	/**
+	 * @brief Transposed view of an expression.
+	 *
+	 * @tparam E Expression operand type.
+	 */
+	template <typename E>
+	class TransposeExpr : public MatrixExpr<TransposeExpr<E>>
+	{
+	private:
+		typename ExprOperand<E>::type m_expr;
+
+	public:
+		using value_type = typename E::value_type;
+		using operand_type = E;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = false;
+
+		explicit TransposeExpr(const E &expr) : m_expr(expr) {}
+
+		int getRows() const { return m_expr.getCols(); }
+		int getCols() const { return m_expr.getRows(); }
+		const E &operand() const { return m_expr; }
+
+		value_type coeff(int i, int j) const
+		{
+			return m_expr.coeff(j, i);
+		}
+
+		bool references(const void *begin, const void *end) const
+		{
+			return m_expr.references(begin, end);
+		}
+
+		void prepare() const
+		{
+			m_expr.prepare();
+		}
+	};
+
+	/**
+	 * @brief Matrix product of two expressions, evaluated by the GEMM kernel.
+	 *
+	 * Assigned directly, or added to another term, the product is written straight into the
+	 * destination. Nested inside a larger element-wise expression it is computed once, by
+	 * prepare(), into an internal buffer that coeff() then reads.
+	 *
+	 * @tparam L Left operand type.
+	 * @tparam R Right operand type.
+	 */
+	template <typename L, typename R>
+	class ProductExpr : public MatrixExpr<ProductExpr<L, R>>
+	{
+	public:
+		using value_type = typename L::value_type;
+		using lhs_type = L;
+		using rhs_type = R;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = false;
+
+	private:
+		typename ExprOperand<L>::type m_lhs;
+		typename ExprOperand<R>::type m_rhs;
+		mutable Matrix<value_type> m_result;
+		mutable bool m_ready = false;
+
+	public:
+		ProductExpr(const L &lhs, const R &rhs) : m_lhs(lhs), m_rhs(rhs) {}
+
+		int getRows() const { return m_lhs.getRows(); }
+		int getCols() const { return m_rhs.getCols(); }
+		const L &lhs() const { return m_lhs; }
+		const R &rhs() const { return m_rhs; }
+
+		value_type coeff(int i, int j) const
+		{
+			return m_result.coeff(i, j);
+		}
+
+		bool references(const void *begin, const void *end) const
+		{
+			return m_lhs.references(begin, end) || m_rhs.references(begin, end);
+		}
+
+		void prepare() const
+		{
+			if (!m_ready)
+			{
+				m_result = Matrix<value_type>(*this);
+				m_ready = true;
+			}
+		}
+	};
+
+	template <typename E>
+	struct IsBinaryExpr : std::false_type
+	{
+	};
+
+	template <typename L, typename R, typename Op>
+	struct IsBinaryExpr<BinaryExpr<L, R, Op>> : std::true_type
+	{
+	};
+
+	template <typename E>
+	struct IsScalarExpr : std::false_type
+	{
+	};
+
+	template <typename E, typename Op>
+	struct IsScalarExpr<ScalarExpr<E, Op>> : std::true_type
+	{
+	};
+
+	template <typename E>
+	struct IsTransposeExpr : std::false_type
+	{
+	};
+
+	template <typename E>
+	struct IsTransposeExpr<TransposeExpr<E>> : std::true_type
+	{
+	};
+
+	template <typename E>
+	struct IsProductExpr : std::false_type
+	{
+	};
+
+	template <typename L, typename R>
+	struct IsProductExpr<ProductExpr<L, R>> : std::true_type
+	{
+	};
+
+	/**
+	 * @brief Element-wise node whose operands are both leaves, so a SIMD kernel can evaluate it.
+	 */
+	template <typename E>
+	struct IsLeafBinaryExpr : std::false_type
+	{
+	};
+
+	template <typename L, typename R, typename Op>
+	struct IsLeafBinaryExpr<BinaryExpr<L, R, Op>> : std::integral_constant<bool, L::isLeaf && R::isLeaf>
+	{
+	};
+
+	/**
+	 * @brief Scalar node whose operand is a leaf, so a SIMD kernel can evaluate it.
+	 */
+	template <typename E>
+	struct IsLeafScalarExpr : std::false_type
+	{
+	};
+
+	template <typename E, typename Op>
+	struct IsLeafScalarExpr<ScalarExpr<E, Op>> : std::integral_constant<bool, E::isLeaf>
+	{
+	};
+
+	/**
+	 * @brief Transpose of a leaf, evaluated by the blocked transpose kernel.
+	 */
+	template <typename E>
+	struct IsLeafTransposeExpr : std::false_type
+	{
+	};
+
+	template <typename E>
+	struct IsLeafTransposeExpr<TransposeExpr<E>> : std::integral_constant<bool, E::isLeaf>
+	{
+	};
+
+	/**
+	 * @brief Sum with a product on either side (A * B + C or C + A * B), evaluated as GEMM with accumulate.
+	 */
+	template <typename E>
+	struct IsProductSum : std::false_type
+	{
+	};
+
+	template <typename L, typename R>
+	struct IsProductSum<BinaryExpr<L, R, simd::AddOp>> : std::integral_constant<bool, IsProductExpr<L>::value || IsProductExpr<R>::value>
+	{
+	};
+
+	/**
+	 * @brief Adds two matrices.
+	 *
+	 * @param lhs The left operand.
+	 * @param rhs The right operand.
+	 * @return A lazy expression representing the sum.
+	 * @throws std::invalid_argument If the dimensions do not match.
+	 */
+	template <typename L, typename R>
+	BinaryExpr<L, R, simd::AddOp> operator+(const MatrixExpr<L> &lhs, const MatrixExpr<R> &rhs)
+	{
+		static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "Element types must match");
+		if (lhs.self().getRows() != rhs.self().getRows() || lhs.self().getCols() != rhs.self().getCols()) // Checks if both matrices are the same size
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		return BinaryExpr<L, R, simd::AddOp>(lhs.self(), rhs.self());
+	}
+
+	/**
+	 * @brief Subtracts two matrices.
+	 *
+	 * @param lhs The left operand.
+	 * @param rhs The right operand.
+	 * @return A lazy expression representing the difference.
+	 * @throws std::invalid_argument If the dimensions do not match.
+	 */
+	template <typename L, typename R>
+	BinaryExpr<L, R, simd::SubOp> operator-(const MatrixExpr<L> &lhs, const MatrixExpr<R> &rhs)
+	{
+		static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "Element types must match");
+		if (lhs.self().getRows() != rhs.self().getRows() || lhs.self().getCols() != rhs.self().getCols()) // Checks if both matrices are the same size
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		return BinaryExpr<L, R, simd::SubOp>(lhs.self(), rhs.self());
+	}
+
+	/**
+	 * @brief Multiplies two matrices.
+	 *
+	 * @param lhs The left operand.
+	 * @param rhs The right operand.
+	 * @return A lazy expression representing the product.
+	 * @throws std::invalid_argument If the matrices have incompatible dimensions.
+	 */
+	template <typename L, typename R>
+	ProductExpr<L, R> operator*(const MatrixExpr<L> &lhs, const MatrixExpr<R> &rhs)
+	{
+		static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "Element types must match");
+		if (lhs.self().getCols() != rhs.self().getRows())
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		return ProductExpr<L, R>(lhs.self(), rhs.self());
+	}
+
+	/**
+	 * @brief Multiplies a matrix by a scalar.
+	 *
+	 * @param expr The matrix operand.
+	 * @param scalar The scalar value.
+	 * @return A lazy expression representing the scaled matrix.
+	 */
+	template <typename E>
+	ScalarExpr<E, simd::MulOp> operator*(const MatrixExpr<E> &expr, const typename E::value_type &scalar)
+	{
+		return ScalarExpr<E, simd::MulOp>(expr.self(), scalar);
+	}
+}
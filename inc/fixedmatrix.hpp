@@ -0,0 +1,599 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "boundscheck.hpp"
+#include "lu.hpp"
+#include "matrix.hpp"
+
+/**
+ * @brief Matrices whose dimensions are template parameters, stored inline (no heap allocation).
+ *
+ * Meant for the many small matrices of geometry and physics code (2x2 to 4x4): every
+ * operation is constexpr, loops over the compile-time dimensions are unrolled, and adding
+ * a 3x3 to a 4x4, or multiplying 3x2 by 3x2, does not compile.
+ */
+
+namespace mg
+{
+	namespace detail
+	{
+		template <typename F, int... I>
+		constexpr void unrollImpl(F &f, std::integer_sequence<int, I...>)
+		{
+			(f(I), ...);
+		}
+
+		/**
+		 * @brief Calls f(0), f(1), ..., f(N - 1) as straight-line code.
+		 */
+		template <int N, typename F>
+		constexpr void unroll(F &&f)
+		{
+			unrollImpl(f, std::make_integer_sequence<int, N>{});
+		}
+
+		/**
+		 * @brief Tells whether the current call is being evaluated at compile time.
+		 *
+		 * Lets constexpr functions switch to SIMD code at run time only.
+		 */
+		constexpr bool constantEvaluated()
+		{
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+			return __builtin_is_constant_evaluated();
+#else
+			return true;
+#endif
+		}
+
+#if defined(__GNUC__) || defined(__clang__)
+		/**
+		 * @brief 4x4 float product c = a * b on SIMD rows: row i of c is sum over k of a(i, k) * row k of b.
+		 */
+		inline void multiply4x4(const float *a, const float *b, float *c)
+		{
+			typedef float Row __attribute__((vector_size(16)));
+			Row rows[4], out[4];
+			__builtin_memcpy(rows, b, sizeof(rows));
+			for (int i = 0; i < 4; i++)
+			{
+				out[i] = a[i * 4] * rows[0] + a[i * 4 + 1] * rows[1] + a[i * 4 + 2] * rows[2] + a[i * 4 + 3] * rows[3];
+			}
+			__builtin_memcpy(c, out, sizeof(out));
+		}
+#endif
+
+		/**
+		 * @brief Storage alignment: 16 bytes when the matrix is a whole number of 16-byte SIMD lanes.
+		 */
+		template <typename T, int Count>
+		constexpr std::size_t fixedAlignment()
+		{
+			return (sizeof(T) * Count) % 16 == 0 && alignof(T) <= 16 ? 16 : alignof(T);
+		}
+	}
+
+	/**
+	 * @brief A matrix with compile-time dimensions, stored row-major inside the object.
+	 *
+	 * @tparam T The data type of the matrix elements.
+	 * @tparam R Number of rows.
+	 * @tparam C Number of columns.
+	 */
+	template <typename T, int R, int C>
+	class FixedMatrix
+	{
+		static_assert(R > 0 && C > 0, "FixedMatrix dimensions must be positive");
+
+	protected:
+		/**
+		 * @brief Row-major elements; element (i, j) lives at i * C + j.
+		 */
+		alignas(detail::fixedAlignment<T, R * C>()) T m_data[R * C];
+
+	public:
+		/**
+		 * @brief The element type.
+		 */
+		using value_type = T;
+
+		/**
+		 * @brief The dimensions, available at compile time.
+		 */
+		static constexpr int rows = R;
+		static constexpr int cols = C;
+
+		/**
+		 * @brief Constructs a matrix with all elements value-initialized (zero for arithmetic types).
+		 */
+		constexpr FixedMatrix() : m_data{} {}
+
+		/**
+		 * @brief Constructs a matrix with all elements set to one value.
+		 *
+		 * @param initialValue Initial value for all elements.
+		 */
+		constexpr explicit FixedMatrix(const T &initialValue) : m_data{}
+		{
+			detail::unroll<R * C>([&](int k)
+								  { m_data[k] = initialValue; });
+		}
+
+		/**
+		 * @brief Constructs a matrix from nested braces, e.g. FixedMatrix<int, 2, 2>({{1, 2}, {3, 4}}).
+		 *
+		 * Too many rows or columns fail to compile; missing trailing ones are zero.
+		 *
+		 * @param values The elements, row by row.
+		 */
+		constexpr FixedMatrix(const T (&values)[R][C]) : m_data{}
+		{
+			detail::unroll<R * C>([&](int k)
+								  { m_data[k] = values[k / C][k % C]; });
+		}
+
+		/**
+		 * @brief Converts a dynamic matrix, view or expression.
+		 *
+		 * @param expr The source; must be R x C.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		template <typename E>
+		explicit FixedMatrix(const MatrixExpr<E> &expr) : m_data{}
+		{
+			static_assert(std::is_same<typename E::value_type, T>::value, "Element types must match");
+			if (expr.self().getRows() != R || expr.self().getCols() != C)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			Matrix<T> scratch;
+			const MatrixView<const T> source = detail::operandView(expr.self(), scratch);
+			for (int k = 0; k < R * C; k++)
+			{
+				m_data[k] = source.coeff(k / C, k % C);
+			}
+		}
+
+		/**
+		 * @brief Copies the elements into a dynamic matrix.
+		 *
+		 * @return An R x C Matrix.
+		 */
+		Matrix<T> toMatrix() const
+		{
+			return Matrix<T>(view());
+		}
+
+		/**
+		 * @brief Copies the elements into a dynamic matrix.
+		 */
+		explicit operator Matrix<T>() const
+		{
+			return toMatrix();
+		}
+
+		/**
+		 * @brief Views the elements as a dynamic matrix, so they can take part in Matrix expressions.
+		 *
+		 * @return A view writing through to this matrix.
+		 */
+		MatrixView<T> view()
+		{
+			return MatrixView<T>(m_data, R, C, C);
+		}
+
+		/**
+		 * @brief Views the elements as a dynamic matrix (const version).
+		 *
+		 * @return A read-only view of this matrix.
+		 */
+		MatrixView<const T> view() const
+		{
+			return MatrixView<const T>(m_data, R, C, C);
+		}
+
+		constexpr int getRows() const
+		{
+			return R;
+		}
+
+		constexpr int getCols() const
+		{
+			return C;
+		}
+
+		constexpr T *data()
+		{
+			return m_data;
+		}
+
+		constexpr const T *data() const
+		{
+			return m_data;
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, checking the indices only if MG_BOUNDS_CHECK is on.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Reference to the element at the specified position.
+		 * @throws std::out_of_range If bounds checking is on and the indices are out of bounds.
+		 */
+		constexpr T &operator()(int i, int j)
+		{
+			if constexpr (BOUNDS_CHECK)
+			{
+				detail::checkIndex(i, j, R, C);
+			}
+			return m_data[i * C + j];
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, checking the indices only if MG_BOUNDS_CHECK is on (const version).
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Const reference to the element at the specified position.
+		 * @throws std::out_of_range If bounds checking is on and the indices are out of bounds.
+		 */
+		constexpr const T &operator()(int i, int j) const
+		{
+			if constexpr (BOUNDS_CHECK)
+			{
+				detail::checkIndex(i, j, R, C);
+			}
+			return m_data[i * C + j];
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, always checking the indices.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		constexpr T &at(int i, int j)
+		{
+			detail::checkIndex(i, j, R, C);
+			return m_data[i * C + j];
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, always checking the indices (const version).
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		constexpr const T &at(int i, int j) const
+		{
+			detail::checkIndex(i, j, R, C);
+			return m_data[i * C + j];
+		}
+
+		/**
+		 * @brief Reads an element without bounds checking.
+		 */
+		constexpr const T &coeff(int i, int j) const
+		{
+			return m_data[i * C + j];
+		}
+
+		/**
+		 * @brief Accesses an element without bounds checking.
+		 */
+		constexpr T &coeffRef(int i, int j)
+		{
+			return m_data[i * C + j];
+		}
+
+		/**
+		 * @brief Gets a pointer to the C contiguous elements of row i (not checked).
+		 */
+		constexpr T *rowPtr(int i)
+		{
+			return m_data + i * C;
+		}
+
+		/**
+		 * @brief Gets a pointer to the C contiguous elements of row i (not checked; const version).
+		 */
+		constexpr const T *rowPtr(int i) const
+		{
+			return m_data + i * C;
+		}
+
+		/**
+		 * @brief Returns an R x R identity matrix.
+		 */
+		static constexpr FixedMatrix identity()
+		{
+			static_assert(R == C, "Identity matrix must be square");
+			FixedMatrix result;
+			detail::unroll<R>([&](int i)
+							  { result.m_data[i * C + i] = T(1); });
+			return result;
+		}
+
+		constexpr FixedMatrix operator+(const FixedMatrix &other) const
+		{
+			FixedMatrix result;
+			detail::unroll<R * C>([&](int k)
+								  { result.m_data[k] = m_data[k] + other.m_data[k]; });
+			return result;
+		}
+
+		constexpr FixedMatrix operator-(const FixedMatrix &other) const
+		{
+			FixedMatrix result;
+			detail::unroll<R * C>([&](int k)
+								  { result.m_data[k] = m_data[k] - other.m_data[k]; });
+			return result;
+		}
+
+		constexpr FixedMatrix operator*(const T &scalar) const
+		{
+			FixedMatrix result;
+			detail::unroll<R * C>([&](int k)
+								  { result.m_data[k] = m_data[k] * scalar; });
+			return result;
+		}
+
+		/**
+		 * @brief Multiplies two matrices; an inner-dimension mismatch does not compile.
+		 *
+		 * Fully unrolled. At run time a 4x4 float product is done on 4-wide SIMD rows
+		 * (each result row is a linear combination of the rows of other).
+		 *
+		 * @tparam K Number of columns of the right operand.
+		 * @param other The right operand, C x K.
+		 * @return The R x K product.
+		 */
+		template <int K>
+		constexpr FixedMatrix<T, R, K> operator*(const FixedMatrix<T, C, K> &other) const
+		{
+			FixedMatrix<T, R, K> result;
+#if defined(__GNUC__) || defined(__clang__)
+			if constexpr (std::is_same<T, float>::value && R == 4 && C == 4 && K == 4)
+			{
+				if (!detail::constantEvaluated())
+				{
+					detail::multiply4x4(m_data, other.data(), result.data());
+					return result;
+				}
+			}
+#endif
+			detail::unroll<R * K>([&](int n)
+								  {
+									  const int i = n / K;
+									  const int j = n % K;
+									  T sum = T();
+									  detail::unroll<C>([&](int k)
+														{ sum += m_data[i * C + k] * other.coeff(k, j); });
+									  result.data()[n] = sum; });
+			return result;
+		}
+
+		constexpr FixedMatrix &operator+=(const FixedMatrix &other)
+		{
+			detail::unroll<R * C>([&](int k)
+								  { m_data[k] += other.m_data[k]; });
+			return *this;
+		}
+
+		constexpr FixedMatrix &operator-=(const FixedMatrix &other)
+		{
+			detail::unroll<R * C>([&](int k)
+								  { m_data[k] -= other.m_data[k]; });
+			return *this;
+		}
+
+		constexpr FixedMatrix &operator*=(const FixedMatrix &other)
+		{
+			static_assert(R == C, "In-place product needs a square matrix");
+			return *this = *this * other;
+		}
+
+		constexpr FixedMatrix &operator*=(const T &scalar)
+		{
+			detail::unroll<R * C>([&](int k)
+								  { m_data[k] *= scalar; });
+			return *this;
+		}
+
+		/**
+		 * @brief Transposes the matrix.
+		 *
+		 * @return The C x R transpose.
+		 */
+		constexpr FixedMatrix<T, C, R> transpose() const
+		{
+			FixedMatrix<T, C, R> result;
+			detail::unroll<R * C>([&](int k)
+								  { result.data()[(k % C) * R + k / C] = m_data[k]; });
+			return result;
+		}
+
+		/**
+		 * @brief Computes the determinant; a non-square matrix does not compile.
+		 *
+		 * Closed form (constexpr) up to 4x4. Larger sizes fall back, at run time, to the same
+		 * algorithms as SquareMatrix: exact Bareiss elimination for integers, LU otherwise.
+		 *
+		 * @return The determinant.
+		 */
+		constexpr T determinant() const
+		{
+			static_assert(R == C, "Determinant needs a square matrix");
+			const T *a = m_data;
+			if constexpr (R == 1)
+			{
+				return a[0];
+			}
+			else if constexpr (R == 2)
+			{
+				return a[0] * a[3] - a[1] * a[2];
+			}
+			else if constexpr (R == 3)
+			{
+				return a[0] * (a[4] * a[8] - a[5] * a[7]) - a[1] * (a[3] * a[8] - a[5] * a[6]) + a[2] * (a[3] * a[7] - a[4] * a[6]);
+			}
+			else if constexpr (R == 4)
+			{
+				// 2x2 minors of the top two rows (s) and bottom two rows (c)
+				const T s0 = a[0] * a[5] - a[4] * a[1];
+				const T s1 = a[0] * a[6] - a[4] * a[2];
+				const T s2 = a[0] * a[7] - a[4] * a[3];
+				const T s3 = a[1] * a[6] - a[5] * a[2];
+				const T s4 = a[1] * a[7] - a[5] * a[3];
+				const T s5 = a[2] * a[7] - a[6] * a[3];
+				const T c5 = a[10] * a[15] - a[14] * a[11];
+				const T c4 = a[9] * a[15] - a[13] * a[11];
+				const T c3 = a[9] * a[14] - a[13] * a[10];
+				const T c2 = a[8] * a[15] - a[12] * a[11];
+				const T c1 = a[8] * a[14] - a[12] * a[10];
+				const T c0 = a[8] * a[13] - a[12] * a[9];
+				return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			}
+			else if constexpr (std::is_integral<T>::value)
+			{
+				return determinantBareiss(toMatrix());
+			}
+			else
+			{
+				return LU<T>(toMatrix()).determinant();
+			}
+		}
+
+		/**
+		 * @brief Computes the inverse; a non-square or integer matrix does not compile.
+		 *
+		 * Closed form (adjugate over determinant, constexpr) up to 4x4, LU for larger sizes.
+		 *
+		 * @return The inverse matrix.
+		 * @throws std::runtime_error If the matrix is singular.
+		 */
+		constexpr FixedMatrix inverse() const
+		{
+			static_assert(R == C, "Inverse needs a square matrix");
+			static_assert(!std::is_integral<T>::value, "Inverse needs a field type; convert integer matrices to floating point");
+			if constexpr (R > 4)
+			{
+				return FixedMatrix(LU<T>(toMatrix()).inverse());
+			}
+			else
+			{
+				const T *a = m_data;
+				FixedMatrix result;
+				T *r = result.m_data;
+				T det = T();
+				if constexpr (R == 1)
+				{
+					det = a[0];
+					r[0] = T(1);
+				}
+				else if constexpr (R == 2)
+				{
+					det = a[0] * a[3] - a[1] * a[2];
+					r[0] = a[3];
+					r[1] = -a[1];
+					r[2] = -a[2];
+					r[3] = a[0];
+				}
+				else if constexpr (R == 3)
+				{
+					r[0] = a[4] * a[8] - a[5] * a[7];
+					r[1] = a[2] * a[7] - a[1] * a[8];
+					r[2] = a[1] * a[5] - a[2] * a[4];
+					r[3] = a[5] * a[6] - a[3] * a[8];
+					r[4] = a[0] * a[8] - a[2] * a[6];
+					r[5] = a[2] * a[3] - a[0] * a[5];
+					r[6] = a[3] * a[7] - a[4] * a[6];
+					r[7] = a[1] * a[6] - a[0] * a[7];
+					r[8] = a[0] * a[4] - a[1] * a[3];
+					det = a[0] * r[0] + a[1] * r[3] + a[2] * r[6];
+				}
+				else
+				{
+					const T s0 = a[0] * a[5] - a[4] * a[1];
+					const T s1 = a[0] * a[6] - a[4] * a[2];
+					const T s2 = a[0] * a[7] - a[4] * a[3];
+					const T s3 = a[1] * a[6] - a[5] * a[2];
+					const T s4 = a[1] * a[7] - a[5] * a[3];
+					const T s5 = a[2] * a[7] - a[6] * a[3];
+					const T c5 = a[10] * a[15] - a[14] * a[11];
+					const T c4 = a[9] * a[15] - a[13] * a[11];
+					const T c3 = a[9] * a[14] - a[13] * a[10];
+					const T c2 = a[8] * a[15] - a[12] * a[11];
+					const T c1 = a[8] * a[14] - a[12] * a[10];
+					const T c0 = a[8] * a[13] - a[12] * a[9];
+					det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+					r[0] = a[5] * c5 - a[6] * c4 + a[7] * c3;
+					r[1] = -a[1] * c5 + a[2] * c4 - a[3] * c3;
+					r[2] = a[13] * s5 - a[14] * s4 + a[15] * s3;
+					r[3] = -a[9] * s5 + a[10] * s4 - a[11] * s3;
+					r[4] = -a[4] * c5 + a[6] * c2 - a[7] * c1;
+					r[5] = a[0] * c5 - a[2] * c2 + a[3] * c1;
+					r[6] = -a[12] * s5 + a[14] * s2 - a[15] * s1;
+					r[7] = a[8] * s5 - a[10] * s2 + a[11] * s1;
+					r[8] = a[4] * c4 - a[5] * c2 + a[7] * c0;
+					r[9] = -a[0] * c4 + a[1] * c2 - a[3] * c0;
+					r[10] = a[12] * s4 - a[13] * s2 + a[15] * s0;
+					r[11] = -a[8] * s4 + a[9] * s2 - a[11] * s0;
+					r[12] = -a[4] * c3 + a[5] * c1 - a[6] * c0;
+					r[13] = a[0] * c3 - a[1] * c1 + a[2] * c0;
+					r[14] = -a[12] * s3 + a[13] * s1 - a[14] * s0;
+					r[15] = a[8] * s3 - a[9] * s1 + a[10] * s0;
+				}
+				if (det == T())
+				{
+					throw std::runtime_error("Matrix is singular");
+				}
+				const T scale = T(1) / det;
+				detail::unroll<R * C>([&](int k)
+									  { r[k] *= scale; });
+				return result;
+			}
+		}
+
+		constexpr bool operator==(const FixedMatrix &other) const
+		{
+			for (int k = 0; k < R * C; k++)
+			{
+				if (!(m_data[k] == other.m_data[k]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		constexpr bool operator!=(const FixedMatrix &other) const
+		{
+			return !(*this == other);
+		}
+
+		/**
+		 * @brief Prints the matrix to an output stream.
+		 */
+		friend std::ostream &operator<<(std::ostream &os, const FixedMatrix &matrix)
+		{
+			for (int i = 0; i < R; i++)
+			{
+				for (int j = 0; j < C; j++)
+				{
+					os << matrix.coeff(i, j) << " ";
+				}
+				os << '\n';
+			}
+			return os;
+		}
+	};
+
+	/**
+	 * @brief Square fixed-size matrix; identity(), determinant() and inverse() are available on it.
+	 */
+	template <typename T, int N>
+	using FixedSquareMatrix = FixedMatrix<T, N, N>;
+}
@@ -0,0 +1,462 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "parallel.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define MG_GEMM_AVX2 1
+#endif
+
+/**
+ * @brief Cache-blocked, register-tiled general matrix multiply used by Matrix::operator*.
+ *
+ * The loop structure follows the usual GotoBLAS layout: C is split into NC-wide column
+ * panels (sized for L3), the K dimension into KC-deep slabs whose packed B panel stays in L3
+ * and whose packed A block (MC x KC) stays in L2, and every MR x NR tile of C is produced by a
+ * micro-kernel that keeps its accumulators in registers while streaming one MR-row sliver of A
+ * and one NR-column sliver of B (the latter sized for L1).
+ *
+ * Within each KC slab the (MC block of rows) x (group of NR slivers) tiles are independent and
+ * are distributed over the thread pool; each thread packs its own A block.
+ */
+
+namespace mg
+{
+	namespace detail
+	{
+		/**
+		 * @brief Blocking parameters for the generic GEMM path.
+		 *
+		 * @tparam T The element type.
+		 */
+		template <typename T>
+		struct GemmBlocking
+		{
+			static constexpr int MR = 4;
+			static constexpr int NR = 4;
+			static constexpr int MC = 64;
+			static constexpr int KC = 256;
+			static constexpr int NC = 1024;
+		};
+
+		/**
+		 * @brief Blocking parameters for float: 6x16 tile = 12 ymm accumulators.
+		 */
+		template <>
+		struct GemmBlocking<float>
+		{
+			static constexpr int MR = 6;
+			static constexpr int NR = 16;
+			static constexpr int MC = 168;
+			static constexpr int KC = 256;
+			static constexpr int NC = 4096;
+		};
+
+		/**
+		 * @brief Blocking parameters for double: 6x8 tile = 12 ymm accumulators.
+		 */
+		template <>
+		struct GemmBlocking<double>
+		{
+			static constexpr int MR = 6;
+			static constexpr int NR = 8;
+			static constexpr int MC = 96;
+			static constexpr int KC = 256;
+			static constexpr int NC = 4096;
+		};
+
+		/**
+		 * @brief Blocking parameters for 32-bit integers: 6x16 tile = 12 ymm accumulators.
+		 */
+		template <>
+		struct GemmBlocking<std::int32_t>
+		{
+			static constexpr int MR = 6;
+			static constexpr int NR = 16;
+			static constexpr int MC = 168;
+			static constexpr int KC = 256;
+			static constexpr int NC = 4096;
+		};
+
+		/**
+		 * @brief Products with fewer multiply-adds than this skip packing and use a plain i-k-j loop.
+		 */
+		constexpr long long GEMM_SMALL_THRESHOLD = 32 * 32 * 32;
+
+		/**
+		 * @brief Packs an mc x kc block of A into MR-row slivers, zero-padding the last sliver.
+		 *
+		 * Sliver s holds rows [s * MR, s * MR + MR) stored column by column, so the micro-kernel
+		 * reads MR consecutive values per step of k.
+		 */
+		template <typename T, int MR>
+		void packA(int mc, int kc, const T *a, int lda, T *buf)
+		{
+			for (int ir = 0; ir < mc; ir += MR)
+			{
+				int rows = std::min(MR, mc - ir);
+				for (int p = 0; p < kc; p++)
+				{
+					for (int r = 0; r < rows; r++)
+					{
+						buf[r] = a[static_cast<std::size_t>(ir + r) * lda + p];
+					}
+					for (int r = rows; r < MR; r++)
+					{
+						buf[r] = T();
+					}
+					buf += MR;
+				}
+			}
+		}
+
+		/**
+		 * @brief Packs a kc x nc panel of B into NR-column slivers, zero-padding the last sliver.
+		 *
+		 * Sliver s holds columns [s * NR, s * NR + NR) stored row by row, so the micro-kernel
+		 * reads NR consecutive values per step of k.
+		 */
+		template <typename T, int NR>
+		void packB(int kc, int nc, const T *b, int ldb, T *buf)
+		{
+			for (int jr = 0; jr < nc; jr += NR)
+			{
+				int cols = std::min(NR, nc - jr);
+				for (int p = 0; p < kc; p++)
+				{
+					const T *src = b + static_cast<std::size_t>(p) * ldb + jr;
+					for (int c = 0; c < cols; c++)
+					{
+						buf[c] = src[c];
+					}
+					for (int c = cols; c < NR; c++)
+					{
+						buf[c] = T();
+					}
+					buf += NR;
+				}
+			}
+		}
+
+		/**
+		 * @brief Writes an MR x NR accumulator tile back to C, clipped to mr x nr.
+		 */
+		template <typename T, int MR, int NR>
+		void storeTile(const T (&acc)[MR][NR], T *c, int ldc, int mr, int nr, bool accumulate)
+		{
+			for (int i = 0; i < mr; i++)
+			{
+				T *row = c + static_cast<std::size_t>(i) * ldc;
+				for (int j = 0; j < nr; j++)
+				{
+					row[j] = accumulate ? row[j] + acc[i][j] : acc[i][j];
+				}
+			}
+		}
+
+		/**
+		 * @brief Portable micro-kernel; the fixed-size accumulator lets the compiler keep it in registers.
+		 */
+		template <typename T, int MR, int NR>
+		struct MicroKernel
+		{
+			static void run(int kc, const T *a, const T *b, T *c, int ldc, int mr, int nr, bool accumulate)
+			{
+				T acc[MR][NR];
+				for (int i = 0; i < MR; i++)
+				{
+					for (int j = 0; j < NR; j++)
+					{
+						acc[i][j] = T();
+					}
+				}
+				for (int p = 0; p < kc; p++)
+				{
+					for (int i = 0; i < MR; i++)
+					{
+						const T ai = a[i];
+						for (int j = 0; j < NR; j++)
+						{
+							acc[i][j] += ai * b[j];
+						}
+					}
+					a += MR;
+					b += NR;
+				}
+				storeTile<T, MR, NR>(acc, c, ldc, mr, nr, accumulate);
+			}
+		};
+
+#ifdef MG_GEMM_AVX2
+		/**
+		 * @brief AVX2/FMA micro-kernel for double: 6 rows x 2 ymm.
+		 */
+		template <>
+		struct MicroKernel<double, 6, 8>
+		{
+			static void run(int kc, const double *a, const double *b, double *c, int ldc, int mr, int nr, bool accumulate)
+			{
+				__m256d acc[6][2];
+#pragma GCC unroll 6
+				for (int i = 0; i < 6; i++)
+				{
+					acc[i][0] = _mm256_setzero_pd();
+					acc[i][1] = _mm256_setzero_pd();
+				}
+				for (int p = 0; p < kc; p++)
+				{
+					__m256d b0 = _mm256_load_pd(b);
+					__m256d b1 = _mm256_load_pd(b + 4);
+#pragma GCC unroll 6
+					for (int i = 0; i < 6; i++)
+					{
+						__m256d ai = _mm256_broadcast_sd(a + i);
+						acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+						acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+					}
+					a += 6;
+					b += 8;
+				}
+				if (mr == 6 && nr == 8)
+				{
+#pragma GCC unroll 6
+					for (int i = 0; i < 6; i++)
+					{
+						double *row = c + static_cast<std::size_t>(i) * ldc;
+						if (accumulate)
+						{
+							acc[i][0] = _mm256_add_pd(acc[i][0], _mm256_loadu_pd(row));
+							acc[i][1] = _mm256_add_pd(acc[i][1], _mm256_loadu_pd(row + 4));
+						}
+						_mm256_storeu_pd(row, acc[i][0]);
+						_mm256_storeu_pd(row + 4, acc[i][1]);
+					}
+					return;
+				}
+				alignas(32) double tile[6][8];
+				for (int i = 0; i < 6; i++)
+				{
+					_mm256_store_pd(tile[i], acc[i][0]);
+					_mm256_store_pd(tile[i] + 4, acc[i][1]);
+				}
+				storeTile<double, 6, 8>(tile, c, ldc, mr, nr, accumulate);
+			}
+		};
+
+		/**
+		 * @brief AVX2/FMA micro-kernel for float: 6 rows x 2 ymm.
+		 */
+		template <>
+		struct MicroKernel<float, 6, 16>
+		{
+			static void run(int kc, const float *a, const float *b, float *c, int ldc, int mr, int nr, bool accumulate)
+			{
+				__m256 acc[6][2];
+#pragma GCC unroll 6
+				for (int i = 0; i < 6; i++)
+				{
+					acc[i][0] = _mm256_setzero_ps();
+					acc[i][1] = _mm256_setzero_ps();
+				}
+				for (int p = 0; p < kc; p++)
+				{
+					__m256 b0 = _mm256_load_ps(b);
+					__m256 b1 = _mm256_load_ps(b + 8);
+#pragma GCC unroll 6
+					for (int i = 0; i < 6; i++)
+					{
+						__m256 ai = _mm256_broadcast_ss(a + i);
+						acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+						acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+					}
+					a += 6;
+					b += 16;
+				}
+				if (mr == 6 && nr == 16)
+				{
+#pragma GCC unroll 6
+					for (int i = 0; i < 6; i++)
+					{
+						float *row = c + static_cast<std::size_t>(i) * ldc;
+						if (accumulate)
+						{
+							acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+							acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+						}
+						_mm256_storeu_ps(row, acc[i][0]);
+						_mm256_storeu_ps(row + 8, acc[i][1]);
+					}
+					return;
+				}
+				alignas(32) float tile[6][16];
+				for (int i = 0; i < 6; i++)
+				{
+					_mm256_store_ps(tile[i], acc[i][0]);
+					_mm256_store_ps(tile[i] + 8, acc[i][1]);
+				}
+				storeTile<float, 6, 16>(tile, c, ldc, mr, nr, accumulate);
+			}
+		};
+
+		/**
+		 * @brief AVX2 micro-kernel for 32-bit integers: 6 rows x 2 ymm.
+		 */
+		template <>
+		struct MicroKernel<std::int32_t, 6, 16>
+		{
+			static void run(int kc, const std::int32_t *a, const std::int32_t *b, std::int32_t *c, int ldc, int mr, int nr, bool accumulate)
+			{
+				__m256i acc[6][2];
+#pragma GCC unroll 6
+				for (int i = 0; i < 6; i++)
+				{
+					acc[i][0] = _mm256_setzero_si256();
+					acc[i][1] = _mm256_setzero_si256();
+				}
+				for (int p = 0; p < kc; p++)
+				{
+					__m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(b));
+					__m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(b + 8));
+#pragma GCC unroll 6
+					for (int i = 0; i < 6; i++)
+					{
+						__m256i ai = _mm256_set1_epi32(a[i]);
+						acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_mullo_epi32(ai, b0));
+						acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_mullo_epi32(ai, b1));
+					}
+					a += 6;
+					b += 16;
+				}
+				alignas(32) std::int32_t tile[6][16];
+				for (int i = 0; i < 6; i++)
+				{
+					_mm256_store_si256(reinterpret_cast<__m256i *>(tile[i]), acc[i][0]);
+					_mm256_store_si256(reinterpret_cast<__m256i *>(tile[i] + 8), acc[i][1]);
+				}
+				storeTile<std::int32_t, 6, 16>(tile, c, ldc, mr, nr, accumulate);
+			}
+		};
+#endif
+
+		/**
+		 * @brief Unblocked i-k-j product for operands too small to amortize packing.
+		 */
+		template <typename T>
+		void gemmSmall(int m, int n, int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, bool accumulate)
+		{
+			for (int i = 0; i < m; i++)
+			{
+				T *ci = c + static_cast<std::size_t>(i) * ldc;
+				if (!accumulate)
+				{
+					std::fill(ci, ci + n, T());
+				}
+				const T *ai = a + static_cast<std::size_t>(i) * lda;
+				for (int p = 0; p < k; p++)
+				{
+					const T aip = ai[p];
+					const T *bp = b + static_cast<std::size_t>(p) * ldb;
+					for (int j = 0; j < n; j++)
+					{
+						ci[j] += aip * bp[j];
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Computes C = A * B, or C += A * B when accumulate is set, on row-major strided buffers.
+	 *
+	 * @tparam T The element type.
+	 * @param m Number of rows of A and C.
+	 * @param n Number of columns of B and C.
+	 * @param k Number of columns of A and rows of B.
+	 * @param a Pointer to A; row i starts at a + i * lda.
+	 * @param lda Leading dimension of A.
+	 * @param b Pointer to B; row i starts at b + i * ldb.
+	 * @param ldb Leading dimension of B.
+	 * @param c Pointer to C; row i starts at c + i * ldc. Must not alias A or B.
+	 * @param ldc Leading dimension of C.
+	 * @param accumulate Adds the product to the existing contents of C instead of overwriting them.
+	 */
+	template <typename T>
+	void gemm(int m, int n, int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, bool accumulate = false)
+	{
+		using Blocking = detail::GemmBlocking<T>;
+		constexpr int MR = Blocking::MR;
+		constexpr int NR = Blocking::NR;
+		constexpr int MC = Blocking::MC;
+		constexpr int KC = Blocking::KC;
+		constexpr int NC = Blocking::NC;
+
+		if (m <= 0 || n <= 0)
+		{
+			return;
+		}
+		if (k <= 0 || static_cast<long long>(m) * n * k < detail::GEMM_SMALL_THRESHOLD)
+		{
+			detail::gemmSmall(m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+			return;
+		}
+
+		const int ncMax = std::min(NC, (n + NR - 1) / NR * NR);
+		const int kcMax = std::min(KC, k);
+		std::vector<T, AlignedAllocator<T>> packedB(static_cast<std::size_t>(ncMax) * kcMax);
+		const unsigned threads = exec::currentPolicy().mode == exec::Mode::Parallel ? ThreadPool::global().concurrency() : 1;
+
+		for (int jc = 0; jc < n; jc += NC)
+		{
+			const int nc = std::min(NC, n - jc);
+			const int slivers = (nc + NR - 1) / NR;
+			for (int pc = 0; pc < k; pc += KC)
+			{
+				const int kc = std::min(KC, k - pc);
+				const bool acc = accumulate || pc > 0;
+				const T *bPanel = b + static_cast<std::size_t>(pc) * ldb + jc;
+				parallelFor(0, slivers, grainFor(static_cast<std::size_t>(kc) * NR), [&](std::size_t lo, std::size_t hi)
+							{
+								const int first = static_cast<int>(lo) * NR;
+								const int cols = std::min(nc, static_cast<int>(hi) * NR) - first;
+								detail::packB<T, NR>(kc, cols, bPanel + first, ldb, packedB.data() + static_cast<std::size_t>(first) * kc);
+							});
+
+				// Split the columns into groups only when there are too few row blocks to go around
+				const int rowBlocks = (m + MC - 1) / MC;
+				const int colGroups = std::max(1, std::min(slivers, static_cast<int>((2 * threads + rowBlocks - 1) / rowBlocks)));
+				const int sliversPerGroup = (slivers + colGroups - 1) / colGroups;
+				const std::size_t tileWork = static_cast<std::size_t>(std::min(MC, m)) * kc * sliversPerGroup * NR;
+
+				parallelFor(0, static_cast<std::size_t>(rowBlocks) * colGroups, grainFor(tileWork), [&](std::size_t lo, std::size_t hi)
+							{
+								thread_local std::vector<T, AlignedAllocator<T>> packedA;
+								packedA.resize(static_cast<std::size_t>(MC) * KC);
+								for (std::size_t task = lo; task < hi; task++)
+								{
+									const int ic = static_cast<int>(task / colGroups) * MC;
+									const int mc = std::min(MC, m - ic);
+									const int jrBegin = static_cast<int>(task % colGroups) * sliversPerGroup * NR;
+									const int jrEnd = std::min(nc, jrBegin + sliversPerGroup * NR);
+									detail::packA<T, MR>(mc, kc, a + static_cast<std::size_t>(ic) * lda + pc, lda, packedA.data());
+
+									for (int jr = jrBegin; jr < jrEnd; jr += NR)
+									{
+										const T *bSliver = packedB.data() + static_cast<std::size_t>(jr) * kc;
+										for (int ir = 0; ir < mc; ir += MR)
+										{
+											const T *aSliver = packedA.data() + static_cast<std::size_t>(ir) * kc;
+											T *cTile = c + static_cast<std::size_t>(ic + ir) * ldc + jc + jr;
+											detail::MicroKernel<T, MR, NR>::run(kc, aSliver, bSliver, cTile, ldc,
+																				std::min(MR, mc - ir), std::min(NR, nc - jr), acc);
+										}
+									}
+								} });
+			}
+		}
+	}
+}
@@ -0,0 +1,424 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+
+#if defined(__F16C__) && defined(__AVX__)
+#include <immintrin.h>
+#define MG_F16C 1
+#endif
+
+/**
+ * @brief Low-precision element types and widened accumulation.
+ *
+ * half (IEEE 754 binary16) and bfloat16 are 16-bit storage types: arithmetic on them is done in
+ * float, and results are rounded back to nearest-even when stored. Together with std::int8_t
+ * they halve or quarter the memory and bandwidth of a matrix. Products of such matrices
+ * accumulate in Accumulator<T> (float for the 16-bit types, std::int32_t for 8-bit integers)
+ * and are only rounded or saturated once, when the result is stored.
+ */
+
+namespace mg
+{
+	namespace detail
+	{
+		inline std::uint32_t floatBits(float f)
+		{
+			std::uint32_t bits;
+			std::memcpy(&bits, &f, sizeof(f));
+			return bits;
+		}
+
+		inline float bitsFloat(std::uint32_t bits)
+		{
+			float f;
+			std::memcpy(&f, &bits, sizeof(f));
+			return f;
+		}
+
+		/**
+		 * @brief Rounds a float to the nearest binary16 value, ties to even; handles subnormals, infinities and NaN.
+		 */
+		inline std::uint16_t floatToHalf(float f)
+		{
+			std::uint32_t x = floatBits(f);
+			const std::uint32_t sign = (x >> 16) & 0x8000u;
+			x &= 0x7FFFFFFFu;
+			std::uint32_t h;
+			if (x >= 0x47800000u) // Too large for binary16, infinity or NaN
+			{
+				h = x > 0x7F800000u ? 0x7E00u : 0x7C00u;
+			}
+			else if (x < 0x38800000u) // Subnormal or zero: let the FPU round the shifted mantissa
+			{
+				h = floatBits(bitsFloat(x) + 0.5f) - 0x3F000000u;
+			}
+			else
+			{
+				const std::uint32_t odd = (x >> 13) & 1u;
+				x += 0xC8000FFFu + odd; // Rebias the exponent by -112 and round to nearest even
+				h = x >> 13;
+			}
+			return static_cast<std::uint16_t>(h | sign);
+		}
+
+		/**
+		 * @brief Widens a binary16 value to float exactly.
+		 */
+		inline float halfToFloat(std::uint16_t h)
+		{
+			constexpr std::uint32_t SHIFTED_EXPONENT = 0x7C00u << 13;
+			std::uint32_t x = (h & 0x7FFFu) << 13;
+			const std::uint32_t exponent = x & SHIFTED_EXPONENT;
+			x += (127 - 15) << 23;
+			if (exponent == SHIFTED_EXPONENT) // Infinity or NaN
+			{
+				x += (128 - 16) << 23;
+			}
+			else if (exponent == 0) // Subnormal or zero: renormalize through the FPU
+			{
+				x = floatBits(bitsFloat(x + (1u << 23)) - bitsFloat(113u << 23));
+			}
+			return bitsFloat(x | (static_cast<std::uint32_t>(h & 0x8000u) << 16));
+		}
+
+		/**
+		 * @brief Rounds a float to the nearest bfloat16 value, ties to even; NaN stays NaN.
+		 */
+		inline std::uint16_t floatToBfloat16(float f)
+		{
+			const std::uint32_t x = floatBits(f);
+			if ((x & 0x7FFFFFFFu) > 0x7F800000u)
+			{
+				return static_cast<std::uint16_t>((x >> 16) | 0x40u);
+			}
+			return static_cast<std::uint16_t>((x + 0x7FFFu + ((x >> 16) & 1u)) >> 16);
+		}
+
+		inline float bfloat16ToFloat(std::uint16_t b)
+		{
+			return bitsFloat(static_cast<std::uint32_t>(b) << 16);
+		}
+	}
+
+	/**
+	 * @brief IEEE 754 binary16: 1 sign bit, 5 exponent bits, 10 mantissa bits; about 3 decimal digits up to 65504.
+	 */
+	struct half
+	{
+		std::uint16_t bits;
+
+		half() = default;
+		half(float value) : bits(detail::floatToHalf(value)) {}
+		operator float() const { return detail::halfToFloat(bits); }
+
+		half &operator+=(float other) { return *this = half(static_cast<float>(*this) + other); }
+		half &operator-=(float other) { return *this = half(static_cast<float>(*this) - other); }
+		half &operator*=(float other) { return *this = half(static_cast<float>(*this) * other); }
+		half &operator/=(float other) { return *this = half(static_cast<float>(*this) / other); }
+
+		/**
+		 * @brief Makes a half from its bit pattern.
+		 */
+		static half fromBits(std::uint16_t bits)
+		{
+			half h;
+			h.bits = bits;
+			return h;
+		}
+	};
+
+	/**
+	 * @brief bfloat16: the upper half of a float; the range of float with about 2 decimal digits.
+	 */
+	struct bfloat16
+	{
+		std::uint16_t bits;
+
+		bfloat16() = default;
+		bfloat16(float value) : bits(detail::floatToBfloat16(value)) {}
+		operator float() const { return detail::bfloat16ToFloat(bits); }
+
+		bfloat16 &operator+=(float other) { return *this = bfloat16(static_cast<float>(*this) + other); }
+		bfloat16 &operator-=(float other) { return *this = bfloat16(static_cast<float>(*this) - other); }
+		bfloat16 &operator*=(float other) { return *this = bfloat16(static_cast<float>(*this) * other); }
+		bfloat16 &operator/=(float other) { return *this = bfloat16(static_cast<float>(*this) / other); }
+
+		/**
+		 * @brief Makes a bfloat16 from its bit pattern.
+		 */
+		static bfloat16 fromBits(std::uint16_t bits)
+		{
+			bfloat16 b;
+			b.bits = bits;
+			return b;
+		}
+	};
+
+	/**
+	 * @brief The type products and sums of T accumulate in: T itself unless it is a low-precision type.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	struct AccumulatorType
+	{
+		using type = T;
+	};
+
+	template <>
+	struct AccumulatorType<half>
+	{
+		using type = float;
+	};
+
+	template <>
+	struct AccumulatorType<bfloat16>
+	{
+		using type = float;
+	};
+
+	template <>
+	struct AccumulatorType<std::int8_t>
+	{
+		using type = std::int32_t;
+	};
+
+	template <>
+	struct AccumulatorType<std::uint8_t>
+	{
+		using type = std::int32_t;
+	};
+
+	template <typename T>
+	using Accumulator = typename AccumulatorType<T>::type;
+
+	/**
+	 * @brief Tells whether T is a 16-bit floating-point storage type.
+	 */
+	template <typename T>
+	struct IsHalfType : std::integral_constant<bool, std::is_same<T, half>::value || std::is_same<T, bfloat16>::value>
+	{
+	};
+
+	/**
+	 * @brief Converts one value to another element type.
+	 *
+	 * 16-bit floating-point types go through float. Integer targets saturate: out-of-range
+	 * values become the smallest or largest representable value, and floating-point values are
+	 * truncated toward zero as by static_cast (NaN becomes 0).
+	 *
+	 * @tparam To The target type.
+	 * @param value The value to convert.
+	 * @return The converted value.
+	 */
+	template <typename To, typename From>
+	To narrow(From value)
+	{
+		if constexpr (IsHalfType<From>::value)
+		{
+			return narrow<To>(static_cast<float>(value));
+		}
+		else if constexpr (IsHalfType<To>::value)
+		{
+			return To(static_cast<float>(value));
+		}
+		else if constexpr (std::is_integral<To>::value && std::is_floating_point<From>::value)
+		{
+			if (!(value == value))
+			{
+				return To();
+			}
+			if (value <= static_cast<From>(std::numeric_limits<To>::lowest()))
+			{
+				return std::numeric_limits<To>::lowest();
+			}
+			if (value >= static_cast<From>(std::numeric_limits<To>::max()))
+			{
+				return std::numeric_limits<To>::max();
+			}
+			return static_cast<To>(value);
+		}
+		else if constexpr (std::is_integral<To>::value && std::is_integral<From>::value)
+		{
+			constexpr bool WIDENS = std::is_signed<To>::value == std::is_signed<From>::value ? sizeof(To) >= sizeof(From)
+																							 : std::is_signed<To>::value && sizeof(To) > sizeof(From);
+			if constexpr (!WIDENS)
+			{
+				if constexpr (std::is_signed<From>::value)
+				{
+					if (value < 0)
+					{
+						return static_cast<long long>(value) < static_cast<long long>(std::numeric_limits<To>::lowest()) ? std::numeric_limits<To>::lowest() : static_cast<To>(value);
+					}
+				}
+				if (static_cast<unsigned long long>(value) > static_cast<unsigned long long>(std::numeric_limits<To>::max()))
+				{
+					return std::numeric_limits<To>::max();
+				}
+			}
+			return static_cast<To>(value);
+		}
+		else
+		{
+			return static_cast<To>(value);
+		}
+	}
+
+	namespace detail
+	{
+		/**
+		 * @brief Converts n contiguous elements with narrow(); uses F16C for half <-> float when available.
+		 */
+		template <typename From, typename To>
+		void convertElements(const From *in, To *out, std::size_t n)
+		{
+			std::size_t i = 0;
+#ifdef MG_F16C
+			if constexpr (std::is_same<From, half>::value && std::is_same<To, float>::value)
+			{
+				for (; i + 8 <= n; i += 8)
+				{
+					_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))));
+				}
+			}
+			else if constexpr (std::is_same<From, float>::value && std::is_same<To, half>::value)
+			{
+				for (; i + 8 <= n; i += 8)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+				}
+			}
+#endif
+			for (; i < n; i++)
+			{
+				out[i] = narrow<To>(in[i]);
+			}
+		}
+
+		/**
+		 * @brief Converts a rows x cols strided block into another, in parallel over the rows.
+		 */
+		template <typename From, typename To>
+		void convertBlock(int rows, int cols, const From *in, int ldin, To *out, int ldout)
+		{
+			parallelFor(0, rows, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								convertElements(in + i * ldin, out + i * ldout, cols);
+							} });
+		}
+
+		/**
+		 * @brief Computes C = A * B (or C += A * B) with the products summed in Acc.
+		 *
+		 * A and B are widened to Acc one block at a time (WIDEN_ROWS rows of C by WIDEN_DEPTH of
+		 * the inner dimension), multiplied by gemm<Acc>, and C is narrowed once per row block,
+		 * so the scratch stays bounded whatever the size of the product.
+		 */
+		template <typename Acc, typename TA, typename TB, typename TC>
+		void widenedGemm(int m, int n, int k, const TA *a, int lda, const TB *b, int ldb, TC *c, int ldc, bool accumulate)
+		{
+			constexpr int WIDEN_ROWS = 512;
+			constexpr int WIDEN_DEPTH = 256;
+			if (m <= 0 || n <= 0)
+			{
+				return;
+			}
+			const int rowsMax = std::min(WIDEN_ROWS, m);
+			const int depthMax = std::max(1, std::min(WIDEN_DEPTH, k));
+			std::vector<Acc, AlignedAllocator<Acc>> wideA(static_cast<std::size_t>(rowsMax) * depthMax);
+			std::vector<Acc, AlignedAllocator<Acc>> wideB(static_cast<std::size_t>(depthMax) * n);
+			std::vector<Acc, AlignedAllocator<Acc>> wideC(std::is_same<TC, Acc>::value ? 0 : static_cast<std::size_t>(rowsMax) * n);
+			for (int i0 = 0; i0 < m; i0 += WIDEN_ROWS)
+			{
+				const int rows = std::min(WIDEN_ROWS, m - i0);
+				Acc *cBlock;
+				int ldw;
+				if constexpr (std::is_same<TC, Acc>::value)
+				{
+					cBlock = c + static_cast<std::size_t>(i0) * ldc;
+					ldw = ldc;
+				}
+				else
+				{
+					cBlock = wideC.data();
+					ldw = n;
+					if (accumulate)
+					{
+						convertBlock(rows, n, c + static_cast<std::size_t>(i0) * ldc, ldc, cBlock, ldw);
+					}
+				}
+				if (k <= 0)
+				{
+					gemm<Acc>(rows, n, 0, nullptr, 0, nullptr, 0, cBlock, ldw, accumulate);
+				}
+				for (int p0 = 0; p0 < k; p0 += WIDEN_DEPTH)
+				{
+					const int depth = std::min(WIDEN_DEPTH, k - p0);
+					convertBlock(rows, depth, a + static_cast<std::size_t>(i0) * lda + p0, lda, wideA.data(), depth);
+					convertBlock(depth, n, b + static_cast<std::size_t>(p0) * ldb, ldb, wideB.data(), n);
+					gemm<Acc>(rows, n, depth, wideA.data(), depth, wideB.data(), n, cBlock, ldw, accumulate || p0 > 0);
+				}
+				if constexpr (!std::is_same<TC, Acc>::value)
+				{
+					convertBlock(rows, n, cBlock, ldw, c + static_cast<std::size_t>(i0) * ldc, ldc);
+				}
+			}
+		}
+	}
+}
+
+namespace std
+{
+	template <>
+	class numeric_limits<mg::half>
+	{
+	public:
+		static constexpr bool is_specialized = true;
+		static constexpr bool is_signed = true;
+		static constexpr bool is_integer = false;
+		static constexpr bool is_exact = false;
+		static constexpr bool has_infinity = true;
+		static constexpr bool has_quiet_NaN = true;
+		static constexpr int digits = 11;
+		static constexpr int max_exponent = 16;
+		static constexpr int min_exponent = -13;
+		static mg::half min() { return mg::half::fromBits(0x0400); }
+		static mg::half lowest() { return mg::half::fromBits(0xFBFF); }
+		static mg::half max() { return mg::half::fromBits(0x7BFF); }
+		static mg::half epsilon() { return mg::half::fromBits(0x1400); }
+		static mg::half infinity() { return mg::half::fromBits(0x7C00); }
+		static mg::half quiet_NaN() { return mg::half::fromBits(0x7E00); }
+	};
+
+	template <>
+	class numeric_limits<mg::bfloat16>
+	{
+	public:
+		static constexpr bool is_specialized = true;
+		static constexpr bool is_signed = true;
+		static constexpr bool is_integer = false;
+		static constexpr bool is_exact = false;
+		static constexpr bool has_infinity = true;
+		static constexpr bool has_quiet_NaN = true;
+		static constexpr int digits = 8;
+		static constexpr int max_exponent = 128;
+		static constexpr int min_exponent = -125;
+		static mg::bfloat16 min() { return mg::bfloat16::fromBits(0x0080); }
+		static mg::bfloat16 lowest() { return mg::bfloat16::fromBits(0xFF7F); }
+		static mg::bfloat16 max() { return mg::bfloat16::fromBits(0x7F7F); }
+		static mg::bfloat16 epsilon() { return mg::bfloat16::fromBits(0x3C00); }
+		static mg::bfloat16 infinity() { return mg::bfloat16::fromBits(0x7F80); }
+		static mg::bfloat16 quiet_NaN() { return mg::bfloat16::fromBits(0x7FC0); }
+	};
+}
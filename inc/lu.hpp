@@ -0,0 +1,579 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "matrix.hpp"
+#include "profile.hpp"
+
+/**
+ * @brief LU factorization with partial pivoting, and exact determinants for integer matrices.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Reusable LU factorization P * A = L * U of a square matrix.
+	 *
+	 * The factorization is blocked: each panel of LU_BLOCK columns is factored with partial
+	 * pivoting, the matching block row of U is obtained by a triangular solve, and the trailing
+	 * submatrix is updated with one GEMM call, so the O(n^3) work runs in the GEMM kernel.
+	 * Factor once, then call determinant(), solve() or inverse() as often as needed.
+	 *
+	 * Integer element types are rejected at compile time because the factors are not integral;
+	 * SquareMatrix<int>::determinant() uses exact fraction-free elimination instead.
+	 *
+	 * @tparam T The element type (float, double, std::complex, ...).
+	 */
+	template <typename T>
+	class LU
+	{
+		static_assert(!std::is_integral<T>::value, "LU needs a field type; convert integer matrices to floating point");
+
+	public:
+		/**
+		 * @brief Number of columns factored per panel.
+		 */
+		static constexpr int LU_BLOCK = 64;
+
+	private:
+		/**
+		 * @brief Packed factors: strictly lower part holds L (unit diagonal implied), upper part holds U.
+		 */
+		Matrix<T> m_lu;
+
+		/**
+		 * @brief Row k was swapped with row m_pivots[k] at step k.
+		 */
+		std::vector<int> m_pivots;
+
+		/**
+		 * @brief Sign of the permutation, +1 or -1.
+		 */
+		int m_sign;
+
+		/**
+		 * @brief Whether a zero pivot was met.
+		 */
+		bool m_singular;
+
+		/**
+		 * @brief Applies the row permutation to the rows of b in place.
+		 */
+		void permute(Matrix<T> &b) const
+		{
+			const int cols = b.getCols();
+			for (int k = 0; k < size(); k++)
+			{
+				if (m_pivots[k] != k)
+				{
+					T *r1 = b.data() + static_cast<std::size_t>(k) * b.getStride();
+					T *r2 = b.data() + static_cast<std::size_t>(m_pivots[k]) * b.getStride();
+					std::swap_ranges(r1, r1 + cols, r2);
+				}
+			}
+		}
+
+		/**
+		 * @brief Factors m_lu in place.
+		 */
+		void factor()
+		{
+			using std::abs;
+			const int n = m_lu.getRows();
+			const int ld = m_lu.getStride();
+			T *a = m_lu.data();
+			auto row = [&](int i)
+			{
+				return a + static_cast<std::size_t>(i) * ld;
+			};
+			std::vector<T, AlignedAllocator<T>> negU12;
+
+			for (int k0 = 0; k0 < n; k0 += LU_BLOCK)
+			{
+				const int kb = std::min(LU_BLOCK, n - k0);
+				const int kEnd = k0 + kb;
+
+				// Panel: unblocked elimination restricted to columns [k0, kEnd)
+				for (int k = k0; k < kEnd; k++)
+				{
+					int p = k;
+					auto best = abs(row(k)[k]);
+					for (int i = k + 1; i < n; i++)
+					{
+						auto v = abs(row(i)[k]);
+						if (v > best)
+						{
+							best = v;
+							p = i;
+						}
+					}
+					m_pivots[k] = p;
+					if (row(p)[k] == T())
+					{
+						m_singular = true;
+						continue;
+					}
+					if (p != k)
+					{
+						std::swap_ranges(row(k), row(k) + n, row(p));
+						m_sign = -m_sign;
+					}
+					const T *rk = row(k);
+					parallelFor(k + 1, n, grainFor(kEnd - k), [&](std::size_t lo, std::size_t hi)
+								{
+									for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+									{
+										T *ri = row(i);
+										ri[k] /= rk[k];
+										const T l = ri[k];
+										for (int j = k + 1; j < kEnd; j++)
+										{
+											ri[j] -= l * rk[j];
+										}
+									} });
+				}
+
+				if (kEnd == n)
+				{
+					break;
+				}
+				const int rest = n - kEnd;
+
+				// U12 = L11^-1 * A12, row by row, columns split across threads
+				parallelFor(0, rest, grainFor(static_cast<std::size_t>(kb) * kb / 2), [&](std::size_t lo, std::size_t hi)
+							{
+								for (int k = k0 + 1; k < kEnd; k++)
+								{
+									T *rk = row(k) + kEnd;
+									for (int i = k0; i < k; i++)
+									{
+										const T l = row(k)[i];
+										const T *ri = row(i) + kEnd;
+										for (std::size_t j = lo; j < hi; j++)
+										{
+											rk[j] -= l * ri[j];
+										}
+									}
+								} });
+
+				// A22 -= L21 * U12 as a single accumulating GEMM against -U12
+				negU12.resize(static_cast<std::size_t>(kb) * rest);
+				for (int k = 0; k < kb; k++)
+				{
+					const T *src = row(k0 + k) + kEnd;
+					T *dst = negU12.data() + static_cast<std::size_t>(k) * rest;
+					for (int j = 0; j < rest; j++)
+					{
+						dst[j] = -src[j];
+					}
+				}
+				gemm(rest, rest, kb, row(kEnd) + k0, ld, negU12.data(), rest, row(kEnd) + kEnd, ld, true);
+			}
+		}
+
+	public:
+		/**
+		 * @brief Factors a square matrix.
+		 *
+		 * @param matrix The matrix to factor.
+		 * @throws std::invalid_argument If the matrix is not square.
+		 */
+		explicit LU(const Matrix<T> &matrix) : m_lu(matrix), m_pivots(matrix.getRows()), m_sign(1), m_singular(false)
+		{
+			if (matrix.getRows() != matrix.getCols())
+			{
+				throw std::invalid_argument("Matrix must be square");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Factorize, size(), size());
+			factor();
+		}
+
+		/**
+		 * @brief Gets the order of the factored matrix.
+		 *
+		 * @return Number of rows (and columns).
+		 */
+		int size() const
+		{
+			return m_lu.getRows();
+		}
+
+		/**
+		 * @brief Tells whether the factored matrix is singular.
+		 *
+		 * @return True if a zero pivot was met.
+		 */
+		bool isSingular() const
+		{
+			return m_singular;
+		}
+
+		/**
+		 * @brief Gets the packed factors: L strictly below the diagonal (unit diagonal implied), U on and above it.
+		 *
+		 * @return The packed L\U matrix.
+		 */
+		const Matrix<T> &factors() const
+		{
+			return m_lu;
+		}
+
+		/**
+		 * @brief Gets the pivot sequence: at step k row k was swapped with row pivots()[k].
+		 *
+		 * @return The pivot indices.
+		 */
+		const std::vector<int> &pivots() const
+		{
+			return m_pivots;
+		}
+
+		/**
+		 * @brief Computes the determinant from the diagonal of U.
+		 *
+		 * @return The determinant of the factored matrix.
+		 */
+		T determinant() const
+		{
+			if (m_singular)
+			{
+				return T();
+			}
+			T det = m_sign < 0 ? T(-1) : T(1);
+			for (int i = 0; i < size(); i++)
+			{
+				det *= m_lu.coeff(i, i);
+			}
+			return det;
+		}
+
+		/**
+		 * @brief Solves A * X = B for any number of right-hand sides.
+		 *
+		 * @param b Right-hand sides, one per column.
+		 * @return The solution X.
+		 * @throws std::invalid_argument If b does not have size() rows.
+		 * @throws std::runtime_error If the matrix is singular.
+		 */
+		Matrix<T> solve(const Matrix<T> &b) const
+		{
+			if (b.getRows() != size())
+			{
+				throw std::invalid_argument("Right-hand side must have as many rows as the matrix");
+			}
+			if (m_singular)
+			{
+				throw std::runtime_error("Matrix is singular");
+			}
+
+			MG_PROFILE_SCOPE(profile::Op::Solve, size(), b.getCols());
+			Matrix<T> x(b);
+			permute(x);
+
+			const int n = size();
+			const int cols = x.getCols();
+			auto xrow = [&](int i)
+			{
+				return x.data() + static_cast<std::size_t>(i) * x.getStride();
+			};
+
+			// Right-hand sides are independent; split their columns across threads
+			parallelFor(0, cols, grainFor(static_cast<std::size_t>(n) * n), [&](std::size_t lo, std::size_t hi)
+						{
+							// Forward substitution with unit lower L
+							for (int i = 1; i < n; i++)
+							{
+								T *xi = xrow(i);
+								for (int k = 0; k < i; k++)
+								{
+									const T l = m_lu.coeff(i, k);
+									const T *xk = xrow(k);
+									for (std::size_t j = lo; j < hi; j++)
+									{
+										xi[j] -= l * xk[j];
+									}
+								}
+							}
+
+							// Back substitution with upper U
+							for (int i = n - 1; i >= 0; i--)
+							{
+								T *xi = xrow(i);
+								for (int k = i + 1; k < n; k++)
+								{
+									const T u = m_lu.coeff(i, k);
+									const T *xk = xrow(k);
+									for (std::size_t j = lo; j < hi; j++)
+									{
+										xi[j] -= u * xk[j];
+									}
+								}
+								const T d = m_lu.coeff(i, i);
+								for (std::size_t j = lo; j < hi; j++)
+								{
+									xi[j] /= d;
+								}
+							} });
+			return x;
+		}
+
+		/**
+		 * @brief Solves A * x = b for a single right-hand side.
+		 *
+		 * @param b The right-hand side.
+		 * @return The solution x.
+		 * @throws std::invalid_argument If b does not have size() entries.
+		 * @throws std::runtime_error If the matrix is singular.
+		 */
+		std::vector<T> solve(const std::vector<T> &b) const
+		{
+			if (b.size() != static_cast<std::size_t>(size()))
+			{
+				throw std::invalid_argument("Right-hand side must have as many rows as the matrix");
+			}
+			Matrix<T> column(size(), 1);
+			std::copy(b.begin(), b.end(), column.data());
+			Matrix<T> x = solve(column);
+			return std::vector<T>(x.data(), x.data() + size());
+		}
+
+		/**
+		 * @brief Computes the inverse by solving against the identity.
+		 *
+		 * @return The inverse matrix.
+		 * @throws std::runtime_error If the matrix is singular.
+		 */
+		Matrix<T> inverse() const
+		{
+			MG_PROFILE_SCOPE(profile::Op::Inverse, size(), size());
+			Matrix<T> identity(size(), size(), T());
+			for (int i = 0; i < size(); i++)
+			{
+				identity(i, i) = T(1);
+			}
+			return solve(identity);
+		}
+	};
+
+	namespace detail
+	{
+		/**
+		 * @brief Tells whether an integer value is representable in another integer type.
+		 */
+		template <typename To, typename From>
+		constexpr bool fitsIn(From value)
+		{
+			using Limits = std::numeric_limits<To>;
+			if constexpr (std::is_signed<From>::value == std::is_signed<To>::value && sizeof(To) >= sizeof(From))
+			{
+				return true;
+			}
+			else if constexpr (std::is_signed<From>::value == std::is_signed<To>::value)
+			{
+				return value >= static_cast<From>(Limits::min()) && value <= static_cast<From>(Limits::max());
+			}
+			else if constexpr (std::is_signed<From>::value)
+			{
+				return value >= 0 && static_cast<typename std::make_unsigned<From>::type>(value) <= Limits::max();
+			}
+			else
+			{
+				return value <= static_cast<typename std::make_unsigned<To>::type>(Limits::max());
+			}
+		}
+
+		/**
+		 * @brief |value|, saturated at the largest value of the type (so the minimum does not overflow).
+		 */
+		template <typename W>
+		constexpr W saturatingAbs(W value)
+		{
+			return value >= 0 ? value : value == std::numeric_limits<W>::min() ? std::numeric_limits<W>::max() : -value;
+		}
+
+		/**
+		 * @brief Signed type holding the intermediates of Bareiss elimination on T: long long, or T if wider.
+		 */
+		template <typename T>
+		using BareissWide = typename std::conditional<(sizeof(T) < sizeof(long long)), std::common_type<long long>, std::make_signed<T>>::type::type;
+
+#if defined(__SIZEOF_INT128__)
+		__extension__ typedef __int128 Int128; ///< __extension__ keeps -Wpedantic quiet about the non-standard type.
+#endif
+
+		/**
+		 * @brief One Bareiss update (a * b - c * d) / divisor, where the division is known to be exact.
+		 *
+		 * Where the compiler has 128-bit integers the products are formed in them, so only the
+		 * result has to fit in W. Elsewhere the products themselves have to fit.
+		 *
+		 * @throws std::overflow_error If the result (or, without 128-bit integers, a product) does not fit in W.
+		 */
+		template <typename W>
+		W bareissUpdate(W a, W b, W c, W d, W divisor)
+		{
+#if defined(__SIZEOF_INT128__)
+			if constexpr (sizeof(W) < sizeof(Int128))
+			{
+				const Int128 result = (static_cast<Int128>(a) * b - static_cast<Int128>(c) * d) / divisor;
+				// Compared directly: in strict ISO mode the type traits do not treat Int128 as signed
+				if (result < std::numeric_limits<W>::min() || result > std::numeric_limits<W>::max())
+				{
+					throw std::overflow_error("Determinant minors overflow the integer type");
+				}
+				return static_cast<W>(result);
+			}
+			else
+#endif
+			{
+				constexpr W max = std::numeric_limits<W>::max();
+				constexpr W min = std::numeric_limits<W>::min();
+				auto productOverflows = [&](W x, W y)
+				{
+					if (x > 0)
+					{
+						return y > 0 ? x > max / y : y < min / x;
+					}
+					return y > 0 ? x < min / y : x != 0 && y < max / x;
+				};
+				if (productOverflows(a, b) || productOverflows(c, d))
+				{
+					throw std::overflow_error("Determinant minors overflow the integer type");
+				}
+				const W ab = a * b;
+				const W cd = c * d;
+				if ((cd > 0 && ab < min + cd) || (cd < 0 && ab > max + cd))
+				{
+					throw std::overflow_error("Determinant minors overflow the integer type");
+				}
+				return (ab - cd) / divisor;
+			}
+		}
+	}
+
+	/**
+	 * @brief Computes the determinant of an integer matrix exactly with fraction-free Bareiss elimination.
+	 *
+	 * Every intermediate value is a minor of the input, and each division is exact. Intermediates
+	 * are held in long long (or T if wider) and multiplied in 128 bits where available, so the
+	 * result is exact whenever every minor met fits in long long; otherwise the function throws
+	 * instead of returning a wrapped-around value. Unimodular matrices can have large minors.
+	 *
+	 * @tparam T An integral element type.
+	 * @param matrix The square matrix.
+	 * @return The determinant.
+	 * @throws std::invalid_argument If the matrix is not square.
+	 * @throws std::overflow_error If an intermediate minor, or the determinant, does not fit in its type.
+	 */
+	template <typename T>
+	T determinantBareiss(const Matrix<T> &matrix)
+	{
+		static_assert(std::is_integral<T>::value, "Bareiss elimination is meant for integer matrices");
+		using Wide = detail::BareissWide<T>;
+
+		const int n = matrix.getRows();
+		if (n != matrix.getCols())
+		{
+			throw std::invalid_argument("Matrix must be square");
+		}
+
+		std::vector<Wide> a(static_cast<std::size_t>(n) * n);
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				if (!detail::fitsIn<Wide>(matrix.coeff(i, j)))
+				{
+					throw std::overflow_error("Determinant minors overflow the integer type");
+				}
+				a[static_cast<std::size_t>(i) * n + j] = static_cast<Wide>(matrix.coeff(i, j));
+			}
+		}
+		auto at = [&](int i, int j) -> Wide &
+		{
+			return a[static_cast<std::size_t>(i) * n + j];
+		};
+
+		constexpr Wide LIMIT = Wide(1) << (std::numeric_limits<Wide>::digits / 2);
+		Wide largest = 0;
+		for (const Wide value : a)
+		{
+			largest = std::max(largest, detail::saturatingAbs(value));
+		}
+
+		int sign = 1;
+		Wide previous = 1;
+		for (int k = 0; k < n - 1; k++)
+		{
+			if (at(k, k) == 0)
+			{
+				int p = k + 1;
+				while (p < n && at(p, k) == 0)
+				{
+					p++;
+				}
+				if (p == n)
+				{
+					return T(0);
+				}
+				std::swap_ranges(&at(k, 0), &at(k, 0) + n, &at(p, 0));
+				sign = -sign;
+			}
+			// While every entry is below 2^(digits / 2), no product can overflow and plain arithmetic is exact
+			const bool small = largest < LIMIT;
+			largest = 0;
+			for (int i = k + 1; i < n; i++)
+			{
+				const Wide pivot = at(k, k), multiplier = at(i, k);
+				Wide *ai = &at(i, 0);
+				const Wide *ak = &at(k, 0);
+				if (small)
+				{
+					for (int j = k + 1; j < n; j++)
+					{
+						ai[j] = (ai[j] * pivot - multiplier * ak[j]) / previous;
+					}
+				}
+				else
+				{
+					for (int j = k + 1; j < n; j++)
+					{
+						ai[j] = detail::bareissUpdate<Wide>(ai[j], pivot, multiplier, ak[j], previous);
+					}
+				}
+				for (int j = k; j < n; j++)
+				{
+					largest = std::max(largest, detail::saturatingAbs(ai[j]));
+				}
+			}
+			for (int j = k + 1; j < n; j++)
+			{
+				largest = std::max(largest, detail::saturatingAbs(at(k, j)));
+			}
+			previous = at(k, k);
+		}
+		if (n == 0)
+		{
+			return T(1);
+		}
+		Wide det = at(n - 1, n - 1);
+		if (sign < 0)
+		{
+			if (det == std::numeric_limits<Wide>::min())
+			{
+				throw std::overflow_error("Determinant overflows the element type");
+			}
+			det = -det;
+		}
+		if (!detail::fitsIn<T>(det))
+		{
+			throw std::overflow_error("Determinant overflows the element type");
+		}
+		return static_cast<T>(det);
+	}
+}
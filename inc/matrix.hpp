@@ -1,7 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
+#include "alignedallocator.hpp"
+#include "boundscheck.hpp"
+#include "expression.hpp"
+#include "gemm.hpp"
+#include "matrixview.hpp"
+#include "memoryresource.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+#include "random.hpp"
+#include "simd.hpp"
+#include "strassen.hpp"
+#include "transpose.hpp"
 
 /**
  * @brief A templated Matrix class for managing 2D matrices.
@@ -12,13 +31,15 @@
 namespace mg
 {
 	template <typename T>
-	class Matrix
+	class Matrix : public MatrixExpr<Matrix<T>>
 	{
 	protected:
 		/**
-		 * @brief 2D vector storage for the matrix.
+		 * @brief Contiguous, aligned row-major storage; element (i, j) lives at i * m_stride + j.
+		 *
+		 * Allocated from the memory resource current when the matrix was created (see memoryresource.hpp).
 		 */
-		std::vector<std::vector<T>> m_matrix;
+		std::vector<T, MatrixAllocator<T>> m_data;
 
 		/**
 		 * @brief Number of rows in the matrix.
@@ -30,11 +51,214 @@ namespace mg
 		 */
 		int m_cols;
 
+		/**
+		 * @brief Leading dimension: distance in elements between the starts of consecutive rows.
+		 */
+		int m_stride;
+
+		/**
+		 * @brief Computes the offset of element (i, j) in the storage buffer.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Offset into m_data.
+		 */
+		std::size_t index(int i, int j) const
+		{
+			return static_cast<std::size_t>(i) * m_stride + j;
+		}
+
+		/**
+		 * @brief Checks whether the rows follow each other without padding.
+		 *
+		 * @return True if the whole matrix is one contiguous span of getRows() * getCols() elements.
+		 */
+		bool isContiguous() const
+		{
+			return m_stride == m_cols || m_rows <= 1;
+		}
+
+		/**
+		 * @brief Gives the matrix the requested dimensions, keeping the buffer when they already match.
+		 *
+		 * Element values are unspecified afterwards; callers overwrite every element.
+		 *
+		 * @param rows Number of rows.
+		 * @param cols Number of columns.
+		 */
+		void reshape(int rows, int cols)
+		{
+			if (rows == m_rows && cols == m_cols)
+			{
+				return;
+			}
+			m_data.resize(static_cast<std::size_t>(rows) * cols);
+			m_rows = rows;
+			m_cols = cols;
+			m_stride = cols;
+		}
+
+		/**
+		 * @brief Gives the row stride to grow to when rows must hold at least cols elements.
+		 *
+		 * Grows geometrically, like std::vector, so repeated column appends are amortized O(1)
+		 * per element, and rounds up to whole 64-byte lines so every row stays aligned.
+		 *
+		 * @param cols The number of columns the rows must hold.
+		 * @return The new stride.
+		 */
+		int grownStride(int cols) const
+		{
+			return roundedStride(std::max<long long>(cols, static_cast<long long>(m_stride) + m_stride / 2));
+		}
+
+		/**
+		 * @brief Rounds a row length up to whole 64-byte lines.
+		 *
+		 * @param cols The number of elements a row must hold.
+		 * @return The rounded stride, never less than cols.
+		 */
+		static int roundedStride(long long cols)
+		{
+			constexpr long long LINE = sizeof(T) < 64 && 64 % sizeof(T) == 0 ? static_cast<long long>(64 / sizeof(T)) : 1;
+			return static_cast<int>(std::min<long long>((cols + LINE - 1) / LINE * LINE, std::numeric_limits<int>::max()));
+		}
+
+		/**
+		 * @brief Moves the elements into a fresh buffer whose rows are stride elements apart.
+		 *
+		 * @param stride The new stride; at least getCols().
+		 */
+		void relayout(int stride)
+		{
+			std::vector<T, MatrixAllocator<T>> data(static_cast<std::size_t>(m_rows) * stride, T(), m_data.get_allocator());
+			parallelFor(0, m_rows, grainFor(m_cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								T *row = m_data.data() + index(static_cast<int>(i), 0);
+								std::move(row, row + m_cols, data.data() + i * stride);
+							} });
+			m_data = std::move(data);
+			m_stride = stride;
+		}
+
+		/**
+		 * @brief Turns a list of indices into a keep/erase mask, ignoring duplicates.
+		 *
+		 * @param indices The indices to erase, in any order.
+		 * @param size The number of rows or columns.
+		 * @param erase Set to one entry per row or column, true for those to erase.
+		 * @return The number of distinct indices.
+		 * @throws std::out_of_range If an index is out of bounds.
+		 */
+		static int eraseMask(const std::vector<int> &indices, int size, std::vector<char> &erase)
+		{
+			erase.assign(static_cast<std::size_t>(size), 0);
+			int count = 0;
+			for (int k : indices)
+			{
+				if (k < 0 || k >= size)
+				{
+					throw std::out_of_range("Index out of bounds");
+				}
+				count += !erase[k];
+				erase[k] = 1;
+			}
+			return count;
+		}
+
+		/**
+		 * @brief Copies the buffer of another matrix for the copy constructor, recorded by the profiler.
+		 */
+		static std::vector<T, MatrixAllocator<T>> copyData(const Matrix &other)
+		{
+			MG_PROFILE_SCOPE(profile::Op::Copy, other.m_rows, other.m_cols);
+			MG_PROFILE_COPY(other.m_data.size() * sizeof(T));
+			return other.m_data;
+		}
+
+		/**
+		 * @brief Tells whether an expression reads any element of this matrix's buffer.
+		 *
+		 * @param expr The expression.
+		 * @return True if some operand of expr overlaps this matrix's storage.
+		 */
+		template <typename E>
+		bool overlaps(const E &expr) const
+		{
+			return expr.references(m_data.data(), m_data.data() + m_data.size());
+		}
+
+		/**
+		 * @brief Evaluates an expression into this matrix, resizing it to the expression's dimensions.
+		 *
+		 * The kernel choice is made by detail::evaluateInto(). When the expression reads this
+		 * matrix in any way other than element (i, j) for element (i, j), it is evaluated into a
+		 * fresh buffer first, except a = a.transpose(), which transposes in place.
+		 *
+		 * @param expr The expression to evaluate.
+		 */
+		template <typename E>
+		void assign(const E &expr)
+		{
+			const int rows = expr.getRows();
+			const int cols = expr.getCols();
+			MG_PROFILE_SCOPE(detail::profileOp<E>(), rows, cols, detail::profileInner(expr));
+			if (overlaps(expr) && (!E::elementwise || rows != m_rows || cols != m_cols))
+			{
+				if constexpr (IsLeafTransposeExpr<E>::value)
+				{
+					const auto &source = expr.operand();
+					if (source.data() == data() && source.getRows() == m_rows && source.getCols() == m_cols)
+					{
+						transposeInPlace(); // a = a.transpose()
+						return;
+					}
+				}
+				// The result would overwrite operands that are still being read
+				Matrix<T> result;
+				result.assign(expr);
+				*this = std::move(result);
+				return;
+			}
+			reshape(rows, cols);
+			detail::evaluateInto(view(), expr);
+		}
+
+		/**
+		 * @brief Applies this = Op(this, expr) element-wise in place.
+		 *
+		 * @param expr The right-hand expression; must have the dimensions of this matrix.
+		 */
+		template <typename Op, typename E>
+		void compound(const E &expr)
+		{
+			MG_PROFILE_SCOPE(detail::profileCompoundOp<Op, E>(), m_rows, m_cols, detail::profileInner(expr));
+			if (!E::elementwise && overlaps(expr))
+			{
+				compound<Op>(Matrix<T>(expr));
+				return;
+			}
+			detail::compoundInto<Op>(view(), expr);
+		}
+
 	public:
+		/**
+		 * @brief The element type, as seen by expressions.
+		 */
+		using value_type = T;
+
+		/**
+		 * @brief Expression flags: a matrix owns its storage and is read element by element.
+		 */
+		static constexpr bool isLeaf = true;
+		static constexpr bool elementwise = true;
+
 		/**
 		 * @brief Default constructor initializing an empty matrix.
 		 */
-		Matrix() : m_rows(0), m_cols(0) {}
+		Matrix() : m_rows(0), m_cols(0), m_stride(0) {}
 
 		/**
 		 * @brief Constructs a matrix with given dimensions and an initial value for all elements.
@@ -42,8 +266,16 @@ namespace mg
 		 * @param rows Number of rows in the matrix.
 		 * @param cols Number of columns in the matrix.
 		 * @param initialValue Initial value for all elements.
+		 * @throws std::invalid_argument If either dimension is negative.
 		 */
-		Matrix(int rows, int cols, T initialValue = T()) : m_rows(rows), m_cols(cols), m_matrix(rows, std::vector<T>(cols, initialValue)) {}
+		Matrix(int rows, int cols, T initialValue = T()) : m_rows(rows), m_cols(cols), m_stride(cols)
+		{
+			if (rows < 0 || cols < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_data.assign(static_cast<std::size_t>(rows) * cols, initialValue);
+		}
 
 		/**
 		 * @brief Constructs a matrix from a given 2D vector.
@@ -51,19 +283,57 @@ namespace mg
 		 * @param matrix A 2D vector representing the initial matrix.
 		 * @throws std::runtime_error If the rows don't have the same number of columns.
 		 */
-		Matrix(const std::vector<std::vector<T>> &matrix) : m_matrix(matrix)
+		Matrix(const std::vector<std::vector<T>> &matrix)
 		{
-			m_rows = matrix.size();
-			m_cols = matrix.empty() ? 0 : matrix[0].size();
+			m_rows = static_cast<int>(matrix.size());
+			m_cols = matrix.empty() ? 0 : static_cast<int>(matrix[0].size());
+			m_stride = m_cols;
 			for (const auto &row : matrix)
 			{
-				if (row.size() != m_cols)
+				if (row.size() != static_cast<std::size_t>(m_cols))
 				{
 					throw std::runtime_error("All rows must have the same number of columns");
 				}
 			}
+			m_data.reserve(static_cast<std::size_t>(m_rows) * m_cols);
+			for (const auto &row : matrix)
+			{
+				m_data.insert(m_data.end(), row.begin(), row.end());
+			}
+		}
+
+		/**
+		 * @brief Copy constructor performing a deep copy of the elements.
+		 *
+		 * @param other The matrix to copy.
+		 */
+		Matrix(const Matrix &other) : MatrixExpr<Matrix<T>>(other), m_data(copyData(other)), m_rows(other.m_rows), m_cols(other.m_cols), m_stride(other.m_stride) {}
+
+		/**
+		 * @brief Move constructor taking over the storage of another matrix without copying it.
+		 *
+		 * @param other The matrix to move from; left as an empty 0x0 matrix.
+		 */
+		Matrix(Matrix &&other) noexcept : m_data(std::move(other.m_data)), m_rows(other.m_rows), m_cols(other.m_cols), m_stride(other.m_stride)
+		{
+			other.m_rows = 0;
+			other.m_cols = 0;
+			other.m_stride = 0;
 		}
 
+		/**
+		 * @brief Constructs a matrix by evaluating a matrix expression.
+		 *
+		 * @param expr The expression, e.g. a * 3 + b - c.
+		 */
+		template <typename E>
+		Matrix(const MatrixExpr<E> &expr) : Matrix()
+		{
+			assign(expr.self());
+		}
+
+		virtual ~Matrix() = default;
+
 		/**
 		 * @brief Gets the number of rows in the matrix.
 		 *
@@ -84,9 +354,51 @@ namespace mg
 			return m_cols;
 		}
 
+		/**
+		 * @brief Gets the leading dimension (row stride) of the storage.
+		 *
+		 * @return Number of elements between the starts of consecutive rows.
+		 */
+		int getStride() const
+		{
+			return m_stride;
+		}
+
+		/**
+		 * @brief Gives direct access to the underlying row-major buffer.
+		 *
+		 * @return Pointer to element (0, 0); row i starts at data() + i * getStride().
+		 */
+		T *data()
+		{
+			return m_data.data();
+		}
+
+		/**
+		 * @brief Gives direct access to the underlying row-major buffer (const version).
+		 *
+		 * @return Pointer to element (0, 0); row i starts at data() + i * getStride().
+		 */
+		const T *data() const
+		{
+			return m_data.data();
+		}
+
+		/**
+		 * @brief Gets the memory resource the storage is allocated from.
+		 *
+		 * @return The resource current on this thread when the matrix was created.
+		 */
+		std::pmr::memory_resource *resource() const
+		{
+			return m_data.get_allocator().resource();
+		}
+
 		/**
 		 * @brief Retrieves a specific row from the matrix.
 		 *
+		 * Copies the row; use row(i) to work on it in place.
+		 *
 		 * @param i The index of the row to retrieve.
 		 * @return A vector representing the row.
 		 * @throws std::out_of_range If the row index is out of bounds.
@@ -98,12 +410,15 @@ namespace mg
 				throw std::out_of_range("Out of bounds");
 				return std::vector<T>();
 			}
-			return m_matrix[i];
+			const T *row = m_data.data() + index(i, 0);
+			return std::vector<T>(row, row + m_cols);
 		}
 
 		/**
 		 * @brief Retrieves a specific column from the matrix.
 		 *
+		 * Copies the column; use col(j) to work on it in place.
+		 *
 		 * @param j The index of the column to retrieve.
 		 * @return A vector representing the column.
 		 * @throws std::out_of_range If the column index is out of bounds.
@@ -117,15 +432,114 @@ namespace mg
 			}
 
 			std::vector<T> col(m_rows);
+			const T *src = m_data.data() + j;
 
 			for (int i = 0; i < m_rows; i++)
 			{
-				col[i] = m_matrix[i][j];
+				col[i] = src[index(i, 0)];
 			}
 
 			return col;
 		}
 
+		/**
+		 * @brief Views the whole matrix without copying it.
+		 *
+		 * @return A view writing through to this matrix.
+		 */
+		MatrixView<T> view()
+		{
+			return MatrixView<T>(data(), m_rows, m_cols, m_stride);
+		}
+
+		/**
+		 * @brief Views the whole matrix without copying it (const version).
+		 *
+		 * @return A read-only view of this matrix.
+		 */
+		MatrixView<const T> view() const
+		{
+			return MatrixView<const T>(data(), m_rows, m_cols, m_stride);
+		}
+
+		/**
+		 * @brief Views a row without copying it.
+		 *
+		 * @param i The row index.
+		 * @return A 1 x getCols() view writing through to this matrix.
+		 * @throws std::out_of_range If the row index is out of bounds.
+		 */
+		RowView<T> row(int i)
+		{
+			return view().row(i);
+		}
+
+		/**
+		 * @brief Views a row without copying it (const version).
+		 *
+		 * @param i The row index.
+		 * @return A read-only 1 x getCols() view.
+		 * @throws std::out_of_range If the row index is out of bounds.
+		 */
+		RowView<const T> row(int i) const
+		{
+			return view().row(i);
+		}
+
+		/**
+		 * @brief Views a column without copying it.
+		 *
+		 * @param j The column index.
+		 * @return A getRows() x 1 view writing through to this matrix.
+		 * @throws std::out_of_range If the column index is out of bounds.
+		 */
+		ColView<T> col(int j)
+		{
+			return view().col(j);
+		}
+
+		/**
+		 * @brief Views a column without copying it (const version).
+		 *
+		 * @param j The column index.
+		 * @return A read-only getRows() x 1 view.
+		 * @throws std::out_of_range If the column index is out of bounds.
+		 */
+		ColView<const T> col(int j) const
+		{
+			return view().col(j);
+		}
+
+		/**
+		 * @brief Views a rectangular block without copying it.
+		 *
+		 * @param i Row of the block's top-left element.
+		 * @param j Column of the block's top-left element.
+		 * @param rows Number of rows in the block.
+		 * @param cols Number of columns in the block.
+		 * @return A rows x cols view writing through to this matrix.
+		 * @throws std::out_of_range If the block does not fit inside the matrix.
+		 */
+		BlockView<T> block(int i, int j, int rows, int cols)
+		{
+			return view().block(i, j, rows, cols);
+		}
+
+		/**
+		 * @brief Views a rectangular block without copying it (const version).
+		 *
+		 * @param i Row of the block's top-left element.
+		 * @param j Column of the block's top-left element.
+		 * @param rows Number of rows in the block.
+		 * @param cols Number of columns in the block.
+		 * @return A read-only rows x cols view.
+		 * @throws std::out_of_range If the block does not fit inside the matrix.
+		 */
+		BlockView<const T> block(int i, int j, int rows, int cols) const
+		{
+			return view().block(i, j, rows, cols);
+		}
+
 		/**
 		 * @brief Adds a row to the matrix at a specified position.
 		 *
@@ -136,16 +550,11 @@ namespace mg
 		 */
 		virtual void addRow(int i, const std::vector<T> &row)
 		{
-			if (row.size() != m_cols)
+			if (row.size() != static_cast<std::size_t>(m_cols))
 			{
 				throw std::invalid_argument("New row must have the same number of columns");
 			}
-			if (i < 0 || i > m_rows)
-			{
-				throw std::out_of_range("Row index out of bounds");
-			}
-			m_matrix.insert(m_matrix.begin() + i, row);
-			++m_rows;
+			insertRows(i, MatrixView<const T>(row.data(), 1, m_cols, m_cols));
 		}
 
 		/**
@@ -160,8 +569,7 @@ namespace mg
 			{
 				throw std::out_of_range("Row index out of bounds");
 			}
-			m_matrix.erase(m_matrix.begin() + i);
-			--m_rows;
+			eraseRows({i});
 		}
 
 		/**
@@ -174,7 +582,7 @@ namespace mg
 		 */
 		virtual void addCol(int j, const std::vector<T> &col)
 		{
-			if (col.size() != m_rows)
+			if (col.size() != static_cast<std::size_t>(m_rows))
 			{
 				throw std::invalid_argument("New column must have the same number of rows");
 			}
@@ -182,11 +590,7 @@ namespace mg
 			{
 				throw std::out_of_range("Column index out of bounds");
 			}
-			for (int i = 0; i < m_rows; i++)
-			{
-				m_matrix[i].insert(m_matrix[i].begin() + j, col[i]);
-			}
-			++m_cols;
+			insertCols(std::vector<int>{j}, MatrixView<const T>(col.data(), m_rows, 1, 1));
 		}
 
 		/**
@@ -201,45 +605,478 @@ namespace mg
 			{
 				throw std::out_of_range("Column index out of bounds");
 			}
-			for (int i = 0; i < m_rows; i++)
+			eraseCols({j});
+		}
+
+		/**
+		 * @brief Inserts the rows of a block before row i, shifting the storage once.
+		 *
+		 * An empty 0x0 matrix takes the block's column count. Appending at the end is amortized
+		 * O(1) per element, as for std::vector; see reserve().
+		 *
+		 * @param i The index at which the first new row will be; getRows() appends.
+		 * @param block The rows to insert; may view this matrix.
+		 * @throws std::invalid_argument If the block does not have getCols() columns.
+		 * @throws std::out_of_range If the row index is out of bounds.
+		 */
+		virtual void insertRows(int i, MatrixView<const T> block)
+		{
+			const bool empty = m_rows == 0 && m_cols == 0;
+			if (block.getCols() != m_cols && !empty)
+			{
+				throw std::invalid_argument("New rows must have the same number of columns");
+			}
+			if (i < 0 || i > m_rows)
 			{
-				m_matrix[i].erase(m_matrix[i].begin() + j);
+				throw std::out_of_range("Row index out of bounds");
 			}
-			--m_cols;
+			if (empty)
+			{
+				m_cols = block.getCols();
+				m_stride = std::max(m_stride, m_cols);
+			}
+			if (block.getRows() == 0)
+			{
+				return;
+			}
+			if (overlaps(block))
+			{
+				insertRows(i, Matrix<T>(block).view()); // The insertion moves the rows being read
+				return;
+			}
+			auto pos = m_data.insert(m_data.begin() + index(i, 0), static_cast<std::size_t>(block.getRows()) * m_stride, T());
+			for (int r = 0; r < block.getRows(); r++)
+			{
+				const T *row = block.rowPtr(r);
+				std::copy(row, row + m_cols, pos + static_cast<std::size_t>(r) * m_stride);
+			}
+			m_rows += block.getRows();
+		}
+
+		/**
+		 * @brief Appends the rows of a block at the bottom of the matrix.
+		 *
+		 * @param block The rows to append; may view this matrix.
+		 * @throws std::invalid_argument If the block does not have getCols() columns.
+		 */
+		void appendRows(MatrixView<const T> block)
+		{
+			insertRows(m_rows, block);
 		}
 
 		/**
-		 * @brief Accesses an element of the matrix.
+		 * @brief Removes a set of rows, compacting the rest in a single pass.
+		 *
+		 * The capacity is kept; see shrinkToFit().
+		 *
+		 * @param indices The rows to remove, in any order; duplicates are ignored.
+		 * @throws std::out_of_range If a row index is out of bounds.
+		 */
+		virtual void eraseRows(const std::vector<int> &indices)
+		{
+			std::vector<char> erase;
+			if (eraseMask(indices, m_rows, erase) == 0)
+			{
+				return;
+			}
+			const std::size_t stride = m_stride;
+			std::size_t out = 0;
+			for (int i = 0; i < m_rows;)
+			{
+				if (erase[i])
+				{
+					i++;
+					continue;
+				}
+				int end = i + 1; // Move each run of kept rows in one go
+				while (end < m_rows && !erase[end])
+				{
+					end++;
+				}
+				if (out != static_cast<std::size_t>(i))
+				{
+					std::move(m_data.begin() + i * stride, m_data.begin() + end * stride, m_data.begin() + out * stride);
+				}
+				out += end - i;
+				i = end;
+			}
+			m_data.resize(out * stride);
+			m_rows = static_cast<int>(out);
+		}
+
+		/**
+		 * @brief Inserts the columns of a block, each before a given column, in one pass over the rows.
+		 *
+		 * Column k of the block goes before column positions[k] of the current matrix, so
+		 * insertCols({0, 2, 2}, b) puts b's first column in front and the other two between the
+		 * current columns 1 and 2, in their order in b. An empty 0x0 matrix takes the block's
+		 * row count. Rows are widened in place while the stride has room (see reserve());
+		 * otherwise the stride grows geometrically, so repeated appends are amortized O(1) per
+		 * element.
+		 *
+		 * @param positions One insertion point per block column, each in [0, getCols()].
+		 * @param block The columns to insert; may view this matrix.
+		 * @throws std::invalid_argument If the block does not have getRows() rows or one column per position.
+		 * @throws std::out_of_range If a position is out of bounds.
+		 */
+		virtual void insertCols(const std::vector<int> &positions, MatrixView<const T> block)
+		{
+			const bool empty = m_rows == 0 && m_cols == 0;
+			if (block.getRows() != m_rows && !empty)
+			{
+				throw std::invalid_argument("New columns must have the same number of rows");
+			}
+			if (positions.size() != static_cast<std::size_t>(block.getCols()))
+			{
+				throw std::invalid_argument("Each new column needs a position");
+			}
+			for (int j : positions)
+			{
+				if (j < 0 || j > m_cols)
+				{
+					throw std::out_of_range("Column index out of bounds");
+				}
+			}
+			if (empty)
+			{
+				m_rows = block.getRows();
+				m_data.resize(static_cast<std::size_t>(m_rows) * m_stride);
+			}
+			const int count = block.getCols();
+			if (count == 0)
+			{
+				return;
+			}
+			if (overlaps(block))
+			{
+				insertCols(positions, Matrix<T>(block).view()); // The insertion moves the columns being read
+				return;
+			}
+			std::vector<int> order(count); // Block columns by insertion point, stable
+			for (int k = 0; k < count; k++)
+			{
+				order[k] = k;
+			}
+			std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+							 { return positions[a] < positions[b]; });
+			const int cols = m_cols + count;
+			if (cols <= m_stride)
+			{
+				// Widen each row in place, from its end, within the padding
+				parallelFor(0, m_rows, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+							{
+								for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+								{
+									T *row = rowPtr(i);
+									int src = m_cols;
+									T *dst = row + cols;
+									for (int n = count - 1; n >= 0; n--)
+									{
+										const int j = positions[order[n]];
+										dst = std::move_backward(row + j, row + src, dst);
+										*--dst = block.coeff(i, order[n]);
+										src = j;
+									}
+								} });
+			}
+			else
+			{
+				const int stride = grownStride(cols);
+				std::vector<T, MatrixAllocator<T>> data(static_cast<std::size_t>(m_rows) * stride, T(), m_data.get_allocator());
+				parallelFor(0, m_rows, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+							{
+								for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+								{
+									T *row = rowPtr(i);
+									T *dst = data.data() + static_cast<std::size_t>(i) * stride;
+									int src = 0;
+									for (int n = 0; n < count; n++)
+									{
+										const int j = positions[order[n]];
+										dst = std::move(row + src, row + j, dst);
+										*dst++ = block.coeff(i, order[n]);
+										src = j;
+									}
+									std::move(row + src, row + m_cols, dst);
+								} });
+				m_data = std::move(data);
+				m_stride = stride;
+			}
+			m_cols = cols;
+		}
+
+		/**
+		 * @brief Inserts the columns of a block side by side before column j.
+		 *
+		 * @param j The index at which the first new column will be; getCols() appends.
+		 * @param block The columns to insert; may view this matrix.
+		 * @throws std::invalid_argument If the block does not have getRows() rows.
+		 * @throws std::out_of_range If the column index is out of bounds.
+		 */
+		void insertCols(int j, MatrixView<const T> block)
+		{
+			insertCols(std::vector<int>(static_cast<std::size_t>(block.getCols()), j), block);
+		}
+
+		/**
+		 * @brief Appends the columns of a block at the right of the matrix.
+		 *
+		 * @param block The columns to append; may view this matrix.
+		 * @throws std::invalid_argument If the block does not have getRows() rows.
+		 */
+		void appendCols(MatrixView<const T> block)
+		{
+			insertCols(m_cols, block);
+		}
+
+		/**
+		 * @brief Removes a set of columns, compacting each row in place in a single pass.
+		 *
+		 * The stride is kept, so columns added later reuse the room; see shrinkToFit().
+		 *
+		 * @param indices The columns to remove, in any order; duplicates are ignored.
+		 * @throws std::out_of_range If a column index is out of bounds.
+		 */
+		virtual void eraseCols(const std::vector<int> &indices)
+		{
+			std::vector<char> erase;
+			const int count = eraseMask(indices, m_cols, erase);
+			if (count == 0)
+			{
+				return;
+			}
+			std::vector<std::pair<int, int>> runs; // Kept columns [first, second)
+			for (int j = 0; j < m_cols; j++)
+			{
+				if (!erase[j])
+				{
+					if (runs.empty() || runs.back().second != j)
+					{
+						runs.emplace_back(j, j);
+					}
+					runs.back().second = j + 1;
+				}
+			}
+			parallelFor(0, m_rows, grainFor(m_cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+							{
+								T *row = rowPtr(i);
+								T *dst = row;
+								for (const auto &run : runs)
+								{
+									if (row + run.first != dst)
+									{
+										std::move(row + run.first, row + run.second, dst);
+									}
+									dst += run.second - run.first;
+								}
+							} });
+			m_cols -= count;
+		}
+
+		/**
+		 * @brief Reserves room so that the matrix can grow to rows x cols without reallocating.
+		 *
+		 * Column room is padding at the end of each row: getStride() becomes at least cols, and
+		 * the matrix is then no longer stored contiguously. Never shrinks the storage.
+		 *
+		 * @param rows The number of rows to make room for.
+		 * @param cols The number of columns to make room for.
+		 * @throws std::invalid_argument If either dimension is negative.
+		 */
+		void reserve(int rows, int cols)
+		{
+			if (rows < 0 || cols < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			if (cols > m_stride)
+			{
+				relayout(roundedStride(cols));
+			}
+			m_data.reserve(static_cast<std::size_t>(std::max(rows, m_rows)) * m_stride);
+		}
+
+		/**
+		 * @brief Gets the number of rows the matrix can hold without reallocating.
+		 *
+		 * @return The row capacity.
+		 */
+		int rowCapacity() const
+		{
+			return m_stride == 0 ? m_rows : static_cast<int>(std::min<std::size_t>(m_data.capacity() / m_stride, std::numeric_limits<int>::max()));
+		}
+
+		/**
+		 * @brief Gets the number of columns the matrix can hold without reallocating.
+		 *
+		 * @return The column capacity, which is the stride.
+		 */
+		int colCapacity() const
+		{
+			return m_stride;
+		}
+
+		/**
+		 * @brief Releases unused capacity, making the storage contiguous again.
+		 */
+		void shrinkToFit()
+		{
+			if (m_stride != m_cols)
+			{
+				relayout(m_cols);
+			}
+			m_data.shrink_to_fit();
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, checking the indices only if MG_BOUNDS_CHECK is on.
 		 *
 		 * @param i The row index.
 		 * @param j The column index.
 		 * @return Reference to the element at the specified position.
-		 * @throws std::out_of_range If the indices are out of bounds.
+		 * @throws std::out_of_range If bounds checking is on and the indices are out of bounds.
 		 */
 		T &operator()(int i, int j)
 		{
-			if (i >= m_rows || j >= m_cols || i < 0 || j < 0)
+			if constexpr (BOUNDS_CHECK)
 			{
-				throw std::out_of_range("Matrix indices out of bounds");
+				detail::checkIndex(i, j, m_rows, m_cols);
 			}
-			return m_matrix[i][j];
+			return m_data[index(i, j)];
 		}
 
 		/**
-		 * @brief Accesses an element of the matrix (const version).
+		 * @brief Accesses an element of the matrix, checking the indices only if MG_BOUNDS_CHECK is on (const version).
 		 *
 		 * @param i The row index.
 		 * @param j The column index.
 		 * @return Const reference to the element at the specified position.
-		 * @throws std::out_of_range If the indices are out of bounds.
+		 * @throws std::out_of_range If bounds checking is on and the indices are out of bounds.
 		 */
 		const T &operator()(int i, int j) const
 		{
-			if (i >= m_rows || j >= m_cols || i < 0 || j < 0)
+			if constexpr (BOUNDS_CHECK)
 			{
-				throw std::out_of_range("Matrix indices out of bounds");
+				detail::checkIndex(i, j, m_rows, m_cols);
 			}
-			return m_matrix[i][j];
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, always checking the indices.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Reference to the element at the specified position.
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T &at(int i, int j)
+		{
+			detail::checkIndex(i, j, m_rows, m_cols);
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Accesses an element of the matrix, always checking the indices (const version).
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Const reference to the element at the specified position.
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		const T &at(int i, int j) const
+		{
+			detail::checkIndex(i, j, m_rows, m_cols);
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Reads an element without bounds checking; used by expression evaluation.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Const reference to the element at the specified position.
+		 */
+		const T &coeff(int i, int j) const
+		{
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Accesses an element without bounds checking.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Reference to the element at the specified position.
+		 */
+		T &coeffRef(int i, int j)
+		{
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Gets a pointer to the first element of a row, for branch-free loops over it.
+		 *
+		 * @param i The row index; not checked.
+		 * @return Pointer to element (i, 0); the row's getCols() elements are contiguous.
+		 */
+		T *rowPtr(int i)
+		{
+			return m_data.data() + index(i, 0);
+		}
+
+		/**
+		 * @brief Gets a pointer to the first element of a row (const version).
+		 *
+		 * @param i The row index; not checked.
+		 * @return Pointer to element (i, 0); the row's getCols() elements are contiguous.
+		 */
+		const T *rowPtr(int i) const
+		{
+			return m_data.data() + index(i, 0);
+		}
+
+		/**
+		 * @brief Tells an expression whether this matrix's storage overlaps the given address range.
+		 *
+		 * @param begin Start of the range.
+		 * @param end One past the end of the range.
+		 * @return True if any element of this matrix lies inside [begin, end).
+		 */
+		bool references(const void *begin, const void *end) const
+		{
+			return detail::overlaps(m_data.data(), m_data.data() + m_data.size(), begin, end);
+		}
+
+		/**
+		 * @brief Expression hook; a matrix is always ready to be read.
+		 */
+		void prepare() const {}
+
+		/**
+		 * @brief Transposes the matrix in place, without allocating a second matrix.
+		 *
+		 * Square matrices swap mirrored tiles; rectangular ones follow the permutation cycles
+		 * of the row-major layout (one bit of bookkeeping per element).
+		 */
+		void transposeInPlace()
+		{
+			if (m_rows == m_cols)
+			{
+				transposeSquareInPlace(data(), m_stride, m_rows);
+				return;
+			}
+			if (!isContiguous())
+			{
+				Matrix<T> result(this->transpose());
+				*this = std::move(result);
+				return;
+			}
+			transposeCycleInPlace(data(), m_rows, m_cols);
+			std::swap(m_rows, m_cols);
+			m_stride = m_cols;
 		}
 
 		/**
@@ -249,13 +1086,18 @@ namespace mg
 		 */
 		void setValues(T val)
 		{
-			for (int i = 0; i < m_rows; i++)
+			if (isContiguous())
 			{
-				for (int j = 0; j < m_cols; j++)
-				{
-					(*this)(i, j) = val;
-				}
+				parallelFor(0, static_cast<std::size_t>(m_rows) * m_cols, exec::PARALLEL_GRAIN, [&](std::size_t lo, std::size_t hi)
+							{ simd::fill(data() + lo, val, hi - lo); });
+				return;
 			}
+			parallelFor(0, m_rows, grainFor(m_cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+							{
+								simd::fill(data() + index(i, 0), val, m_cols);
+							} });
 		}
 
 		/**
@@ -277,69 +1119,58 @@ namespace mg
 		/**
 		 * @brief Sets all elements of the matrix to random values within a specified range.
 		 *
+		 * Integers are drawn uniformly from [n, m], floating-point values from [n, m). Every call
+		 * uses a fresh seed; see the seeded overload for reproducible matrices.
+		 *
 		 * @param n The minimum value of the range.
 		 * @param m The maximum value of the range.
 		 * @throws std::invalid_argument If the minimum value is greater than the maximum value.
 		 */
 		void setRandomValues(T n, T m)
 		{
-			if (n > m)
-			{
-				throw std::invalid_argument("Min cannot be greater than Max");
-			}
-
-			srand((unsigned)time(NULL));
-			for (int i = 0; i < m_rows; i++)
-			{
-				for (int j = 0; j < m_cols; j++)
-				{
-					(*this)(i, j) = n + (rand() % m);
-				}
-			}
+			fillUniform(view(), n, m, detail::freshSeed());
 		}
 
 		/**
-		 * @brief Transposes the matrix.
+		 * @brief Sets all elements of the matrix to reproducible random values within a specified range.
+		 *
+		 * The result depends only on the seed, stream and dimensions, not on the thread count.
 		 *
-		 * @return A new transposed matrix.
+		 * @param n The minimum value of the range.
+		 * @param m The maximum value of the range.
+		 * @param seed The seed.
+		 * @param stream Selects an independent sequence under the same seed.
+		 * @throws std::invalid_argument If the minimum value is greater than the maximum value.
 		 */
-		Matrix<T> transpose()
+		void setRandomValues(T n, T m, std::uint64_t seed, std::uint64_t stream = 0)
 		{
-			Matrix<T> result(this->getCols(), this->getRows());
-
-			for (int i = 0; i < this->getRows(); i++)
-			{
-				for (int j = 0; j < this->getCols(); j++)
-				{
-					result(j, i) = (*this)(i, j);
-				}
-			}
-			return result;
+			fillUniform(view(), n, m, seed, stream);
 		}
 
 		/**
-		 * @brief Adds two matrices.
+		 * @brief Sets all elements of a floating-point matrix to normally distributed random values.
 		 *
-		 * @param other The matrix to add.
-		 * @return A new matrix representing the sum.
+		 * @param mean The mean of the distribution.
+		 * @param stddev The standard deviation of the distribution.
+		 * @param seed The seed; the same seed, stream and dimensions give the same matrix.
+		 * @param stream Selects an independent sequence under the same seed.
+		 * @throws std::invalid_argument If the standard deviation is negative.
 		 */
-		Matrix<T> operator+(const Matrix<T> &other) const
+		void setNormalValues(T mean, T stddev, std::uint64_t seed, std::uint64_t stream = 0)
 		{
-			if (m_rows != other.m_rows || m_cols != other.m_cols) // Checks if both matrices are the same size
-			{
-				throw std::invalid_argument("Matrix dimensions must match");
-			}
-
-			Matrix<T> result(m_rows, m_cols); // Result matrix
+			fillNormal(view(), mean, stddev, seed, stream);
+		}
 
-			for (int i = 0; i < m_rows; i++)
-			{
-				for (int j = 0; j < m_cols; j++)
-				{
-					result(i, j) = (*this)(i, j) + other(i, j); // Addition
-				}
-			}
-			return result;
+		/**
+		 * @brief Sets all elements of a floating-point matrix to normally distributed random values, with a fresh seed.
+		 *
+		 * @param mean The mean of the distribution.
+		 * @param stddev The standard deviation of the distribution.
+		 * @throws std::invalid_argument If the standard deviation is negative.
+		 */
+		void setNormalValues(T mean, T stddev)
+		{
+			fillNormal(view(), mean, stddev, detail::freshSeed());
 		}
 
 		/**
@@ -355,34 +1186,32 @@ namespace mg
 				throw std::invalid_argument("Matrix dimensions must match");
 			}
 
-			*this = (*this) + other;
+			MG_PROFILE_SCOPE(profile::Op::Add, m_rows, m_cols);
+			detail::applyBinary<simd::AddOp>(view(), *this, other); // In place, no temporary
 
 			return *this;
 		}
 
 		/**
-		 * @brief Subtracts two matrices.
+		 * @brief Adds a matrix expression to the current matrix.
 		 *
-		 * @param other The matrix to subtract.
-		 * @return A new matrix representing the difference.
+		 * A product operand (a += b * c) accumulates straight into this matrix.
+		 *
+		 * @param expr The expression to add.
+		 * @return Reference to the modified matrix.
 		 */
-		Matrix<T> operator-(const Matrix<T> &other) const
+		template <typename E>
+		Matrix<T> &operator+=(const MatrixExpr<E> &expr)
 		{
-			if (m_rows != other.m_rows || m_cols != other.m_cols) // Checks if both matrices are the same size
+			const E &other = expr.self();
+			if (m_rows != other.getRows() || m_cols != other.getCols()) // Checks if both matrices are the same size
 			{
 				throw std::invalid_argument("Matrix dimensions must match");
 			}
 
-			Matrix<T> result(m_rows, m_cols); // Result matrix
+			compound<simd::AddOp>(other);
 
-			for (int i = 0; i < m_rows; i++)
-			{
-				for (int j = 0; j < m_cols; j++)
-				{
-					result(i, j) = (*this)(i, j) - other(i, j); // Substraction
-				}
-			}
-			return result;
+			return *this;
 		}
 
 		/**
@@ -398,38 +1227,30 @@ namespace mg
 				throw std::invalid_argument("Matrix dimensions must match");
 			}
 
-			*this = (*this) - other;
+			MG_PROFILE_SCOPE(profile::Op::Subtract, m_rows, m_cols);
+			detail::applyBinary<simd::SubOp>(view(), *this, other); // In place, no temporary
 
 			return *this;
 		}
 
 		/**
-		 * @brief Multiplies two matrices.
+		 * @brief Subtracts a matrix expression from the current matrix.
 		 *
-		 * @param other The matrix to multiply with.
-		 * @return A new matrix representing the product.
-		 * @throws std::invalid_argument If the matrices have incompatible dimensions.
+		 * @param expr The expression to subtract.
+		 * @return Reference to the modified matrix.
 		 */
-		Matrix<T> operator*(const Matrix<T> &other) const
+		template <typename E>
+		Matrix<T> &operator-=(const MatrixExpr<E> &expr)
 		{
-			if (m_cols != other.m_rows)
+			const E &other = expr.self();
+			if (m_rows != other.getRows() || m_cols != other.getCols()) // Checks if both matrices are the same size
 			{
 				throw std::invalid_argument("Matrix dimensions must match");
 			}
 
-			Matrix<T> result(m_rows, other.m_cols, 0); // Result matrix
+			compound<simd::SubOp>(other);
 
-			for (int i = 0; i < m_rows; ++i)
-			{
-				for (int j = 0; j < other.m_cols; ++j)
-				{
-					for (int k = 0; k < m_cols; ++k)
-					{
-						result(i, j) += (*this)(i, k) * other(k, j); // Multiplication
-					}
-				}
-			}
-			return result;
+			return *this;
 		}
 
 		/**
@@ -445,55 +1266,96 @@ namespace mg
 				throw std::invalid_argument("Matrix dimensions must match");
 			}
 
-			*this = (*this) * other;
+			*this = (*this) * other; // The product needs its own buffer; it is moved in, not copied
 
 			return *this;
 		}
 
 		/**
-		 * @brief Multiplies the matrix by a scalar.
+		 * @brief Scales the current matrix by a scalar.
 		 *
 		 * @param scalar The scalar value.
-		 * @return A new matrix representing the scaled matrix.
+		 * @return Reference to the modified matrix.
 		 */
-		Matrix<T> operator*(const T &scalar) const
+		Matrix<T> &operator*=(const T &scalar)
 		{
-			Matrix<T> result(m_rows, m_cols);
+			MG_PROFILE_SCOPE(profile::Op::Scale, m_rows, m_cols);
+			detail::applyScalar<simd::MulOp>(view(), *this, scalar); // In place, no temporary
+			return *this;
+		}
 
-			for (int i = 0; i < m_rows; i++)
+		/**
+		 * @brief Makes one matrix another.
+		 *
+		 * @param other Other matrix.
+		 * @return Reference to the modified matrix.
+		 */
+		Matrix<T> &operator=(const Matrix &other)
+		{
+			if (this != &other)
 			{
-				for (int j = 0; j < m_cols; j++)
-				{
-					result(i, j) = (*this)(i, j) * scalar;
-				}
+				MG_PROFILE_SCOPE(profile::Op::Copy, other.m_rows, other.m_cols);
+				MG_PROFILE_COPY(other.m_data.size() * sizeof(T));
+				m_data = other.m_data;
+				m_rows = other.m_rows;
+				m_cols = other.m_cols;
+				m_stride = other.m_stride;
 			}
-			return result;
+			return *this;
 		}
 
 		/**
-		 * @brief Scales the current matrix by a scalar.
+		 * @brief Takes over the storage of another matrix without copying it.
 		 *
-		 * @param scalar The scalar value.
+		 * The matrix keeps its memory resource: if other allocates from a different one, the
+		 * elements are moved into this matrix's resource instead.
+		 *
+		 * @param other Other matrix; left as an empty 0x0 matrix.
 		 * @return Reference to the modified matrix.
 		 */
-		Matrix<T> &operator*=(const T &scalar)
+		Matrix<T> &operator=(Matrix &&other)
 		{
-			*this = (*this) * scalar;
+			if (this != &other)
+			{
+				m_data = std::move(other.m_data);
+				m_rows = other.m_rows;
+				m_cols = other.m_cols;
+				m_stride = other.m_stride;
+				other.m_data.clear();
+				other.m_rows = 0;
+				other.m_cols = 0;
+				other.m_stride = 0;
+			}
 			return *this;
 		}
 
 		/**
-		 * @brief Makes one matrix another.
+		 * @brief Evaluates a matrix expression into this matrix.
 		 *
-		 * @param other Other matrix.
+		 * The existing buffer is reused when the dimensions match.
+		 *
+		 * @param expr The expression to evaluate.
 		 * @return Reference to the modified matrix.
 		 */
-		Matrix<T> &operator=(const Matrix &other)
+		template <typename E>
+		Matrix<T> &operator=(const MatrixExpr<E> &expr)
 		{
-			m_matrix = other.m_matrix;
+			assign(expr.self());
 			return *this;
 		}
 
+		/**
+		 * @brief Writes the matrix to a binary matrix file (see matrixio.hpp for the format).
+		 *
+		 * Defined in matrixio.hpp, which must be included to call it; this keeps the memory
+		 * mapping headers out of matrix.hpp. Read the file back with loadMatrix<T>(path), or
+		 * map it without copying with mapMatrix<T>(path).
+		 *
+		 * @param path The file to create or overwrite.
+		 * @throws std::runtime_error If the file cannot be written.
+		 */
+		void save(const std::string &path) const;
+
 		/**
 		 * @brief Compares two matrices for equality.
 		 *
@@ -502,7 +1364,20 @@ namespace mg
 		 */
 		bool operator==(const Matrix<T> &other) const
 		{
-			return m_matrix == other.m_matrix;
+			if (m_rows != other.m_rows || m_cols != other.m_cols)
+			{
+				return false;
+			}
+			for (int i = 0; i < m_rows; i++)
+			{
+				const T *a = m_data.data() + index(i, 0);
+				const T *b = other.m_data.data() + other.index(i, 0);
+				if (!std::equal(a, a + m_cols, b))
+				{
+					return false;
+				}
+			}
+			return true;
 		}
 
 		/**
@@ -525,13 +1400,13 @@ namespace mg
 		 */
 		friend std::ostream &operator<<(std::ostream &os, const Matrix &matrix)
 		{
-			for (const auto &row : matrix.m_matrix)
+			for (int i = 0; i < matrix.m_rows; i++)
 			{
-				for (const auto &elem : row)
+				for (int j = 0; j < matrix.m_cols; j++)
 				{
-					os << elem << " ";
+					os << matrix.m_data[matrix.index(i, j)] << " ";
 				}
-				os << std::endl;
+				os << '\n';
 			}
 			return os;
 		}
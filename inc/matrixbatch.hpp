@@ -0,0 +1,995 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "boundscheck.hpp"
+#include "lu.hpp"
+#include "matrix.hpp"
+#include "matrixview.hpp"
+#include "memoryresource.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/**
+ * @brief Batches of many small matrices of the same shape, operated on together.
+ *
+ * A MatrixBatch stores its matrices interleaved in packs of LANES: pack p holds matrices
+ * p * LANES to p * LANES + LANES - 1, and element (i, j) of all of them sits in LANES
+ * consecutive slots. Every kernel therefore runs the same arithmetic on LANES matrices at once
+ * with full-width SIMD instructions, packs are distributed over the thread pool, and a whole
+ * batch costs one call instead of one per matrix. The last pack is padded with zero matrices.
+ */
+
+namespace mg
+{
+	template <typename T>
+	class MatrixBatch;
+
+	template <typename T>
+	class BatchLU;
+
+	namespace detail
+	{
+		/**
+		 * @brief Computes C = A * B for the LANES interleaved m x k and k x n matrices of one pack.
+		 */
+		template <typename T>
+		void multiplyPack(const T *a, const T *b, T *c, int m, int n, int k)
+		{
+			constexpr int W = MatrixBatch<T>::LANES;
+			for (int i = 0; i < m; i++)
+			{
+				T *ci = c + static_cast<std::size_t>(i) * n * W;
+				std::fill(ci, ci + static_cast<std::size_t>(n) * W, T());
+				for (int p = 0; p < k; p++)
+				{
+					const T *aip = a + (static_cast<std::size_t>(i) * k + p) * W;
+					const T *bp = b + static_cast<std::size_t>(p) * n * W;
+					for (int j = 0; j < n; j++)
+					{
+						T *cij = ci + static_cast<std::size_t>(j) * W;
+						const T *bpj = bp + static_cast<std::size_t>(j) * W;
+						for (int l = 0; l < W; l++)
+						{
+							cij[l] += aip[l] * bpj[l];
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		 * @brief Swaps rows r and i of the LANES interleaved matrices of a pack in the lanes where mask is set.
+		 *
+		 * @param a The pack.
+		 * @param cols Row length of the matrices.
+		 * @param first First column to swap.
+		 */
+		template <typename T, typename V>
+		void swapRowsWhere(T *a, int cols, int first, int r, int i, const int *mask)
+		{
+			constexpr int W = MatrixBatch<V>::LANES;
+			T *rr = a + static_cast<std::size_t>(r) * cols * W;
+			T *ri = a + static_cast<std::size_t>(i) * cols * W;
+			for (int j = first; j < cols; j++)
+			{
+				for (int l = 0; l < W; l++)
+				{
+					const T x = rr[j * W + l];
+					const T y = ri[j * W + l];
+					rr[j * W + l] = mask[l] ? y : x;
+					ri[j * W + l] = mask[l] ? x : y;
+				}
+			}
+		}
+
+		/**
+		 * @brief Determinants of the LANES interleaved n x n integer matrices of a pack, by Bareiss elimination.
+		 *
+		 * Each lane pivots on its first non-zero entry; a lane without one is singular and
+		 * carries on with a unit pivot so that no lane ever divides by zero.
+		 *
+		 * The lanes are eliminated together as long as no entry reaches 2^(digits / 2) of the
+		 * intermediate type, which keeps every product of two entries from overflowing. Past that
+		 * bound the pack is redone one matrix at a time with determinantBareiss(), which forms the
+		 * products in 128 bits and throws if a minor itself overflows.
+		 *
+		 * @throws std::overflow_error If a minor or a determinant does not fit in its type.
+		 */
+		template <typename T>
+		void bareissPack(const T *pack, int n, T *det)
+		{
+			using Wide = BareissWide<T>;
+			constexpr int W = MatrixBatch<T>::LANES;
+			constexpr Wide LIMIT = Wide(1) << (std::numeric_limits<Wide>::digits / 2);
+			const std::size_t size = static_cast<std::size_t>(n) * n * W;
+			thread_local std::vector<Wide> buffer;
+			buffer.resize(size);
+			auto at = [&](int i, int j)
+			{
+				return buffer.data() + (static_cast<std::size_t>(i) * n + j) * W;
+			};
+			Wide sign[W], previous[W], pivot[W], largest[W];
+			int zero[W], row[W], mask[W];
+			for (int l = 0; l < W; l++)
+			{
+				sign[l] = 1;
+				previous[l] = 1;
+				largest[l] = 0;
+				zero[l] = 0;
+			}
+			for (std::size_t e = 0; e < size; e += W)
+			{
+				for (int l = 0; l < W; l++)
+				{
+					buffer[e + l] = static_cast<Wide>(pack[e + l]);
+					largest[l] = std::max(largest[l], fitsIn<Wide>(pack[e + l]) ? saturatingAbs(buffer[e + l]) : LIMIT);
+				}
+			}
+
+			bool exact = true;
+			for (int k = 0; k < n - 1; k++)
+			{
+				for (int l = 0; l < W; l++)
+				{
+					exact &= largest[l] < LIMIT;
+				}
+				if (!exact)
+				{
+					break;
+				}
+				for (int l = 0; l < W; l++)
+				{
+					row[l] = at(k, k)[l] != 0 ? k : n;
+				}
+				for (int i = k + 1; i < n; i++)
+				{
+					for (int l = 0; l < W; l++)
+					{
+						row[l] = row[l] == n && at(i, k)[l] != 0 ? i : row[l];
+					}
+				}
+				for (int l = 0; l < W; l++)
+				{
+					zero[l] |= row[l] == n;
+					sign[l] = row[l] != k && row[l] != n ? -sign[l] : sign[l];
+				}
+				for (int i = k + 1; i < n; i++)
+				{
+					int any = 0;
+					for (int l = 0; l < W; l++)
+					{
+						mask[l] = row[l] == i;
+						any |= mask[l];
+					}
+					if (any)
+					{
+						swapRowsWhere<Wide, T>(buffer.data(), n, k, k, i, mask);
+					}
+				}
+				for (int l = 0; l < W; l++)
+				{
+					pivot[l] = zero[l] ? 1 : at(k, k)[l];
+				}
+				for (int i = k + 1; i < n; i++)
+				{
+					const Wide *aik = at(i, k);
+					for (int j = k + 1; j < n; j++)
+					{
+						Wide *aij = at(i, j);
+						const Wide *akj = at(k, j);
+						for (int l = 0; l < W; l++)
+						{
+							const Wide multiplier = zero[l] ? 0 : aik[l];
+							aij[l] = (aij[l] * pivot[l] - multiplier * akj[l]) / previous[l];
+							largest[l] = std::max(largest[l], saturatingAbs(aij[l]));
+						}
+					}
+				}
+				for (int l = 0; l < W; l++)
+				{
+					previous[l] = pivot[l];
+				}
+			}
+			for (int l = 0; l < W && exact; l++)
+			{
+				const Wide value = n == 0 ? 1 : zero[l] ? 0 : sign[l] * at(n - 1, n - 1)[l];
+				if (!fitsIn<T>(value))
+				{
+					throw std::overflow_error("Determinant overflows the element type");
+				}
+				det[l] = static_cast<T>(value);
+			}
+			if (!exact)
+			{
+				Matrix<T> matrix(n, n);
+				for (int l = 0; l < W; l++)
+				{
+					for (int i = 0; i < n; i++)
+					{
+						for (int j = 0; j < n; j++)
+						{
+							matrix.coeffRef(i, j) = pack[(static_cast<std::size_t>(i) * n + j) * W + l];
+						}
+					}
+					det[l] = determinantBareiss(matrix);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief A batch of count matrices of rows x cols elements in one interleaved buffer.
+	 *
+	 * @tparam T The data type of the matrix elements.
+	 */
+	template <typename T>
+	class MatrixBatch
+	{
+	public:
+		/**
+		 * @brief Matrices per pack: one 64-byte line of elements, i.e. one AVX-512 register.
+		 */
+		static constexpr int LANES = sizeof(T) < 64 && 64 % sizeof(T) == 0 ? static_cast<int>(64 / sizeof(T)) : 1;
+
+	private:
+		/**
+		 * @brief Packs of LANES interleaved matrices; element (b, i, j) lives at offset(b, i, j).
+		 */
+		std::vector<T, MatrixAllocator<T>> m_data;
+
+		/**
+		 * @brief Number of matrices in the batch.
+		 */
+		int m_count;
+
+		/**
+		 * @brief Number of rows of each matrix.
+		 */
+		int m_rows;
+
+		/**
+		 * @brief Number of columns of each matrix.
+		 */
+		int m_cols;
+
+		std::size_t offset(int b, int i, int j) const
+		{
+			return static_cast<std::size_t>(b / LANES) * packSize() + (static_cast<std::size_t>(i) * m_cols + j) * LANES + b % LANES;
+		}
+
+		void checkShape(const MatrixBatch &other) const
+		{
+			if (m_count != other.m_count)
+			{
+				throw std::invalid_argument("Batch sizes must match");
+			}
+			if (m_rows != other.m_rows || m_cols != other.m_cols)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+		}
+
+		/**
+		 * @brief Applies this = Op(this, other) over the whole buffer, padding included.
+		 */
+		template <typename Op>
+		MatrixBatch &apply(const MatrixBatch &other)
+		{
+			checkShape(other);
+			parallelFor(0, m_data.size(), exec::PARALLEL_GRAIN, [&](std::size_t lo, std::size_t hi)
+						{ simd::binary<Op>(m_data.data() + lo, other.m_data.data() + lo, m_data.data() + lo, hi - lo); });
+			return *this;
+		}
+
+	public:
+		/**
+		 * @brief Default constructor initializing an empty batch.
+		 */
+		MatrixBatch() : m_count(0), m_rows(0), m_cols(0) {}
+
+		/**
+		 * @brief Constructs a batch of count rows x cols matrices with an initial value for all elements.
+		 *
+		 * @param count Number of matrices.
+		 * @param rows Number of rows of each matrix.
+		 * @param cols Number of columns of each matrix.
+		 * @param initialValue Initial value for all elements.
+		 * @throws std::invalid_argument If a dimension is negative.
+		 */
+		MatrixBatch(int count, int rows, int cols, T initialValue = T()) : m_count(count), m_rows(rows), m_cols(cols)
+		{
+			if (count < 0 || rows < 0 || cols < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_data.assign(static_cast<std::size_t>(packCount()) * packSize(), T());
+			if (initialValue != T())
+			{
+				for (int b = 0; b < count; b++)
+				{
+					for (int i = 0; i < rows; i++)
+					{
+						for (int j = 0; j < cols; j++)
+						{
+							m_data[offset(b, i, j)] = initialValue;
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		 * @brief Gathers separate matrices of the same shape into a batch.
+		 *
+		 * @param matrices The matrices, in batch order.
+		 * @throws std::invalid_argument If the matrices do not all have the same dimensions.
+		 */
+		explicit MatrixBatch(const std::vector<Matrix<T>> &matrices)
+			: MatrixBatch(static_cast<int>(matrices.size()), matrices.empty() ? 0 : matrices[0].getRows(), matrices.empty() ? 0 : matrices[0].getCols())
+		{
+			for (int b = 0; b < m_count; b++)
+			{
+				setMatrix(b, matrices[b].view());
+			}
+		}
+
+		/**
+		 * @brief Gets the number of matrices in the batch.
+		 *
+		 * @return The batch size.
+		 */
+		int size() const
+		{
+			return m_count;
+		}
+
+		/**
+		 * @brief Gets the number of rows of each matrix.
+		 *
+		 * @return Number of rows.
+		 */
+		int getRows() const
+		{
+			return m_rows;
+		}
+
+		/**
+		 * @brief Gets the number of columns of each matrix.
+		 *
+		 * @return Number of columns.
+		 */
+		int getCols() const
+		{
+			return m_cols;
+		}
+
+		/**
+		 * @brief Gets the number of packs of LANES matrices, the last one possibly padded.
+		 *
+		 * @return Number of packs.
+		 */
+		int packCount() const
+		{
+			return (m_count + LANES - 1) / LANES;
+		}
+
+		/**
+		 * @brief Gets the number of elements in one pack.
+		 *
+		 * @return getRows() * getCols() * LANES.
+		 */
+		std::size_t packSize() const
+		{
+			return static_cast<std::size_t>(m_rows) * m_cols * LANES;
+		}
+
+		/**
+		 * @brief Gives direct access to the interleaved buffer.
+		 *
+		 * @return Pointer to the first pack; element (i, j) of matrix b is at
+		 *         data()[(b / LANES) * packSize() + (i * getCols() + j) * LANES + b % LANES].
+		 */
+		T *data()
+		{
+			return m_data.data();
+		}
+
+		/**
+		 * @brief Gives direct access to the interleaved buffer (const version).
+		 *
+		 * @return Pointer to the first pack.
+		 */
+		const T *data() const
+		{
+			return m_data.data();
+		}
+
+		/**
+		 * @brief Accesses element (i, j) of matrix b, checking the indices only if MG_BOUNDS_CHECK is on.
+		 *
+		 * @param b The index of the matrix in the batch.
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Reference to the element.
+		 * @throws std::out_of_range If bounds checking is on and an index is out of bounds.
+		 */
+		T &operator()(int b, int i, int j)
+		{
+			if constexpr (BOUNDS_CHECK)
+			{
+				detail::checkIndex(b, m_count);
+				detail::checkIndex(i, j, m_rows, m_cols);
+			}
+			return m_data[offset(b, i, j)];
+		}
+
+		/**
+		 * @brief Accesses element (i, j) of matrix b, checking the indices only if MG_BOUNDS_CHECK is on (const version).
+		 */
+		const T &operator()(int b, int i, int j) const
+		{
+			if constexpr (BOUNDS_CHECK)
+			{
+				detail::checkIndex(b, m_count);
+				detail::checkIndex(i, j, m_rows, m_cols);
+			}
+			return m_data[offset(b, i, j)];
+		}
+
+		/**
+		 * @brief Accesses element (i, j) of matrix b, always checking the indices.
+		 *
+		 * @throws std::out_of_range If an index is out of bounds.
+		 */
+		T &at(int b, int i, int j)
+		{
+			detail::checkIndex(b, m_count);
+			detail::checkIndex(i, j, m_rows, m_cols);
+			return m_data[offset(b, i, j)];
+		}
+
+		/**
+		 * @brief Accesses element (i, j) of matrix b, always checking the indices (const version).
+		 *
+		 * @throws std::out_of_range If an index is out of bounds.
+		 */
+		const T &at(int b, int i, int j) const
+		{
+			detail::checkIndex(b, m_count);
+			detail::checkIndex(i, j, m_rows, m_cols);
+			return m_data[offset(b, i, j)];
+		}
+
+		/**
+		 * @brief Copies one matrix out of the batch.
+		 *
+		 * @param b The index of the matrix.
+		 * @return A copy of matrix b.
+		 * @throws std::out_of_range If b is out of bounds.
+		 */
+		Matrix<T> getMatrix(int b) const
+		{
+			detail::checkIndex(b, m_count);
+			Matrix<T> result(m_rows, m_cols);
+			for (int i = 0; i < m_rows; i++)
+			{
+				for (int j = 0; j < m_cols; j++)
+				{
+					result.coeffRef(i, j) = m_data[offset(b, i, j)];
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Overwrites one matrix of the batch.
+		 *
+		 * @param b The index of the matrix.
+		 * @param matrix The new contents; pass m.view() for a Matrix m.
+		 * @throws std::out_of_range If b is out of bounds.
+		 * @throws std::invalid_argument If the dimensions differ from the batch's.
+		 */
+		void setMatrix(int b, MatrixView<const T> matrix)
+		{
+			detail::checkIndex(b, m_count);
+			if (matrix.getRows() != m_rows || matrix.getCols() != m_cols)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			for (int i = 0; i < m_rows; i++)
+			{
+				for (int j = 0; j < m_cols; j++)
+				{
+					m_data[offset(b, i, j)] = matrix.coeff(i, j);
+				}
+			}
+		}
+
+		/**
+		 * @brief Adds another batch element-wise.
+		 *
+		 * @param other The batch to add.
+		 * @return Reference to this batch.
+		 * @throws std::invalid_argument If the batch sizes or dimensions differ.
+		 */
+		MatrixBatch &operator+=(const MatrixBatch &other)
+		{
+			return apply<simd::AddOp>(other);
+		}
+
+		/**
+		 * @brief Subtracts another batch element-wise.
+		 *
+		 * @param other The batch to subtract.
+		 * @return Reference to this batch.
+		 * @throws std::invalid_argument If the batch sizes or dimensions differ.
+		 */
+		MatrixBatch &operator-=(const MatrixBatch &other)
+		{
+			return apply<simd::SubOp>(other);
+		}
+
+		/**
+		 * @brief Scales every matrix of the batch.
+		 *
+		 * @param scalar The scalar value.
+		 * @return Reference to this batch.
+		 */
+		MatrixBatch &operator*=(const T &scalar)
+		{
+			parallelFor(0, m_data.size(), exec::PARALLEL_GRAIN, [&](std::size_t lo, std::size_t hi)
+						{ simd::withScalar<simd::MulOp>(m_data.data() + lo, scalar, m_data.data() + lo, hi - lo); });
+			return *this;
+		}
+
+		MatrixBatch operator+(const MatrixBatch &other) const
+		{
+			MatrixBatch result(*this);
+			return result += other;
+		}
+
+		MatrixBatch operator-(const MatrixBatch &other) const
+		{
+			MatrixBatch result(*this);
+			return result -= other;
+		}
+
+		MatrixBatch operator*(const T &scalar) const
+		{
+			MatrixBatch result(*this);
+			return result *= scalar;
+		}
+
+		/**
+		 * @brief Multiplies every matrix by the matching matrix of another batch.
+		 *
+		 * @param other The right-hand factors; other.getRows() must equal getCols().
+		 * @return The batch of products.
+		 * @throws std::invalid_argument If the batch sizes or inner dimensions differ.
+		 */
+		MatrixBatch operator*(const MatrixBatch &other) const
+		{
+			if (m_count != other.m_count)
+			{
+				throw std::invalid_argument("Batch sizes must match");
+			}
+			if (m_cols != other.m_rows)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			const int m = m_rows;
+			const int n = other.m_cols;
+			const int k = m_cols;
+			MatrixBatch result(m_count, m, n);
+			parallelFor(0, packCount(), grainFor(static_cast<std::size_t>(m) * n * k * LANES), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t p = lo; p < hi; p++)
+							{
+								detail::multiplyPack(m_data.data() + p * packSize(), other.m_data.data() + p * other.packSize(),
+													 result.m_data.data() + p * result.packSize(), m, n, k);
+							} });
+			return result;
+		}
+
+		/**
+		 * @brief Computes the determinant of every matrix.
+		 *
+		 * Floating-point batches use LU factorization with partial pivoting, integer batches
+		 * exact fraction-free (Bareiss) elimination, as SquareMatrix::determinant() does.
+		 *
+		 * @return One determinant per matrix, in batch order.
+		 * @throws std::invalid_argument If the matrices are not square.
+		 * @throws std::overflow_error For integer matrices whose elimination overflows (see determinantBareiss()).
+		 */
+		std::vector<T> determinants() const
+		{
+			if constexpr (std::is_integral<T>::value)
+			{
+				if (m_rows != m_cols)
+				{
+					throw std::invalid_argument("Matrix must be square");
+				}
+				std::vector<T> result(static_cast<std::size_t>(packCount()) * LANES);
+				parallelFor(0, packCount(), grainFor(static_cast<std::size_t>(m_rows) * m_rows * m_rows * LANES), [&](std::size_t lo, std::size_t hi)
+							{
+								for (std::size_t p = lo; p < hi; p++)
+								{
+									detail::bareissPack(m_data.data() + p * packSize(), m_rows, result.data() + p * LANES);
+								} });
+				result.resize(m_count);
+				return result;
+			}
+			else
+			{
+				return lu().determinants();
+			}
+		}
+
+		/**
+		 * @brief Factors every matrix for repeated solves or determinants.
+		 *
+		 * @return The batched LU factorization with partial pivoting.
+		 * @throws std::invalid_argument If the matrices are not square.
+		 */
+		BatchLU<T> lu() const
+		{
+			return BatchLU<T>(*this);
+		}
+
+		/**
+		 * @brief Solves A_b * X_b = B_b for every matrix A_b of the batch.
+		 *
+		 * @param rhs The right-hand sides: one getRows() x r matrix per matrix of the batch.
+		 * @return The solutions.
+		 * @throws std::invalid_argument If the shapes do not match.
+		 * @throws std::runtime_error If a matrix of the batch is singular.
+		 */
+		MatrixBatch solve(const MatrixBatch &rhs) const
+		{
+			return lu().solve(rhs);
+		}
+	};
+
+	/**
+	 * @brief LU factorizations P_b * A_b = L_b * U_b of every matrix of a batch.
+	 *
+	 * Each lane of a pack chooses its own pivots; row exchanges are done with per-lane selects
+	 * so that the elimination stays vectorized across the batch. Factor once, then call
+	 * determinants() or solve() as often as needed.
+	 *
+	 * @tparam T The element type (float or double).
+	 */
+	template <typename T>
+	class BatchLU
+	{
+		static_assert(!std::is_integral<T>::value, "LU needs a field type; convert integer matrices to floating point");
+
+		static constexpr int W = MatrixBatch<T>::LANES;
+
+		/**
+		 * @brief Packed factors of every matrix, as in LU::factors().
+		 */
+		MatrixBatch<T> m_lu;
+
+		/**
+		 * @brief Per pack, n x LANES pivot rows: lane l swapped row k with m_pivots[(p * n + k) * LANES + l].
+		 */
+		std::vector<int> m_pivots;
+
+		/**
+		 * @brief Permutation sign of every lane, +1 or -1.
+		 */
+		std::vector<T> m_sign;
+
+		/**
+		 * @brief Whether every lane met a zero pivot.
+		 */
+		std::vector<int> m_singular;
+
+		/**
+		 * @brief Factors the LANES matrices of pack p in place.
+		 */
+		void factorPack(int p)
+		{
+			const int n = size();
+			T *a = m_lu.data() + p * m_lu.packSize();
+			int *pivots = m_pivots.data() + static_cast<std::size_t>(p) * n * W;
+			T *sign = m_sign.data() + static_cast<std::size_t>(p) * W;
+			int *singular = m_singular.data() + static_cast<std::size_t>(p) * W;
+			auto at = [&](int i, int j)
+			{
+				return a + (static_cast<std::size_t>(i) * n + j) * W;
+			};
+			for (int l = 0; l < W; l++)
+			{
+				sign[l] = T(1);
+				singular[l] = 0;
+			}
+			T best[W], divisor[W];
+			int row[W], mask[W];
+			for (int k = 0; k < n; k++)
+			{
+				for (int l = 0; l < W; l++)
+				{
+					best[l] = std::abs(at(k, k)[l]);
+					row[l] = k;
+				}
+				for (int i = k + 1; i < n; i++)
+				{
+					const T *aik = at(i, k);
+					for (int l = 0; l < W; l++)
+					{
+						const T v = std::abs(aik[l]);
+						const int take = v > best[l];
+						best[l] = take ? v : best[l];
+						row[l] = take ? i : row[l];
+					}
+				}
+				for (int l = 0; l < W; l++)
+				{
+					pivots[k * W + l] = row[l];
+					sign[l] = row[l] != k ? -sign[l] : sign[l];
+				}
+				for (int i = k + 1; i < n; i++)
+				{
+					int any = 0;
+					for (int l = 0; l < W; l++)
+					{
+						mask[l] = row[l] == i;
+						any |= mask[l];
+					}
+					if (any)
+					{
+						detail::swapRowsWhere<T, T>(a, n, 0, k, i, mask);
+					}
+				}
+				const T *akk = at(k, k);
+				for (int l = 0; l < W; l++)
+				{
+					singular[l] |= akk[l] == T(0);
+					divisor[l] = akk[l] == T(0) ? T(1) : akk[l]; // A zero column below the pivot stays zero
+				}
+				for (int i = k + 1; i < n; i++)
+				{
+					T *lik = at(i, k);
+					for (int l = 0; l < W; l++)
+					{
+						lik[l] /= divisor[l];
+					}
+					for (int j = k + 1; j < n; j++)
+					{
+						T *aij = at(i, j);
+						const T *akj = at(k, j);
+						for (int l = 0; l < W; l++)
+						{
+							aij[l] -= lik[l] * akj[l];
+						}
+					}
+				}
+			}
+		}
+
+	public:
+		/**
+		 * @brief Factors every matrix of a batch.
+		 *
+		 * @param batch The batch of square matrices.
+		 * @throws std::invalid_argument If the matrices are not square.
+		 */
+		explicit BatchLU(const MatrixBatch<T> &batch) : m_lu(batch)
+		{
+			if (batch.getRows() != batch.getCols())
+			{
+				throw std::invalid_argument("Matrix must be square");
+			}
+			const int n = size();
+			const std::size_t lanes = static_cast<std::size_t>(m_lu.packCount()) * W;
+			m_pivots.resize(lanes * n);
+			m_sign.resize(lanes);
+			m_singular.resize(lanes);
+			parallelFor(0, m_lu.packCount(), grainFor(static_cast<std::size_t>(n) * n * n * W), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t p = lo; p < hi; p++)
+							{
+								factorPack(static_cast<int>(p));
+							} });
+		}
+
+		/**
+		 * @brief Gets the order of the factored matrices.
+		 *
+		 * @return Number of rows (and columns) of each matrix.
+		 */
+		int size() const
+		{
+			return m_lu.getRows();
+		}
+
+		/**
+		 * @brief Gets the number of factored matrices.
+		 *
+		 * @return The batch size.
+		 */
+		int count() const
+		{
+			return m_lu.size();
+		}
+
+		/**
+		 * @brief Tells whether a factored matrix is singular.
+		 *
+		 * @param b The index of the matrix.
+		 * @return True if a zero pivot was met.
+		 * @throws std::out_of_range If b is out of bounds.
+		 */
+		bool isSingular(int b) const
+		{
+			detail::checkIndex(b, count());
+			return m_singular[b] != 0;
+		}
+
+		/**
+		 * @brief Gets the packed factors, as LU::factors() does for each matrix.
+		 *
+		 * @return The batch of packed L\U matrices.
+		 */
+		const MatrixBatch<T> &factors() const
+		{
+			return m_lu;
+		}
+
+		/**
+		 * @brief Computes the determinants from the diagonals of U.
+		 *
+		 * @return One determinant per matrix; zero for singular ones.
+		 */
+		std::vector<T> determinants() const
+		{
+			const int n = size();
+			std::vector<T> result(m_sign.size());
+			parallelFor(0, m_lu.packCount(), grainFor(static_cast<std::size_t>(n) * W), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t p = lo; p < hi; p++)
+							{
+								const T *a = m_lu.data() + p * m_lu.packSize();
+								T det[W];
+								for (int l = 0; l < W; l++)
+								{
+									det[l] = m_sign[p * W + l];
+								}
+								for (int i = 0; i < n; i++)
+								{
+									const T *aii = a + (static_cast<std::size_t>(i) * n + i) * W;
+									for (int l = 0; l < W; l++)
+									{
+										det[l] *= aii[l];
+									}
+								}
+								for (int l = 0; l < W; l++)
+								{
+									result[p * W + l] = m_singular[p * W + l] ? T() : det[l];
+								}
+							} });
+			result.resize(count());
+			return result;
+		}
+
+		/**
+		 * @brief Solves A_b * X_b = B_b for every factored matrix.
+		 *
+		 * @param rhs The right-hand sides: one size() x r matrix per factored matrix.
+		 * @return The solutions.
+		 * @throws std::invalid_argument If rhs does not hold count() matrices of size() rows.
+		 * @throws std::runtime_error If a factored matrix is singular.
+		 */
+		MatrixBatch<T> solve(const MatrixBatch<T> &rhs) const
+		{
+			if (rhs.size() != count())
+			{
+				throw std::invalid_argument("Batch sizes must match");
+			}
+			if (rhs.getRows() != size())
+			{
+				throw std::invalid_argument("Right-hand side must have as many rows as the matrix");
+			}
+			for (int b = 0; b < count(); b++)
+			{
+				if (m_singular[b])
+				{
+					throw std::runtime_error("Matrix " + std::to_string(b) + " of the batch is singular");
+				}
+			}
+			const int n = size();
+			const int r = rhs.getCols();
+			MatrixBatch<T> x(rhs);
+			parallelFor(0, m_lu.packCount(), grainFor(static_cast<std::size_t>(n) * n * r * W), [&](std::size_t lo, std::size_t hi)
+						{
+							int mask[W];
+							T divisor[W];
+							for (std::size_t p = lo; p < hi; p++)
+							{
+								const T *a = m_lu.data() + p * m_lu.packSize();
+								const int *pivots = m_pivots.data() + p * n * W;
+								T *xp = x.data() + p * x.packSize();
+								auto lu = [&](int i, int j)
+								{
+									return a + (static_cast<std::size_t>(i) * n + j) * W;
+								};
+								auto xr = [&](int i, int j)
+								{
+									return xp + (static_cast<std::size_t>(i) * r + j) * W;
+								};
+								for (int k = 0; k < n; k++)
+								{
+									for (int i = k + 1; i < n; i++)
+									{
+										int any = 0;
+										for (int l = 0; l < W; l++)
+										{
+											mask[l] = pivots[k * W + l] == i;
+											any |= mask[l];
+										}
+										if (any)
+										{
+											detail::swapRowsWhere<T, T>(xp, r, 0, k, i, mask);
+										}
+									}
+								}
+								// Forward substitution with unit lower L
+								for (int i = 1; i < n; i++)
+								{
+									for (int k = 0; k < i; k++)
+									{
+										const T *lik = lu(i, k);
+										for (int j = 0; j < r; j++)
+										{
+											T *xij = xr(i, j);
+											const T *xkj = xr(k, j);
+											for (int l = 0; l < W; l++)
+											{
+												xij[l] -= lik[l] * xkj[l];
+											}
+										}
+									}
+								}
+								// Back substitution with upper U; padding lanes divide by one
+								for (int i = n - 1; i >= 0; i--)
+								{
+									for (int k = i + 1; k < n; k++)
+									{
+										const T *uik = lu(i, k);
+										for (int j = 0; j < r; j++)
+										{
+											T *xij = xr(i, j);
+											const T *xkj = xr(k, j);
+											for (int l = 0; l < W; l++)
+											{
+												xij[l] -= uik[l] * xkj[l];
+											}
+										}
+									}
+									const T *uii = lu(i, i);
+									for (int l = 0; l < W; l++)
+									{
+										divisor[l] = uii[l] == T(0) ? T(1) : uii[l];
+									}
+									for (int j = 0; j < r; j++)
+									{
+										T *xij = xr(i, j);
+										for (int l = 0; l < W; l++)
+										{
+											xij[l] /= divisor[l];
+										}
+									}
+								} } });
+			return x;
+		}
+	};
+}
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "matrix.hpp"
+#include "matrixview.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MG_HAS_MMAP 1
+#endif
+
+/**
+ * @brief Binary matrix files: a fixed 64-byte header followed by the raw row-major elements.
+ *
+ * Header (all integers in the byte order recorded in it):
+ *
+ *   offset size field
+ *   0      4    magic "MGMX"
+ *   4      2    format version (MATRIX_FILE_VERSION)
+ *   6      1    element type (DType)
+ *   7      1    byte order (1 = little endian, 2 = big endian)
+ *   8      4    element size in bytes
+ *   12     4    alignment of the element data within the file
+ *   16     8    rows
+ *   24     8    columns
+ *   32     8    stride (elements between the starts of consecutive rows)
+ *   40     8    offset of element (0, 0) from the start of the file
+ *   48     16   reserved, zero
+ *
+ * The data offset is a multiple of the alignment (MATRIX_ALIGNMENT), so a memory-mapped file
+ * is as aligned as a Matrix buffer and can be read in place by every kernel.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Current version of the binary matrix format.
+	 */
+	constexpr std::uint16_t MATRIX_FILE_VERSION = 1;
+
+	/**
+	 * @brief Element types that can be stored in a matrix file.
+	 */
+	enum class DType : std::uint8_t
+	{
+		Int8 = 1,
+		Int16 = 2,
+		Int32 = 3,
+		Int64 = 4,
+		UInt8 = 5,
+		UInt16 = 6,
+		UInt32 = 7,
+		UInt64 = 8,
+		Float32 = 9,
+		Float64 = 10
+	};
+
+	/**
+	 * @brief On-disk header of a matrix file.
+	 */
+	struct MatrixFileHeader
+	{
+		char magic[4];
+		std::uint16_t version;
+		std::uint8_t dtype;
+		std::uint8_t byteOrder;
+		std::uint32_t elementSize;
+		std::uint32_t alignment;
+		std::uint64_t rows;
+		std::uint64_t cols;
+		std::uint64_t stride;
+		std::uint64_t dataOffset;
+		std::uint8_t reserved[16];
+	};
+
+	static_assert(sizeof(MatrixFileHeader) == 64, "Matrix file header must be 64 bytes");
+
+	namespace detail
+	{
+		template <typename T>
+		struct DTypeOf;
+
+		template <>
+		struct DTypeOf<std::int8_t> : std::integral_constant<DType, DType::Int8>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::int16_t> : std::integral_constant<DType, DType::Int16>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::int32_t> : std::integral_constant<DType, DType::Int32>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::int64_t> : std::integral_constant<DType, DType::Int64>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::uint8_t> : std::integral_constant<DType, DType::UInt8>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::uint16_t> : std::integral_constant<DType, DType::UInt16>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::uint32_t> : std::integral_constant<DType, DType::UInt32>
+		{
+		};
+
+		template <>
+		struct DTypeOf<std::uint64_t> : std::integral_constant<DType, DType::UInt64>
+		{
+		};
+
+		template <>
+		struct DTypeOf<float> : std::integral_constant<DType, DType::Float32>
+		{
+		};
+
+		template <>
+		struct DTypeOf<double> : std::integral_constant<DType, DType::Float64>
+		{
+		};
+
+		/**
+		 * @brief Byte order of this machine, as recorded in the header.
+		 */
+		inline std::uint8_t nativeByteOrder()
+		{
+			const std::uint16_t probe = 1;
+			unsigned char first;
+			std::memcpy(&first, &probe, 1);
+			return first == 1 ? 1 : 2;
+		}
+
+		inline void swapBytes(void *value, std::size_t size)
+		{
+			unsigned char *bytes = static_cast<unsigned char *>(value);
+			for (std::size_t k = 0; k < size / 2; k++)
+			{
+				std::swap(bytes[k], bytes[size - 1 - k]);
+			}
+		}
+
+		/**
+		 * @brief Converts a header written on a machine of the other byte order.
+		 */
+		inline void swapHeader(MatrixFileHeader &header)
+		{
+			swapBytes(&header.version, sizeof(header.version));
+			swapBytes(&header.elementSize, sizeof(header.elementSize));
+			swapBytes(&header.alignment, sizeof(header.alignment));
+			swapBytes(&header.rows, sizeof(header.rows));
+			swapBytes(&header.cols, sizeof(header.cols));
+			swapBytes(&header.stride, sizeof(header.stride));
+			swapBytes(&header.dataOffset, sizeof(header.dataOffset));
+		}
+
+		/**
+		 * @brief Checks a header read from path against the element type T and the file size.
+		 *
+		 * @param header The header, in native byte order.
+		 * @param fileSize Size of the file in bytes.
+		 * @param path File name, for error messages.
+		 * @return Number of bytes from element (0, 0) to the end of the last row.
+		 * @throws std::runtime_error If the file is not a matrix of T, is misaligned or is truncated.
+		 */
+		template <typename T>
+		std::size_t validateHeader(const MatrixFileHeader &header, std::uint64_t fileSize, const std::string &path)
+		{
+			if (header.version == 0 || header.version > MATRIX_FILE_VERSION)
+			{
+				throw std::runtime_error("Unsupported matrix file version in " + path);
+			}
+			if (header.dtype != static_cast<std::uint8_t>(DTypeOf<T>::value) || header.elementSize != sizeof(T))
+			{
+				throw std::runtime_error("Element type of " + path + " does not match");
+			}
+			if (header.rows > static_cast<std::uint64_t>(INT32_MAX) || header.cols > static_cast<std::uint64_t>(INT32_MAX) ||
+				header.stride > static_cast<std::uint64_t>(INT32_MAX) || (header.rows > 1 && header.stride < header.cols))
+			{
+				throw std::runtime_error("Invalid matrix dimensions in " + path);
+			}
+			// A misaligned offset would make the mapped elements misaligned T objects
+			if (header.alignment == 0 || (header.alignment & (header.alignment - 1)) != 0 ||
+				header.dataOffset % header.alignment != 0 || header.dataOffset % alignof(T) != 0)
+			{
+				throw std::runtime_error("Invalid data alignment in " + path);
+			}
+			// At most 2^62 elements, so only the byte count could wrap; compare element counts instead
+			const std::uint64_t elements = header.rows == 0 || header.cols == 0 ? 0 : (header.rows - 1) * header.stride + header.cols;
+			if (header.dataOffset < sizeof(MatrixFileHeader) || header.dataOffset > fileSize ||
+				elements > (fileSize - header.dataOffset) / sizeof(T))
+			{
+				throw std::runtime_error("Matrix file " + path + " is truncated");
+			}
+			return static_cast<std::size_t>(elements * sizeof(T));
+		}
+
+		/**
+		 * @brief Builds the header of a file holding a compact rows x cols matrix of T.
+		 */
+		template <typename T>
+		MatrixFileHeader makeHeader(int rows, int cols)
+		{
+			MatrixFileHeader header = {};
+			std::memcpy(header.magic, "MGMX", 4);
+			header.version = MATRIX_FILE_VERSION;
+			header.dtype = static_cast<std::uint8_t>(DTypeOf<T>::value);
+			header.byteOrder = nativeByteOrder();
+			header.elementSize = sizeof(T);
+			header.alignment = MATRIX_ALIGNMENT;
+			header.rows = static_cast<std::uint64_t>(rows);
+			header.cols = static_cast<std::uint64_t>(cols);
+			header.stride = header.cols;
+			header.dataOffset = (sizeof(MatrixFileHeader) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+			return header;
+		}
+
+		/**
+		 * @brief Writes a header and the padding up to its data offset.
+		 */
+		inline void writeHeader(std::ostream &file, const MatrixFileHeader &header)
+		{
+			file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			const std::vector<char> padding(header.dataOffset - sizeof(header), 0);
+			file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+		}
+
+		/**
+		 * @brief Reads the header of a matrix file and converts it to native byte order.
+		 *
+		 * @param file The open file, positioned at its start.
+		 * @param path File name, for error messages.
+		 * @return The header; byteOrder still records the byte order of the data.
+		 * @throws std::runtime_error If the file is not a matrix file.
+		 */
+		inline MatrixFileHeader readHeader(std::istream &file, const std::string &path)
+		{
+			MatrixFileHeader header;
+			if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, "MGMX", 4) != 0)
+			{
+				throw std::runtime_error(path + " is not a matrix file");
+			}
+			if (header.byteOrder != 1 && header.byteOrder != 2)
+			{
+				throw std::runtime_error("Invalid byte order in " + path);
+			}
+			if (header.byteOrder != nativeByteOrder())
+			{
+				swapHeader(header);
+			}
+			return header;
+		}
+	}
+
+	/**
+	 * @brief Writes a matrix (or any view) to a binary matrix file.
+	 *
+	 * Rows are written back to back, so the stored stride equals the number of columns.
+	 *
+	 * @param matrix The elements to write.
+	 * @param path The file to create or overwrite.
+	 * @throws std::runtime_error If the file cannot be written.
+	 */
+	template <typename T>
+	void saveMatrix(MatrixView<const T> matrix, const std::string &path)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		detail::writeHeader(file, detail::makeHeader<T>(matrix.getRows(), matrix.getCols()));
+		const std::size_t rowBytes = static_cast<std::size_t>(matrix.getCols()) * sizeof(T);
+		if (detail::isContiguous(matrix))
+		{
+			file.write(reinterpret_cast<const char *>(matrix.data()), static_cast<std::streamsize>(rowBytes * matrix.getRows()));
+		}
+		else
+		{
+			for (int i = 0; i < matrix.getRows(); i++)
+			{
+				file.write(reinterpret_cast<const char *>(matrix.data() + static_cast<std::size_t>(i) * matrix.getStride()), static_cast<std::streamsize>(rowBytes));
+			}
+		}
+		if (!file.flush())
+		{
+			throw std::runtime_error("Cannot write " + path);
+		}
+	}
+
+	/**
+	 * @brief Writes a view of a mutable matrix to a binary matrix file.
+	 */
+	template <typename T>
+	void saveMatrix(MatrixView<T> matrix, const std::string &path)
+	{
+		saveMatrix<T>(MatrixView<const T>(matrix), path);
+	}
+
+	/**
+	 * @brief Writes a matrix to a binary matrix file; read it back with loadMatrix<T>(path) or mapMatrix<T>(path).
+	 */
+	template <typename T>
+	void saveMatrix(const Matrix<T> &matrix, const std::string &path)
+	{
+		saveMatrix<T>(matrix.view(), path);
+	}
+
+	template <typename T>
+	void Matrix<T>::save(const std::string &path) const
+	{
+		saveMatrix<T>(view(), path);
+	}
+
+	/**
+	 * @brief Reads a binary matrix file into a new matrix, converting the byte order if needed.
+	 *
+	 * @tparam T The element type stored in the file.
+	 * @param path The file to read.
+	 * @return The matrix.
+	 * @throws std::runtime_error If the file cannot be read or does not hold a matrix of T.
+	 */
+	template <typename T>
+	Matrix<T> loadMatrix(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			throw std::runtime_error("Cannot open " + path);
+		}
+		const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+		file.seekg(0);
+		const MatrixFileHeader header = detail::readHeader(file, path);
+		detail::validateHeader<T>(header, fileSize, path);
+
+		Matrix<T> matrix(static_cast<int>(header.rows), static_cast<int>(header.cols));
+		const std::size_t rowBytes = static_cast<std::size_t>(header.cols) * sizeof(T);
+		for (int i = 0; i < matrix.getRows(); i++)
+		{
+			file.seekg(static_cast<std::streamoff>(header.dataOffset + i * header.stride * sizeof(T)));
+			if (!file.read(reinterpret_cast<char *>(matrix.data() + static_cast<std::size_t>(i) * matrix.getStride()), static_cast<std::streamsize>(rowBytes)))
+			{
+				throw std::runtime_error("Cannot read " + path);
+			}
+		}
+		if (header.byteOrder != detail::nativeByteOrder() && sizeof(T) > 1)
+		{
+			for (int i = 0; i < matrix.getRows(); i++)
+			{
+				T *row = matrix.data() + static_cast<std::size_t>(i) * matrix.getStride();
+				for (int j = 0; j < matrix.getCols(); j++)
+				{
+					detail::swapBytes(row + j, sizeof(T));
+				}
+			}
+		}
+		return matrix;
+	}
+
+	/**
+	 * @brief A read-only view of a matrix file mapped into memory.
+	 *
+	 * The elements are paged in from the file on first access and never copied; the mapping
+	 * is released when the object is destroyed. Being a MatrixView, it can be used directly as
+	 * an operand; views and expressions built from it must not outlive it.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	class MappedMatrix : public MatrixView<const T>
+	{
+	private:
+		void *m_mapping = nullptr;
+		std::size_t m_length = 0;
+
+		/**
+		 * @brief Holds the elements on platforms without mmap.
+		 */
+		std::vector<T, AlignedAllocator<T>> m_buffer;
+
+		void release()
+		{
+#ifdef MG_HAS_MMAP
+			if (m_mapping != nullptr)
+			{
+				munmap(m_mapping, m_length);
+			}
+#endif
+			m_mapping = nullptr;
+			m_length = 0;
+			m_buffer.clear();
+		}
+
+		template <typename U>
+		friend MappedMatrix<U> mapMatrix(const std::string &path);
+
+	public:
+		MappedMatrix() = default;
+		MappedMatrix(const MappedMatrix &) = delete;
+		MappedMatrix &operator=(const MappedMatrix &) = delete;
+
+		MappedMatrix(MappedMatrix &&other) noexcept : MatrixView<const T>(other), m_mapping(other.m_mapping), m_length(other.m_length), m_buffer(std::move(other.m_buffer))
+		{
+			other.m_mapping = nullptr;
+			other.m_length = 0;
+			other.m_data = nullptr;
+			other.m_rows = other.m_cols = other.m_stride = 0;
+		}
+
+		MappedMatrix &operator=(MappedMatrix &&other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				this->m_data = other.m_data;
+				this->m_rows = other.m_rows;
+				this->m_cols = other.m_cols;
+				this->m_stride = other.m_stride;
+				m_mapping = other.m_mapping;
+				m_length = other.m_length;
+				m_buffer = std::move(other.m_buffer);
+				other.m_mapping = nullptr;
+				other.m_length = 0;
+				other.m_data = nullptr;
+				other.m_rows = other.m_cols = other.m_stride = 0;
+			}
+			return *this;
+		}
+
+		~MappedMatrix()
+		{
+			release();
+		}
+	};
+
+	/**
+	 * @brief Maps a binary matrix file into memory without reading or copying it.
+	 *
+	 * @tparam T The element type stored in the file.
+	 * @param path The file to map.
+	 * @return A read-only view of the file's elements.
+	 * @throws std::runtime_error If the file cannot be mapped, does not hold a matrix of T, or
+	 *         was written on a machine of the other byte order (use loadMatrix() for those).
+	 */
+	template <typename T>
+	MappedMatrix<T> mapMatrix(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			throw std::runtime_error("Cannot open " + path);
+		}
+		const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+		file.seekg(0);
+		const MatrixFileHeader header = detail::readHeader(file, path);
+		const std::size_t bytes = detail::validateHeader<T>(header, fileSize, path);
+		if (header.byteOrder != detail::nativeByteOrder() && sizeof(T) > 1)
+		{
+			throw std::runtime_error("Byte order of " + path + " differs from this machine; it cannot be mapped");
+		}
+
+		MappedMatrix<T> mapped;
+		const T *data = nullptr;
+		if (bytes > 0)
+		{
+#ifdef MG_HAS_MMAP
+			file.close();
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				throw std::runtime_error("Cannot open " + path);
+			}
+			const std::size_t length = static_cast<std::size_t>(header.dataOffset) + bytes;
+			void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (mapping == MAP_FAILED)
+			{
+				throw std::runtime_error("Cannot map " + path);
+			}
+			mapped.m_mapping = mapping;
+			mapped.m_length = length;
+			data = reinterpret_cast<const T *>(static_cast<const char *>(mapping) + header.dataOffset);
+#else
+			mapped.m_buffer.resize((bytes + sizeof(T) - 1) / sizeof(T));
+			file.seekg(static_cast<std::streamoff>(header.dataOffset));
+			if (!file.read(reinterpret_cast<char *>(mapped.m_buffer.data()), static_cast<std::streamsize>(bytes)))
+			{
+				throw std::runtime_error("Cannot read " + path);
+			}
+			data = mapped.m_buffer.data();
+#endif
+		}
+		mapped.m_data = data;
+		mapped.m_rows = static_cast<int>(header.rows);
+		mapped.m_cols = static_cast<int>(header.cols);
+		mapped.m_stride = static_cast<int>(header.stride);
+		return mapped;
+	}
+}
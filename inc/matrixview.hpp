@@ -0,0 +1,862 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include "boundscheck.hpp"
+#include "expression.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+#include "simd.hpp"
+#include "strassen.hpp"
+#include "transpose.hpp"
+
+/**
+ * @brief Non-owning views of matrix storage, and the kernels that evaluate expressions into them.
+ *
+ * A view is a pointer, dimensions and a row stride into memory owned by someone else (usually
+ * a Matrix). Slicing is free: no allocation, no copy. Views take part in expressions exactly
+ * like matrices (SIMD element-wise kernels, GEMM operands, blocked transpose), and a view of a
+ * mutable matrix can be assigned to, which writes through to the matrix.
+ *
+ * A view does not keep its matrix alive and is invalidated by anything that reallocates the
+ * matrix (assigning a different size, adding or removing rows or columns).
+ */
+
+namespace mg
+{
+	namespace detail
+	{
+		/**
+		 * @brief Tells whether two address ranges [aBegin, aEnd) and [bBegin, bEnd) share any byte.
+		 */
+		inline bool overlaps(const void *aBegin, const void *aEnd, const void *bBegin, const void *bEnd)
+		{
+			std::less<const void *> less;
+			return aBegin != aEnd && bBegin != bEnd && less(aBegin, bEnd) && less(bBegin, aEnd);
+		}
+
+		/**
+		 * @brief Tells whether a leaf's rows follow each other without padding.
+		 */
+		template <typename L>
+		bool isContiguous(const L &leaf)
+		{
+			return leaf.getStride() == leaf.getCols() || leaf.getRows() <= 1;
+		}
+
+		/**
+		 * @brief Classifies an expression for the profiler (see profile.hpp).
+		 */
+		template <typename E>
+		constexpr profile::Op profileOp()
+		{
+			if constexpr (E::isLeaf)
+			{
+				return profile::Op::Copy;
+			}
+			else if constexpr (IsLeafTransposeExpr<E>::value)
+			{
+				return profile::Op::Transpose;
+			}
+			else if constexpr (IsProductExpr<E>::value || IsProductSum<E>::value)
+			{
+				return profile::Op::Multiply;
+			}
+			else if constexpr (IsLeafBinaryExpr<E>::value)
+			{
+				// op_type is only named once the trait has matched: other nodes need not have one
+				if constexpr (std::is_same<typename E::op_type, simd::AddOp>::value)
+				{
+					return profile::Op::Add;
+				}
+				else if constexpr (std::is_same<typename E::op_type, simd::SubOp>::value)
+				{
+					return profile::Op::Subtract;
+				}
+				else
+				{
+					return profile::Op::Elementwise;
+				}
+			}
+			else if constexpr (IsLeafScalarExpr<E>::value)
+			{
+				if constexpr (std::is_same<typename E::op_type, simd::MulOp>::value)
+				{
+					return profile::Op::Scale;
+				}
+				else
+				{
+					return profile::Op::Elementwise;
+				}
+			}
+			else
+			{
+				return profile::Op::Elementwise;
+			}
+		}
+
+		/**
+		 * @brief Classifies dst = Op(dst, expr) for the profiler.
+		 */
+		template <typename Op, typename E>
+		constexpr profile::Op profileCompoundOp()
+		{
+			if constexpr (IsProductExpr<E>::value && std::is_same<Op, simd::AddOp>::value)
+			{
+				return profile::Op::Multiply;
+			}
+			else if constexpr (std::is_same<Op, simd::AddOp>::value)
+			{
+				return profile::Op::Add;
+			}
+			else if constexpr (std::is_same<Op, simd::SubOp>::value)
+			{
+				return profile::Op::Subtract;
+			}
+			else
+			{
+				return profile::Op::Elementwise;
+			}
+		}
+
+		/**
+		 * @brief The inner dimension of a product expression, for the profiler's shape histogram; 0 otherwise.
+		 */
+		template <typename E>
+		int profileInner(const E &expr)
+		{
+			if constexpr (IsProductExpr<E>::value)
+			{
+				return expr.lhs().getCols();
+			}
+			else if constexpr (IsProductSum<E>::value)
+			{
+				if constexpr (IsProductExpr<typename E::lhs_type>::value)
+				{
+					return expr.lhs().lhs().getCols();
+				}
+				else
+				{
+					return expr.rhs().lhs().getCols();
+				}
+			}
+			else
+			{
+				return 0;
+			}
+		}
+
+		template <typename T, typename E>
+		void evaluateInto(const MatrixView<T> &dst, const E &expr);
+
+		template <typename Op, typename T, typename E>
+		void compoundInto(const MatrixView<T> &dst, const E &expr);
+	}
+
+	/**
+	 * @brief Non-owning strided window onto row-major matrix storage.
+	 *
+	 * Element (i, j) lives at data() + i * getStride() + j. MatrixView<const T> is a read-only
+	 * view; MatrixView<T> can also be written through.
+	 *
+	 * @tparam T The element type, const-qualified for a read-only view.
+	 */
+	template <typename T>
+	class MatrixView : public MatrixExpr<MatrixView<T>>
+	{
+	protected:
+		/**
+		 * @brief Address of element (0, 0).
+		 */
+		T *m_data;
+
+		/**
+		 * @brief Number of rows in the view.
+		 */
+		int m_rows;
+
+		/**
+		 * @brief Number of columns in the view.
+		 */
+		int m_cols;
+
+		/**
+		 * @brief Distance in elements between the starts of consecutive rows.
+		 */
+		int m_stride;
+
+		/**
+		 * @brief Computes the offset of element (i, j) from data().
+		 */
+		std::size_t index(int i, int j) const
+		{
+			return static_cast<std::size_t>(i) * m_stride + j;
+		}
+
+	public:
+		/**
+		 * @brief The element type, as seen by expressions.
+		 */
+		using value_type = typename std::remove_const<T>::type;
+
+		/**
+		 * @brief Expression flags: a view reads strided storage element by element.
+		 */
+		static constexpr bool isLeaf = true;
+		static constexpr bool elementwise = true;
+
+		/**
+		 * @brief Constructs an empty view.
+		 */
+		MatrixView() : m_data(nullptr), m_rows(0), m_cols(0), m_stride(0) {}
+
+		/**
+		 * @brief Constructs a view of existing storage.
+		 *
+		 * @param data Address of element (0, 0).
+		 * @param rows Number of rows.
+		 * @param cols Number of columns.
+		 * @param stride Distance in elements between the starts of consecutive rows.
+		 * @throws std::invalid_argument If a dimension is negative or the stride is smaller than cols.
+		 */
+		MatrixView(T *data, int rows, int cols, int stride) : m_data(data), m_rows(rows), m_cols(cols), m_stride(stride)
+		{
+			if (rows < 0 || cols < 0 || (rows > 1 && stride < cols))
+			{
+				throw std::invalid_argument("Invalid view dimensions");
+			}
+		}
+
+		/**
+		 * @brief Constructs a view that shares the storage of another view (no elements are copied).
+		 */
+		MatrixView(const MatrixView &other) = default;
+
+		/**
+		 * @brief Converts a mutable view to a read-only one.
+		 */
+		template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+		MatrixView(const MatrixView<U> &other) : MatrixView(other.data(), other.getRows(), other.getCols(), other.getStride())
+		{
+		}
+
+		int getRows() const
+		{
+			return m_rows;
+		}
+
+		int getCols() const
+		{
+			return m_cols;
+		}
+
+		int getStride() const
+		{
+			return m_stride;
+		}
+
+		/**
+		 * @brief Gives direct access to the viewed storage.
+		 *
+		 * @return Pointer to element (0, 0); row i starts at data() + i * getStride().
+		 */
+		T *data() const
+		{
+			return m_data;
+		}
+
+		/**
+		 * @brief Accesses an element of the view, checking the indices only if MG_BOUNDS_CHECK is on.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Reference to the element at the specified position.
+		 * @throws std::out_of_range If bounds checking is on and the indices are out of bounds.
+		 */
+		T &operator()(int i, int j) const
+		{
+			if constexpr (BOUNDS_CHECK)
+			{
+				detail::checkIndex(i, j, m_rows, m_cols);
+			}
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Accesses an element of the view, always checking the indices.
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return Reference to the element at the specified position.
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T &at(int i, int j) const
+		{
+			detail::checkIndex(i, j, m_rows, m_cols);
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Reads an element without bounds checking; used by expression evaluation.
+		 */
+		const value_type &coeff(int i, int j) const
+		{
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Accesses an element without bounds checking.
+		 */
+		T &coeffRef(int i, int j) const
+		{
+			return m_data[index(i, j)];
+		}
+
+		/**
+		 * @brief Gets a pointer to the first element of a row.
+		 *
+		 * @param i The row index; not checked.
+		 * @return Pointer to element (i, 0); the row's getCols() elements are contiguous.
+		 */
+		T *rowPtr(int i) const
+		{
+			return m_data + index(i, 0);
+		}
+
+		/**
+		 * @brief Tells an expression whether the viewed elements overlap the given address range.
+		 *
+		 * @param begin Start of the range.
+		 * @param end One past the end of the range.
+		 * @return True if any viewed element lies inside [begin, end).
+		 */
+		bool references(const void *begin, const void *end) const
+		{
+			if (m_rows == 0 || m_cols == 0)
+			{
+				return false;
+			}
+			return detail::overlaps(m_data, m_data + index(m_rows - 1, m_cols), begin, end);
+		}
+
+		/**
+		 * @brief Expression hook; a view is always ready to be read.
+		 */
+		void prepare() const {}
+
+		/**
+		 * @brief Views one row.
+		 *
+		 * @param i The row index.
+		 * @return A 1 x getCols() view of row i.
+		 * @throws std::out_of_range If the row index is out of bounds.
+		 */
+		RowView<T> row(int i) const
+		{
+			if (i >= m_rows || i < 0)
+			{
+				throw std::out_of_range("Out of bounds");
+			}
+			return RowView<T>(m_data + index(i, 0), m_cols);
+		}
+
+		/**
+		 * @brief Views one column.
+		 *
+		 * @param j The column index.
+		 * @return A getRows() x 1 view of column j.
+		 * @throws std::out_of_range If the column index is out of bounds.
+		 */
+		ColView<T> col(int j) const
+		{
+			if (j >= m_cols || j < 0)
+			{
+				throw std::out_of_range("Out of bounds");
+			}
+			return ColView<T>(m_data + j, m_rows, m_stride);
+		}
+
+		/**
+		 * @brief Views a rectangular block.
+		 *
+		 * @param i Row of the block's top-left element.
+		 * @param j Column of the block's top-left element.
+		 * @param rows Number of rows in the block.
+		 * @param cols Number of columns in the block.
+		 * @return A rows x cols view sharing this view's stride.
+		 * @throws std::out_of_range If the block does not fit inside the view.
+		 */
+		BlockView<T> block(int i, int j, int rows, int cols) const
+		{
+			if (i < 0 || j < 0 || rows < 0 || cols < 0 || i > m_rows - rows || j > m_cols - cols)
+			{
+				throw std::out_of_range("Block out of bounds");
+			}
+			return BlockView<T>(m_data + index(i, j), rows, cols, m_stride);
+		}
+
+		/**
+		 * @brief Sets all viewed elements to a specified value.
+		 *
+		 * @param val The value to set.
+		 */
+		void setValues(const value_type &val) const
+		{
+			static_assert(!std::is_const<T>::value, "Cannot write through a read-only view");
+			parallelFor(0, m_rows, grainFor(m_cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+							{
+								simd::fill(m_data + index(i, 0), val, m_cols);
+							} });
+		}
+
+		/**
+		 * @brief Copies the elements of another view into this one; both must have the same dimensions.
+		 *
+		 * Views have reference semantics for construction but value semantics for assignment:
+		 * a = b writes b's elements into the storage a refers to.
+		 *
+		 * @param other The view to copy from.
+		 * @return Reference to this view.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		MatrixView &operator=(const MatrixView &other)
+		{
+			return *this = static_cast<const MatrixExpr<MatrixView> &>(other);
+		}
+
+		/**
+		 * @brief Evaluates a matrix expression into the viewed storage.
+		 *
+		 * @param expr The expression; must have the dimensions of this view.
+		 * @return Reference to this view.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		template <typename E>
+		MatrixView &operator=(const MatrixExpr<E> &expr)
+		{
+			static_assert(!std::is_const<T>::value, "Cannot write through a read-only view");
+			const E &other = expr.self();
+			checkSize(other);
+			MG_PROFILE_SCOPE(detail::profileOp<E>(), m_rows, m_cols, detail::profileInner(other));
+			if (other.references(m_data, end()))
+			{
+				// Operands overlap the destination; evaluate them before writing anything
+				Matrix<value_type> result(other);
+				detail::evaluateInto(*this, result);
+				return *this;
+			}
+			detail::evaluateInto(*this, other);
+			return *this;
+		}
+
+		/**
+		 * @brief Adds a matrix expression to the viewed elements.
+		 *
+		 * @param expr The expression to add.
+		 * @return Reference to this view.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		template <typename E>
+		MatrixView &operator+=(const MatrixExpr<E> &expr)
+		{
+			return compound<simd::AddOp>(expr.self());
+		}
+
+		/**
+		 * @brief Subtracts a matrix expression from the viewed elements.
+		 *
+		 * @param expr The expression to subtract.
+		 * @return Reference to this view.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		template <typename E>
+		MatrixView &operator-=(const MatrixExpr<E> &expr)
+		{
+			return compound<simd::SubOp>(expr.self());
+		}
+
+		/**
+		 * @brief Scales the viewed elements by a scalar.
+		 *
+		 * @param scalar The scalar value.
+		 * @return Reference to this view.
+		 */
+		MatrixView &operator*=(const value_type &scalar)
+		{
+			static_assert(!std::is_const<T>::value, "Cannot write through a read-only view");
+			MG_PROFILE_SCOPE(profile::Op::Scale, m_rows, m_cols);
+			detail::evaluateInto(*this, (*this) * scalar);
+			return *this;
+		}
+
+		/**
+		 * @brief Prints the viewed elements to an output stream.
+		 */
+		friend std::ostream &operator<<(std::ostream &os, const MatrixView &view)
+		{
+			for (int i = 0; i < view.m_rows; i++)
+			{
+				for (int j = 0; j < view.m_cols; j++)
+				{
+					os << view.coeff(i, j) << " ";
+				}
+				os << '\n';
+			}
+			return os;
+		}
+
+	private:
+		/**
+		 * @brief One past the last viewed element.
+		 */
+		T *end() const
+		{
+			return m_rows == 0 || m_cols == 0 ? m_data : m_data + index(m_rows - 1, m_cols);
+		}
+
+		template <typename E>
+		void checkSize(const E &other) const
+		{
+			if (m_rows != other.getRows() || m_cols != other.getCols())
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+		}
+
+		template <typename Op, typename E>
+		MatrixView &compound(const E &other)
+		{
+			static_assert(!std::is_const<T>::value, "Cannot write through a read-only view");
+			checkSize(other);
+			MG_PROFILE_SCOPE(detail::profileCompoundOp<Op, E>(), m_rows, m_cols, detail::profileInner(other));
+			if (other.references(m_data, end()))
+			{
+				detail::compoundInto<Op>(*this, Matrix<value_type>(other));
+				return *this;
+			}
+			detail::compoundInto<Op>(*this, other);
+			return *this;
+		}
+	};
+
+	/**
+	 * @brief View of one matrix row, indexable as a vector.
+	 *
+	 * @tparam T The element type, const-qualified for a read-only view.
+	 */
+	template <typename T>
+	class RowView : public MatrixView<T>
+	{
+	public:
+		RowView() = default;
+		RowView(const RowView &other) = default;
+
+		/**
+		 * @brief Constructs a view of cols consecutive elements.
+		 */
+		RowView(T *data, int cols) : MatrixView<T>(data, 1, cols, cols) {}
+
+		using MatrixView<T>::operator=;
+
+		RowView &operator=(const RowView &other)
+		{
+			MatrixView<T>::operator=(other);
+			return *this;
+		}
+
+		/**
+		 * @brief Gets the number of elements in the row.
+		 */
+		int size() const
+		{
+			return this->m_cols;
+		}
+
+		/**
+		 * @brief Accesses element k of the row without bounds checking.
+		 */
+		T &operator[](int k) const
+		{
+			return this->m_data[k];
+		}
+
+		/**
+		 * @brief Accesses element k of the row, always checking the index.
+		 *
+		 * @throws std::out_of_range If the index is out of bounds.
+		 */
+		T &at(int k) const
+		{
+			detail::checkIndex(k, this->m_cols);
+			return this->m_data[k];
+		}
+	};
+
+	/**
+	 * @brief View of one matrix column, indexable as a vector.
+	 *
+	 * @tparam T The element type, const-qualified for a read-only view.
+	 */
+	template <typename T>
+	class ColView : public MatrixView<T>
+	{
+	public:
+		ColView() = default;
+		ColView(const ColView &other) = default;
+
+		/**
+		 * @brief Constructs a view of rows elements spaced stride apart.
+		 */
+		ColView(T *data, int rows, int stride) : MatrixView<T>(data, rows, 1, stride) {}
+
+		using MatrixView<T>::operator=;
+
+		ColView &operator=(const ColView &other)
+		{
+			MatrixView<T>::operator=(other);
+			return *this;
+		}
+
+		/**
+		 * @brief Gets the number of elements in the column.
+		 */
+		int size() const
+		{
+			return this->m_rows;
+		}
+
+		/**
+		 * @brief Accesses element k of the column without bounds checking.
+		 */
+		T &operator[](int k) const
+		{
+			return this->m_data[static_cast<std::size_t>(k) * this->m_stride];
+		}
+
+		/**
+		 * @brief Accesses element k of the column, always checking the index.
+		 *
+		 * @throws std::out_of_range If the index is out of bounds.
+		 */
+		T &at(int k) const
+		{
+			detail::checkIndex(k, this->m_rows);
+			return this->m_data[static_cast<std::size_t>(k) * this->m_stride];
+		}
+	};
+
+	namespace detail
+	{
+		/**
+		 * @brief Read-only view of a leaf operand (a Matrix or any view).
+		 */
+		template <typename L>
+		MatrixView<const typename L::value_type> leafView(const L &leaf)
+		{
+			return MatrixView<const typename L::value_type>(leaf.data(), leaf.getRows(), leaf.getCols(), leaf.getStride());
+		}
+
+		/**
+		 * @brief Returns a GEMM operand as strided storage, evaluating it into scratch if it is not a leaf.
+		 *
+		 * @param expr The operand.
+		 * @param scratch Storage used when the operand has to be evaluated.
+		 * @return View of the operand's values.
+		 */
+		template <typename E>
+		MatrixView<const typename E::value_type> operandView(const E &expr, Matrix<typename E::value_type> &scratch)
+		{
+			if constexpr (E::isLeaf)
+			{
+				return leafView(expr);
+			}
+			else
+			{
+				scratch = Matrix<typename E::value_type>(expr);
+				return leafView(scratch);
+			}
+		}
+
+		/**
+		 * @brief Stores Op(a, b) element-wise into dst; all three have the same dimensions.
+		 *
+		 * @tparam Op One of simd::AddOp, simd::SubOp, simd::MulOp.
+		 */
+		template <typename Op, typename T, typename A, typename B>
+		void applyBinary(const MatrixView<T> &dst, const A &a, const B &b)
+		{
+			const int rows = dst.getRows();
+			const int cols = dst.getCols();
+			if (isContiguous(dst) && isContiguous(a) && isContiguous(b))
+			{
+				parallelFor(0, static_cast<std::size_t>(rows) * cols, exec::PARALLEL_GRAIN, [&](std::size_t lo, std::size_t hi)
+							{ simd::binary<Op>(a.data() + lo, b.data() + lo, dst.data() + lo, hi - lo); });
+				return;
+			}
+			parallelFor(0, rows, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								simd::binary<Op>(a.data() + i * a.getStride(), b.data() + i * b.getStride(), dst.data() + i * dst.getStride(), cols);
+							} });
+		}
+
+		/**
+		 * @brief Stores Op(a, scalar) element-wise into dst; both have the same dimensions.
+		 *
+		 * @tparam Op One of simd::AddOp, simd::SubOp, simd::MulOp.
+		 */
+		template <typename Op, typename T, typename A>
+		void applyScalar(const MatrixView<T> &dst, const A &a, const typename A::value_type &scalar)
+		{
+			const int rows = dst.getRows();
+			const int cols = dst.getCols();
+			if (isContiguous(dst) && isContiguous(a))
+			{
+				parallelFor(0, static_cast<std::size_t>(rows) * cols, exec::PARALLEL_GRAIN, [&](std::size_t lo, std::size_t hi)
+							{ simd::withScalar<Op>(a.data() + lo, scalar, dst.data() + lo, hi - lo); });
+				return;
+			}
+			parallelFor(0, rows, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								simd::withScalar<Op>(a.data() + i * a.getStride(), scalar, dst.data() + i * dst.getStride(), cols);
+							} });
+		}
+
+		/**
+		 * @brief Copies a leaf into dst row by row.
+		 */
+		template <typename T, typename A>
+		void copyInto(const MatrixView<T> &dst, const A &a)
+		{
+			const int cols = dst.getCols();
+			parallelFor(0, dst.getRows(), grainFor(cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								const auto *src = a.data() + i * a.getStride();
+								std::copy(src, src + cols, dst.data() + i * dst.getStride());
+							} });
+		}
+
+		/**
+		 * @brief Computes dst = lhs * rhs (or dst += lhs * rhs) with the GEMM kernel, or Strassen-Winograd per the default algorithm.
+		 *
+		 * @param dst Destination with the dimensions of the product; must not overlap its operands.
+		 * @param product The product expression.
+		 * @param accumulate Adds to the current contents instead of overwriting them.
+		 */
+		template <typename T, typename L, typename R>
+		void multiplyInto(const MatrixView<T> &dst, const ProductExpr<L, R> &product, bool accumulate)
+		{
+			Matrix<typename L::value_type> lhsScratch, rhsScratch;
+			const auto a = operandView(product.lhs(), lhsScratch);
+			const auto b = operandView(product.rhs(), rhsScratch);
+			multiplyWith(a.getRows(), b.getCols(), a.getCols(), a.data(), a.getStride(), b.data(), b.getStride(), dst.data(), dst.getStride(), accumulate); // Multiplication
+		}
+
+		/**
+		 * @brief Evaluates an expression into dst, which has the expression's dimensions and does not overlap its operands.
+		 *
+		 * Simple shapes go to dedicated kernels (SIMD element-wise ops, GEMM, GEMM with
+		 * accumulate for A * B + C, blocked transpose, row copies); everything else runs as one
+		 * fused loop over the elements.
+		 */
+		template <typename T, typename E>
+		void evaluateInto(const MatrixView<T> &dst, const E &expr)
+		{
+			if constexpr (IsLeafTransposeExpr<E>::value)
+			{
+				const auto &source = expr.operand();
+				MG_PROFILE_COPY(static_cast<std::size_t>(source.getRows()) * source.getCols() * sizeof(T));
+				transposeCopy(source.data(), source.getStride(), dst.data(), dst.getStride(), source.getRows(), source.getCols());
+			}
+			else if constexpr (IsProductExpr<E>::value)
+			{
+				multiplyInto(dst, expr, false);
+			}
+			else if constexpr (IsProductSum<E>::value)
+			{
+				if constexpr (IsProductExpr<typename E::lhs_type>::value)
+				{
+					evaluateInto(dst, expr.rhs());
+					multiplyInto(dst, expr.lhs(), true);
+				}
+				else
+				{
+					evaluateInto(dst, expr.lhs());
+					multiplyInto(dst, expr.rhs(), true);
+				}
+			}
+			else if constexpr (IsLeafBinaryExpr<E>::value)
+			{
+				applyBinary<typename E::op_type>(dst, expr.lhs(), expr.rhs());
+			}
+			else if constexpr (IsLeafScalarExpr<E>::value)
+			{
+				applyScalar<typename E::op_type>(dst, expr.operand(), expr.scalar());
+			}
+			else if constexpr (E::isLeaf)
+			{
+				MG_PROFILE_COPY(static_cast<std::size_t>(dst.getRows()) * dst.getCols() * sizeof(T));
+				copyInto(dst, expr);
+			}
+			else
+			{
+				expr.prepare();
+				const int cols = dst.getCols();
+				parallelFor(0, dst.getRows(), grainFor(cols), [&](std::size_t lo, std::size_t hi)
+							{
+								for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+								{
+									T *row = dst.data() + static_cast<std::size_t>(i) * dst.getStride();
+									for (int j = 0; j < cols; j++)
+									{
+										row[j] = expr.coeff(i, j);
+									}
+								} });
+			}
+		}
+
+		/**
+		 * @brief Applies dst = Op(dst, expr) element-wise in place; expr has dst's dimensions and does not overlap it.
+		 *
+		 * A product added in place (a += b * c) accumulates straight into dst.
+		 */
+		template <typename Op, typename T, typename E>
+		void compoundInto(const MatrixView<T> &dst, const E &expr)
+		{
+			if constexpr (IsProductExpr<E>::value && std::is_same<Op, simd::AddOp>::value)
+			{
+				multiplyInto(dst, expr, true);
+			}
+			else if constexpr (E::isLeaf)
+			{
+				applyBinary<Op>(dst, dst, expr);
+			}
+			else
+			{
+				expr.prepare();
+				const int cols = dst.getCols();
+				parallelFor(0, dst.getRows(), grainFor(cols), [&](std::size_t lo, std::size_t hi)
+							{
+								for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+								{
+									T *row = dst.data() + static_cast<std::size_t>(i) * dst.getStride();
+									for (int j = 0; j < cols; j++)
+									{
+										Op::apply(row[j], row[j], expr.coeff(i, j));
+									}
+								} });
+			}
+		}
+	}
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "profile.hpp"
+
+/**
+ * @brief Memory resources for matrix storage: the per-thread resource hook, a bump arena and a size-class pool.
+ *
+ * Every Matrix allocates its buffer from the memory resource current on the constructing
+ * thread (aligned operator new unless changed), and keeps that resource for its lifetime.
+ * A MatrixResourceScope routes the matrices created in a block, temporaries included, to
+ * another resource:
+ *
+ * @code
+ * {
+ *     mg::MatrixResourceScope scope(mg::threadArena());
+ *     mg::Matrix<double> c = a * b + d; // scratch from the arena, no global heap traffic
+ *     ...
+ * }
+ * mg::threadArena().reset(); // every arena matrix must be gone by now
+ * @endcode
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Memory resource backed by the global aligned operator new; the default for matrices.
+	 */
+	class AlignedNewResource : public std::pmr::memory_resource
+	{
+	private:
+		void *do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			return ::operator new(bytes, std::align_val_t(std::max(alignment, MATRIX_ALIGNMENT)));
+		}
+
+		void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+		{
+			::operator delete(p, bytes, std::align_val_t(std::max(alignment, MATRIX_ALIGNMENT)));
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			return dynamic_cast<const AlignedNewResource *>(&other) != nullptr;
+		}
+	};
+
+	/**
+	 * @brief Gets the process-wide aligned operator new resource.
+	 */
+	inline std::pmr::memory_resource *alignedNewResource()
+	{
+		static AlignedNewResource resource;
+		return &resource;
+	}
+
+	namespace detail
+	{
+		inline std::pmr::memory_resource *&currentMatrixResource()
+		{
+			thread_local std::pmr::memory_resource *resource = alignedNewResource();
+			return resource;
+		}
+	}
+
+	/**
+	 * @brief Gets the resource that matrices created on this thread allocate from.
+	 */
+	inline std::pmr::memory_resource *getMatrixResource()
+	{
+		return detail::currentMatrixResource();
+	}
+
+	/**
+	 * @brief Sets the resource that matrices created on this thread allocate from.
+	 *
+	 * @param resource The new resource, or nullptr for aligned operator new. It must outlive
+	 *                 every matrix allocated from it.
+	 * @return The previous resource.
+	 */
+	inline std::pmr::memory_resource *setMatrixResource(std::pmr::memory_resource *resource)
+	{
+		std::pmr::memory_resource *previous = detail::currentMatrixResource();
+		detail::currentMatrixResource() = resource != nullptr ? resource : alignedNewResource();
+		return previous;
+	}
+
+	/**
+	 * @brief Makes a resource current on this thread for the lifetime of the scope.
+	 */
+	class MatrixResourceScope
+	{
+	private:
+		std::pmr::memory_resource *m_previous;
+
+	public:
+		explicit MatrixResourceScope(std::pmr::memory_resource &resource) : m_previous(setMatrixResource(&resource)) {}
+
+		MatrixResourceScope(const MatrixResourceScope &) = delete;
+		MatrixResourceScope &operator=(const MatrixResourceScope &) = delete;
+
+		~MatrixResourceScope()
+		{
+			setMatrixResource(m_previous);
+		}
+	};
+
+	/**
+	 * @brief Allocator for matrix buffers: aligned to MATRIX_ALIGNMENT, drawing on a memory resource.
+	 *
+	 * Default construction and container copies pick up the thread's current resource
+	 * (getMatrixResource()). As with std::pmr::polymorphic_allocator, a container keeps its
+	 * resource on assignment; moving between containers on different resources copies.
+	 *
+	 * @tparam T The type of the allocated elements.
+	 */
+	template <typename T>
+	class MatrixAllocator
+	{
+	private:
+		std::pmr::memory_resource *m_resource;
+
+	public:
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::false_type;
+		using propagate_on_container_move_assignment = std::false_type;
+		using propagate_on_container_swap = std::false_type;
+
+		/**
+		 * @brief Effective alignment, never weaker than the natural alignment of T.
+		 */
+		static constexpr std::size_t alignment = MATRIX_ALIGNMENT > alignof(T) ? MATRIX_ALIGNMENT : alignof(T);
+
+		MatrixAllocator() noexcept : m_resource(getMatrixResource()) {}
+
+		MatrixAllocator(std::pmr::memory_resource *resource) noexcept : m_resource(resource != nullptr ? resource : alignedNewResource()) {}
+
+		template <typename U>
+		MatrixAllocator(const MatrixAllocator<U> &other) noexcept : m_resource(other.resource()) {}
+
+		T *allocate(std::size_t n)
+		{
+			MG_PROFILE_ALLOC(n * sizeof(T));
+			return static_cast<T *>(m_resource->allocate(n * sizeof(T), alignment));
+		}
+
+		void deallocate(T *p, std::size_t n) noexcept
+		{
+			m_resource->deallocate(p, n * sizeof(T), alignment);
+		}
+
+		/**
+		 * @brief A copied container allocates from the current resource, not the source's.
+		 */
+		MatrixAllocator select_on_container_copy_construction() const
+		{
+			return MatrixAllocator();
+		}
+
+		std::pmr::memory_resource *resource() const noexcept
+		{
+			return m_resource;
+		}
+
+		template <typename U>
+		bool operator==(const MatrixAllocator<U> &other) const noexcept
+		{
+			return m_resource == other.resource() || m_resource->is_equal(*other.resource());
+		}
+
+		template <typename U>
+		bool operator!=(const MatrixAllocator<U> &other) const noexcept
+		{
+			return !(*this == other);
+		}
+	};
+
+	/**
+	 * @brief Bump allocator for short-lived scratch matrices.
+	 *
+	 * Allocation advances a pointer through large chunks; deallocation is a no-op, so freeing
+	 * from any thread is safe, but allocation is not synchronized: use one arena per thread
+	 * (threadArena()). reset() reclaims everything at once, e.g. at the end of a request.
+	 */
+	class ArenaResource : public std::pmr::memory_resource
+	{
+	private:
+		struct Chunk
+		{
+			char *data;
+			std::size_t size;
+		};
+
+		std::pmr::memory_resource *m_upstream;
+		std::size_t m_chunkSize;
+		std::vector<Chunk> m_chunks;
+		std::size_t m_offset = 0;	// Bump offset into m_chunks.back()
+		std::size_t m_used = 0;		// Bytes handed out since the last reset, padding included
+
+		void addChunk(std::size_t minimum)
+		{
+			const std::size_t size = std::max(m_chunkSize, minimum);
+			m_chunks.push_back(Chunk{static_cast<char *>(m_upstream->allocate(size, MATRIX_ALIGNMENT)), size});
+			m_offset = 0;
+			m_chunkSize = std::min(m_chunkSize * 2, std::size_t(1) << 30); // Fewer chunks as demand grows
+		}
+
+		void freeChunks()
+		{
+			for (const Chunk &chunk : m_chunks)
+			{
+				m_upstream->deallocate(chunk.data, chunk.size, MATRIX_ALIGNMENT);
+			}
+			m_chunks.clear();
+			m_offset = 0;
+		}
+
+		/**
+		 * @brief Bumps the offset in the current chunk, or returns nullptr if the request does not fit.
+		 */
+		void *bump(std::size_t bytes, std::size_t alignment)
+		{
+			if (m_chunks.empty())
+			{
+				return nullptr;
+			}
+			const Chunk &chunk = m_chunks.back();
+			const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(chunk.data);
+			const std::size_t start = static_cast<std::size_t>((base + m_offset + alignment - 1) / alignment * alignment - base);
+			if (start > chunk.size || chunk.size - start < bytes)
+			{
+				return nullptr;
+			}
+			m_used += start + bytes - m_offset;
+			m_offset = start + bytes;
+			return chunk.data + start;
+		}
+
+		void *do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			alignment = std::max(alignment, alignof(std::max_align_t));
+			if (void *p = bump(bytes, alignment))
+			{
+				return p;
+			}
+			addChunk(bytes + alignment); // Room to align inside the chunk
+			return bump(bytes, alignment);
+		}
+
+		void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			return this == &other;
+		}
+
+	public:
+		/**
+		 * @brief Creates an empty arena.
+		 *
+		 * @param chunkSize Size in bytes of the first chunk; later chunks double, up to 1 GiB.
+		 * @param upstream Where chunks come from.
+		 */
+		explicit ArenaResource(std::size_t chunkSize = std::size_t(1) << 20, std::pmr::memory_resource *upstream = alignedNewResource())
+			: m_upstream(upstream), m_chunkSize(std::max<std::size_t>(chunkSize, MATRIX_ALIGNMENT)) {}
+
+		ArenaResource(const ArenaResource &) = delete;
+		ArenaResource &operator=(const ArenaResource &) = delete;
+
+		~ArenaResource() override
+		{
+			freeChunks();
+		}
+
+		/**
+		 * @brief Reclaims every allocation, keeping one chunk large enough for the peak usage seen.
+		 *
+		 * Memory handed out before the reset must no longer be in use.
+		 */
+		void reset()
+		{
+			if (m_chunks.size() > 1)
+			{
+				std::size_t total = 0;
+				for (const Chunk &chunk : m_chunks)
+				{
+					total += chunk.size;
+				}
+				freeChunks();
+				m_chunkSize = total;
+				addChunk(total);
+			}
+			m_offset = 0;
+			m_used = 0;
+		}
+
+		/**
+		 * @brief Reclaims every allocation and returns all chunks upstream.
+		 */
+		void release()
+		{
+			freeChunks();
+			m_used = 0;
+		}
+
+		/**
+		 * @brief Bytes allocated since the last reset, alignment padding included.
+		 */
+		std::size_t bytesUsed() const
+		{
+			return m_used;
+		}
+
+		/**
+		 * @brief Bytes held from upstream.
+		 */
+		std::size_t capacity() const
+		{
+			std::size_t total = 0;
+			for (const Chunk &chunk : m_chunks)
+			{
+				total += chunk.size;
+			}
+			return total;
+		}
+	};
+
+	/**
+	 * @brief Gets this thread's scratch arena.
+	 */
+	inline ArenaResource &threadArena()
+	{
+		thread_local ArenaResource arena;
+		return arena;
+	}
+
+	/**
+	 * @brief Thread-safe pool recycling buffers by power-of-two size class.
+	 *
+	 * A freed buffer goes to the free list of its class instead of back to the system, and the
+	 * next allocation of that class takes it without touching the global heap. Each class has
+	 * its own lock, so threads working on different sizes do not contend. Requests above the
+	 * largest class, or aligned beyond MATRIX_ALIGNMENT, go straight upstream. Rounding up to a
+	 * power of two wastes at most half of a buffer.
+	 */
+	class PoolResource : public std::pmr::memory_resource
+	{
+	private:
+		static constexpr int MIN_CLASS_SHIFT = 6; // 64-byte smallest class
+
+		struct SizeClass
+		{
+			std::mutex mutex;
+			std::vector<void *> blocks;
+		};
+
+		std::pmr::memory_resource *m_upstream;
+		int m_classes;
+		std::size_t m_maxCachedPerClass;
+		std::vector<SizeClass> m_freeLists;
+
+		/**
+		 * @brief Index of the smallest class holding bytes, or -1 if the request is not pooled.
+		 */
+		int classOf(std::size_t bytes, std::size_t alignment) const
+		{
+			if (alignment > MATRIX_ALIGNMENT)
+			{
+				return -1;
+			}
+			int c = 0;
+			while (c < m_classes && (std::size_t(1) << (c + MIN_CLASS_SHIFT)) < bytes)
+			{
+				c++;
+			}
+			return c < m_classes ? c : -1;
+		}
+
+		void *do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			const int c = classOf(bytes, alignment);
+			if (c < 0)
+			{
+				return m_upstream->allocate(bytes, alignment);
+			}
+			{
+				SizeClass &sizeClass = m_freeLists[c];
+				std::lock_guard<std::mutex> lock(sizeClass.mutex);
+				if (!sizeClass.blocks.empty())
+				{
+					void *p = sizeClass.blocks.back();
+					sizeClass.blocks.pop_back();
+					return p;
+				}
+			}
+			return m_upstream->allocate(std::size_t(1) << (c + MIN_CLASS_SHIFT), MATRIX_ALIGNMENT);
+		}
+
+		void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+		{
+			const int c = classOf(bytes, alignment);
+			if (c < 0)
+			{
+				m_upstream->deallocate(p, bytes, alignment);
+				return;
+			}
+			const std::size_t blockSize = std::size_t(1) << (c + MIN_CLASS_SHIFT);
+			{
+				SizeClass &sizeClass = m_freeLists[c];
+				std::lock_guard<std::mutex> lock(sizeClass.mutex);
+				if ((sizeClass.blocks.size() + 1) * blockSize <= m_maxCachedPerClass)
+				{
+					sizeClass.blocks.push_back(p);
+					return;
+				}
+			}
+			m_upstream->deallocate(p, blockSize, MATRIX_ALIGNMENT);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			return this == &other;
+		}
+
+	public:
+		/**
+		 * @brief Creates an empty pool.
+		 *
+		 * @param maxBlockSize Largest pooled buffer in bytes, rounded up to a power of two.
+		 * @param maxCachedPerClass Most bytes of free buffers kept per size class; the excess is returned upstream.
+		 * @param upstream Where buffers come from.
+		 */
+		explicit PoolResource(std::size_t maxBlockSize = std::size_t(1) << 28, std::size_t maxCachedPerClass = std::size_t(1) << 30,
+							  std::pmr::memory_resource *upstream = alignedNewResource())
+			: m_upstream(upstream), m_classes(1), m_maxCachedPerClass(maxCachedPerClass)
+		{
+			while ((std::size_t(1) << (m_classes - 1 + MIN_CLASS_SHIFT)) < maxBlockSize)
+			{
+				m_classes++;
+			}
+			m_freeLists = std::vector<SizeClass>(m_classes);
+		}
+
+		PoolResource(const PoolResource &) = delete;
+		PoolResource &operator=(const PoolResource &) = delete;
+
+		~PoolResource() override
+		{
+			release();
+		}
+
+		/**
+		 * @brief Returns every cached free buffer upstream. Buffers in use are not affected.
+		 */
+		void release()
+		{
+			for (int c = 0; c < m_classes; c++)
+			{
+				SizeClass &sizeClass = m_freeLists[c];
+				std::lock_guard<std::mutex> lock(sizeClass.mutex);
+				for (void *p : sizeClass.blocks)
+				{
+					m_upstream->deallocate(p, std::size_t(1) << (c + MIN_CLASS_SHIFT), MATRIX_ALIGNMENT);
+				}
+				sizeClass.blocks.clear();
+			}
+		}
+
+		/**
+		 * @brief Bytes of free buffers currently cached.
+		 */
+		std::size_t cachedBytes()
+		{
+			std::size_t total = 0;
+			for (int c = 0; c < m_classes; c++)
+			{
+				std::lock_guard<std::mutex> lock(m_freeLists[c].mutex);
+				total += m_freeLists[c].blocks.size() << (c + MIN_CLASS_SHIFT);
+			}
+			return total;
+		}
+	};
+
+	/**
+	 * @brief Gets the process-wide size-class pool.
+	 */
+	inline PoolResource &sharedPool()
+	{
+		static PoolResource pool;
+		return pool;
+	}
+}
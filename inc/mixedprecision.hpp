@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "lowprecision.hpp"
+#include "matrix.hpp"
+#include "matrixview.hpp"
+#include "parallel.hpp"
+
+/**
+ * @brief Conversions between element types, and products and sums computed in a wider type.
+ *
+ * Example: an int8 weight matrix times int8 activations, summed exactly in int32:
+ *     mg::Matrix<std::int32_t> y = mg::mixedMultiply<std::int32_t>(w, x);
+ * or half inputs with a float accumulator, rounded back to half once at the end:
+ *     mg::Matrix<mg::half> z = mg::mixedMultiply<float, mg::half>(a, b);
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Converts every element of a matrix to another type with narrow().
+	 *
+	 * Integer targets saturate instead of wrapping; see narrow().
+	 *
+	 * @tparam U The element type of the result.
+	 * @param source The matrix to convert.
+	 * @return A matrix of U with the dimensions of source.
+	 */
+	template <typename U, typename T>
+	Matrix<U> convertMatrix(MatrixView<const T> source)
+	{
+		Matrix<U> result(source.getRows(), source.getCols());
+		detail::convertBlock(source.getRows(), source.getCols(), source.data(), source.getStride(), result.data(), result.getStride());
+		return result;
+	}
+
+	template <typename U, typename T>
+	Matrix<U> convertMatrix(const Matrix<T> &source)
+	{
+		return convertMatrix<U>(source.view());
+	}
+
+	/**
+	 * @brief Computes A * B with the products summed in Acc, and stores the result as Out.
+	 *
+	 * The operands are widened to Acc block by block, so the scratch stays small; the result
+	 * is narrowed once per element. Low-precision matrices multiplied with operator* do the
+	 * same with Acc = Accumulator<T> and Out = T.
+	 *
+	 * @tparam Acc The accumulation type, e.g. float for half or std::int32_t for std::int8_t.
+	 * @tparam Out The element type of the result; Acc by default.
+	 * @param a The left operand.
+	 * @param b The right operand.
+	 * @return The product.
+	 * @throws std::invalid_argument If the inner dimensions differ.
+	 */
+	template <typename Acc, typename Out = Acc, typename TA, typename TB>
+	Matrix<Out> mixedMultiply(MatrixView<const TA> a, MatrixView<const TB> b)
+	{
+		if (a.getCols() != b.getRows())
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		const int m = a.getRows();
+		const int n = b.getCols();
+		const int k = a.getCols();
+		Matrix<Out> result(m, n);
+		if constexpr (std::is_same<TA, Acc>::value && std::is_same<TB, Acc>::value && std::is_same<Out, Acc>::value)
+		{
+			multiplyWith(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), result.data(), result.getStride());
+		}
+		else
+		{
+			detail::widenedGemm<Acc>(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), result.data(), result.getStride(), false);
+		}
+		return result;
+	}
+
+	template <typename Acc, typename Out = Acc, typename TA, typename TB>
+	Matrix<Out> mixedMultiply(const Matrix<TA> &a, const Matrix<TB> &b)
+	{
+		return mixedMultiply<Acc, Out>(a.view(), b.view());
+	}
+
+	/**
+	 * @brief Sums the elements of a matrix in Acc.
+	 *
+	 * Rows are summed in fixed chunks whose partial sums are added in order, so the result
+	 * does not depend on the number of threads.
+	 *
+	 * @tparam Acc The accumulation type, e.g. std::int32_t for std::int8_t.
+	 * @param source The matrix to sum.
+	 * @return The sum of all elements.
+	 */
+	template <typename Acc, typename T>
+	Acc mixedSum(MatrixView<const T> source)
+	{
+		const int rows = source.getRows();
+		const int cols = source.getCols();
+		const std::size_t rowsPerChunk = grainFor(cols);
+		const std::size_t chunks = (rows + rowsPerChunk - 1) / rowsPerChunk;
+		std::vector<Acc> partial(chunks, Acc());
+		parallelFor(0, chunks, 1, [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t chunk = lo; chunk < hi; chunk++)
+						{
+							const std::size_t end = std::min<std::size_t>(rows, (chunk + 1) * rowsPerChunk);
+							Acc sum = Acc();
+							for (std::size_t i = chunk * rowsPerChunk; i < end; i++)
+							{
+								const T *row = source.data() + i * source.getStride();
+								for (int j = 0; j < cols; j++)
+								{
+									sum += static_cast<Acc>(row[j]);
+								}
+							}
+							partial[chunk] = sum;
+						} });
+		return std::accumulate(partial.begin(), partial.end(), Acc());
+	}
+
+	template <typename Acc, typename T>
+	Acc mixedSum(const Matrix<T> &source)
+	{
+		return mixedSum<Acc>(source.view());
+	}
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "gemm.hpp"
+#include "matrix.hpp"
+#include "matrixio.hpp"
+#include "matrixview.hpp"
+
+/**
+ * @brief Out-of-core matrix multiplication for operands and results larger than memory.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Memory used by outOfCoreMultiply() when no budget is given: 1 GiB.
+	 */
+	constexpr std::size_t OUT_OF_CORE_DEFAULT_BUDGET = std::size_t(1) << 30;
+
+	namespace detail
+	{
+		/**
+		 * @brief Copies the rows x cols block of src starting at (i0, j0) into a compact buffer.
+		 */
+		template <typename T>
+		void loadTile(MatrixView<const T> src, int i0, int j0, int rows, int cols, T *dst)
+		{
+			for (int i = 0; i < rows; i++)
+			{
+				const T *row = src.data() + static_cast<std::size_t>(i0 + i) * src.getStride() + j0;
+				std::copy(row, row + cols, dst + static_cast<std::size_t>(i) * cols);
+			}
+		}
+	}
+
+	/**
+	 * @brief Computes C = A * B tile by tile, writing C to a matrix file, within a fixed memory budget.
+	 *
+	 * C is produced in square tiles. For each tile, matching tiles of A and B are streamed in
+	 * along the inner dimension and multiplied with the GEMM kernel into the resident C tile,
+	 * which is then written to disk. Tile loads and result writes run on background threads,
+	 * double-buffered: the next pair of A and B tiles is read, and the previous C tile written,
+	 * while the current pair is being multiplied.
+	 *
+	 * The operands are usually file-backed views from mapMatrix(), so only the tiles being
+	 * copied are paged in; in-memory matrices work too. Six tiles are resident (two each of A,
+	 * B and C), so the tile order is sqrt(budget / (6 * sizeof(T))).
+	 *
+	 * @param a Left operand, m x k.
+	 * @param b Right operand, k x n.
+	 * @param path The result file (matrixio.hpp format) to create or overwrite.
+	 * @param memoryBudget Bytes of tile buffers to use.
+	 * @throws std::invalid_argument If the dimensions do not match or the budget cannot hold six 1 x 1 tiles.
+	 * @throws std::runtime_error If the result cannot be written.
+	 */
+	template <typename T>
+	void outOfCoreMultiply(MatrixView<const T> a, MatrixView<const T> b, const std::string &path, std::size_t memoryBudget = OUT_OF_CORE_DEFAULT_BUDGET)
+	{
+		if (a.getCols() != b.getRows())
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		if (memoryBudget < 6 * sizeof(T))
+		{
+			throw std::invalid_argument("Memory budget is too small");
+		}
+		const int m = a.getRows();
+		const int n = b.getCols();
+		const int k = a.getCols();
+
+		// Tile order from the budget, rounded down to whole GEMM panels when large enough
+		int tile = static_cast<int>(std::sqrt(static_cast<double>(memoryBudget / (6 * sizeof(T)))));
+		if (tile >= 64)
+		{
+			tile -= tile % 64;
+		}
+		tile = std::max(tile, 1);
+		const int tm = std::min(tile, std::max(m, 1));
+		const int tn = std::min(tile, std::max(n, 1));
+		const int tk = std::min(tile, std::max(k, 1));
+
+		const MatrixFileHeader header = detail::makeHeader<T>(m, n);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		detail::writeHeader(file, header);
+		if (!file)
+		{
+			throw std::runtime_error("Cannot write " + path);
+		}
+		if (m == 0 || n == 0)
+		{
+			return;
+		}
+
+		// The work is a sequence of steps (C tile, inner block); step s + 1 is loaded during step s
+		const int tilesDown = (m + tm - 1) / tm;
+		const int tilesAcross = (n + tn - 1) / tn;
+		const int innerBlocks = std::max((k + tk - 1) / tk, 1);
+		const long long steps = static_cast<long long>(tilesDown) * tilesAcross * innerBlocks;
+
+		struct Step
+		{
+			int i0, j0, p0, rows, cols, depth;
+		};
+		auto stepAt = [&](long long s)
+		{
+			const int p = static_cast<int>(s % innerBlocks);
+			const long long t = s / innerBlocks;
+			Step step;
+			step.i0 = static_cast<int>(t / tilesAcross) * tm;
+			step.j0 = static_cast<int>(t % tilesAcross) * tn;
+			step.p0 = p * tk;
+			step.rows = std::min(tm, m - step.i0);
+			step.cols = std::min(tn, n - step.j0);
+			step.depth = std::min(tk, k - step.p0);
+			return step;
+		};
+
+		using Buffer = std::vector<T, AlignedAllocator<T>>;
+		Buffer aTiles[2], bTiles[2], cTiles[2];
+		for (int s = 0; s < 2; s++)
+		{
+			aTiles[s].resize(static_cast<std::size_t>(tm) * tk);
+			bTiles[s].resize(static_cast<std::size_t>(tk) * tn);
+			cTiles[s].resize(static_cast<std::size_t>(tm) * tn);
+		}
+
+		auto load = [&, a, b](long long s, int slot)
+		{
+			const Step step = stepAt(s);
+			detail::loadTile(a, step.i0, step.p0, step.rows, step.depth, aTiles[slot].data());
+			detail::loadTile(b, step.p0, step.j0, step.depth, step.cols, bTiles[slot].data());
+		};
+		auto store = [&](Step step, int slot)
+		{
+			const std::size_t rowBytes = static_cast<std::size_t>(step.cols) * sizeof(T);
+			for (int i = 0; i < step.rows; i++)
+			{
+				const std::uint64_t offset = header.dataOffset + (static_cast<std::uint64_t>(step.i0 + i) * n + step.j0) * sizeof(T);
+				file.seekp(static_cast<std::streamoff>(offset));
+				file.write(reinterpret_cast<const char *>(cTiles[slot].data() + static_cast<std::size_t>(i) * step.cols), static_cast<std::streamsize>(rowBytes));
+			}
+			if (!file)
+			{
+				throw std::runtime_error("Cannot write " + path);
+			}
+		};
+
+		std::future<void> loading = std::async(std::launch::async, load, 0LL, 0);
+		std::future<void> storing;
+		int cSlot = 0;
+		for (long long s = 0; s < steps; s++)
+		{
+			const int slot = static_cast<int>(s & 1);
+			loading.get();
+			if (s + 1 < steps)
+			{
+				loading = std::async(std::launch::async, load, s + 1, slot ^ 1);
+			}
+
+			const Step step = stepAt(s);
+			if (step.depth > 0)
+			{
+				gemm(step.rows, step.cols, step.depth, aTiles[slot].data(), step.depth, bTiles[slot].data(), step.cols,
+					 cTiles[cSlot].data(), step.cols, step.p0 > 0);
+			}
+			else
+			{
+				std::fill(cTiles[cSlot].begin(), cTiles[cSlot].end(), T()); // k == 0: C is all zeros
+			}
+
+			if (s % innerBlocks == innerBlocks - 1)
+			{
+				// The tile is complete: write it out in the background and switch C buffers
+				if (storing.valid())
+				{
+					storing.get();
+				}
+				storing = std::async(std::launch::async, store, step, cSlot);
+				cSlot ^= 1;
+			}
+		}
+		storing.get();
+		if (!file.flush())
+		{
+			throw std::runtime_error("Cannot write " + path);
+		}
+	}
+
+	/**
+	 * @brief Multiplies two matrix files into a third without loading any of them whole.
+	 *
+	 * @tparam T The element type stored in the files.
+	 * @param lhsPath File holding A (m x k).
+	 * @param rhsPath File holding B (k x n).
+	 * @param path The result file to create or overwrite.
+	 * @param memoryBudget Bytes of tile buffers to use.
+	 * @throws std::invalid_argument If the dimensions do not match.
+	 * @throws std::runtime_error If a file cannot be read, mapped or written.
+	 */
+	template <typename T>
+	void outOfCoreMultiply(const std::string &lhsPath, const std::string &rhsPath, const std::string &path, std::size_t memoryBudget = OUT_OF_CORE_DEFAULT_BUDGET)
+	{
+		const MappedMatrix<T> a = mapMatrix<T>(lhsPath);
+		const MappedMatrix<T> b = mapMatrix<T>(rhsPath);
+		outOfCoreMultiply<T>(a, b, path, memoryBudget);
+	}
+}
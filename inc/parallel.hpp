@@ -0,0 +1,609 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief Library-owned work-stealing thread pool and execution policies.
+ *
+ * Kernels call parallelFor(); whether it actually fans out is decided by the execution policy
+ * in effect (exec::par by default) and by the amount of work, so small matrices stay serial.
+ * The global policy is set with exec::setDefaultPolicy(); exec::ScopedPolicy overrides it for
+ * the calls made by the current thread inside a scope. The worker count is taken from the
+ * MG_NUM_THREADS environment variable, or from the CPUs the process may run on.
+ */
+
+namespace mg
+{
+	namespace exec
+	{
+		/**
+		 * @brief Whether kernels may split their work across threads.
+		 */
+		enum class Mode
+		{
+			Sequential,
+			Parallel
+		};
+
+		/**
+		 * @brief An execution policy, passed by value.
+		 */
+		struct Policy
+		{
+			Mode mode;
+		};
+
+		/**
+		 * @brief Run everything on the calling thread.
+		 */
+		constexpr Policy seq{Mode::Sequential};
+
+		/**
+		 * @brief Split work above the size threshold across the thread pool.
+		 */
+		constexpr Policy par{Mode::Parallel};
+
+		/**
+		 * @brief Minimum number of elements (or multiply-adds, for GEMM) per parallel chunk.
+		 */
+		constexpr std::size_t PARALLEL_GRAIN = std::size_t(1) << 15;
+
+		namespace detail
+		{
+			inline std::atomic<Mode> &globalMode()
+			{
+				static std::atomic<Mode> mode(Mode::Parallel);
+				return mode;
+			}
+
+			inline const Policy *&scopedPolicy()
+			{
+				thread_local const Policy *policy = nullptr;
+				return policy;
+			}
+		}
+
+		/**
+		 * @brief Sets the policy used by every thread that has no scoped override.
+		 *
+		 * @param policy The new default policy.
+		 */
+		inline void setDefaultPolicy(Policy policy)
+		{
+			detail::globalMode().store(policy.mode, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Gets the policy in effect for the calling thread.
+		 *
+		 * @return The innermost ScopedPolicy of this thread, or the global default.
+		 */
+		inline Policy currentPolicy()
+		{
+			const Policy *scoped = detail::scopedPolicy();
+			return scoped ? *scoped : Policy{detail::globalMode().load(std::memory_order_relaxed)};
+		}
+
+		/**
+		 * @brief Overrides the execution policy for the calling thread until the end of the scope.
+		 *
+		 * Example: { mg::exec::ScopedPolicy serial(mg::exec::seq); c = a * b; }
+		 */
+		class ScopedPolicy
+		{
+		private:
+			Policy m_policy;
+			const Policy *m_previous;
+
+		public:
+			explicit ScopedPolicy(Policy policy) : m_policy(policy), m_previous(detail::scopedPolicy())
+			{
+				detail::scopedPolicy() = &m_policy;
+			}
+
+			~ScopedPolicy()
+			{
+				detail::scopedPolicy() = m_previous;
+			}
+
+			ScopedPolicy(const ScopedPolicy &) = delete;
+			ScopedPolicy &operator=(const ScopedPolicy &) = delete;
+		};
+	}
+
+	namespace detail
+	{
+		/**
+		 * @brief Parses a sysfs CPU list such as "0-3,8,10-11".
+		 */
+		inline std::vector<int> parseCpuList(const std::string &list)
+		{
+			std::vector<int> cpus;
+			std::size_t pos = 0;
+			while (pos < list.size())
+			{
+				std::size_t end = list.find(',', pos);
+				if (end == std::string::npos)
+				{
+					end = list.size();
+				}
+				std::string item = list.substr(pos, end - pos);
+				std::size_t dash = item.find('-');
+				try
+				{
+					int first = std::stoi(item.substr(0, dash));
+					int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+					for (int cpu = first; cpu <= last; cpu++)
+					{
+						cpus.push_back(cpu);
+					}
+				}
+				catch (const std::exception &)
+				{
+				}
+				pos = end + 1;
+			}
+			return cpus;
+		}
+
+		/**
+		 * @brief Orders the CPUs this process may use so that consecutive workers land on different NUMA nodes.
+		 *
+		 * Spreading workers over the nodes maximizes the aggregate memory bandwidth available to
+		 * the mostly bandwidth-bound matrix kernels. Returns an empty list where the topology
+		 * cannot be read, in which case workers are not pinned.
+		 */
+		inline std::vector<int> numaCpuOrder()
+		{
+			std::vector<int> order;
+#ifdef __linux__
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			{
+				return order;
+			}
+
+			std::vector<std::vector<int>> nodes;
+			for (int node = 0;; node++)
+			{
+				std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+				if (!file)
+				{
+					break;
+				}
+				std::string list;
+				std::getline(file, list);
+				std::vector<int> cpus;
+				for (int cpu : parseCpuList(list))
+				{
+					if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+					{
+						cpus.push_back(cpu);
+					}
+				}
+				if (!cpus.empty())
+				{
+					nodes.push_back(cpus);
+				}
+			}
+			if (nodes.empty())
+			{
+				std::vector<int> cpus;
+				for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				{
+					if (CPU_ISSET(cpu, &allowed))
+					{
+						cpus.push_back(cpu);
+					}
+				}
+				nodes.push_back(cpus);
+			}
+
+			for (std::size_t i = 0;; i++)
+			{
+				bool any = false;
+				for (const auto &cpus : nodes)
+				{
+					if (i < cpus.size())
+					{
+						order.push_back(cpus[i]);
+						any = true;
+					}
+				}
+				if (!any)
+				{
+					break;
+				}
+			}
+#endif
+			return order;
+		}
+	}
+
+	/**
+	 * @brief Fixed-size pool of worker threads with one work-stealing deque per worker.
+	 *
+	 * A worker pushes and pops tasks at the back of its own deque and steals from the front of
+	 * the others when it runs dry. Threads outside the pool submit round-robin. A thread that
+	 * waits in parallelFor() keeps executing pool tasks, so nested parallel calls cannot deadlock.
+	 */
+	class ThreadPool
+	{
+	public:
+		using Task = std::function<void()>;
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		std::atomic<std::size_t> m_pending;
+		std::atomic<std::size_t> m_nextQueue;
+		bool m_stop;
+
+		/**
+		 * @brief Identity of the calling thread: the pool it works for and its queue index there.
+		 */
+		struct WorkerIdentity
+		{
+			const ThreadPool *pool = nullptr;
+			int index = -1;
+		};
+
+		static WorkerIdentity &identity()
+		{
+			thread_local WorkerIdentity id;
+			return id;
+		}
+
+		/**
+		 * @brief Index of the calling thread's own queue, or -1 outside this pool.
+		 */
+		int workerIndex() const
+		{
+			const WorkerIdentity &id = identity();
+			return id.pool == this ? id.index : -1;
+		}
+
+		bool tryPop(std::size_t queue, bool back, Task &task)
+		{
+			Queue &q = *m_queues[queue];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (q.tasks.empty())
+			{
+				return false;
+			}
+			if (back)
+			{
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			m_pending.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		void workerLoop(int index, int cpu)
+		{
+#ifdef __linux__
+			if (cpu >= 0)
+			{
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				CPU_SET(cpu, &set);
+				pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+			}
+#else
+			(void)cpu;
+#endif
+			identity() = WorkerIdentity{this, index};
+			while (true)
+			{
+				if (runPending())
+				{
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(m_sleepMutex);
+				m_wake.wait(lock, [this]
+							{ return m_stop || m_pending.load(std::memory_order_relaxed) > 0; });
+				if (m_stop && m_pending.load(std::memory_order_relaxed) == 0)
+				{
+					return;
+				}
+			}
+		}
+
+	public:
+		/**
+		 * @brief Starts the workers.
+		 *
+		 * @param workers Number of worker threads (the calling thread of parallelFor() also works).
+		 * @param pin Pin workers to CPUs, spread over NUMA nodes.
+		 */
+		explicit ThreadPool(unsigned workers, bool pin = true) : m_pending(0), m_nextQueue(0), m_stop(false)
+		{
+			std::vector<int> cpus = pin ? detail::numaCpuOrder() : std::vector<int>();
+			for (unsigned i = 0; i < workers; i++)
+			{
+				m_queues.push_back(std::make_unique<Queue>());
+			}
+			for (unsigned i = 0; i < workers; i++)
+			{
+				// CPU 0 of the order is left to the submitting thread
+				int cpu = cpus.size() > 1 ? cpus[(i + 1) % cpus.size()] : -1;
+				m_threads.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(i), cpu);
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (auto &thread : m_threads)
+			{
+				thread.join();
+			}
+		}
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		/**
+		 * @brief Gets the number of threads that execute work, counting the submitting thread.
+		 *
+		 * @return Workers + 1.
+		 */
+		unsigned concurrency() const
+		{
+			return static_cast<unsigned>(m_threads.size()) + 1;
+		}
+
+		/**
+		 * @brief Queues a task.
+		 *
+		 * @param task The task to run on some worker.
+		 */
+		void submit(Task task)
+		{
+			if (m_queues.empty())
+			{
+				task();
+				return;
+			}
+			int self = workerIndex();
+			std::size_t queue = self >= 0 ? static_cast<std::size_t>(self) : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+			{
+				std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+				m_queues[queue]->tasks.push_back(std::move(task));
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_pending.fetch_add(1, std::memory_order_relaxed);
+			}
+			m_wake.notify_one();
+		}
+
+		/**
+		 * @brief Runs one queued task on the calling thread, its own queue first, then by stealing.
+		 *
+		 * @return True if a task was run.
+		 */
+		bool runPending()
+		{
+			if (m_queues.empty() || m_pending.load(std::memory_order_relaxed) == 0)
+			{
+				return false;
+			}
+			Task task;
+			int self = workerIndex();
+			if (self >= 0 && tryPop(static_cast<std::size_t>(self), true, task))
+			{
+				task();
+				return true;
+			}
+			std::size_t start = self >= 0 ? static_cast<std::size_t>(self) + 1 : 0;
+			for (std::size_t k = 0; k < m_queues.size(); k++)
+			{
+				if (tryPop((start + k) % m_queues.size(), false, task))
+				{
+					task();
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * @brief Calls fn(lo, hi) over disjoint subranges covering [begin, end), on all threads.
+		 *
+		 * Chunks are handed out dynamically, so uneven chunk costs balance themselves. The call
+		 * returns once every chunk has finished; the first exception thrown by fn is rethrown.
+		 *
+		 * @param begin Start of the range.
+		 * @param end End of the range.
+		 * @param grain Minimum chunk length.
+		 * @param fn Callable taking (std::size_t lo, std::size_t hi).
+		 */
+		template <typename F>
+		void run(std::size_t begin, std::size_t end, std::size_t grain, F &&fn)
+		{
+			struct State
+			{
+				std::atomic<std::size_t> next{0};
+				std::atomic<std::size_t> done{0};
+				std::size_t chunks = 0;
+				std::size_t chunkSize = 0;
+				std::size_t begin = 0;
+				std::size_t end = 0;
+				std::function<void(std::size_t, std::size_t)> body;
+				std::mutex errorMutex;
+				std::exception_ptr error;
+
+				void work()
+				{
+					std::size_t c;
+					while ((c = next.fetch_add(1, std::memory_order_relaxed)) < chunks)
+					{
+						std::size_t lo = begin + c * chunkSize;
+						std::size_t hi = std::min(end, lo + chunkSize);
+						try
+						{
+							body(lo, hi);
+						}
+						catch (...)
+						{
+							std::lock_guard<std::mutex> lock(errorMutex);
+							if (!error)
+							{
+								error = std::current_exception();
+							}
+						}
+						done.fetch_add(1, std::memory_order_acq_rel);
+					}
+				}
+			};
+
+			const std::size_t n = end - begin;
+			const std::size_t threads = concurrency();
+			auto state = std::make_shared<State>();
+			state->chunkSize = std::max(grain, (n + threads * 4 - 1) / (threads * 4));
+			state->chunks = (n + state->chunkSize - 1) / state->chunkSize;
+			state->begin = begin;
+			state->end = end;
+			state->body = std::ref(fn);
+
+			const std::size_t helpers = std::min<std::size_t>(m_threads.size(), state->chunks - 1);
+			for (std::size_t h = 0; h < helpers; h++)
+			{
+				submit([state]
+					   { state->work(); });
+			}
+			state->work();
+			while (state->done.load(std::memory_order_acquire) < state->chunks)
+			{
+				if (!runPending())
+				{
+					std::this_thread::yield();
+				}
+			}
+			if (state->error)
+			{
+				std::rethrow_exception(state->error);
+			}
+		}
+
+		/**
+		 * @brief Gets the process-wide pool used by the matrix kernels.
+		 *
+		 * @return The pool, created on first use with MG_NUM_THREADS (or one per usable CPU) threads.
+		 */
+		static ThreadPool &global()
+		{
+			static ThreadPool pool(defaultConcurrency() - 1);
+			return pool;
+		}
+
+		/**
+		 * @brief Gets the number of threads the global pool is created with.
+		 *
+		 * @return MG_NUM_THREADS if set, otherwise the number of CPUs the process may use.
+		 */
+		static unsigned defaultConcurrency()
+		{
+			if (const char *env = std::getenv("MG_NUM_THREADS"))
+			{
+				int requested = std::atoi(env);
+				if (requested > 0)
+				{
+					return static_cast<unsigned>(requested);
+				}
+			}
+#ifdef __linux__
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0)
+			{
+				return static_cast<unsigned>(CPU_COUNT(&allowed));
+			}
+#endif
+			unsigned hardware = std::thread::hardware_concurrency();
+			return hardware > 0 ? hardware : 1;
+		}
+	};
+
+	/**
+	 * @brief Calls fn(lo, hi) over subranges of [begin, end), in parallel when the policy and size allow.
+	 *
+	 * The range is processed serially under exec::seq, on single-threaded pools, and whenever it
+	 * holds fewer than two grains of work.
+	 *
+	 * @param begin Start of the range.
+	 * @param end End of the range.
+	 * @param grain Minimum chunk length; size it so a chunk is about exec::PARALLEL_GRAIN units of work.
+	 * @param fn Callable taking (std::size_t lo, std::size_t hi).
+	 */
+	template <typename F>
+	void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, F &&fn)
+	{
+		if (end <= begin)
+		{
+			return;
+		}
+		grain = std::max<std::size_t>(grain, 1);
+		if (exec::currentPolicy().mode == exec::Mode::Sequential || end - begin < 2 * grain)
+		{
+			fn(begin, end);
+			return;
+		}
+		ThreadPool &pool = ThreadPool::global();
+		if (pool.concurrency() <= 1)
+		{
+			fn(begin, end);
+			return;
+		}
+		pool.run(begin, end, grain, fn);
+	}
+
+	/**
+	 * @brief Computes the grain for a loop whose iterations each cost about `cost` units of work.
+	 *
+	 * @param cost Work per iteration (e.g. the row length for a loop over rows).
+	 * @return Number of iterations per chunk of about exec::PARALLEL_GRAIN units.
+	 */
+	inline std::size_t grainFor(std::size_t cost)
+	{
+		return std::max<std::size_t>(1, exec::PARALLEL_GRAIN / std::max<std::size_t>(cost, 1));
+	}
+}
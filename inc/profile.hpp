@@ -0,0 +1,628 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Opt-in instrumentation of the library's hot paths.
+ *
+ * When MG_PROFILE is non-zero (CMake: -DMG_PROFILE=ON), the following are recorded:
+ * - every expression evaluation (operator+, operator*, transpose(), ...), with its shape;
+ * - every deep copy;
+ * - every LU factorization, solve, inverse and determinant;
+ * - every reduction (sum, norm, dot product, ...; see reduction.hpp);
+ * - the bytes of every buffer allocation, charged to the operation running at the time.
+ *
+ * Each thread records into its own counters. Recording takes no lock and no atomic
+ * read-modify-write; the counters are atomic only so that snapshot() can read them from
+ * another thread. When a thread exits its counters are kept and handed to the next new
+ * thread, so memory is bounded by the number of threads recording at once. writeJson()
+ * summarizes the counters per operation: calls, latency percentiles, the most frequent
+ * shapes, and bytes allocated and copied. Between startTrace() and stopTrace() every call is
+ * also logged, and writeChromeTrace() saves the log for chrome://tracing or Perfetto.
+ *
+ * MG_PROFILE defaults to 0, and the hooks (MG_PROFILE_SCOPE, MG_PROFILE_ALLOC and
+ * MG_PROFILE_COPY) then expand to nothing. As with MG_BOUNDS_CHECK, the value must be the
+ * same in every translation unit of a program.
+ *
+ * Operations nest, and each one is timed including the ones it contains: a determinant
+ * includes its LU factorization, and the factorization the copy of its input. An evaluation
+ * whose operands overlap its destination goes through a temporary, which is recorded as a
+ * second call of the same operation.
+ */
+
+#ifndef MG_PROFILE
+#define MG_PROFILE 0
+#endif
+
+#if MG_PROFILE
+#define MG_PROFILE_CONCAT_(a, b) a##b
+#define MG_PROFILE_CONCAT(a, b) MG_PROFILE_CONCAT_(a, b)
+#define MG_PROFILE_SCOPE(...) const ::mg::profile::Scope MG_PROFILE_CONCAT(mgProfileScope, __LINE__)(__VA_ARGS__)
+#define MG_PROFILE_ALLOC(bytes) ::mg::profile::recordAllocation(bytes)
+#define MG_PROFILE_COPY(bytes) ::mg::profile::recordCopy(bytes)
+#else
+#define MG_PROFILE_SCOPE(...) ((void)0)
+#define MG_PROFILE_ALLOC(bytes) ((void)0)
+#define MG_PROFILE_COPY(bytes) ((void)0)
+#endif
+
+namespace mg
+{
+	/**
+	 * @brief Whether the library records profiling data in this build.
+	 */
+	constexpr bool PROFILE = MG_PROFILE != 0;
+
+	namespace profile
+	{
+		/**
+		 * @brief The recorded operations; Untracked collects allocations made outside all of them.
+		 */
+		enum class Op : int
+		{
+			Untracked,
+			Copy,
+			Add,
+			Subtract,
+			Multiply,
+			Scale,
+			Transpose,
+			Elementwise,
+			Factorize,
+			Solve,
+			Inverse,
+			Determinant,
+			Reduce,
+			Count
+		};
+
+		constexpr int OP_COUNT = static_cast<int>(Op::Count);
+
+		/**
+		 * @brief Gets the name of an operation as written to the reports.
+		 */
+		inline const char *name(Op op)
+		{
+			static const char *const names[OP_COUNT] = {"untracked", "copy", "add", "subtract", "multiply", "scale", "transpose",
+														"elementwise", "factorize", "solve", "inverse", "determinant", "reduce"};
+			return names[static_cast<int>(op)];
+		}
+
+		/**
+		 * @brief Distinct shapes counted per operation and thread; rarer ones are only counted in total.
+		 */
+		constexpr int SHAPE_SLOTS = 64;
+
+		/**
+		 * @brief Latency histogram buckets: four per power of two of nanoseconds, up to about 2^48 ns.
+		 */
+		constexpr int LATENCY_BUCKETS = 4 * 48;
+
+		/**
+		 * @brief Trace events kept per thread between startTrace() and stopTrace(); later ones are dropped.
+		 */
+		constexpr std::size_t TRACE_CAPACITY = std::size_t(1) << 16;
+
+		/**
+		 * @brief How often an operation ran at one shape: rows x cols, and the inner dimension of a product.
+		 */
+		struct Shape
+		{
+			int rows;
+			int cols;
+			int inner;
+			std::uint64_t count;
+		};
+
+		/**
+		 * @brief Counters of one operation, summed over all threads.
+		 */
+		struct OpStats
+		{
+			Op op;
+			std::uint64_t calls;
+			std::uint64_t totalNs;
+			std::uint64_t maxNs;
+			std::uint64_t p50Ns;
+			std::uint64_t p90Ns;
+			std::uint64_t p99Ns;
+			std::uint64_t allocations;
+			std::uint64_t bytesAllocated;
+			std::uint64_t bytesCopied;
+			std::vector<Shape> shapes; ///< Most frequent first.
+			std::uint64_t otherShapes; ///< Calls at shapes that did not fit in the shape table.
+		};
+
+		/**
+		 * @brief One traced call; times are relative to the first use of the profiler.
+		 */
+		struct TraceEvent
+		{
+			Op op;
+			int rows;
+			int cols;
+			int inner;
+			std::int64_t startNs;
+			std::int64_t durationNs;
+		};
+
+		namespace detail
+		{
+			using Clock = std::chrono::steady_clock;
+			using Counter = std::atomic<std::uint64_t>;
+
+			/**
+			 * @brief Adds to a counter that only the calling thread writes: a plain load and store.
+			 */
+			inline void bump(Counter &counter, std::uint64_t value)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			}
+
+			inline int latencyBucket(std::uint64_t ns)
+			{
+				if (ns < 4)
+				{
+					return static_cast<int>(ns);
+				}
+				int octave = 0;
+				for (std::uint64_t v = ns; v > 1; v >>= 1)
+				{
+					octave++;
+				}
+				const int bucket = 4 * (octave - 1) + static_cast<int>((ns >> (octave - 2)) & 3);
+				return std::min(bucket, LATENCY_BUCKETS - 1);
+			}
+
+			/**
+			 * @brief Largest latency that falls into a bucket.
+			 */
+			inline std::uint64_t bucketLimit(int bucket)
+			{
+				if (bucket < 4)
+				{
+					return static_cast<std::uint64_t>(bucket);
+				}
+				const int shift = bucket / 4 - 1;
+				return ((static_cast<std::uint64_t>(4 + bucket % 4) + 1) << shift) - 1;
+			}
+
+			/**
+			 * @brief Packs a shape into a non-zero key; dimensions are kept modulo 2^21.
+			 */
+			inline std::uint64_t shapeKey(int rows, int cols, int inner)
+			{
+				const std::uint64_t mask = (std::uint64_t(1) << 21) - 1;
+				return std::uint64_t(1) << 63 | (static_cast<std::uint64_t>(rows) & mask) << 42 | (static_cast<std::uint64_t>(cols) & mask) << 21 | (static_cast<std::uint64_t>(inner) & mask);
+			}
+
+			struct OpCounters
+			{
+				Counter calls;
+				Counter totalNs;
+				Counter maxNs;
+				Counter allocations;
+				Counter bytesAllocated;
+				Counter bytesCopied;
+				Counter otherShapes;
+				Counter shapeKeys[SHAPE_SLOTS]; ///< Open addressing; written once, zero while free.
+				Counter shapeCounts[SHAPE_SLOTS];
+				Counter latency[LATENCY_BUCKETS];
+			};
+
+			/**
+			 * @brief The counters and trace log of one thread; only that thread writes them.
+			 */
+			struct ThreadProfile
+			{
+				int id = 0;
+				Op current = Op::Untracked;
+				OpCounters ops[OP_COUNT];
+				std::vector<TraceEvent> trace;
+				std::atomic<std::size_t> traceSize{0};
+				Counter traceDropped{0};
+
+				void record(Op op, int rows, int cols, int inner, std::int64_t startNs, std::uint64_t ns);
+			};
+
+			/**
+			 * @brief Every thread profile ever created, and the ones whose thread has exited.
+			 *
+			 * A profile outlives its thread, so that its counters stay in the totals, and is handed
+			 * to the next thread that starts recording. Memory therefore grows with the largest
+			 * number of threads recording at the same time, not with the number of threads ever
+			 * started. A reused profile keeps adding to the same counters and trace log, so one
+			 * trace "tid" can stand for several threads that did not run at the same time.
+			 */
+			struct Registry
+			{
+				std::mutex mutex;
+				std::vector<std::unique_ptr<ThreadProfile>> threads;
+				std::vector<ThreadProfile *> idle; ///< Profiles whose thread has exited.
+				std::atomic<bool> tracing{false};
+				const Clock::time_point origin = Clock::now();
+			};
+
+			inline Registry &registry()
+			{
+				// Never destroyed: pool threads hand their profile back while static objects are being destroyed
+				static Registry *instance = new Registry();
+				return *instance;
+			}
+
+			/**
+			 * @brief Returns a thread's profile to the registry when the thread exits.
+			 */
+			struct ProfileLease
+			{
+				ThreadProfile **profile;
+
+				~ProfileLease()
+				{
+					Registry &r = registry();
+					std::lock_guard<std::mutex> lock(r.mutex);
+					(*profile)->current = Op::Untracked;
+					r.idle.push_back(*profile);
+					*profile = nullptr; // A later record on this thread takes a fresh profile, never released
+				}
+			};
+
+			/**
+			 * @brief Gets the calling thread's profile, taking an idle one or creating one on first use.
+			 */
+			inline ThreadProfile &threadProfile()
+			{
+				thread_local ThreadProfile *profile = nullptr;
+				if (profile == nullptr)
+				{
+					Registry &r = registry();
+					{
+						std::lock_guard<std::mutex> lock(r.mutex);
+						if (!r.idle.empty())
+						{
+							profile = r.idle.back();
+							r.idle.pop_back();
+						}
+						else
+						{
+							r.threads.push_back(std::make_unique<ThreadProfile>()); // Value-initialized: all counters zero
+							profile = r.threads.back().get();
+							profile->id = static_cast<int>(r.threads.size()) - 1;
+						}
+					}
+					thread_local ProfileLease lease{&profile}; // Constructed once per thread, destroyed at its exit
+				}
+				return *profile;
+			}
+
+			inline std::int64_t sinceOrigin(Clock::time_point t)
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(t - registry().origin).count();
+			}
+
+			inline void ThreadProfile::record(Op op, int rows, int cols, int inner, std::int64_t startNs, std::uint64_t ns)
+			{
+				OpCounters &c = ops[static_cast<int>(op)];
+				bump(c.calls, 1);
+				bump(c.totalNs, ns);
+				if (ns > c.maxNs.load(std::memory_order_relaxed))
+				{
+					c.maxNs.store(ns, std::memory_order_relaxed);
+				}
+				bump(c.latency[latencyBucket(ns)], 1);
+
+				const std::uint64_t key = shapeKey(rows, cols, inner);
+				int slot = static_cast<int>((key * 0x9E3779B97F4A7C15ull) >> 58);
+				for (int probe = 0;; probe++, slot = (slot + 1) % SHAPE_SLOTS)
+				{
+					if (probe == SHAPE_SLOTS)
+					{
+						bump(c.otherShapes, 1);
+						break;
+					}
+					const std::uint64_t k = c.shapeKeys[slot].load(std::memory_order_relaxed);
+					if (k == key)
+					{
+						bump(c.shapeCounts[slot], 1);
+						break;
+					}
+					if (k == 0)
+					{
+						c.shapeCounts[slot].store(1, std::memory_order_relaxed);
+						c.shapeKeys[slot].store(key, std::memory_order_release); // Publishes the count
+						break;
+					}
+				}
+
+				if (registry().tracing.load(std::memory_order_relaxed))
+				{
+					const std::size_t size = traceSize.load(std::memory_order_relaxed);
+					if (size == TRACE_CAPACITY)
+					{
+						bump(traceDropped, 1);
+						return;
+					}
+					if (trace.empty())
+					{
+						trace.resize(TRACE_CAPACITY);
+					}
+					trace[size] = TraceEvent{op, rows, cols, inner, startNs, static_cast<std::int64_t>(ns)};
+					traceSize.store(size + 1, std::memory_order_release);
+				}
+			}
+
+			template <typename F>
+			void forEachThread(F fn)
+			{
+				Registry &r = registry();
+				std::lock_guard<std::mutex> lock(r.mutex);
+				for (const auto &thread : r.threads)
+				{
+					fn(*thread);
+				}
+			}
+
+			inline std::uint64_t percentile(const std::vector<std::uint64_t> &histogram, std::uint64_t calls, double fraction)
+			{
+				const std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(calls - 1)) + 1;
+				std::uint64_t seen = 0;
+				for (int b = 0; b < LATENCY_BUCKETS; b++)
+				{
+					seen += histogram[b];
+					if (seen >= rank)
+					{
+						return bucketLimit(b);
+					}
+				}
+				return bucketLimit(LATENCY_BUCKETS - 1);
+			}
+		}
+
+		/**
+		 * @brief Times one operation from construction to destruction and charges allocations made meanwhile to it.
+		 *
+		 * Use it through MG_PROFILE_SCOPE(op, rows, cols[, inner]), which vanishes when profiling is off.
+		 */
+		class Scope
+		{
+			detail::ThreadProfile &m_profile;
+			Op m_op;
+			Op m_previous;
+			int m_rows;
+			int m_cols;
+			int m_inner;
+			detail::Clock::time_point m_start;
+
+		public:
+			Scope(Op op, int rows, int cols, int inner = 0)
+				: m_profile(detail::threadProfile()), m_op(op), m_previous(m_profile.current), m_rows(rows), m_cols(cols), m_inner(inner)
+			{
+				m_profile.current = op;
+				m_start = detail::Clock::now();
+			}
+
+			~Scope()
+			{
+				const detail::Clock::time_point end = detail::Clock::now();
+				m_profile.current = m_previous;
+				const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
+				m_profile.record(m_op, m_rows, m_cols, m_inner, detail::sinceOrigin(m_start), static_cast<std::uint64_t>(ns));
+			}
+
+			Scope(const Scope &) = delete;
+			Scope &operator=(const Scope &) = delete;
+		};
+
+		/**
+		 * @brief Charges an allocation to the operation running on this thread.
+		 *
+		 * @param bytes The size of the allocation.
+		 */
+		inline void recordAllocation(std::size_t bytes)
+		{
+			detail::ThreadProfile &p = detail::threadProfile();
+			detail::OpCounters &c = p.ops[static_cast<int>(p.current)];
+			detail::bump(c.allocations, 1);
+			detail::bump(c.bytesAllocated, bytes);
+		}
+
+		/**
+		 * @brief Charges copied elements to the operation running on this thread.
+		 *
+		 * @param bytes The number of bytes copied.
+		 */
+		inline void recordCopy(std::size_t bytes)
+		{
+			detail::ThreadProfile &p = detail::threadProfile();
+			detail::bump(p.ops[static_cast<int>(p.current)].bytesCopied, bytes);
+		}
+
+		/**
+		 * @brief Sums the counters of all threads.
+		 *
+		 * Safe to call while other threads record; their latest calls may be missing.
+		 *
+		 * @return One entry per operation that ran or allocated, in Op order.
+		 */
+		inline std::vector<OpStats> snapshot()
+		{
+			std::vector<OpStats> result;
+			for (int o = 0; o < OP_COUNT; o++)
+			{
+				OpStats stats{static_cast<Op>(o), 0, 0, 0, 0, 0, 0, 0, 0, 0, {}, 0};
+				std::vector<std::uint64_t> histogram(LATENCY_BUCKETS, 0);
+				detail::forEachThread([&](const detail::ThreadProfile &thread)
+									  {
+										  const detail::OpCounters &c = thread.ops[o];
+										  stats.calls += c.calls.load(std::memory_order_relaxed);
+										  stats.totalNs += c.totalNs.load(std::memory_order_relaxed);
+										  stats.maxNs = std::max<std::uint64_t>(stats.maxNs, c.maxNs.load(std::memory_order_relaxed));
+										  stats.allocations += c.allocations.load(std::memory_order_relaxed);
+										  stats.bytesAllocated += c.bytesAllocated.load(std::memory_order_relaxed);
+										  stats.bytesCopied += c.bytesCopied.load(std::memory_order_relaxed);
+										  stats.otherShapes += c.otherShapes.load(std::memory_order_relaxed);
+										  for (int b = 0; b < LATENCY_BUCKETS; b++)
+										  {
+											  histogram[b] += c.latency[b].load(std::memory_order_relaxed);
+										  }
+										  for (int s = 0; s < SHAPE_SLOTS; s++)
+										  {
+											  const std::uint64_t key = c.shapeKeys[s].load(std::memory_order_acquire);
+											  if (key == 0)
+											  {
+												  continue;
+											  }
+											  const std::uint64_t mask = (std::uint64_t(1) << 21) - 1;
+											  const Shape shape{static_cast<int>(key >> 42 & mask), static_cast<int>(key >> 21 & mask), static_cast<int>(key & mask),
+																c.shapeCounts[s].load(std::memory_order_relaxed)};
+											  auto same = std::find_if(stats.shapes.begin(), stats.shapes.end(), [&](const Shape &x)
+																	   { return x.rows == shape.rows && x.cols == shape.cols && x.inner == shape.inner; });
+											  if (same == stats.shapes.end())
+											  {
+												  stats.shapes.push_back(shape);
+											  }
+											  else
+											  {
+												  same->count += shape.count;
+											  }
+										  } });
+				if (stats.calls == 0 && stats.allocations == 0 && stats.bytesCopied == 0)
+				{
+					continue;
+				}
+				if (stats.calls > 0)
+				{
+					stats.p50Ns = std::min(stats.maxNs, detail::percentile(histogram, stats.calls, 0.50));
+					stats.p90Ns = std::min(stats.maxNs, detail::percentile(histogram, stats.calls, 0.90));
+					stats.p99Ns = std::min(stats.maxNs, detail::percentile(histogram, stats.calls, 0.99));
+				}
+				std::stable_sort(stats.shapes.begin(), stats.shapes.end(), [](const Shape &a, const Shape &b)
+								 { return a.count > b.count; });
+				result.push_back(std::move(stats));
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Zeroes all counters and empties the trace log.
+		 *
+		 * Call it while no other thread uses the library; concurrent records may survive.
+		 */
+		inline void reset()
+		{
+			detail::forEachThread([](detail::ThreadProfile &thread)
+								  {
+									  for (detail::OpCounters &c : thread.ops)
+									  {
+										  for (detail::Counter *counter : {&c.calls, &c.totalNs, &c.maxNs, &c.allocations, &c.bytesAllocated, &c.bytesCopied, &c.otherShapes})
+										  {
+											  counter->store(0, std::memory_order_relaxed);
+										  }
+										  for (int s = 0; s < SHAPE_SLOTS; s++)
+										  {
+											  c.shapeKeys[s].store(0, std::memory_order_relaxed);
+											  c.shapeCounts[s].store(0, std::memory_order_relaxed);
+										  }
+										  for (detail::Counter &bucket : c.latency)
+										  {
+											  bucket.store(0, std::memory_order_relaxed);
+										  }
+									  }
+									  thread.traceSize.store(0, std::memory_order_relaxed);
+									  thread.traceDropped.store(0, std::memory_order_relaxed);
+								  });
+		}
+
+		/**
+		 * @brief Starts logging every call for writeChromeTrace(), discarding the previous log.
+		 *
+		 * Each thread keeps its first TRACE_CAPACITY events; later ones are counted as dropped.
+		 */
+		inline void startTrace()
+		{
+			detail::forEachThread([](detail::ThreadProfile &thread)
+								  {
+									  thread.traceSize.store(0, std::memory_order_relaxed);
+									  thread.traceDropped.store(0, std::memory_order_relaxed);
+								  });
+			detail::registry().tracing.store(true, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Stops logging calls; the log is kept for writeChromeTrace().
+		 */
+		inline void stopTrace()
+		{
+			detail::registry().tracing.store(false, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Writes snapshot() as one JSON document.
+		 *
+		 * @param os The output stream.
+		 * @param maxShapes The number of most frequent shapes listed per operation.
+		 */
+		inline void writeJson(std::ostream &os, std::size_t maxShapes = 16)
+		{
+			const std::vector<OpStats> stats = snapshot();
+			os << "{\n  \"profile\": " << (PROFILE ? "true" : "false") << ",\n  \"operations\": [\n";
+			for (std::size_t k = 0; k < stats.size(); k++)
+			{
+				const OpStats &s = stats[k];
+				os << "    {\"op\": \"" << name(s.op) << "\", \"calls\": " << s.calls << ", \"total_ns\": " << s.totalNs
+				   << ", \"p50_ns\": " << s.p50Ns << ", \"p90_ns\": " << s.p90Ns << ", \"p99_ns\": " << s.p99Ns << ", \"max_ns\": " << s.maxNs
+				   << ", \"allocations\": " << s.allocations << ", \"bytes_allocated\": " << s.bytesAllocated << ", \"bytes_copied\": " << s.bytesCopied
+				   << ", \"shapes\": [";
+				for (std::size_t j = 0; j < s.shapes.size() && j < maxShapes; j++)
+				{
+					const Shape &shape = s.shapes[j];
+					os << (j > 0 ? ", " : "") << "{\"rows\": " << shape.rows << ", \"cols\": " << shape.cols << ", \"inner\": " << shape.inner << ", \"count\": " << shape.count << "}";
+				}
+				std::uint64_t rest = s.otherShapes;
+				for (std::size_t j = maxShapes; j < s.shapes.size(); j++)
+				{
+					rest += s.shapes[j].count;
+				}
+				os << "], \"other_shapes\": " << rest << "}" << (k + 1 < stats.size() ? "," : "") << "\n";
+			}
+			os << "  ]\n}\n";
+		}
+
+		/**
+		 * @brief Writes the trace log in the Chrome trace event format (chrome://tracing, Perfetto).
+		 *
+		 * Call it after stopTrace(), or while no other thread uses the library.
+		 *
+		 * @param os The output stream.
+		 */
+		inline void writeChromeTrace(std::ostream &os)
+		{
+			os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+			bool first = true;
+			std::uint64_t dropped = 0;
+			char time[64];
+			detail::forEachThread([&](const detail::ThreadProfile &thread)
+								  {
+									  const std::size_t size = thread.traceSize.load(std::memory_order_acquire);
+									  dropped += thread.traceDropped.load(std::memory_order_relaxed);
+									  for (std::size_t e = 0; e < size; e++)
+									  {
+										  const TraceEvent &event = thread.trace[e];
+										  std::snprintf(time, sizeof(time), "\"ts\": %.3f, \"dur\": %.3f", event.startNs / 1e3, event.durationNs / 1e3); // Microseconds
+										  os << (first ? "" : ",\n") << "{\"name\": \"" << name(event.op) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread.id
+											 << ", " << time << ", \"args\": {\"rows\": " << event.rows << ", \"cols\": " << event.cols << ", \"inner\": " << event.inner << "}}";
+										  first = false;
+									  } });
+			os << "\n], \"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+		}
+	}
+}
@@ -0,0 +1,674 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include "matrixview.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/**
+ * @brief Random number generation: Philox and xoshiro engines, and parallel matrix fills.
+ *
+ * Fills are driven by the counter-based Philox4x32-10 generator: the value of element (i, j)
+ * is a pure function of (seed, stream, i * cols + j), so a fill is reproducible for a given
+ * seed whatever the number of threads or the order they run in. Distinct streams give
+ * independent matrices under one seed.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Philox4x32-10 counter-based generator (Salmon et al., SC'11).
+	 *
+	 * block() maps a 128-bit counter to four 32-bit words under a 64-bit key (the seed), with
+	 * no state between calls. The object is also a sequential UniformRandomBitGenerator that
+	 * walks the counter, for use with the standard distributions.
+	 */
+	class Philox4x32
+	{
+	private:
+		static constexpr std::uint32_t M0 = 0xD2511F53;
+		static constexpr std::uint32_t M1 = 0xCD9E8D57;
+		static constexpr std::uint32_t W0 = 0x9E3779B9;
+		static constexpr std::uint32_t W1 = 0xBB67AE85;
+
+		std::uint32_t m_key[2];
+		std::uint64_t m_stream;
+		std::uint64_t m_position = 0; // Words drawn through operator()
+		std::uint64_t m_cached = ~std::uint64_t(0);
+		std::uint32_t m_buffer[4] = {};
+
+	public:
+		/**
+		 * @brief Number of counters a batch computes at once, lane by lane.
+		 */
+		static constexpr int BATCH = 64;
+
+		using result_type = std::uint32_t;
+
+		/**
+		 * @brief Creates the generator for a seed; stream selects an independent sequence.
+		 */
+		explicit Philox4x32(std::uint64_t seed = 0, std::uint64_t stream = 0)
+			: m_key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)}, m_stream(stream) {}
+
+		/**
+		 * @brief Computes the four words of counter (counter, stream).
+		 */
+		void block(std::uint64_t counter, std::uint32_t out[4]) const
+		{
+			batch(counter, 1, out);
+		}
+
+		/**
+		 * @brief Computes the words of count <= BATCH consecutive counters into out[4 * count].
+		 *
+		 * The rounds run over all lanes together so the compiler can vectorize them.
+		 */
+		void batch(std::uint64_t first, int count, std::uint32_t *out) const
+		{
+			std::uint32_t c0[BATCH], c1[BATCH], c2[BATCH], c3[BATCH];
+			for (int l = 0; l < BATCH; l++)
+			{
+				const std::uint64_t counter = first + l;
+				c0[l] = static_cast<std::uint32_t>(counter);
+				c1[l] = static_cast<std::uint32_t>(counter >> 32);
+				c2[l] = static_cast<std::uint32_t>(m_stream);
+				c3[l] = static_cast<std::uint32_t>(m_stream >> 32);
+			}
+			std::uint32_t k0 = m_key[0], k1 = m_key[1];
+			for (int round = 0; round < 10; round++)
+			{
+				for (int l = 0; l < BATCH; l++)
+				{
+					const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * c0[l];
+					const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * c2[l];
+					const std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1[l] ^ k0;
+					const std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3[l] ^ k1;
+					c1[l] = static_cast<std::uint32_t>(p1);
+					c3[l] = static_cast<std::uint32_t>(p0);
+					c0[l] = n0;
+					c2[l] = n2;
+				}
+				k0 += W0;
+				k1 += W1;
+			}
+			for (int l = 0; l < count; l++)
+			{
+				out[4 * l] = c0[l];
+				out[4 * l + 1] = c1[l];
+				out[4 * l + 2] = c2[l];
+				out[4 * l + 3] = c3[l];
+			}
+		}
+
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+
+		static constexpr result_type max()
+		{
+			return std::numeric_limits<result_type>::max();
+		}
+
+		/**
+		 * @brief Returns the next word of the sequence.
+		 */
+		result_type operator()()
+		{
+			const std::uint64_t counter = m_position / 4;
+			if (counter != m_cached)
+			{
+				block(counter, m_buffer);
+				m_cached = counter;
+			}
+			return m_buffer[m_position++ % 4];
+		}
+
+		/**
+		 * @brief Skips n words in O(1).
+		 */
+		void discard(std::uint64_t n)
+		{
+			m_position += n;
+		}
+	};
+
+	/**
+	 * @brief xoshiro256++ (Blackman and Vigna): a fast sequential 64-bit generator.
+	 *
+	 * Seeded through SplitMix64. jump() advances by 2^128 draws, splitting one seed into
+	 * non-overlapping sequences for parallel consumers.
+	 */
+	class Xoshiro256
+	{
+	private:
+		std::uint64_t m_state[4];
+
+		static std::uint64_t rotl(std::uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+	public:
+		using result_type = std::uint64_t;
+
+		explicit Xoshiro256(std::uint64_t seed = 0)
+		{
+			for (std::uint64_t &word : m_state)
+			{
+				seed += 0x9E3779B97F4A7C15ULL; // SplitMix64
+				std::uint64_t z = seed;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				word = z ^ (z >> 31);
+			}
+		}
+
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+
+		static constexpr result_type max()
+		{
+			return std::numeric_limits<result_type>::max();
+		}
+
+		result_type operator()()
+		{
+			const std::uint64_t result = rotl(m_state[0] + m_state[3], 23) + m_state[0];
+			const std::uint64_t t = m_state[1] << 17;
+			m_state[2] ^= m_state[0];
+			m_state[3] ^= m_state[1];
+			m_state[1] ^= m_state[2];
+			m_state[0] ^= m_state[3];
+			m_state[2] ^= t;
+			m_state[3] = rotl(m_state[3], 45);
+			return result;
+		}
+
+		/**
+		 * @brief Advances the state by 2^128 draws.
+		 */
+		void jump()
+		{
+			static constexpr std::uint64_t JUMP[] = {0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL};
+			std::uint64_t s[4] = {};
+			for (std::uint64_t word : JUMP)
+			{
+				for (int b = 0; b < 64; b++)
+				{
+					if (word & (std::uint64_t(1) << b))
+					{
+						for (int k = 0; k < 4; k++)
+						{
+							s[k] ^= m_state[k];
+						}
+					}
+					(*this)();
+				}
+			}
+			std::copy(s, s + 4, m_state);
+		}
+	};
+
+	namespace detail
+	{
+		/**
+		 * @brief Returns a different well-mixed seed on every call, for fills without an explicit seed.
+		 */
+		inline std::uint64_t freshSeed()
+		{
+			static std::atomic<std::uint64_t> counter{(static_cast<std::uint64_t>(std::random_device()()) << 32) ^
+													   static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())};
+			std::uint64_t z = counter.fetch_add(0x9E3779B97F4A7C15ULL, std::memory_order_relaxed);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+
+		/**
+		 * @brief Maps random bits to [1, 2) by filling the mantissa; integer ops only, so it vectorizes.
+		 *
+		 * A long double wider than double is the double value widened, so it has 52 random bits.
+		 */
+		template <typename T>
+		MG_ALWAYS_INLINE T unitInterval12(std::uint64_t bits)
+		{
+			T value;
+			if constexpr (sizeof(T) == 4)
+			{
+				const std::uint32_t word = 0x3F800000u | static_cast<std::uint32_t>(bits >> 9);
+				std::memcpy(&value, &word, sizeof(value));
+			}
+			else if constexpr (sizeof(T) == 8)
+			{
+				const std::uint64_t word = 0x3FF0000000000000ULL | (bits >> 12);
+				std::memcpy(&value, &word, sizeof(value));
+			}
+			else
+			{
+				value = static_cast<T>(unitInterval12<double>(bits));
+			}
+			return value;
+		}
+
+		/**
+		 * @brief Unbiased integers in [low, high]: Lemire's multiply-shift with rejection.
+		 *
+		 * Each element consumes one 32-bit word (64-bit for ranges above 2^32). A rejected word
+		 * is replaced by words from a separate Philox key derived from the element index, so
+		 * the result still depends only on (seed, stream, index).
+		 */
+		template <typename T>
+		struct UniformInt
+		{
+			static constexpr int WORDS = sizeof(T) > 4 ? 2 : 1;
+
+			T low;
+			std::uint64_t range; // high - low + 1, or 0 for the full 64-bit range
+			std::uint64_t seed;
+			std::uint64_t stream;
+
+			std::uint64_t redraw(std::uint64_t index, int &attempt) const
+			{
+				std::uint32_t words[4];
+				Philox4x32(seed ^ (0xA0761D6478BD642FULL * static_cast<std::uint64_t>(attempt / 2 + 1)), stream).block(index, words);
+				const int k = 2 * (attempt % 2);
+				attempt++;
+				return WORDS == 2 ? words[k] | static_cast<std::uint64_t>(words[k + 1]) << 32 : words[k];
+			}
+
+			T operator()(std::uint64_t bits, std::uint64_t index) const
+			{
+				using U = std::make_unsigned_t<T>;
+				if (WORDS == 1 || range <= (std::uint64_t(1) << 32))
+				{
+					if (range == 0 || range == (std::uint64_t(1) << 32))
+					{
+						return static_cast<T>(static_cast<U>(low) + static_cast<U>(bits));
+					}
+					std::uint32_t word = static_cast<std::uint32_t>(bits);
+					std::uint64_t m = static_cast<std::uint64_t>(word) * range;
+					if (static_cast<std::uint32_t>(m) < range)
+					{
+						const std::uint32_t threshold = static_cast<std::uint32_t>((std::uint64_t(1) << 32) % range);
+						int attempt = 0;
+						while (static_cast<std::uint32_t>(m) < threshold)
+						{
+							word = static_cast<std::uint32_t>(redraw(index, attempt));
+							m = static_cast<std::uint64_t>(word) * range;
+						}
+					}
+					return static_cast<T>(static_cast<U>(low) + static_cast<U>(m >> 32));
+				}
+				// Ranges beyond 32 bits: mask to the next power of two and reject
+				std::uint64_t mask = range - 1;
+				for (int shift = 1; shift < 64; shift *= 2)
+				{
+					mask |= mask >> shift;
+				}
+				int attempt = 0;
+				while ((bits & mask) >= range)
+				{
+					bits = redraw(index, attempt);
+				}
+				return static_cast<T>(static_cast<U>(low) + static_cast<U>(bits & mask));
+			}
+		};
+
+		/**
+		 * @brief Floats in [low, high), from the top 23 (float) or 52 (double, long double) bits of the words.
+		 */
+		template <typename T>
+		struct UniformReal
+		{
+			static constexpr int WORDS = sizeof(T) > 4 ? 2 : 1;
+
+			T low;
+			T width;
+
+			T operator()(std::uint64_t bits, std::uint64_t) const
+			{
+				const T value = low + (unitInterval12<T>(bits) - 1) * width;
+				return value < low + width ? value : low; // Rounding may reach the open end
+			}
+		};
+
+		/**
+		 * @brief Writes dist(bits(e), e) for the count elements e = first, first + 1, ... into out.
+		 *
+		 * Element e takes word e of the Philox stream, or words 2e and 2e + 1 for 64-bit types.
+		 */
+		template <typename T, typename Dist>
+		void generate(const Philox4x32 &philox, const Dist &dist, std::uint64_t first, std::size_t count, T *out)
+		{
+			constexpr int PER_BLOCK = 4 / Dist::WORDS;
+			std::uint32_t words[4 * Philox4x32::BATCH];
+			std::uint64_t e = first;
+			const std::uint64_t end = first + count;
+			while (e < end)
+			{
+				const std::uint64_t block = e / PER_BLOCK;
+				const std::uint64_t blocks = std::min<std::uint64_t>((end - 1) / PER_BLOCK - block + 1, Philox4x32::BATCH);
+				philox.batch(block, static_cast<int>(blocks), words);
+				const std::uint64_t base = block * PER_BLOCK;
+				const std::size_t skip = static_cast<std::size_t>(e - base);
+				const std::size_t stop = static_cast<std::size_t>(std::min(end, (block + blocks) * PER_BLOCK) - base);
+				for (std::size_t k = skip; k < stop; k++)
+				{
+					const std::uint64_t bits = Dist::WORDS == 2 ? words[2 * k] | static_cast<std::uint64_t>(words[2 * k + 1]) << 32 : words[k];
+					*out++ = dist(bits, base + k);
+				}
+				e = base + stop;
+			}
+		}
+
+		/**
+		 * @brief Natural logarithm of a positive normal number, branch-free so loops over it vectorize.
+		 *
+		 * x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then the Cephes logf polynomial (float) or
+		 * the fdlibm log kernel (double) for log(m); accurate to about 1 ulp.
+		 */
+		template <typename T>
+		MG_ALWAYS_INLINE T logPositive(T x)
+		{
+			using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+			constexpr int MANTISSA = std::numeric_limits<T>::digits - 1;
+			constexpr Bits MANTISSA_MASK = (Bits(1) << MANTISSA) - 1;
+			constexpr Bits HALF_EXPONENT = static_cast<Bits>(std::numeric_limits<T>::max_exponent - 2) << MANTISSA;
+			Bits bits;
+			std::memcpy(&bits, &x, sizeof(x));
+			T e = static_cast<T>(static_cast<int>(bits >> MANTISSA) - (std::numeric_limits<T>::max_exponent - 2));
+			bits = (bits & MANTISSA_MASK) | HALF_EXPONENT; // m in [0.5, 1)
+			T m;
+			std::memcpy(&m, &bits, sizeof(m));
+			const bool small = m < static_cast<T>(0.70710678118654752440);
+			e = small ? e - 1 : e;
+			const T f = small ? m + m - 1 : m - 1;
+			const T z = f * f;
+			if constexpr (sizeof(T) == 4)
+			{
+				T p = static_cast<T>(7.0376836292E-2);
+				p = p * f + static_cast<T>(-1.1514610310E-1);
+				p = p * f + static_cast<T>(1.1676998740E-1);
+				p = p * f + static_cast<T>(-1.2420140846E-1);
+				p = p * f + static_cast<T>(1.4249322787E-1);
+				p = p * f + static_cast<T>(-1.6668057665E-1);
+				p = p * f + static_cast<T>(2.0000714765E-1);
+				p = p * f + static_cast<T>(-2.4999993993E-1);
+				p = p * f + static_cast<T>(3.3333331174E-1);
+				T y = f * z * p;
+				y += e * static_cast<T>(-2.12194440e-4);
+				y -= static_cast<T>(0.5) * z;
+				return f + y + e * static_cast<T>(0.693359375); // ln 2 split in two parts for accuracy
+			}
+			else
+			{
+				// fdlibm: log(1 + f) = f - f^2 / 2 + s (f^2 / 2 + R(s^2)), s = f / (2 + f)
+				const T s = f / (2 + f);
+				const T s2 = s * s;
+				const T s4 = s2 * s2;
+				const T t1 = s4 * (static_cast<T>(3.999999999940941908e-01) + s4 * (static_cast<T>(2.222219843214978396e-01) + s4 * static_cast<T>(1.531383769920937332e-01)));
+				const T t2 = s2 * (static_cast<T>(6.666666666666735130e-01) + s4 * (static_cast<T>(2.857142874366239149e-01) + s4 * (static_cast<T>(1.818357216161805012e-01) + s4 * static_cast<T>(1.479819860511658591e-01))));
+				const T half = static_cast<T>(0.5) * z;
+				return e * static_cast<T>(6.93147180369123816490e-01) - ((half - (s * (half + t1 + t2) + e * static_cast<T>(1.90821492927058770002e-10))) - f);
+			}
+		}
+
+		/**
+		 * @brief Square root of x >= 0 by Newton's method, without the errno path of std::sqrt.
+		 *
+		 * std::sqrt keeps a scalar call for negative arguments unless built with
+		 * -fno-math-errno, which stops the caller from vectorizing. Starts from the bit-trick
+		 * reciprocal square root, refines it, then corrects the product once; within 1 ulp.
+		 */
+		template <typename T>
+		MG_ALWAYS_INLINE T sqrtNonNegative(T x)
+		{
+			using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+			constexpr Bits MAGIC = sizeof(T) == 4 ? Bits(0x5F375A86u) : Bits(0x5FE6EB50C7B537A9ull);
+			constexpr int STEPS = sizeof(T) == 4 ? 2 : 3;
+			Bits bits;
+			std::memcpy(&bits, &x, sizeof(x));
+			bits = MAGIC - (bits >> 1);
+			T y;
+			std::memcpy(&y, &bits, sizeof(y));
+			const T half = static_cast<T>(0.5) * x;
+			for (int k = 0; k < STEPS; k++)
+			{
+				y = y * (static_cast<T>(1.5) - half * y * y);
+			}
+			const T s = x * y; // 0 for x = 0, as y stays finite
+			return s + static_cast<T>(0.5) * y * (x - s * s);
+		}
+
+		/**
+		 * @brief Computes sin(2 pi u) and cos(2 pi u) for u in [0, 1), branch-free.
+		 *
+		 * The turn fraction is reduced exactly to [-1/8, 1/8] plus a quadrant, then Cephes
+		 * polynomials for [-pi/4, pi/4] are evaluated and swapped or negated by quadrant.
+		 */
+		template <typename T>
+		MG_ALWAYS_INLINE void sinCosTurns(T u, T &sine, T &cosine)
+		{
+			const std::int32_t q = static_cast<std::int32_t>(u * 4 + static_cast<T>(0.5)); // Nearest quarter turn, 0..4
+			const T x = (u - static_cast<T>(q) * static_cast<T>(0.25)) * static_cast<T>(6.283185307179586476925);
+			const T z = x * x;
+			T s, c;
+			if constexpr (sizeof(T) == 4)
+			{
+				s = x + x * z * ((static_cast<T>(-1.9515295891E-4) * z + static_cast<T>(8.3321608736E-3)) * z + static_cast<T>(-1.6666654611E-1));
+				c = 1 - static_cast<T>(0.5) * z + z * z * ((static_cast<T>(2.443315711809948E-5) * z + static_cast<T>(-1.388731625493765E-3)) * z + static_cast<T>(4.166664568298827E-2));
+			}
+			else
+			{
+				T ps = static_cast<T>(1.58962301576546568060E-10);
+				ps = ps * z + static_cast<T>(-2.50507477628578072866E-8);
+				ps = ps * z + static_cast<T>(2.75573136213857245213E-6);
+				ps = ps * z + static_cast<T>(-1.98412698295895385996E-4);
+				ps = ps * z + static_cast<T>(8.33333333332211858878E-3);
+				ps = ps * z + static_cast<T>(-1.66666666666666307295E-1);
+				s = x + x * z * ps;
+				T pc = static_cast<T>(-1.13585365213876817300E-11);
+				pc = pc * z + static_cast<T>(2.08757008419747316778E-9);
+				pc = pc * z + static_cast<T>(-2.75573141792967388112E-7);
+				pc = pc * z + static_cast<T>(2.48015872888517045348E-5);
+				pc = pc * z + static_cast<T>(-1.38888888888730564116E-3);
+				pc = pc * z + static_cast<T>(4.16666666666665929218E-2);
+				c = 1 - static_cast<T>(0.5) * z + z * z * pc;
+			}
+			// Rotate by q quarter turns: (s, c) -> (c, -s) -> (-s, -c) -> (-c, s)
+			const T rs = (q & 1) ? c : s;
+			const T rc = (q & 1) ? s : c;
+			sine = (q & 2) ? -rs : rs;
+			cosine = ((q + 1) & 2) ? -rc : rc; // Quadrants 1 and 2
+		}
+
+		/**
+		 * @brief Box-Muller over a batch of Philox words: pair p makes z[2p] and z[2p + 1].
+		 *
+		 * Each pair takes 32 bits per uniform for float and 64 for double. Every step is
+		 * branch-free arithmetic, so the loop vectorizes.
+		 */
+		template <typename T>
+		void boxMuller(const std::uint32_t *words, int pairs, T mean, T stddev, T *z)
+		{
+			for (int p = 0; p < pairs; p++)
+			{
+				std::uint64_t a, b;
+				if constexpr (sizeof(T) == 4)
+				{
+					a = words[2 * p];
+					b = words[2 * p + 1];
+				}
+				else
+				{
+					a = words[4 * p] | static_cast<std::uint64_t>(words[4 * p + 1]) << 32;
+					b = words[4 * p + 2] | static_cast<std::uint64_t>(words[4 * p + 3]) << 32;
+				}
+				const T u1 = 2 - unitInterval12<T>(a); // (0, 1], keeps log finite
+				const T u2 = unitInterval12<T>(b) - 1; // [0, 1)
+				const T radius = -2 * logPositive(u1);
+				const T r = sqrtNonNegative(radius) * stddev;
+				T sine, cosine;
+				sinCosTurns(u2, sine, cosine);
+				z[2 * p] = mean + r * cosine;
+				z[2 * p + 1] = mean + r * sine;
+			}
+		}
+
+		/**
+		 * @brief Normal variates by the Box-Muller transform; elements 2p and 2p + 1 share a uniform pair.
+		 */
+		template <typename T>
+		void generateNormal(const Philox4x32 &philox, T mean, T stddev, std::uint64_t first, std::size_t count, T *out)
+		{
+			constexpr int PAIRS_PER_BLOCK = sizeof(T) > 4 ? 1 : 2;
+			std::uint32_t words[4 * Philox4x32::BATCH];
+			T z[2 * PAIRS_PER_BLOCK * Philox4x32::BATCH];
+			std::uint64_t e = first;
+			const std::uint64_t end = first + count;
+			while (e < end)
+			{
+				const std::uint64_t block = e / (2 * PAIRS_PER_BLOCK);
+				const std::uint64_t blocks = std::min<std::uint64_t>((end - 1) / (2 * PAIRS_PER_BLOCK) - block + 1, Philox4x32::BATCH);
+				philox.batch(block, static_cast<int>(blocks), words);
+				const int pairs = static_cast<int>(blocks) * PAIRS_PER_BLOCK;
+				boxMuller(words, pairs, mean, stddev, z);
+				const std::uint64_t base = block * 2 * PAIRS_PER_BLOCK;
+				const std::uint64_t stop = std::min(end, base + 2 * static_cast<std::uint64_t>(pairs));
+				for (; e < stop; e++)
+				{
+					*out++ = z[e - base];
+				}
+			}
+		}
+
+		/**
+		 * @brief Normal variates for types wider than double: standard normals drawn in double, then scaled in T.
+		 *
+		 * The bit-level log and square root kernels only handle float and double.
+		 */
+		template <typename T>
+		void generateNormalWidened(const Philox4x32 &philox, T mean, T stddev, std::uint64_t first, std::size_t count, T *out)
+		{
+			constexpr std::size_t CHUNK = 256;
+			double z[CHUNK];
+			for (std::size_t done = 0; done < count; done += CHUNK)
+			{
+				const std::size_t n = std::min(CHUNK, count - done);
+				generateNormal(philox, 0.0, 1.0, first + done, n, z);
+				for (std::size_t k = 0; k < n; k++)
+				{
+					out[done + k] = mean + stddev * static_cast<T>(z[k]);
+				}
+			}
+		}
+
+		/**
+		 * @brief Runs gen(first, count, out) over every row of dst in parallel; element (i, j) has index i * cols + j.
+		 */
+		template <typename T, typename Gen>
+		void fillIndexed(const MatrixView<T> &dst, const Gen &gen)
+		{
+			const int rows = dst.getRows();
+			const int cols = dst.getCols();
+			if (rows == 0 || cols == 0)
+			{
+				return;
+			}
+			if (dst.getStride() == cols || rows == 1)
+			{
+				parallelFor(0, static_cast<std::size_t>(rows) * cols, grainFor(8), [&](std::size_t lo, std::size_t hi)
+							{ gen(lo, hi - lo, dst.data() + lo); });
+				return;
+			}
+			parallelFor(0, rows, grainFor(8 * static_cast<std::size_t>(cols)), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								gen(i * cols, cols, dst.rowPtr(static_cast<int>(i)));
+							} });
+		}
+	}
+
+	/**
+	 * @brief Fills a matrix with uniform random values, reproducibly in parallel.
+	 *
+	 * Integers are drawn without bias from [low, high]; floating-point values from [low, high).
+	 *
+	 * @param dst The destination.
+	 * @param low The minimum value.
+	 * @param high The maximum value.
+	 * @param seed The seed; the same seed, stream and shape give the same matrix.
+	 * @param stream Selects an independent sequence under the same seed.
+	 * @throws std::invalid_argument If low is greater than high.
+	 */
+	template <typename T>
+	void fillUniform(const MatrixView<T> &dst, T low, T high, std::uint64_t seed, std::uint64_t stream = 0)
+	{
+		static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "fillUniform needs an arithmetic element type");
+		if (low > high)
+		{
+			throw std::invalid_argument("Min cannot be greater than Max");
+		}
+		const Philox4x32 philox(seed, stream);
+		if constexpr (std::is_integral<T>::value)
+		{
+			using U = std::make_unsigned_t<T>;
+			const std::uint64_t range = static_cast<std::uint64_t>(static_cast<U>(static_cast<U>(high) - static_cast<U>(low))) + 1;
+			const detail::UniformInt<T> dist{low, range, seed, stream};
+			detail::fillIndexed(dst, [&](std::uint64_t first, std::size_t count, T *out)
+								{ detail::generate(philox, dist, first, count, out); });
+		}
+		else
+		{
+			const detail::UniformReal<T> dist{low, high - low};
+			detail::fillIndexed(dst, [&](std::uint64_t first, std::size_t count, T *out)
+								{ detail::generate(philox, dist, first, count, out); });
+		}
+	}
+
+	/**
+	 * @brief Fills a floating-point matrix with normal random values, reproducibly in parallel.
+	 *
+	 * @param dst The destination.
+	 * @param mean The mean of the distribution.
+	 * @param stddev The standard deviation of the distribution.
+	 * @param seed The seed; the same seed, stream and shape give the same matrix.
+	 * @param stream Selects an independent sequence under the same seed.
+	 * @throws std::invalid_argument If stddev is negative.
+	 */
+	template <typename T>
+	void fillNormal(const MatrixView<T> &dst, T mean, T stddev, std::uint64_t seed, std::uint64_t stream = 0)
+	{
+		static_assert(std::is_floating_point<T>::value, "fillNormal needs a floating-point element type");
+		if (stddev < 0)
+		{
+			throw std::invalid_argument("Standard deviation must be non-negative");
+		}
+		const Philox4x32 philox(seed, stream);
+		if constexpr (sizeof(T) > sizeof(double))
+		{
+			detail::fillIndexed(dst, [&](std::uint64_t first, std::size_t count, T *out)
+								{ detail::generateNormalWidened(philox, mean, stddev, first, count, out); });
+		}
+		else
+		{
+			detail::fillIndexed(dst, [&](std::uint64_t first, std::size_t count, T *out)
+								{ detail::generateNormal(philox, mean, stddev, first, count, out); });
+		}
+	}
+}
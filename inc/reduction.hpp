@@ -0,0 +1,608 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "lowprecision.hpp"
+#include "matrix.hpp"
+#include "matrixview.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+
+/**
+ * @brief Reductions over matrices: sums, extrema, norms, trace and dot products.
+ *
+ * Elements are summed in Accumulator<T> (float for half and bfloat16, int32 for 8-bit
+ * integers, T otherwise). Floating-point sums are pairwise: each row is split in halves down
+ * to blocks of PAIRWISE_LEAF elements, which are summed in SUM_LANES interleaved partial sums,
+ * and row and chunk results are combined pairwise as well. The rounding error grows with the
+ * logarithm of the number of elements instead of linearly. The summation order depends only on
+ * the dimensions, so results are bitwise identical for any number of threads and for views
+ * of any stride.
+ *
+ * Column-wise reductions read whole rows and add them into a row of partial sums, so no
+ * column is ever walked with a stride.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Type of norms of a matrix of T: the accumulator for floating-point types, double otherwise.
+	 */
+	template <typename T>
+	using NormType = typename std::conditional<std::is_floating_point<Accumulator<T>>::value, Accumulator<T>, double>::type;
+
+	namespace detail
+	{
+		/**
+		 * @brief Interleaved partial sums at the leaves of a pairwise sum.
+		 */
+		constexpr std::size_t SUM_LANES = 8;
+
+		/**
+		 * @brief Length below which a pairwise sum stops splitting.
+		 */
+		constexpr std::size_t PAIRWISE_LEAF = 256;
+
+		/**
+		 * @brief Rows summed one after the other, per column, before column partials are combined pairwise.
+		 */
+		constexpr int COLUMN_LEAF = 64;
+
+		/**
+		 * @brief Sums term(i) for i in [begin, end) pairwise.
+		 *
+		 * The split points depend only on begin and end, so the result is reproducible.
+		 */
+		template <typename Acc, typename F>
+		Acc pairwiseSum(std::size_t begin, std::size_t end, const F &term)
+		{
+			const std::size_t n = end - begin;
+			if (n > PAIRWISE_LEAF)
+			{
+				std::size_t half = n / 2;
+				half -= half % SUM_LANES;
+				return pairwiseSum<Acc>(begin, begin + half, term) + pairwiseSum<Acc>(begin + half, end, term);
+			}
+			Acc lane[SUM_LANES] = {};
+			std::size_t i = begin;
+			for (; i + SUM_LANES <= end; i += SUM_LANES)
+			{
+				for (std::size_t k = 0; k < SUM_LANES; k++)
+				{
+					lane[k] += term(i + k);
+				}
+			}
+			for (std::size_t width = SUM_LANES / 2; width > 0; width /= 2)
+			{
+				for (std::size_t k = 0; k < width; k++)
+				{
+					lane[k] += lane[k + width];
+				}
+			}
+			Acc sum = lane[0];
+			for (; i < end; i++)
+			{
+				sum += term(i);
+			}
+			return sum;
+		}
+
+		/**
+		 * @brief Sums rowTerm(i) over the rows of a rows x cols matrix, in parallel.
+		 *
+		 * Rows are grouped into fixed chunks sized from cols alone; the row results of a chunk,
+		 * and then the chunk results, are summed pairwise.
+		 */
+		template <typename Acc, typename F>
+		Acc sumRows(int rows, int cols, const F &rowTerm)
+		{
+			const std::size_t rowsPerChunk = grainFor(cols);
+			const std::size_t chunks = (static_cast<std::size_t>(rows) + rowsPerChunk - 1) / rowsPerChunk;
+			std::vector<Acc> partial(chunks, Acc());
+			parallelFor(0, chunks, 1, [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t chunk = lo; chunk < hi; chunk++)
+							{
+								const std::size_t first = chunk * rowsPerChunk;
+								const std::size_t last = std::min<std::size_t>(rows, first + rowsPerChunk);
+								partial[chunk] = pairwiseSum<Acc>(first, last, [&](std::size_t i)
+																  { return rowTerm(static_cast<int>(i)); });
+							} });
+			return pairwiseSum<Acc>(0, chunks, [&](std::size_t c)
+									{ return partial[c]; });
+		}
+
+		/**
+		 * @brief Sums term(row[j]) down every column of a view.
+		 *
+		 * Blocks of COLUMN_LEAF rows are added row by row into contiguous partial rows, in
+		 * parallel; the partial rows are then combined pairwise, one tree level at a time.
+		 */
+		template <typename Acc, typename T, typename F>
+		std::vector<Acc> sumColumns(MatrixView<const T> source, const F &term)
+		{
+			const int rows = source.getRows();
+			const std::size_t cols = static_cast<std::size_t>(source.getCols());
+			const std::size_t leaves = (static_cast<std::size_t>(rows) + COLUMN_LEAF - 1) / COLUMN_LEAF;
+			if (leaves == 0)
+			{
+				return std::vector<Acc>(cols, Acc());
+			}
+			std::vector<Acc> partial(leaves * cols, Acc());
+			parallelFor(0, leaves, grainFor(COLUMN_LEAF * cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t leaf = lo; leaf < hi; leaf++)
+							{
+								Acc *out = partial.data() + leaf * cols;
+								const int last = static_cast<int>(std::min<std::size_t>(rows, (leaf + 1) * COLUMN_LEAF));
+								for (int i = static_cast<int>(leaf * COLUMN_LEAF); i < last; i++)
+								{
+									const T *row = source.data() + static_cast<std::size_t>(i) * source.getStride();
+									for (std::size_t j = 0; j < cols; j++)
+									{
+										out[j] += term(row[j]);
+									}
+								}
+							} });
+			for (std::size_t width = 1; width < leaves; width *= 2)
+			{
+				const std::size_t pairs = (leaves - width + 2 * width - 1) / (2 * width);
+				parallelFor(0, pairs, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+							{
+								for (std::size_t k = lo; k < hi; k++)
+								{
+									Acc *dst = partial.data() + 2 * k * width * cols;
+									const Acc *src = dst + width * cols;
+									for (std::size_t j = 0; j < cols; j++)
+									{
+										dst[j] += src[j];
+									}
+								}
+							});
+			}
+			partial.resize(cols);
+			return partial;
+		}
+
+		template <typename Acc>
+		Acc magnitude(Acc value)
+		{
+			if constexpr (std::is_unsigned<Acc>::value)
+			{
+				return value;
+			}
+			else
+			{
+				return std::abs(value);
+			}
+		}
+
+		/**
+		 * @brief Finds the smallest (Better = std::less) or largest (Better = std::greater) element.
+		 *
+		 * A NaN replaces the running value and is never replaced, so a NaN anywhere makes the
+		 * result NaN, whichever thread meets it.
+		 */
+		template <typename Better, typename T>
+		Accumulator<T> extremum(MatrixView<const T> source)
+		{
+			using Acc = Accumulator<T>;
+			const int rows = source.getRows();
+			const int cols = source.getCols();
+			if (rows == 0 || cols == 0)
+			{
+				throw std::invalid_argument("Cannot reduce an empty matrix");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Reduce, rows, cols);
+			auto pick = [](Acc x, Acc value)
+			{
+				return (Better()(x, value) | (x != x)) ? x : value;
+			};
+			const std::size_t rowsPerChunk = grainFor(cols);
+			const std::size_t chunks = (static_cast<std::size_t>(rows) + rowsPerChunk - 1) / rowsPerChunk;
+			std::vector<Acc> best(chunks);
+			parallelFor(0, chunks, 1, [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t chunk = lo; chunk < hi; chunk++)
+							{
+								const std::size_t last = std::min<std::size_t>(rows, (chunk + 1) * rowsPerChunk);
+								Acc lane[SUM_LANES];
+								std::fill(lane, lane + SUM_LANES, static_cast<Acc>(source.data()[chunk * rowsPerChunk * source.getStride()]));
+								for (std::size_t i = chunk * rowsPerChunk; i < last; i++)
+								{
+									const T *row = source.data() + i * source.getStride();
+									std::size_t j = 0;
+									for (; j + SUM_LANES <= static_cast<std::size_t>(cols); j += SUM_LANES)
+									{
+										for (std::size_t k = 0; k < SUM_LANES; k++)
+										{
+											lane[k] = pick(static_cast<Acc>(row[j + k]), lane[k]);
+										}
+									}
+									for (; j < static_cast<std::size_t>(cols); j++)
+									{
+										lane[0] = pick(static_cast<Acc>(row[j]), lane[0]);
+									}
+								}
+								Acc value = lane[0];
+								for (std::size_t k = 1; k < SUM_LANES; k++)
+								{
+									value = pick(lane[k], value);
+								}
+								best[chunk] = value;
+							} });
+			Acc result = best[0];
+			for (const Acc &value : best)
+			{
+				result = pick(value, result);
+			}
+			return result;
+		}
+	}
+
+	/**
+	 * @brief Sums all elements, pairwise for floating-point types.
+	 *
+	 * @param source The matrix to sum.
+	 * @return The sum; zero for an empty matrix.
+	 */
+	template <typename T>
+	Accumulator<T> sum(MatrixView<const T> source)
+	{
+		using Acc = Accumulator<T>;
+		MG_PROFILE_SCOPE(profile::Op::Reduce, source.getRows(), source.getCols());
+		return detail::sumRows<Acc>(source.getRows(), source.getCols(), [&](int i)
+									{
+										const T *row = source.data() + static_cast<std::size_t>(i) * source.getStride();
+										return detail::pairwiseSum<Acc>(0, source.getCols(), [row](std::size_t j)
+																		{ return static_cast<Acc>(row[j]); }); });
+	}
+
+	/**
+	 * @brief Computes the sum of the element-wise products of two matrices of equal size.
+	 *
+	 * For row or column vectors this is the usual dot product.
+	 *
+	 * @param a The first operand.
+	 * @param b The second operand.
+	 * @return The sum of a(i, j) * b(i, j).
+	 * @throws std::invalid_argument If the dimensions differ.
+	 */
+	template <typename T>
+	Accumulator<T> dot(MatrixView<const T> a, MatrixView<const T> b)
+	{
+		using Acc = Accumulator<T>;
+		if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		MG_PROFILE_SCOPE(profile::Op::Reduce, a.getRows(), a.getCols());
+		return detail::sumRows<Acc>(a.getRows(), a.getCols(), [&](int i)
+									{
+										const T *x = a.data() + static_cast<std::size_t>(i) * a.getStride();
+										const T *y = b.data() + static_cast<std::size_t>(i) * b.getStride();
+										return detail::pairwiseSum<Acc>(0, a.getCols(), [x, y](std::size_t j)
+																		{ return static_cast<Acc>(x[j]) * static_cast<Acc>(y[j]); }); });
+	}
+
+	/**
+	 * @brief Finds the smallest element.
+	 *
+	 * @return The smallest element; NaN if any element is NaN.
+	 * @throws std::invalid_argument If the matrix is empty.
+	 */
+	template <typename T>
+	Accumulator<T> minCoeff(MatrixView<const T> source)
+	{
+		return detail::extremum<std::less<Accumulator<T>>>(source);
+	}
+
+	/**
+	 * @brief Finds the largest element.
+	 *
+	 * @return The largest element; NaN if any element is NaN.
+	 * @throws std::invalid_argument If the matrix is empty.
+	 */
+	template <typename T>
+	Accumulator<T> maxCoeff(MatrixView<const T> source)
+	{
+		return detail::extremum<std::greater<Accumulator<T>>>(source);
+	}
+
+	/**
+	 * @brief Sums the diagonal of a square matrix.
+	 *
+	 * @throws std::invalid_argument If the matrix is not square.
+	 */
+	template <typename T>
+	Accumulator<T> trace(MatrixView<const T> source)
+	{
+		using Acc = Accumulator<T>;
+		if (source.getRows() != source.getCols())
+		{
+			throw std::invalid_argument("Matrix must be square");
+		}
+		const std::size_t step = static_cast<std::size_t>(source.getStride()) + 1;
+		return detail::pairwiseSum<Acc>(0, source.getRows(), [&](std::size_t i)
+										{ return static_cast<Acc>(source.data()[i * step]); });
+	}
+
+	/**
+	 * @brief Sums each row.
+	 *
+	 * @return One sum per row.
+	 */
+	template <typename T>
+	std::vector<Accumulator<T>> rowSums(MatrixView<const T> source)
+	{
+		using Acc = Accumulator<T>;
+		MG_PROFILE_SCOPE(profile::Op::Reduce, source.getRows(), source.getCols());
+		std::vector<Acc> sums(source.getRows());
+		parallelFor(0, source.getRows(), grainFor(source.getCols()), [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t i = lo; i < hi; i++)
+						{
+							const T *row = source.data() + i * source.getStride();
+							sums[i] = detail::pairwiseSum<Acc>(0, source.getCols(), [row](std::size_t j)
+															   { return static_cast<Acc>(row[j]); });
+						} });
+		return sums;
+	}
+
+	/**
+	 * @brief Sums each column, reading the matrix row by row.
+	 *
+	 * @return One sum per column.
+	 */
+	template <typename T>
+	std::vector<Accumulator<T>> colSums(MatrixView<const T> source)
+	{
+		using Acc = Accumulator<T>;
+		MG_PROFILE_SCOPE(profile::Op::Reduce, source.getRows(), source.getCols());
+		return detail::sumColumns<Acc>(source, [](const T &x)
+									   { return static_cast<Acc>(x); });
+	}
+
+	/**
+	 * @brief Computes the Frobenius norm, the square root of the sum of squared elements.
+	 *
+	 * The squares are summed unscaled, so elements beyond about the square root of the
+	 * largest NormType<T> overflow.
+	 */
+	template <typename T>
+	NormType<T> frobeniusNorm(MatrixView<const T> source)
+	{
+		using Real = NormType<T>;
+		MG_PROFILE_SCOPE(profile::Op::Reduce, source.getRows(), source.getCols());
+		return std::sqrt(detail::sumRows<Real>(source.getRows(), source.getCols(), [&](int i)
+											   {
+												   const T *row = source.data() + static_cast<std::size_t>(i) * source.getStride();
+												   return detail::pairwiseSum<Real>(0, source.getCols(), [row](std::size_t j)
+																					{
+																						const Real x = static_cast<Real>(row[j]);
+																						return x * x; }); }));
+	}
+
+	/**
+	 * @brief Computes the 1-norm, the largest sum of absolute values of a column.
+	 *
+	 * @return The norm; zero for an empty matrix.
+	 */
+	template <typename T>
+	NormType<T> norm1(MatrixView<const T> source)
+	{
+		using Real = NormType<T>;
+		MG_PROFILE_SCOPE(profile::Op::Reduce, source.getRows(), source.getCols());
+		const std::vector<Real> sums = detail::sumColumns<Real>(source, [](const T &x)
+																{ return detail::magnitude(static_cast<Real>(x)); });
+		return sums.empty() ? Real() : *std::max_element(sums.begin(), sums.end());
+	}
+
+	/**
+	 * @brief Computes the infinity norm, the largest sum of absolute values of a row.
+	 *
+	 * @return The norm; zero for an empty matrix.
+	 */
+	template <typename T>
+	NormType<T> normInf(MatrixView<const T> source)
+	{
+		using Real = NormType<T>;
+		MG_PROFILE_SCOPE(profile::Op::Reduce, source.getRows(), source.getCols());
+		std::vector<Real> sums(source.getRows());
+		parallelFor(0, source.getRows(), grainFor(source.getCols()), [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t i = lo; i < hi; i++)
+						{
+							const T *row = source.data() + i * source.getStride();
+							sums[i] = detail::pairwiseSum<Real>(0, source.getCols(), [row](std::size_t j)
+																{ return detail::magnitude(static_cast<Real>(row[j])); });
+						} });
+		return sums.empty() ? Real() : *std::max_element(sums.begin(), sums.end());
+	}
+
+	/**
+	 * @brief Sums all elements of a view of a mutable matrix (see sum()).
+	 */
+	template <typename T>
+	Accumulator<T> sum(MatrixView<T> source)
+	{
+		return sum<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Sums all elements of a matrix (see sum()).
+	 */
+	template <typename T>
+	Accumulator<T> sum(const Matrix<T> &source)
+	{
+		return sum<T>(source.view());
+	}
+
+	/**
+	 * @brief Computes the dot product of two views of mutable matrices (see dot()).
+	 */
+	template <typename T>
+	Accumulator<T> dot(MatrixView<T> a, MatrixView<T> b)
+	{
+		return dot<T>(MatrixView<const T>(a), MatrixView<const T>(b));
+	}
+
+	/**
+	 * @brief Computes the dot product of two matrices (see dot()).
+	 */
+	template <typename T>
+	Accumulator<T> dot(const Matrix<T> &a, const Matrix<T> &b)
+	{
+		return dot<T>(a.view(), b.view());
+	}
+
+	/**
+	 * @brief Finds the smallest element of a view of a mutable matrix (see minCoeff()).
+	 */
+	template <typename T>
+	Accumulator<T> minCoeff(MatrixView<T> source)
+	{
+		return minCoeff<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Finds the smallest element of a matrix (see minCoeff()).
+	 */
+	template <typename T>
+	Accumulator<T> minCoeff(const Matrix<T> &source)
+	{
+		return minCoeff<T>(source.view());
+	}
+
+	/**
+	 * @brief Finds the largest element of a view of a mutable matrix (see maxCoeff()).
+	 */
+	template <typename T>
+	Accumulator<T> maxCoeff(MatrixView<T> source)
+	{
+		return maxCoeff<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Finds the largest element of a matrix (see maxCoeff()).
+	 */
+	template <typename T>
+	Accumulator<T> maxCoeff(const Matrix<T> &source)
+	{
+		return maxCoeff<T>(source.view());
+	}
+
+	/**
+	 * @brief Sums the diagonal of a view of a mutable matrix (see trace()).
+	 */
+	template <typename T>
+	Accumulator<T> trace(MatrixView<T> source)
+	{
+		return trace<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Sums the diagonal of a matrix (see trace()).
+	 */
+	template <typename T>
+	Accumulator<T> trace(const Matrix<T> &source)
+	{
+		return trace<T>(source.view());
+	}
+
+	/**
+	 * @brief Sums each row of a view of a mutable matrix (see rowSums()).
+	 */
+	template <typename T>
+	std::vector<Accumulator<T>> rowSums(MatrixView<T> source)
+	{
+		return rowSums<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Sums each row of a matrix (see rowSums()).
+	 */
+	template <typename T>
+	std::vector<Accumulator<T>> rowSums(const Matrix<T> &source)
+	{
+		return rowSums<T>(source.view());
+	}
+
+	/**
+	 * @brief Sums each column of a view of a mutable matrix (see colSums()).
+	 */
+	template <typename T>
+	std::vector<Accumulator<T>> colSums(MatrixView<T> source)
+	{
+		return colSums<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Sums each column of a matrix (see colSums()).
+	 */
+	template <typename T>
+	std::vector<Accumulator<T>> colSums(const Matrix<T> &source)
+	{
+		return colSums<T>(source.view());
+	}
+
+	/**
+	 * @brief Computes the Frobenius norm of a view of a mutable matrix (see frobeniusNorm()).
+	 */
+	template <typename T>
+	NormType<T> frobeniusNorm(MatrixView<T> source)
+	{
+		return frobeniusNorm<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Computes the Frobenius norm of a matrix (see frobeniusNorm()).
+	 */
+	template <typename T>
+	NormType<T> frobeniusNorm(const Matrix<T> &source)
+	{
+		return frobeniusNorm<T>(source.view());
+	}
+
+	/**
+	 * @brief Computes the 1-norm of a view of a mutable matrix (see norm1()).
+	 */
+	template <typename T>
+	NormType<T> norm1(MatrixView<T> source)
+	{
+		return norm1<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Computes the 1-norm of a matrix (see norm1()).
+	 */
+	template <typename T>
+	NormType<T> norm1(const Matrix<T> &source)
+	{
+		return norm1<T>(source.view());
+	}
+
+	/**
+	 * @brief Computes the infinity norm of a view of a mutable matrix (see normInf()).
+	 */
+	template <typename T>
+	NormType<T> normInf(MatrixView<T> source)
+	{
+		return normInf<T>(MatrixView<const T>(source));
+	}
+
+	/**
+	 * @brief Computes the infinity norm of a matrix (see normInf()).
+	 */
+	template <typename T>
+	NormType<T> normInf(const Matrix<T> &source)
+	{
+		return normInf<T>(source.view());
+	}
+}
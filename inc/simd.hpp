@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MG_SIMD_X86 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MG_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define MG_ALWAYS_INLINE inline
+#endif
+
+/**
+ * @brief Element-wise kernels over contiguous memory with runtime instruction-set dispatch.
+ *
+ * Each kernel is compiled three times (SSE2, AVX2, AVX-512) from one generic vector loop and
+ * the widest variant supported by the running CPU is picked once, on first use, through CPUID.
+ * Types other than float, double, int32 and int64 take a plain scalar loop.
+ */
+
+namespace mg
+{
+	namespace simd
+	{
+		/**
+		 * @brief Instruction-set levels the element-wise kernels can be dispatched to.
+		 */
+		enum class Isa
+		{
+			Scalar,
+			SSE2,
+			AVX2,
+			AVX512
+		};
+
+		/**
+		 * @brief Queries the CPU for the widest supported instruction set.
+		 *
+		 * @return The detected level, Isa::Scalar on non-x86 targets.
+		 */
+		inline Isa detectIsa()
+		{
+#ifdef MG_SIMD_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+			{
+				return Isa::AVX512;
+			}
+			if (__builtin_cpu_supports("avx2"))
+			{
+				return Isa::AVX2;
+			}
+			if (__builtin_cpu_supports("sse2"))
+			{
+				return Isa::SSE2;
+			}
+#endif
+			return Isa::Scalar;
+		}
+
+		/**
+		 * @brief Returns the instruction set used by the kernels, detected once per process.
+		 *
+		 * @return The active level.
+		 */
+		inline Isa activeIsa()
+		{
+			static const Isa isa = detectIsa();
+			return isa;
+		}
+
+		/**
+		 * @brief True for the element types that have vectorized kernels.
+		 */
+		template <typename T>
+		struct IsSimdType : std::integral_constant<bool, std::is_same<T, float>::value || std::is_same<T, double>::value ||
+															 std::is_same<T, std::int32_t>::value || std::is_same<T, std::int64_t>::value>
+		{
+		};
+
+		/**
+		 * @brief Element-wise operations, usable on scalars and on vector registers alike.
+		 *
+		 * The result is written through a reference so vector values never cross a call boundary.
+		 */
+		struct AddOp
+		{
+			template <typename V>
+			static MG_ALWAYS_INLINE void apply(V &out, const V &a, const V &b) { out = a + b; }
+		};
+
+		struct SubOp
+		{
+			template <typename V>
+			static MG_ALWAYS_INLINE void apply(V &out, const V &a, const V &b) { out = a - b; }
+		};
+
+		struct MulOp
+		{
+			template <typename V>
+			static MG_ALWAYS_INLINE void apply(V &out, const V &a, const V &b) { out = a * b; }
+		};
+
+		namespace detail
+		{
+			/**
+			 * @brief Generic binary loop: out[i] = Op(a[i], b[i]), Bytes-wide vectors, two per iteration.
+			 */
+			template <typename T, std::size_t Bytes, typename Op>
+			MG_ALWAYS_INLINE void binaryLoop(const T *a, const T *b, T *out, std::size_t n)
+			{
+#ifdef MG_SIMD_X86
+				typedef T V __attribute__((vector_size(Bytes)));
+				constexpr std::size_t W = Bytes / sizeof(T);
+				std::size_t i = 0;
+				for (; i + 2 * W <= n; i += 2 * W)
+				{
+					V a0, a1, b0, b1;
+					std::memcpy(&a0, a + i, Bytes);
+					std::memcpy(&a1, a + i + W, Bytes);
+					std::memcpy(&b0, b + i, Bytes);
+					std::memcpy(&b1, b + i + W, Bytes);
+					V r0, r1;
+					Op::apply(r0, a0, b0);
+					Op::apply(r1, a1, b1);
+					std::memcpy(out + i, &r0, Bytes);
+					std::memcpy(out + i + W, &r1, Bytes);
+				}
+				for (; i + W <= n; i += W)
+				{
+					V va, vb;
+					std::memcpy(&va, a + i, Bytes);
+					std::memcpy(&vb, b + i, Bytes);
+					V r;
+					Op::apply(r, va, vb);
+					std::memcpy(out + i, &r, Bytes);
+				}
+				for (; i < n; i++)
+				{
+					Op::apply(out[i], a[i], b[i]);
+				}
+#else
+				for (std::size_t i = 0; i < n; i++)
+				{
+					Op::apply(out[i], a[i], b[i]);
+				}
+#endif
+			}
+
+			/**
+			 * @brief Generic scalar-broadcast loop: out[i] = Op(a[i], s).
+			 */
+			template <typename T, std::size_t Bytes, typename Op>
+			MG_ALWAYS_INLINE void scalarLoop(const T *a, T s, T *out, std::size_t n)
+			{
+#ifdef MG_SIMD_X86
+				typedef T V __attribute__((vector_size(Bytes)));
+				constexpr std::size_t W = Bytes / sizeof(T);
+				V vs;
+				for (std::size_t l = 0; l < W; l++)
+				{
+					vs[l] = s;
+				}
+				std::size_t i = 0;
+				for (; i + 2 * W <= n; i += 2 * W)
+				{
+					V a0, a1;
+					std::memcpy(&a0, a + i, Bytes);
+					std::memcpy(&a1, a + i + W, Bytes);
+					V r0, r1;
+					Op::apply(r0, a0, vs);
+					Op::apply(r1, a1, vs);
+					std::memcpy(out + i, &r0, Bytes);
+					std::memcpy(out + i + W, &r1, Bytes);
+				}
+				for (; i + W <= n; i += W)
+				{
+					V va;
+					std::memcpy(&va, a + i, Bytes);
+					V r;
+					Op::apply(r, va, vs);
+					std::memcpy(out + i, &r, Bytes);
+				}
+				for (; i < n; i++)
+				{
+					Op::apply(out[i], a[i], s);
+				}
+#else
+				for (std::size_t i = 0; i < n; i++)
+				{
+					Op::apply(out[i], a[i], s);
+				}
+#endif
+			}
+
+			/**
+			 * @brief Generic broadcast store: out[i] = s.
+			 */
+			template <typename T, std::size_t Bytes>
+			MG_ALWAYS_INLINE void fillLoop(T *out, T s, std::size_t n)
+			{
+#ifdef MG_SIMD_X86
+				typedef T V __attribute__((vector_size(Bytes)));
+				constexpr std::size_t W = Bytes / sizeof(T);
+				V vs;
+				for (std::size_t l = 0; l < W; l++)
+				{
+					vs[l] = s;
+				}
+				std::size_t i = 0;
+				for (; i + W <= n; i += W)
+				{
+					std::memcpy(out + i, &vs, Bytes);
+				}
+				for (; i < n; i++)
+				{
+					out[i] = s;
+				}
+#else
+				std::fill(out, out + n, s);
+#endif
+			}
+
+#ifdef MG_SIMD_X86
+			template <typename T, typename Op>
+			__attribute__((target("avx512f"))) void binaryAvx512(const T *a, const T *b, T *out, std::size_t n) { binaryLoop<T, 64, Op>(a, b, out, n); }
+
+			template <typename T, typename Op>
+			__attribute__((target("avx2"))) void binaryAvx2(const T *a, const T *b, T *out, std::size_t n) { binaryLoop<T, 32, Op>(a, b, out, n); }
+
+			template <typename T, typename Op>
+			__attribute__((target("sse2"))) void binarySse2(const T *a, const T *b, T *out, std::size_t n) { binaryLoop<T, 16, Op>(a, b, out, n); }
+
+			template <typename T, typename Op>
+			__attribute__((target("avx512f"))) void scalarAvx512(const T *a, T s, T *out, std::size_t n) { scalarLoop<T, 64, Op>(a, s, out, n); }
+
+			template <typename T, typename Op>
+			__attribute__((target("avx2"))) void scalarAvx2(const T *a, T s, T *out, std::size_t n) { scalarLoop<T, 32, Op>(a, s, out, n); }
+
+			template <typename T, typename Op>
+			__attribute__((target("sse2"))) void scalarSse2(const T *a, T s, T *out, std::size_t n) { scalarLoop<T, 16, Op>(a, s, out, n); }
+
+			template <typename T>
+			__attribute__((target("avx512f"))) void fillAvx512(T *out, T s, std::size_t n) { fillLoop<T, 64>(out, s, n); }
+
+			template <typename T>
+			__attribute__((target("avx2"))) void fillAvx2(T *out, T s, std::size_t n) { fillLoop<T, 32>(out, s, n); }
+
+			template <typename T>
+			__attribute__((target("sse2"))) void fillSse2(T *out, T s, std::size_t n) { fillLoop<T, 16>(out, s, n); }
+#endif
+		}
+
+		/**
+		 * @brief Computes out[i] = Op(a[i], b[i]) for i in [0, n). out may alias a or b.
+		 *
+		 * @tparam Op One of AddOp, SubOp, MulOp.
+		 */
+		template <typename Op, typename T>
+		void binary(const T *a, const T *b, T *out, std::size_t n)
+		{
+#ifdef MG_SIMD_X86
+			if constexpr (IsSimdType<T>::value)
+			{
+				switch (activeIsa())
+				{
+				case Isa::AVX512:
+					detail::binaryAvx512<T, Op>(a, b, out, n);
+					return;
+				case Isa::AVX2:
+					detail::binaryAvx2<T, Op>(a, b, out, n);
+					return;
+				case Isa::SSE2:
+					detail::binarySse2<T, Op>(a, b, out, n);
+					return;
+				default:
+					break;
+				}
+			}
+#endif
+			for (std::size_t i = 0; i < n; i++)
+			{
+				Op::apply(out[i], a[i], b[i]);
+			}
+		}
+
+		/**
+		 * @brief Computes out[i] = Op(a[i], s) for i in [0, n). out may alias a.
+		 *
+		 * @tparam Op One of AddOp, SubOp, MulOp.
+		 */
+		template <typename Op, typename T>
+		void withScalar(const T *a, const T &s, T *out, std::size_t n)
+		{
+#ifdef MG_SIMD_X86
+			if constexpr (IsSimdType<T>::value)
+			{
+				switch (activeIsa())
+				{
+				case Isa::AVX512:
+					detail::scalarAvx512<T, Op>(a, s, out, n);
+					return;
+				case Isa::AVX2:
+					detail::scalarAvx2<T, Op>(a, s, out, n);
+					return;
+				case Isa::SSE2:
+					detail::scalarSse2<T, Op>(a, s, out, n);
+					return;
+				default:
+					break;
+				}
+			}
+#endif
+			for (std::size_t i = 0; i < n; i++)
+			{
+				Op::apply(out[i], a[i], s);
+			}
+		}
+
+		/**
+		 * @brief Sets out[i] = s for i in [0, n).
+		 */
+		template <typename T>
+		void fill(T *out, const T &s, std::size_t n)
+		{
+#ifdef MG_SIMD_X86
+			if constexpr (IsSimdType<T>::value)
+			{
+				switch (activeIsa())
+				{
+				case Isa::AVX512:
+					detail::fillAvx512<T>(out, s, n);
+					return;
+				case Isa::AVX2:
+					detail::fillAvx2<T>(out, s, n);
+					return;
+				case Isa::SSE2:
+					detail::fillSse2<T>(out, s, n);
+					return;
+				default:
+					break;
+				}
+			}
+#endif
+			std::fill(out, out + n, s);
+		}
+
+		/**
+		 * @brief out[i] = a[i] + b[i].
+		 */
+		template <typename T>
+		void add(const T *a, const T *b, T *out, std::size_t n)
+		{
+			binary<AddOp>(a, b, out, n);
+		}
+
+		/**
+		 * @brief out[i] = a[i] - b[i].
+		 */
+		template <typename T>
+		void sub(const T *a, const T *b, T *out, std::size_t n)
+		{
+			binary<SubOp>(a, b, out, n);
+		}
+
+		/**
+		 * @brief out[i] = a[i] * s.
+		 */
+		template <typename T>
+		void scale(const T *a, const T &s, T *out, std::size_t n)
+		{
+			withScalar<MulOp>(a, s, out, n);
+		}
+	}
+}
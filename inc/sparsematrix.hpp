@@ -0,0 +1,636 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "matrix.hpp"
+#include "parallel.hpp"
+
+/**
+ * @brief Compressed sparse matrices (CSR and CSC) that interoperate with mg::Matrix.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Storage order of a SparseMatrix.
+	 */
+	enum class SparseLayout
+	{
+		CSR, ///< Compressed rows: offsets per row, column indices, values.
+		CSC  ///< Compressed columns: offsets per column, row indices, values.
+	};
+
+	/**
+	 * @brief One (row, column, value) entry of a matrix in coordinate (COO) form.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	struct Triplet
+	{
+		int row;
+		int col;
+		T value;
+	};
+
+	/**
+	 * @brief A sparse matrix storing only its non-zero elements.
+	 *
+	 * The non-zeros are grouped by outer index (rows for CSR, columns for CSC): those of outer
+	 * index k are at positions offsets()[k] to offsets()[k + 1] - 1 of indices() (their inner
+	 * index, sorted ascending) and values(). Memory is O(nnz + outer dimension) and products
+	 * cost O(nnz) per dense column instead of O(rows * cols).
+	 *
+	 * CSR is the layout for products (SpMV and SpMM run in parallel over rows); CSC suits
+	 * column access and is what transpose() of a CSR matrix gives for free.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	class SparseMatrix
+	{
+	private:
+		/**
+		 * @brief Storage order.
+		 */
+		SparseLayout m_layout;
+
+		/**
+		 * @brief Number of rows in the matrix.
+		 */
+		int m_rows;
+
+		/**
+		 * @brief Number of columns in the matrix.
+		 */
+		int m_cols;
+
+		/**
+		 * @brief Start of each outer index's entries; outer dimension + 1 elements.
+		 */
+		std::vector<std::size_t> m_offsets;
+
+		/**
+		 * @brief Inner index of each entry.
+		 */
+		std::vector<int> m_indices;
+
+		/**
+		 * @brief Value of each entry.
+		 */
+		std::vector<T> m_values;
+
+		int outerSize() const
+		{
+			return m_layout == SparseLayout::CSR ? m_rows : m_cols;
+		}
+
+		int innerSize() const
+		{
+			return m_layout == SparseLayout::CSR ? m_cols : m_rows;
+		}
+
+		/**
+		 * @brief Merges two matrices of equal dimensions and layout entry by entry, dropping exact zeros.
+		 *
+		 * @param other The right operand.
+		 * @param sign +1 for a sum, -1 for a difference.
+		 */
+		SparseMatrix combine(const SparseMatrix &other, int sign) const
+		{
+			if (m_rows != other.m_rows || m_cols != other.m_cols)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			if (other.m_layout != m_layout)
+			{
+				return combine(other.toLayout(m_layout), sign);
+			}
+
+			SparseMatrix result(m_rows, m_cols, m_layout);
+			result.m_indices.reserve(m_indices.size() + other.m_indices.size());
+			result.m_values.reserve(m_values.size() + other.m_values.size());
+			auto push = [&](int index, const T &value)
+			{
+				if (value != T())
+				{
+					result.m_indices.push_back(index);
+					result.m_values.push_back(value);
+				}
+			};
+			for (int k = 0; k < outerSize(); k++)
+			{
+				std::size_t p = m_offsets[k], q = other.m_offsets[k];
+				const std::size_t pEnd = m_offsets[k + 1], qEnd = other.m_offsets[k + 1];
+				while (p < pEnd || q < qEnd)
+				{
+					if (q == qEnd || (p < pEnd && m_indices[p] < other.m_indices[q]))
+					{
+						push(m_indices[p], m_values[p]);
+						p++;
+					}
+					else if (p == pEnd || other.m_indices[q] < m_indices[p])
+					{
+						push(other.m_indices[q], sign < 0 ? T(-other.m_values[q]) : other.m_values[q]);
+						q++;
+					}
+					else
+					{
+						push(m_indices[p], sign < 0 ? T(m_values[p] - other.m_values[q]) : T(m_values[p] + other.m_values[q]));
+						p++;
+						q++;
+					}
+				}
+				result.m_offsets[k + 1] = result.m_indices.size();
+			}
+			return result;
+		}
+
+	public:
+		/**
+		 * @brief The element type.
+		 */
+		using value_type = T;
+
+		/**
+		 * @brief Default constructor initializing an empty 0x0 matrix.
+		 */
+		SparseMatrix() : SparseMatrix(0, 0) {}
+
+		/**
+		 * @brief Constructs an all-zero matrix.
+		 *
+		 * @param rows Number of rows.
+		 * @param cols Number of columns.
+		 * @param layout Storage order.
+		 * @throws std::invalid_argument If either dimension is negative.
+		 */
+		SparseMatrix(int rows, int cols, SparseLayout layout = SparseLayout::CSR) : m_layout(layout), m_rows(rows), m_cols(cols)
+		{
+			if (rows < 0 || cols < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_offsets.assign(static_cast<std::size_t>(outerSize()) + 1, 0);
+		}
+
+		/**
+		 * @brief Constructs a matrix from coordinate (COO) triplets.
+		 *
+		 * Triplets may come in any order; duplicates are summed and entries that end up zero are dropped.
+		 *
+		 * @param rows Number of rows.
+		 * @param cols Number of columns.
+		 * @param triplets The non-zero entries.
+		 * @param layout Storage order.
+		 * @throws std::invalid_argument If either dimension is negative.
+		 * @throws std::out_of_range If a triplet lies outside the matrix.
+		 */
+		SparseMatrix(int rows, int cols, const std::vector<Triplet<T>> &triplets, SparseLayout layout = SparseLayout::CSR) : SparseMatrix(rows, cols, layout)
+		{
+			const bool csr = layout == SparseLayout::CSR;
+			for (const auto &t : triplets)
+			{
+				if (t.row < 0 || t.row >= rows || t.col < 0 || t.col >= cols)
+				{
+					throw std::out_of_range("Triplet indices out of bounds");
+				}
+				m_offsets[(csr ? t.row : t.col) + 1]++;
+			}
+			for (int k = 0; k < outerSize(); k++)
+			{
+				m_offsets[k + 1] += m_offsets[k];
+			}
+
+			// Bucket by outer index, then sort and merge each bucket by inner index
+			std::vector<std::pair<int, T>> entries(triplets.size());
+			std::vector<std::size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+			for (const auto &t : triplets)
+			{
+				entries[next[csr ? t.row : t.col]++] = std::make_pair(csr ? t.col : t.row, t.value);
+			}
+			m_indices.reserve(entries.size());
+			m_values.reserve(entries.size());
+			std::size_t begin = 0;
+			for (int k = 0; k < outerSize(); k++)
+			{
+				const std::size_t end = m_offsets[k + 1];
+				std::sort(entries.begin() + begin, entries.begin() + end, [](const std::pair<int, T> &a, const std::pair<int, T> &b)
+						  { return a.first < b.first; });
+				for (std::size_t p = begin; p < end;)
+				{
+					T sum = entries[p].second;
+					std::size_t q = p + 1;
+					while (q < end && entries[q].first == entries[p].first)
+					{
+						sum += entries[q++].second;
+					}
+					if (sum != T())
+					{
+						m_indices.push_back(entries[p].first);
+						m_values.push_back(sum);
+					}
+					p = q;
+				}
+				begin = end;
+				m_offsets[k + 1] = m_indices.size();
+			}
+		}
+
+		/**
+		 * @brief Compresses a dense matrix, view or expression, keeping its non-zero elements.
+		 *
+		 * @param expr The dense operand.
+		 * @param layout Storage order.
+		 */
+		template <typename E>
+		explicit SparseMatrix(const MatrixExpr<E> &expr, SparseLayout layout = SparseLayout::CSR) : SparseMatrix(expr.self().getRows(), expr.self().getCols(), layout)
+		{
+			Matrix<T> scratch;
+			const MatrixView<const T> dense = detail::operandView(expr.self(), scratch);
+			const bool csr = layout == SparseLayout::CSR;
+			for (int k = 0; k < outerSize(); k++)
+			{
+				for (int l = 0; l < innerSize(); l++)
+				{
+					const T &value = csr ? dense.coeff(k, l) : dense.coeff(l, k);
+					if (value != T())
+					{
+						m_indices.push_back(l);
+						m_values.push_back(value);
+					}
+				}
+				m_offsets[k + 1] = m_indices.size();
+			}
+		}
+
+		/**
+		 * @brief Gets the number of rows in the matrix.
+		 *
+		 * @return Number of rows.
+		 */
+		int getRows() const
+		{
+			return m_rows;
+		}
+
+		/**
+		 * @brief Gets the number of columns in the matrix.
+		 *
+		 * @return Number of columns.
+		 */
+		int getCols() const
+		{
+			return m_cols;
+		}
+
+		/**
+		 * @brief Gets the storage order.
+		 *
+		 * @return SparseLayout::CSR or SparseLayout::CSC.
+		 */
+		SparseLayout getLayout() const
+		{
+			return m_layout;
+		}
+
+		/**
+		 * @brief Gets the number of stored elements.
+		 *
+		 * @return Number of non-zeros.
+		 */
+		std::size_t nonZeros() const
+		{
+			return m_values.size();
+		}
+
+		/**
+		 * @brief Gets the start of each outer index's entries (rows for CSR, columns for CSC).
+		 *
+		 * @return Outer dimension + 1 offsets; the last one equals nonZeros().
+		 */
+		const std::vector<std::size_t> &offsets() const
+		{
+			return m_offsets;
+		}
+
+		/**
+		 * @brief Gets the inner index of each entry (column for CSR, row for CSC).
+		 *
+		 * @return nonZeros() indices, ascending within each outer index.
+		 */
+		const std::vector<int> &indices() const
+		{
+			return m_indices;
+		}
+
+		/**
+		 * @brief Gets the value of each entry.
+		 *
+		 * @return nonZeros() values.
+		 */
+		const std::vector<T> &values() const
+		{
+			return m_values;
+		}
+
+		/**
+		 * @brief Reads an element, zero if it is not stored; O(log nnz per row/column).
+		 *
+		 * @param i The row index.
+		 * @param j The column index.
+		 * @return The element value.
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T operator()(int i, int j) const
+		{
+			if (i >= m_rows || j >= m_cols || i < 0 || j < 0)
+			{
+				throw std::out_of_range("Matrix indices out of bounds");
+			}
+			const int outer = m_layout == SparseLayout::CSR ? i : j;
+			const int inner = m_layout == SparseLayout::CSR ? j : i;
+			const auto first = m_indices.begin() + m_offsets[outer];
+			const auto last = m_indices.begin() + m_offsets[outer + 1];
+			const auto it = std::lower_bound(first, last, inner);
+			return it != last && *it == inner ? m_values[it - m_indices.begin()] : T();
+		}
+
+		/**
+		 * @brief Converts to the other storage order (or copies, if already in the requested one).
+		 *
+		 * @param layout The storage order wanted.
+		 * @return The same matrix stored in that order.
+		 */
+		SparseMatrix toLayout(SparseLayout layout) const
+		{
+			if (layout == m_layout)
+			{
+				return *this;
+			}
+			// The same matrix in the other order is the transposed storage with the dimensions kept
+			SparseMatrix result(m_rows, m_cols, layout);
+			for (int index : m_indices)
+			{
+				result.m_offsets[index + 1]++;
+			}
+			for (int k = 0; k < innerSize(); k++)
+			{
+				result.m_offsets[k + 1] += result.m_offsets[k];
+			}
+			result.m_indices.resize(nonZeros());
+			result.m_values.resize(nonZeros());
+			std::vector<std::size_t> next(result.m_offsets.begin(), result.m_offsets.end() - 1);
+			for (int k = 0; k < outerSize(); k++)
+			{
+				for (std::size_t p = m_offsets[k]; p < m_offsets[k + 1]; p++)
+				{
+					const std::size_t q = next[m_indices[p]]++;
+					result.m_indices[q] = k;
+					result.m_values[q] = m_values[p];
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Transposes the matrix.
+		 *
+		 * The arrays are reused as they are: a CSR matrix transposes to a CSC one and vice versa.
+		 * Use toLayout() on the result to keep the original storage order.
+		 *
+		 * @return The transposed matrix.
+		 */
+		SparseMatrix transpose() const
+		{
+			SparseMatrix result(*this);
+			std::swap(result.m_rows, result.m_cols);
+			result.m_layout = m_layout == SparseLayout::CSR ? SparseLayout::CSC : SparseLayout::CSR;
+			return result;
+		}
+
+		/**
+		 * @brief Expands into a dense matrix.
+		 *
+		 * @return A dense matrix with the same elements.
+		 */
+		Matrix<T> toDense() const
+		{
+			Matrix<T> dense(m_rows, m_cols, T());
+			const std::size_t ld = dense.getStride();
+			const bool csr = m_layout == SparseLayout::CSR;
+			for (int k = 0; k < outerSize(); k++)
+			{
+				for (std::size_t p = m_offsets[k]; p < m_offsets[k + 1]; p++)
+				{
+					const std::size_t i = csr ? k : m_indices[p];
+					const std::size_t j = csr ? m_indices[p] : k;
+					dense.data()[i * ld + j] = m_values[p];
+				}
+			}
+			return dense;
+		}
+
+		/**
+		 * @brief Multiplies by a dense vector (SpMV).
+		 *
+		 * CSR rows are split across threads; CSC scatters column by column on one thread.
+		 *
+		 * @param x The vector; must have getCols() entries.
+		 * @return The product, with getRows() entries.
+		 * @throws std::invalid_argument If the sizes do not match.
+		 */
+		std::vector<T> operator*(const std::vector<T> &x) const
+		{
+			if (x.size() != static_cast<std::size_t>(m_cols))
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			std::vector<T> y(m_rows, T());
+			if (m_layout == SparseLayout::CSC)
+			{
+				for (int j = 0; j < m_cols; j++)
+				{
+					for (std::size_t p = m_offsets[j]; p < m_offsets[j + 1]; p++)
+					{
+						y[m_indices[p]] += m_values[p] * x[j];
+					}
+				}
+				return y;
+			}
+			parallelFor(0, m_rows, grainFor(nonZeros() / (m_rows + 1) + 1), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								T sum = T();
+								for (std::size_t p = m_offsets[i]; p < m_offsets[i + 1]; p++)
+								{
+									sum += m_values[p] * x[m_indices[p]];
+								}
+								y[i] = sum;
+							} });
+			return y;
+		}
+
+		/**
+		 * @brief Multiplies by a dense matrix, view or expression (SpMM), in parallel over the rows of the result.
+		 *
+		 * @param expr The dense right operand; must have getCols() rows.
+		 * @return The dense product.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		template <typename E>
+		Matrix<T> operator*(const MatrixExpr<E> &expr) const
+		{
+			if (expr.self().getRows() != m_cols)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			if (m_layout == SparseLayout::CSC)
+			{
+				return toLayout(SparseLayout::CSR) * expr;
+			}
+			Matrix<T> scratch;
+			const MatrixView<const T> b = detail::operandView(expr.self(), scratch);
+			const int n = b.getCols();
+			Matrix<T> c(m_rows, n, T());
+			parallelFor(0, m_rows, grainFor((nonZeros() / (m_rows + 1) + 1) * n), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								T *ci = c.data() + i * c.getStride();
+								for (std::size_t p = m_offsets[i]; p < m_offsets[i + 1]; p++)
+								{
+									const T a = m_values[p];
+									const T *bk = b.data() + static_cast<std::size_t>(m_indices[p]) * b.getStride();
+									for (int j = 0; j < n; j++)
+									{
+										ci[j] += a * bk[j];
+									}
+								}
+							} });
+			return c;
+		}
+
+		/**
+		 * @brief Adds two sparse matrices; the result has this matrix's layout.
+		 *
+		 * @param other The matrix to add.
+		 * @return The sum.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		SparseMatrix operator+(const SparseMatrix &other) const
+		{
+			return combine(other, 1);
+		}
+
+		/**
+		 * @brief Subtracts two sparse matrices; the result has this matrix's layout.
+		 *
+		 * @param other The matrix to subtract.
+		 * @return The difference.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		SparseMatrix operator-(const SparseMatrix &other) const
+		{
+			return combine(other, -1);
+		}
+
+		/**
+		 * @brief Multiplies the matrix by a scalar.
+		 *
+		 * @param scalar The scalar value.
+		 * @return The scaled matrix; a zero scalar gives an empty matrix.
+		 */
+		SparseMatrix operator*(const T &scalar) const
+		{
+			if (scalar == T())
+			{
+				return SparseMatrix(m_rows, m_cols, m_layout);
+			}
+			SparseMatrix result(*this);
+			for (T &value : result.m_values)
+			{
+				value *= scalar;
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Compares two matrices element by element, regardless of layout.
+		 *
+		 * @param other The matrix to compare with.
+		 * @return True if the matrices are equal, false otherwise.
+		 */
+		bool operator==(const SparseMatrix &other) const
+		{
+			if (m_rows != other.m_rows || m_cols != other.m_cols)
+			{
+				return false;
+			}
+			if (other.m_layout != m_layout)
+			{
+				return *this == other.toLayout(m_layout);
+			}
+			return m_offsets == other.m_offsets && m_indices == other.m_indices && m_values == other.m_values;
+		}
+
+		/**
+		 * @brief Compares two matrices for inequality.
+		 *
+		 * @param other The matrix to compare with.
+		 * @return True if the matrices are not equal, false otherwise.
+		 */
+		bool operator!=(const SparseMatrix &other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	/**
+	 * @brief Multiplies a dense matrix, view or expression by a sparse matrix, in parallel over the rows of the result.
+	 *
+	 * @param expr The dense left operand; must have b.getRows() columns.
+	 * @param b The sparse right operand.
+	 * @return The dense product.
+	 * @throws std::invalid_argument If the dimensions do not match.
+	 */
+	template <typename E>
+	Matrix<typename E::value_type> operator*(const MatrixExpr<E> &expr, const SparseMatrix<typename E::value_type> &b)
+	{
+		using T = typename E::value_type;
+		if (expr.self().getCols() != b.getRows())
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		if (b.getLayout() == SparseLayout::CSC)
+		{
+			return expr * b.toLayout(SparseLayout::CSR);
+		}
+		Matrix<T> scratch;
+		const MatrixView<const T> a = detail::operandView(expr.self(), scratch);
+		const auto &offsets = b.offsets();
+		const auto &indices = b.indices();
+		const auto &values = b.values();
+		Matrix<T> c(a.getRows(), b.getCols(), T());
+		parallelFor(0, a.getRows(), grainFor(b.nonZeros() + 1), [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t i = lo; i < hi; i++)
+						{
+							const T *ai = a.data() + i * a.getStride();
+							T *ci = c.data() + i * c.getStride();
+							for (int k = 0; k < b.getRows(); k++)
+							{
+								const T aik = ai[k];
+								for (std::size_t p = offsets[k]; p < offsets[k + 1]; p++)
+								{
+									ci[indices[p]] += aik * values[p];
+								}
+							}
+						} });
+		return c;
+	}
+}
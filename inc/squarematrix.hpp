@@ -1,7 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include "lu.hpp"
 #include "matrix.hpp"
+#include "profile.hpp"
+#include "structuredmatrix.hpp"
 
 /**
  * @class SquareMatrix
@@ -15,31 +20,106 @@ namespace mg
     class SquareMatrix : public Matrix<T>
     {
     private:
+        /**
+         * @brief Throws: a square matrix cannot change shape.
+         *
+         * The row and column edits of Matrix are private here, so calls through a SquareMatrix
+         * do not compile; calls through a Matrix reference or pointer end up here.
+         *
+         * @throws std::logic_error Always.
+         */
+        [[noreturn]] static void shapeFixed()
+        {
+            throw std::logic_error("Cannot change the shape of a square matrix");
+        }
+
+        /**
+         * @brief The product of the diagonal of an integer matrix, checked like determinantBareiss().
+         * @throws std::overflow_error If a partial product does not fit in the element type.
+         */
+        T integerDiagonalProduct() const
+        {
+            using Wide = detail::BareissWide<T>;
+            const int n = this->getRows();
+            for (int i = 0; i < n; i++)
+            {
+                if (this->coeff(i, i) == T(0))
+                {
+                    return T(0); // Before any partial product can overflow
+                }
+            }
+            Wide det = 1;
+            for (int i = 0; i < n; i++)
+            {
+                if (!detail::fitsIn<Wide>(this->coeff(i, i)))
+                {
+                    throw std::overflow_error("Determinant overflows the element type");
+                }
+                det = detail::bareissUpdate<Wide>(det, static_cast<Wide>(this->coeff(i, i)), 0, 0, 1);
+                if (!detail::fitsIn<T>(det))
+                {
+                    throw std::overflow_error("Determinant overflows the element type");
+                }
+            }
+            return static_cast<T>(det);
+        }
+
         /**
          * @brief Overridden method to prevent adding a row in a square matrix.
          * @param i The index at which the row will be added.
          * @param row The row to add.
+         * @throws std::logic_error Always.
          */
-        void addRow(int i, const std::vector<T> &row) override {}
+        void addRow(int /*i*/, const std::vector<T> & /*row*/) override { shapeFixed(); }
 
         /**
          * @brief Overridden method to prevent removing a row in a square matrix.
          * @param i The index of the row to remove.
+         * @throws std::logic_error Always.
          */
-        void removeRow(int i) override {}
+        void removeRow(int /*i*/) override { shapeFixed(); }
 
         /**
          * @brief Overridden method to prevent adding a column in a square matrix.
          * @param j The index at which the column will be added.
          * @param col The column to add.
+         * @throws std::logic_error Always.
          */
-        void addCol(int j, const std::vector<T> &col) override {}
+        void addCol(int /*j*/, const std::vector<T> & /*col*/) override { shapeFixed(); }
 
         /**
          * @brief Overridden method to prevent removing a column in a square matrix.
-         * @param index The index of the column to remove.
+         * @param j The index of the column to remove.
+         * @throws std::logic_error Always.
+         */
+        void removeCol(int /*j*/) override { shapeFixed(); }
+
+        /**
+         * @brief Overridden method to prevent inserting rows in a square matrix.
+         * @throws std::logic_error Always.
          */
-        void removeCol(int j) override {}
+        void insertRows(int /*i*/, MatrixView<const T> /*block*/) override { shapeFixed(); }
+
+        /**
+         * @brief Overridden method to prevent removing rows from a square matrix.
+         * @throws std::logic_error Always.
+         */
+        void eraseRows(const std::vector<int> & /*indices*/) override { shapeFixed(); }
+
+        /**
+         * @brief Overridden method to prevent inserting columns in a square matrix.
+         * @throws std::logic_error Always.
+         */
+        void insertCols(const std::vector<int> & /*positions*/, MatrixView<const T> /*block*/) override { shapeFixed(); }
+
+        /**
+         * @brief Overridden method to prevent removing columns from a square matrix.
+         * @throws std::logic_error Always.
+         */
+        void eraseCols(const std::vector<int> & /*indices*/) override { shapeFixed(); }
+
+        using Matrix<T>::appendRows;
+        using Matrix<T>::appendCols;
 
     public:
         /**
@@ -62,57 +142,182 @@ namespace mg
             }
         }
 
+        /**
+         * @brief Constructs a square matrix by evaluating a matrix expression.
+         * @param expr The expression to evaluate.
+         * @throws std::runtime_error If the result is not square.
+         */
+        template <typename E>
+        SquareMatrix(const MatrixExpr<E> &expr) : Matrix<T>(expr)
+        {
+            if (this->getRows() != this->getCols())
+            {
+                throw std::runtime_error("Matrix must be square");
+            }
+        }
+
+        /**
+         * @brief Copy constructor performing a deep copy of the elements.
+         * @param other The square matrix to copy.
+         */
+        SquareMatrix(const SquareMatrix &other) = default;
+
+        /**
+         * @brief Move constructor taking over the storage of another square matrix.
+         * @param other The square matrix to move from; left empty.
+         */
+        SquareMatrix(SquareMatrix &&other) noexcept = default;
+
+        /**
+         * @brief Copies another square matrix into this one.
+         * @param other The square matrix to copy.
+         * @return Reference to the modified matrix.
+         */
+        SquareMatrix &operator=(const SquareMatrix &other) = default;
+
+        /**
+         * @brief Takes over the storage of another square matrix without copying it.
+         * @param other The square matrix to move from; left empty.
+         * @return Reference to the modified matrix.
+         */
+        SquareMatrix &operator=(SquareMatrix &&other) = default;
+
+        /**
+         * @brief Evaluates a matrix expression into this square matrix.
+         * @param expr The expression to evaluate.
+         * @return Reference to the modified matrix.
+         * @throws std::runtime_error If the expression is not square.
+         */
+        template <typename E>
+        SquareMatrix &operator=(const MatrixExpr<E> &expr)
+        {
+            if (expr.self().getRows() != expr.self().getCols())
+            {
+                throw std::runtime_error("Matrix must be square");
+            }
+            Matrix<T>::operator=(expr);
+            return *this;
+        }
+
         /**
          * @brief Creates an identity matrix of size n x n.
+         *
+         * The result stores only its diagonal; assigning it to a SquareMatrix or Matrix
+         * expands it to dense form.
+         *
          * @param n The size of the identity matrix.
-         * @return A SquareMatrix representing the identity matrix.
+         * @return A DiagonalMatrix representing the identity matrix.
          */
-        static SquareMatrix<T> identity(size_t n)
+        static DiagonalMatrix<T> identity(size_t n)
         {
-            SquareMatrix<T> result(n, 0);
+            return DiagonalMatrix<T>::identity(static_cast<int>(n));
+        }
 
-            for (int i = 0; i < n; i++)
+        /**
+         * @brief Multiplies by another square matrix with a chosen algorithm.
+         *
+         * operator* uses the process default (see setDefaultMultiplyAlgorithm()), which picks
+         * Strassen-Winograd only for large float and double products. Strassen-Winograd is
+         * about 30% faster from n = 2048 but is only normwise accurate; see strassen.hpp.
+         *
+         * @param other The right-hand factor.
+         * @param algorithm The algorithm computing the product.
+         * @return The product.
+         * @throws std::invalid_argument If the sizes differ.
+         */
+        SquareMatrix<T> multiply(const SquareMatrix<T> &other, MultiplyAlgorithm algorithm) const
+        {
+            const int n = this->getRows();
+            if (other.getRows() != n)
             {
-                result(i, i) = 1;
+                throw std::invalid_argument("Matrix dimensions must match");
             }
+            MG_PROFILE_SCOPE(profile::Op::Multiply, n, n, n);
+            SquareMatrix<T> result(n);
+            multiplyWith(n, n, n, this->data(), this->getStride(), other.data(), other.getStride(), result.data(), result.getStride(), false, algorithm);
             return result;
         }
 
         /**
-         * @brief Computes the determinant of the square matrix.
-         * @return The determinant of the matrix.
+         * @brief Checks whether all elements below or all elements above the diagonal are zero.
+         * @return True for a lower or upper triangular (including diagonal) matrix.
          */
-        T determinant() const
+        bool isTriangular() const
         {
-            int n = this->getRows();
-            if (n == 1)
-            {
-                return (*this)(0, 0);
-            }
-            if (n == 2)
+            const int n = this->getRows();
+            bool upper = true;
+            bool lower = true;
+            for (int i = 0; i < n && (upper || lower); i++)
             {
-                return (*this)(0, 0) * (*this)(1, 1) - (*this)(0, 1) * (*this)(1, 0);
+                const T *row = this->rowPtr(i);
+                for (int j = 0; j < i && upper; j++)
+                {
+                    upper = row[j] == T();
+                }
+                for (int j = i + 1; j < n && lower; j++)
+                {
+                    lower = row[j] == T();
+                }
             }
+            return upper || lower;
+        }
+
+        /**
+         * @brief Factors the matrix for repeated solves, determinants or inversion.
+         * @return The LU factorization with partial pivoting.
+         */
+        LU<T> lu() const
+        {
+            return LU<T>(*this);
+        }
+
+        /**
+         * @brief Computes the inverse of the square matrix.
+         * @return The inverse matrix.
+         * @throws std::runtime_error If the matrix is singular.
+         */
+        SquareMatrix<T> inverse() const
+        {
+            return SquareMatrix<T>(lu().inverse());
+        }
 
-            T det = 0;
-            for (int p = 0; p < n; p++)
+        /**
+         * @brief Computes the determinant of the square matrix.
+         *
+         * Triangular matrices take the product of the diagonal after an O(n^2) scan. Otherwise
+         * integer matrices use exact fraction-free (Bareiss) elimination, other types an LU
+         * factorization; both are O(n^3).
+         *
+         * @return The determinant of the matrix.
+         * @throws std::overflow_error For an integer matrix whose elimination overflows (see determinantBareiss()).
+         */
+        T determinant() const
+        {
+            MG_PROFILE_SCOPE(profile::Op::Determinant, this->getRows(), this->getCols());
+            if (isTriangular())
             {
-                SquareMatrix<T> subMatrix(n - 1);
-                for (int i = 1; i < n; i++)
+                if constexpr (std::is_integral<T>::value)
                 {
-                    int subCol = 0;
-                    for (int j = 0; j < n; j++)
+                    return integerDiagonalProduct();
+                }
+                else
+                {
+                    T det = T(1);
+                    for (int i = 0; i < this->getRows(); i++)
                     {
-                        if (j == p)
-                            continue;
-                        subMatrix(i - 1, subCol) = (*this)(i, j);
-                        subCol++;
+                        det *= this->coeff(i, i);
                     }
+                    return det;
                 }
-                T sign = (p % 2 == 0) ? 1 : -1;
-                det += sign * (*this)(0, p) * subMatrix.determinant();
             }
-            return det;
+            if constexpr (std::is_integral<T>::value)
+            {
+                return determinantBareiss(*this);
+            }
+            else
+            {
+                return LU<T>(*this).determinant();
+            }
         }
     };
 }
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "alignedallocator.hpp"
+#include "gemm.hpp"
+#include "lowprecision.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+/**
+ * @brief Strassen-Winograd matrix multiplication for large products.
+ *
+ * Each level of recursion splits A, B and C into quadrants and forms the product from 7
+ * half-size products and 15 quadrant additions instead of 8 products, scheduled after Boyer,
+ * Dumas, Pernet and Zhou so that a level needs only two quadrant-sized temporaries besides C.
+ * Recursion stops at the crossover size, below which the blocked gemm() kernel is faster.
+ * Odd dimensions are handled by peeling: the even-sized core goes through the recursion and
+ * the last row, column or inner index is fixed up with gemm().
+ *
+ * Accuracy: the error is bounded normwise, not elementwise as for the classic product. For
+ * the Winograd variant the bound grows like (n / crossover)^log2(18) u ||A|| ||B|| (Higham,
+ * Accuracy and Stability of Numerical Algorithms, section 23.2), so small elements of C can
+ * lose relative accuracy when A or B have entries of very different magnitudes. Each level
+ * typically costs a few bits; it is therefore only chosen automatically for float and double
+ * products above STRASSEN_THRESHOLD, and never for integer types.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Which algorithm computes a matrix product.
+	 */
+	enum class MultiplyAlgorithm
+	{
+		Auto,     // Strassen for large float/double products, classic otherwise
+		Classic,  // Always the O(n^3) blocked kernel
+		Strassen, // Always Strassen-Winograd, down to the crossover
+	};
+
+	/**
+	 * @brief Operand size below which the recursion switches to the blocked kernel.
+	 */
+	constexpr int STRASSEN_CROSSOVER = 512;
+
+	/**
+	 * @brief Smallest dimension from which MultiplyAlgorithm::Auto picks Strassen-Winograd.
+	 */
+	constexpr int STRASSEN_THRESHOLD = 2048;
+
+	namespace detail
+	{
+		inline std::atomic<MultiplyAlgorithm> &defaultMultiplyAlgorithm()
+		{
+			static std::atomic<MultiplyAlgorithm> algorithm(MultiplyAlgorithm::Auto);
+			return algorithm;
+		}
+
+		/**
+		 * @brief Computes c = Op(a, b) on rows x cols strided blocks; c may alias a or b.
+		 */
+		template <typename Op, typename T>
+		void strassenCombine(int rows, int cols, const T *a, int lda, const T *b, int ldb, T *c, int ldc)
+		{
+			parallelFor(0, rows, grainFor(cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								simd::binary<Op>(a + i * lda, b + i * ldb, c + i * ldc, cols);
+							} });
+		}
+
+		/**
+		 * @brief Scratch elements strassenRecurse() needs for an m x k times k x n product.
+		 */
+		inline std::size_t strassenScratch(int m, int n, int k, int crossover)
+		{
+			std::size_t total = 0;
+			while (std::min({m, n, k}) > crossover)
+			{
+				m /= 2;
+				n /= 2;
+				k /= 2;
+				total += static_cast<std::size_t>(m) * std::max(k, n) + static_cast<std::size_t>(k) * n;
+			}
+			return total;
+		}
+
+		/**
+		 * @brief Computes C = A * B by Strassen-Winograd recursion, using scratch for temporaries.
+		 *
+		 * The steps follow Boyer et al., "Memory efficient scheduling of Strassen-Winograd's
+		 * matrix multiplication algorithm" (2009), table 1: X holds the A-side sums and P1, Y the
+		 * B-side sums, and the C quadrants hold the other products until they are combined.
+		 */
+		template <typename T>
+		void strassenRecurse(int m, int n, int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, T *scratch, int crossover)
+		{
+			if (std::min({m, n, k}) <= crossover)
+			{
+				gemm(m, n, k, a, lda, b, ldb, c, ldc, false);
+				return;
+			}
+			const int hm = m / 2;
+			const int hn = n / 2;
+			const int hk = k / 2;
+			const T *a11 = a;
+			const T *a12 = a + hk;
+			const T *a21 = a + static_cast<std::size_t>(hm) * lda;
+			const T *a22 = a21 + hk;
+			const T *b11 = b;
+			const T *b12 = b + hn;
+			const T *b21 = b + static_cast<std::size_t>(hk) * ldb;
+			const T *b22 = b21 + hn;
+			T *c11 = c;
+			T *c12 = c + hn;
+			T *c21 = c + static_cast<std::size_t>(hm) * ldc;
+			T *c22 = c21 + hn;
+			T *x = scratch; // hm x hk sums of A, then hm x hn for P1
+			T *y = x + static_cast<std::size_t>(hm) * std::max(hk, hn); // hk x hn sums of B
+			T *rest = y + static_cast<std::size_t>(hk) * hn;
+
+			strassenCombine<simd::SubOp>(hm, hk, a11, lda, a21, lda, x, hk); // S3 = A11 - A21
+			strassenCombine<simd::SubOp>(hk, hn, b22, ldb, b12, ldb, y, hn); // T3 = B22 - B12
+			strassenRecurse(hm, hn, hk, x, hk, y, hn, c21, ldc, rest, crossover); // P7 = S3 T3
+			strassenCombine<simd::AddOp>(hm, hk, a21, lda, a22, lda, x, hk); // S1 = A21 + A22
+			strassenCombine<simd::SubOp>(hk, hn, b12, ldb, b11, ldb, y, hn); // T1 = B12 - B11
+			strassenRecurse(hm, hn, hk, x, hk, y, hn, c22, ldc, rest, crossover); // P5 = S1 T1
+			strassenCombine<simd::SubOp>(hm, hk, x, hk, a11, lda, x, hk); // S2 = S1 - A11
+			strassenCombine<simd::SubOp>(hk, hn, b22, ldb, y, hn, y, hn); // T2 = B22 - T1
+			strassenRecurse(hm, hn, hk, x, hk, y, hn, c12, ldc, rest, crossover); // P6 = S2 T2
+			strassenCombine<simd::SubOp>(hm, hk, a12, lda, x, hk, x, hk); // S4 = A12 - S2
+			strassenRecurse(hm, hn, hk, x, hk, b22, ldb, c11, ldc, rest, crossover); // P3 = S4 B22
+			strassenRecurse(hm, hn, hk, a11, lda, b11, ldb, x, hn, rest, crossover); // P1 = A11 B11
+			strassenCombine<simd::AddOp>(hm, hn, x, hn, c12, ldc, c12, ldc); // U2 = P1 + P6
+			strassenCombine<simd::AddOp>(hm, hn, c12, ldc, c21, ldc, c21, ldc); // U3 = U2 + P7
+			strassenCombine<simd::AddOp>(hm, hn, c12, ldc, c22, ldc, c12, ldc); // U4 = U2 + P5
+			strassenCombine<simd::AddOp>(hm, hn, c21, ldc, c22, ldc, c22, ldc); // U7 = U3 + P5
+			strassenCombine<simd::AddOp>(hm, hn, c12, ldc, c11, ldc, c12, ldc); // U5 = U4 + P3
+			strassenCombine<simd::SubOp>(hk, hn, y, hn, b21, ldb, y, hn); // T4 = T2 - B21
+			strassenRecurse(hm, hn, hk, a22, lda, y, hn, c11, ldc, rest, crossover); // P4 = A22 T4
+			strassenCombine<simd::SubOp>(hm, hn, c21, ldc, c11, ldc, c21, ldc); // U6 = U3 - P4
+			strassenRecurse(hm, hn, hk, a12, lda, b21, ldb, c11, ldc, rest, crossover); // P2 = A12 B21
+			strassenCombine<simd::AddOp>(hm, hn, x, hn, c11, ldc, c11, ldc); // U1 = P1 + P2
+
+			// Peel odd dimensions: the last inner index, then the last column and row of C
+			const int m0 = 2 * hm;
+			const int n0 = 2 * hn;
+			const int k0 = 2 * hk;
+			if (k0 < k)
+			{
+				gemm(m0, n0, 1, a + k0, lda, b + static_cast<std::size_t>(k0) * ldb, ldb, c, ldc, true);
+			}
+			if (n0 < n)
+			{
+				gemm(m, 1, k, a, lda, b + n0, ldb, c + n0, ldc, false);
+			}
+			if (m0 < m)
+			{
+				gemm(1, n0, k, a + static_cast<std::size_t>(m0) * lda, lda, b, ldb, c + static_cast<std::size_t>(m0) * ldc, ldc, false);
+			}
+		}
+	}
+
+	/**
+	 * @brief Sets the algorithm used by products that do not choose one, for all threads.
+	 *
+	 * @param algorithm The new default; MultiplyAlgorithm::Auto initially.
+	 */
+	inline void setDefaultMultiplyAlgorithm(MultiplyAlgorithm algorithm)
+	{
+		detail::defaultMultiplyAlgorithm().store(algorithm, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Gets the algorithm used by products that do not choose one.
+	 *
+	 * @return The current default.
+	 */
+	inline MultiplyAlgorithm defaultMultiplyAlgorithm()
+	{
+		return detail::defaultMultiplyAlgorithm().load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Computes C = A * B, or C += A * B, by Strassen-Winograd recursion on row-major strided buffers.
+	 *
+	 * Takes the same arguments as gemm(). Scratch memory is allocated once per call and is
+	 * bounded by (m k + k n) / 3 elements, plus m n when accumulating.
+	 *
+	 * @tparam T The element type.
+	 * @param m Number of rows of A and C.
+	 * @param n Number of columns of B and C.
+	 * @param k Number of columns of A and rows of B.
+	 * @param a Pointer to A; row i starts at a + i * lda.
+	 * @param lda Leading dimension of A.
+	 * @param b Pointer to B; row i starts at b + i * ldb.
+	 * @param ldb Leading dimension of B.
+	 * @param c Pointer to C; row i starts at c + i * ldc. Must not alias A or B.
+	 * @param ldc Leading dimension of C.
+	 * @param accumulate Adds the product to the existing contents of C instead of overwriting them.
+	 * @param crossover Operand size below which gemm() takes over; at least 1.
+	 */
+	template <typename T>
+	void strassenGemm(int m, int n, int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, bool accumulate = false, int crossover = STRASSEN_CROSSOVER)
+	{
+		crossover = std::max(crossover, 1);
+		if (m <= 0 || n <= 0)
+		{
+			return;
+		}
+		if (std::min({m, n, k}) <= crossover)
+		{
+			gemm(m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+			return;
+		}
+		std::vector<T, AlignedAllocator<T>> scratch(detail::strassenScratch(m, n, k, crossover) + (accumulate ? static_cast<std::size_t>(m) * n : 0));
+		if (!accumulate)
+		{
+			detail::strassenRecurse(m, n, k, a, lda, b, ldb, c, ldc, scratch.data(), crossover);
+			return;
+		}
+		T *product = scratch.data() + detail::strassenScratch(m, n, k, crossover);
+		detail::strassenRecurse(m, n, k, a, lda, b, ldb, product, n, scratch.data(), crossover);
+		detail::strassenCombine<simd::AddOp>(m, n, c, ldc, product, n, c, ldc);
+	}
+
+	/**
+	 * @brief Computes C = A * B, or C += A * B, with the given algorithm.
+	 *
+	 * MultiplyAlgorithm::Auto picks Strassen-Winograd for float and double when every
+	 * dimension is at least STRASSEN_THRESHOLD, and gemm() otherwise. Low-precision types
+	 * (see lowprecision.hpp) always accumulate in Accumulator<T> with the blocked kernel.
+	 *
+	 * @param algorithm The algorithm; the process default if omitted.
+	 */
+	template <typename T>
+	void multiplyWith(int m, int n, int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, bool accumulate = false,
+					  MultiplyAlgorithm algorithm = defaultMultiplyAlgorithm())
+	{
+		if constexpr (!std::is_same<Accumulator<T>, T>::value)
+		{
+			detail::widenedGemm<Accumulator<T>>(m, n, k, a, lda, b, ldb, c, ldc, accumulate); // Never sum in a low-precision type
+		}
+		else if (algorithm == MultiplyAlgorithm::Strassen ||
+				 (algorithm == MultiplyAlgorithm::Auto && std::is_floating_point<T>::value && std::min({m, n, k}) >= STRASSEN_THRESHOLD))
+		{
+			strassenGemm(m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+		}
+		else
+		{
+			gemm(m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+		}
+	}
+}
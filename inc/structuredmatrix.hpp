@@ -0,0 +1,1117 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
+#include "strassen.hpp"
+
+/**
+ * @brief Structured square matrices: diagonal, triangular, symmetric and banded.
+ *
+ * Each type stores only the elements its structure allows, and has kernels that do work in
+ * proportion to them: O(n) determinants of diagonal and triangular matrices, triangular solves
+ * (TRSM) and products, symmetric rank-k updates (SYRK) at GEMM speed, and banded products and
+ * solves in O(n * bandwidth). All four are matrix expressions, so they mix with dense matrices
+ * in +, - and assignments, and a dense copy is just Matrix<T> m = structured.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Which triangle of a TriangularMatrix is stored; the other one is zero.
+	 */
+	enum class Triangle
+	{
+		Lower, ///< Elements with j <= i.
+		Upper  ///< Elements with j >= i.
+	};
+
+	template <typename T>
+	class DiagonalMatrix;
+
+	template <typename T>
+	class TriangularMatrix;
+
+	template <typename T>
+	class SymmetricMatrix;
+
+	template <typename T>
+	class BandedMatrix;
+
+	/**
+	 * @brief Expression nodes refer to structured operands instead of copying their storage.
+	 */
+	template <typename T>
+	struct ExprOperand<DiagonalMatrix<T>>
+	{
+		using type = const DiagonalMatrix<T> &;
+	};
+
+	template <typename T>
+	struct ExprOperand<TriangularMatrix<T>>
+	{
+		using type = const TriangularMatrix<T> &;
+	};
+
+	template <typename T>
+	struct ExprOperand<SymmetricMatrix<T>>
+	{
+		using type = const SymmetricMatrix<T> &;
+	};
+
+	template <typename T>
+	struct ExprOperand<BandedMatrix<T>>
+	{
+		using type = const BandedMatrix<T> &;
+	};
+
+	namespace detail
+	{
+		inline void checkSquareIndex(int i, int j, int n)
+		{
+			checkIndex(i, j, n, n);
+		}
+
+		/**
+		 * @brief Throws unless a right-hand side has n rows.
+		 */
+		inline void checkRightHandSide(int rows, int n)
+		{
+			if (rows != n)
+			{
+				throw std::invalid_argument("Right-hand side must have as many rows as the matrix");
+			}
+		}
+
+	}
+
+	/**
+	 * @brief A diagonal matrix, stored as its n diagonal elements.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	class DiagonalMatrix : public MatrixExpr<DiagonalMatrix<T>>
+	{
+	private:
+		/**
+		 * @brief The diagonal elements.
+		 */
+		std::vector<T> m_diagonal;
+
+	public:
+		using value_type = T;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = true;
+
+		/**
+		 * @brief Constructs an n x n diagonal matrix with the same value on the whole diagonal.
+		 *
+		 * @param n The order of the matrix.
+		 * @param value The diagonal value.
+		 * @throws std::invalid_argument If n is negative.
+		 */
+		explicit DiagonalMatrix(int n = 0, T value = T())
+		{
+			if (n < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_diagonal.assign(n, value);
+		}
+
+		/**
+		 * @brief Constructs a diagonal matrix from its diagonal elements.
+		 *
+		 * @param diagonal The diagonal, top-left first.
+		 */
+		explicit DiagonalMatrix(std::vector<T> diagonal) : m_diagonal(std::move(diagonal)) {}
+
+		/**
+		 * @brief Creates an identity matrix in O(n) memory.
+		 *
+		 * @param n The order of the matrix.
+		 * @return The n x n identity.
+		 */
+		static DiagonalMatrix identity(int n)
+		{
+			return DiagonalMatrix(n, T(1));
+		}
+
+		int getRows() const { return static_cast<int>(m_diagonal.size()); }
+		int getCols() const { return static_cast<int>(m_diagonal.size()); }
+		int size() const { return static_cast<int>(m_diagonal.size()); }
+
+		/**
+		 * @brief Gets the diagonal elements.
+		 */
+		const std::vector<T> &diagonal() const { return m_diagonal; }
+		std::vector<T> &diagonal() { return m_diagonal; }
+
+		value_type coeff(int i, int j) const
+		{
+			return i == j ? m_diagonal[i] : T();
+		}
+
+		bool references(const void *, const void *) const { return false; }
+		void prepare() const {}
+
+		/**
+		 * @brief Reads an element; zero off the diagonal.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T operator()(int i, int j) const
+		{
+			detail::checkSquareIndex(i, j, size());
+			return coeff(i, j);
+		}
+
+		/**
+		 * @brief Computes the determinant, the product of the diagonal, in O(n).
+		 *
+		 * @return The determinant.
+		 */
+		T determinant() const
+		{
+			T det = T(1);
+			for (const T &d : m_diagonal)
+			{
+				det *= d;
+			}
+			return det;
+		}
+
+		/**
+		 * @brief Computes the inverse, the reciprocal of each diagonal element.
+		 *
+		 * @return The inverse.
+		 * @throws std::runtime_error If a diagonal element is zero.
+		 */
+		DiagonalMatrix inverse() const
+		{
+			static_assert(!std::is_integral<T>::value, "Inversion needs a field type; convert integer matrices to floating point");
+			DiagonalMatrix result(size());
+			for (int i = 0; i < size(); i++)
+			{
+				if (m_diagonal[i] == T())
+				{
+					throw std::runtime_error("Matrix is singular");
+				}
+				result.m_diagonal[i] = T(1) / m_diagonal[i];
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Solves D * X = B by scaling the rows of B.
+		 *
+		 * @param b Right-hand sides, one per column.
+		 * @return The solution X.
+		 * @throws std::invalid_argument If b does not have size() rows.
+		 * @throws std::runtime_error If a diagonal element is zero.
+		 */
+		Matrix<T> solve(const Matrix<T> &b) const
+		{
+			detail::checkRightHandSide(b.getRows(), size());
+			return inverse() * b;
+		}
+
+		/**
+		 * @brief Scales row i of a dense matrix by element i of the diagonal, in O(n * cols).
+		 *
+		 * @param b The right operand; must have size() rows.
+		 * @return The product.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		Matrix<T> operator*(const Matrix<T> &b) const
+		{
+			if (b.getRows() != size())
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Multiply, size(), b.getCols(), size());
+			Matrix<T> c(b.getRows(), b.getCols());
+			parallelFor(0, size(), grainFor(b.getCols()), [&](std::size_t lo, std::size_t hi)
+						{
+							for (std::size_t i = lo; i < hi; i++)
+							{
+								simd::withScalar<simd::MulOp>(b.rowPtr(static_cast<int>(i)), m_diagonal[i], c.rowPtr(static_cast<int>(i)), b.getCols());
+							} });
+			return c;
+		}
+
+		/**
+		 * @brief Multiplies two diagonal matrices in O(n).
+		 *
+		 * @throws std::invalid_argument If the sizes differ.
+		 */
+		DiagonalMatrix operator*(const DiagonalMatrix &other) const
+		{
+			if (other.size() != size())
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			DiagonalMatrix result(size());
+			simd::binary<simd::MulOp>(m_diagonal.data(), other.m_diagonal.data(), result.m_diagonal.data(), m_diagonal.size());
+			return result;
+		}
+	};
+
+	/**
+	 * @brief Scales column j of a dense matrix by element j of a diagonal matrix, in O(rows * n).
+	 *
+	 * @param a The dense left operand; must have d.size() columns.
+	 * @param d The diagonal right operand.
+	 * @return The product.
+	 * @throws std::invalid_argument If the dimensions do not match.
+	 */
+	template <typename T>
+	Matrix<T> operator*(const Matrix<T> &a, const DiagonalMatrix<T> &d)
+	{
+		if (a.getCols() != d.size())
+		{
+			throw std::invalid_argument("Matrix dimensions must match");
+		}
+		MG_PROFILE_SCOPE(profile::Op::Multiply, a.getRows(), d.size(), d.size());
+		Matrix<T> c(a.getRows(), a.getCols());
+		parallelFor(0, a.getRows(), grainFor(a.getCols()), [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t i = lo; i < hi; i++)
+						{
+							simd::binary<simd::MulOp>(a.rowPtr(static_cast<int>(i)), d.diagonal().data(), c.rowPtr(static_cast<int>(i)), a.getCols());
+						} });
+		return c;
+	}
+
+	/**
+	 * @brief A lower or upper triangular matrix in packed row-major storage.
+	 *
+	 * Row i of a lower triangular matrix holds elements 0..i, of an upper one elements i..n-1,
+	 * and the rows follow each other: n * (n + 1) / 2 elements in all.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	class TriangularMatrix : public MatrixExpr<TriangularMatrix<T>>
+	{
+	private:
+		int m_size;
+		Triangle m_triangle;
+
+		/**
+		 * @brief The stored triangle, row after row.
+		 */
+		std::vector<T> m_data;
+
+		bool stored(int i, int j) const
+		{
+			return m_triangle == Triangle::Lower ? j <= i : j >= i;
+		}
+
+		/**
+		 * @brief Offset of the first stored element of row i.
+		 */
+		std::size_t rowOffset(int i) const
+		{
+			const std::size_t r = static_cast<std::size_t>(i);
+			return m_triangle == Triangle::Lower ? r * (r + 1) / 2 : r * (2 * static_cast<std::size_t>(m_size) - r + 1) / 2;
+		}
+
+		/**
+		 * @brief Offset of element (i, j), which must be stored.
+		 */
+		std::size_t offset(int i, int j) const
+		{
+			return rowOffset(i) + static_cast<std::size_t>(m_triangle == Triangle::Lower ? j : j - i);
+		}
+
+		/**
+		 * @brief First and one-past-last stored column of row i.
+		 */
+		int rowBegin(int i) const { return m_triangle == Triangle::Lower ? 0 : i; }
+		int rowEnd(int i) const { return m_triangle == Triangle::Lower ? i + 1 : m_size; }
+
+	public:
+		using value_type = T;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = true;
+
+		/**
+		 * @brief Constructs an n x n triangular matrix with an initial value for the stored triangle.
+		 *
+		 * @param n The order of the matrix.
+		 * @param triangle The stored triangle.
+		 * @param initialValue Initial value for the stored elements.
+		 * @throws std::invalid_argument If n is negative.
+		 */
+		TriangularMatrix(int n, Triangle triangle, T initialValue = T()) : m_size(n), m_triangle(triangle)
+		{
+			if (n < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_data.assign(static_cast<std::size_t>(n) * (n + 1) / 2, initialValue);
+		}
+
+		/**
+		 * @brief Takes one triangle of a square matrix; the other elements are ignored.
+		 *
+		 * @param matrix The square matrix.
+		 * @param triangle The triangle to take.
+		 * @throws std::invalid_argument If the matrix is not square.
+		 */
+		TriangularMatrix(const Matrix<T> &matrix, Triangle triangle) : TriangularMatrix(matrix.getRows(), triangle)
+		{
+			if (matrix.getRows() != matrix.getCols())
+			{
+				throw std::invalid_argument("Matrix must be square");
+			}
+			for (int i = 0; i < m_size; i++)
+			{
+				std::copy(matrix.rowPtr(i) + rowBegin(i), matrix.rowPtr(i) + rowEnd(i), m_data.data() + rowOffset(i));
+			}
+		}
+
+		int getRows() const { return m_size; }
+		int getCols() const { return m_size; }
+		int size() const { return m_size; }
+		Triangle getTriangle() const { return m_triangle; }
+
+		/**
+		 * @brief Gives direct access to the packed storage, row after row.
+		 */
+		const T *data() const { return m_data.data(); }
+		T *data() { return m_data.data(); }
+
+		value_type coeff(int i, int j) const
+		{
+			return stored(i, j) ? m_data[offset(i, j)] : T();
+		}
+
+		bool references(const void *, const void *) const { return false; }
+		void prepare() const {}
+
+		/**
+		 * @brief Reads an element; zero outside the stored triangle.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T operator()(int i, int j) const
+		{
+			detail::checkSquareIndex(i, j, m_size);
+			return coeff(i, j);
+		}
+
+		/**
+		 * @brief Accesses an element of the stored triangle.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds or outside the stored triangle.
+		 */
+		T &operator()(int i, int j)
+		{
+			detail::checkSquareIndex(i, j, m_size);
+			if (!stored(i, j))
+			{
+				throw std::out_of_range("Element is outside the stored triangle");
+			}
+			return m_data[offset(i, j)];
+		}
+
+		/**
+		 * @brief Transposes the matrix: the lower triangle becomes the upper one and vice versa.
+		 *
+		 * @return The transposed matrix.
+		 */
+		TriangularMatrix transpose() const
+		{
+			TriangularMatrix result(m_size, m_triangle == Triangle::Lower ? Triangle::Upper : Triangle::Lower);
+			for (int i = 0; i < m_size; i++)
+			{
+				for (int j = rowBegin(i); j < rowEnd(i); j++)
+				{
+					result.m_data[result.offset(j, i)] = m_data[offset(i, j)];
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * @brief Computes the determinant, the product of the diagonal, in O(n).
+		 *
+		 * @return The determinant.
+		 */
+		T determinant() const
+		{
+			T det = T(1);
+			for (int i = 0; i < m_size; i++)
+			{
+				det *= m_data[offset(i, i)];
+			}
+			return det;
+		}
+
+		/**
+		 * @brief Multiplies by a dense matrix (TRMM), skipping the zero triangle; in parallel over rows.
+		 *
+		 * @param b The right operand; must have size() rows.
+		 * @return The product.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		Matrix<T> operator*(const Matrix<T> &b) const
+		{
+			if (b.getRows() != m_size)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Multiply, m_size, b.getCols(), m_size);
+			const int cols = b.getCols();
+			Matrix<T> c(m_size, cols, T());
+			parallelFor(0, m_size, grainFor(static_cast<std::size_t>(m_size) * cols / 2 + 1), [&](std::size_t lo, std::size_t hi)
+						{
+							for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+							{
+								T *ci = c.rowPtr(i);
+								const T *ai = m_data.data() + rowOffset(i) - rowBegin(i);
+								for (int k = rowBegin(i); k < rowEnd(i); k++)
+								{
+									const T aik = ai[k];
+									const T *bk = b.rowPtr(k);
+									for (int j = 0; j < cols; j++)
+									{
+										ci[j] += aik * bk[j];
+									}
+								}
+							} });
+			return c;
+		}
+
+		/**
+		 * @brief Solves T * X = B by blocked forward or back substitution (TRSM).
+		 *
+		 * Rows are solved in blocks of SOLVE_BLOCK: the contribution of the rows solved so far is
+		 * removed with one GEMM per block, and only the small diagonal block is substituted row by
+		 * row, its columns split across threads. The cost is O(n^2) per right-hand side.
+		 *
+		 * @param b Right-hand sides, one per column.
+		 * @return The solution X.
+		 * @throws std::invalid_argument If b does not have size() rows.
+		 * @throws std::runtime_error If a diagonal element is zero.
+		 */
+		Matrix<T> solve(const Matrix<T> &b) const
+		{
+			static_assert(!std::is_integral<T>::value, "Triangular solves need a field type; convert integer matrices to floating point");
+			detail::checkRightHandSide(b.getRows(), m_size);
+			for (int i = 0; i < m_size; i++)
+			{
+				if (m_data[offset(i, i)] == T())
+				{
+					throw std::runtime_error("Matrix is singular");
+				}
+			}
+			MG_PROFILE_SCOPE(profile::Op::Solve, m_size, b.getCols());
+			constexpr int SOLVE_BLOCK = 128;
+			const int n = m_size;
+			const int cols = b.getCols();
+			const bool lower = m_triangle == Triangle::Lower;
+			Matrix<T> x(b);
+			Matrix<T> panel(std::min(SOLVE_BLOCK, n), n);
+			Matrix<T> update(std::min(SOLVE_BLOCK, n), cols);
+			for (int block = 0; block < n; block += SOLVE_BLOCK)
+			{
+				// Lower: rows i0..i1 depend on rows 0..i0; upper: on rows i1..n, solved from the bottom
+				const int i0 = lower ? block : std::max(0, n - block - SOLVE_BLOCK);
+				const int i1 = lower ? std::min(n, block + SOLVE_BLOCK) : n - block;
+				const int k0 = lower ? 0 : i1;
+				const int k1 = lower ? i0 : n;
+				if (k1 > k0 && cols > 0)
+				{
+					for (int i = i0; i < i1; i++)
+					{
+						const T *ai = m_data.data() + rowOffset(i) - rowBegin(i); // ai[k] is element (i, k)
+						std::copy(ai + k0, ai + k1, panel.rowPtr(i - i0));
+					}
+					multiplyWith(i1 - i0, cols, k1 - k0, panel.data(), panel.getStride(), x.rowPtr(k0), x.getStride(), update.data(), update.getStride(), false);
+					for (int i = i0; i < i1; i++)
+					{
+						simd::binary<simd::SubOp>(x.rowPtr(i), update.rowPtr(i - i0), x.rowPtr(i), cols);
+					}
+				}
+				parallelFor(0, cols, grainFor(static_cast<std::size_t>(i1 - i0) * (i1 - i0) / 2 + 1), [&](std::size_t lo, std::size_t hi)
+							{
+								const int j0 = static_cast<int>(lo);
+								const int width = static_cast<int>(hi - lo);
+								for (int step = 0; step < i1 - i0; step++)
+								{
+									const int i = lower ? i0 + step : i1 - 1 - step;
+									T *xi = x.rowPtr(i) + j0;
+									const T *ai = m_data.data() + rowOffset(i) - rowBegin(i);
+									const int kBegin = lower ? i0 : i + 1;
+									const int kEnd = lower ? i : i1;
+									for (int k = kBegin; k < kEnd; k++)
+									{
+										const T aik = ai[k];
+										const T *xk = x.rowPtr(k) + j0;
+										for (int j = 0; j < width; j++)
+										{
+											xi[j] -= aik * xk[j];
+										}
+									}
+									const T pivot = ai[i];
+									for (int j = 0; j < width; j++)
+									{
+										xi[j] /= pivot;
+									}
+								} });
+			}
+			return x;
+		}
+
+		/**
+		 * @brief Solves T * x = b for one right-hand side.
+		 *
+		 * @throws std::invalid_argument If b does not have size() entries.
+		 * @throws std::runtime_error If a diagonal element is zero.
+		 */
+		std::vector<T> solve(const std::vector<T> &b) const
+		{
+			Matrix<T> column(static_cast<int>(b.size()), 1);
+			std::copy(b.begin(), b.end(), column.data());
+			const Matrix<T> x = solve(column);
+			return std::vector<T>(x.data(), x.data() + x.getRows());
+		}
+	};
+
+	/**
+	 * @brief A symmetric matrix, storing its lower triangle packed row after row.
+	 *
+	 * Element (i, j) and element (j, i) are the same stored value.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	class SymmetricMatrix : public MatrixExpr<SymmetricMatrix<T>>
+	{
+	private:
+		int m_size;
+
+		/**
+		 * @brief The lower triangle: row i holds elements (i, 0)..(i, i) at i * (i + 1) / 2.
+		 */
+		std::vector<T> m_data;
+
+		static std::size_t offset(int i, int j)
+		{
+			if (j > i)
+			{
+				std::swap(i, j);
+			}
+			return static_cast<std::size_t>(i) * (i + 1) / 2 + j;
+		}
+
+	public:
+		using value_type = T;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = true;
+
+		/**
+		 * @brief Constructs an n x n symmetric matrix with an initial value for all elements.
+		 *
+		 * @param n The order of the matrix.
+		 * @param initialValue Initial value for all elements.
+		 * @throws std::invalid_argument If n is negative.
+		 */
+		explicit SymmetricMatrix(int n = 0, T initialValue = T()) : m_size(n)
+		{
+			if (n < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_data.assign(static_cast<std::size_t>(n) * (n + 1) / 2, initialValue);
+		}
+
+		/**
+		 * @brief Takes the lower triangle of a square matrix; the upper one is ignored.
+		 *
+		 * @param matrix The square matrix.
+		 * @throws std::invalid_argument If the matrix is not square.
+		 */
+		explicit SymmetricMatrix(const Matrix<T> &matrix) : SymmetricMatrix(matrix.getRows())
+		{
+			if (matrix.getRows() != matrix.getCols())
+			{
+				throw std::invalid_argument("Matrix must be square");
+			}
+			for (int i = 0; i < m_size; i++)
+			{
+				std::copy(matrix.rowPtr(i), matrix.rowPtr(i) + i + 1, m_data.data() + offset(i, 0));
+			}
+		}
+
+		int getRows() const { return m_size; }
+		int getCols() const { return m_size; }
+		int size() const { return m_size; }
+
+		/**
+		 * @brief Gives direct access to the packed lower triangle, row after row.
+		 */
+		const T *data() const { return m_data.data(); }
+		T *data() { return m_data.data(); }
+
+		value_type coeff(int i, int j) const
+		{
+			return m_data[offset(i, j)];
+		}
+
+		bool references(const void *, const void *) const { return false; }
+		void prepare() const {}
+
+		/**
+		 * @brief Reads an element.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T operator()(int i, int j) const
+		{
+			detail::checkSquareIndex(i, j, m_size);
+			return m_data[offset(i, j)];
+		}
+
+		/**
+		 * @brief Accesses an element; writing (i, j) also writes (j, i).
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T &operator()(int i, int j)
+		{
+			detail::checkSquareIndex(i, j, m_size);
+			return m_data[offset(i, j)];
+		}
+
+		/**
+		 * @brief Symmetric rank-k update (SYRK): this = alpha * A * A^T + beta * this.
+		 *
+		 * Only the lower triangle is computed, in blocks of rows multiplied by the GEMM kernel
+		 * against A^T: about half the work of the full product A * A^T.
+		 *
+		 * @param a An n x k matrix.
+		 * @param alpha Scale of A * A^T.
+		 * @param beta Scale of the current contents; zero ignores them.
+		 * @throws std::invalid_argument If a does not have size() rows.
+		 */
+		void rankUpdate(const Matrix<T> &a, T alpha = T(1), T beta = T(1))
+		{
+			if (a.getRows() != m_size)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Multiply, m_size, m_size, a.getCols());
+			constexpr int BLOCK = 128;
+			const int k = a.getCols();
+			const Matrix<T> at(a.transpose());
+			Matrix<T> block(std::min(BLOCK, m_size), m_size);
+			for (int i0 = 0; i0 < m_size; i0 += BLOCK)
+			{
+				const int i1 = std::min(m_size, i0 + BLOCK);
+				// Rows i0..i1 of A * A^T, up to column i1: the diagonal block and everything left of it
+				if (k > 0)
+				{
+					multiplyWith(i1 - i0, i1, k, a.rowPtr(i0), a.getStride(), at.data(), at.getStride(), block.data(), block.getStride(), false);
+				}
+				else
+				{
+					block.setValues(T());
+				}
+				for (int i = i0; i < i1; i++)
+				{
+					const T *product = block.rowPtr(i - i0);
+					T *row = m_data.data() + offset(i, 0);
+					for (int j = 0; j <= i; j++)
+					{
+						row[j] = beta == T() ? alpha * product[j] : alpha * product[j] + beta * row[j];
+					}
+				}
+			}
+		}
+
+		/**
+		 * @brief Multiplies by a dense matrix (SYMM), expanding the packed triangle for the GEMM kernel.
+		 *
+		 * @param b The right operand; must have size() rows.
+		 * @return The product.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		Matrix<T> operator*(const Matrix<T> &b) const
+		{
+			if (b.getRows() != m_size)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Multiply, m_size, b.getCols(), m_size);
+			const Matrix<T> dense(*this);
+			Matrix<T> c(m_size, b.getCols());
+			multiplyWith(m_size, b.getCols(), m_size, dense.data(), dense.getStride(), b.data(), b.getStride(), c.data(), c.getStride());
+			return c;
+		}
+	};
+
+	/**
+	 * @brief A square band matrix: kl diagonals below the main one and ku above it, zero elsewhere.
+	 *
+	 * Row i stores columns i - kl..i + ku, kl + ku + 1 slots per row (those before column 0 or
+	 * after column n - 1 are unused). Products and solves cost O(n * (kl + ku)) per column
+	 * instead of O(n^2); determinant() and solve() factor with partial pivoting inside the band.
+	 *
+	 * @tparam T The element type.
+	 */
+	template <typename T>
+	class BandedMatrix : public MatrixExpr<BandedMatrix<T>>
+	{
+	private:
+		int m_size;
+		int m_lower;
+		int m_upper;
+
+		/**
+		 * @brief The band, row after row: element (i, j) at i * width() + j - i + m_lower.
+		 */
+		std::vector<T> m_data;
+
+		int width() const
+		{
+			return m_lower + m_upper + 1;
+		}
+
+		bool inBand(int i, int j) const
+		{
+			return j - i <= m_upper && i - j <= m_lower;
+		}
+
+		/**
+		 * @brief LU factors with partial pivoting inside the band.
+		 *
+		 * Row exchanges widen U to kl + ku diagonals above the main one, so the factors use rows
+		 * of 2 * kl + ku + 1 slots: element (i, j) at i * stride + j - i + kl.
+		 */
+		struct Factors
+		{
+			std::vector<T> lu;
+			std::vector<int> pivots;
+			int stride;
+			bool negative;
+			bool singular;
+		};
+
+		Factors factor() const
+		{
+			static_assert(!std::is_integral<T>::value, "LU needs a field type; convert integer matrices to floating point");
+			const int n = m_size;
+			const int kl = m_lower;
+			const int reach = m_lower + m_upper; // Last column of U in a row, relative to the diagonal
+			Factors f{std::vector<T>(static_cast<std::size_t>(n) * (2 * kl + m_upper + 1), T()), std::vector<int>(n), 2 * kl + m_upper + 1, false, false};
+			auto at = [&](int i, int j) -> T &
+			{
+				return f.lu[static_cast<std::size_t>(i) * f.stride + (j - i + kl)];
+			};
+			for (int i = 0; i < n; i++)
+			{
+				for (int j = std::max(0, i - kl); j <= std::min(n - 1, i + m_upper); j++)
+				{
+					at(i, j) = m_data[static_cast<std::size_t>(i) * width() + (j - i + kl)];
+				}
+			}
+			for (int k = 0; k < n; k++)
+			{
+				const int last = std::min(n - 1, k + kl);
+				const int right = std::min(n - 1, k + reach);
+				int p = k;
+				for (int i = k + 1; i <= last; i++)
+				{
+					if (std::abs(at(i, k)) > std::abs(at(p, k)))
+					{
+						p = i;
+					}
+				}
+				f.pivots[k] = p;
+				if (p != k)
+				{
+					f.negative = !f.negative;
+					for (int j = k; j <= right; j++)
+					{
+						std::swap(at(k, j), at(p, j));
+					}
+				}
+				const T pivot = at(k, k);
+				if (pivot == T())
+				{
+					f.singular = true;
+					continue;
+				}
+				for (int i = k + 1; i <= last; i++)
+				{
+					const T l = at(i, k) / pivot;
+					at(i, k) = l;
+					T *ri = &at(i, k + 1);
+					const T *rk = &at(k, k + 1);
+					for (int j = 0; j < right - k; j++)
+					{
+						ri[j] -= l * rk[j];
+					}
+				}
+			}
+			return f;
+		}
+
+	public:
+		using value_type = T;
+		static constexpr bool isLeaf = false;
+		static constexpr bool elementwise = true;
+
+		/**
+		 * @brief Constructs an n x n band matrix with an initial value for the band.
+		 *
+		 * @param n The order of the matrix.
+		 * @param lower Number of diagonals below the main one.
+		 * @param upper Number of diagonals above the main one.
+		 * @param initialValue Initial value for the band.
+		 * @throws std::invalid_argument If a dimension is negative.
+		 */
+		BandedMatrix(int n, int lower, int upper, T initialValue = T()) : m_size(n), m_lower(lower), m_upper(upper)
+		{
+			if (n < 0 || lower < 0 || upper < 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be non-negative");
+			}
+			m_data.assign(static_cast<std::size_t>(n) * width(), T());
+			for (int i = 0; i < n; i++)
+			{
+				for (int j = std::max(0, i - lower); j <= std::min(n - 1, i + upper); j++)
+				{
+					m_data[static_cast<std::size_t>(i) * width() + (j - i + lower)] = initialValue;
+				}
+			}
+		}
+
+		/**
+		 * @brief Takes the band of a square matrix; the elements outside it are ignored.
+		 *
+		 * @throws std::invalid_argument If the matrix is not square or a bandwidth is negative.
+		 */
+		BandedMatrix(const Matrix<T> &matrix, int lower, int upper) : BandedMatrix(matrix.getRows(), lower, upper)
+		{
+			if (matrix.getRows() != matrix.getCols())
+			{
+				throw std::invalid_argument("Matrix must be square");
+			}
+			for (int i = 0; i < m_size; i++)
+			{
+				for (int j = std::max(0, i - lower); j <= std::min(m_size - 1, i + upper); j++)
+				{
+					m_data[static_cast<std::size_t>(i) * width() + (j - i + lower)] = matrix.coeff(i, j);
+				}
+			}
+		}
+
+		int getRows() const { return m_size; }
+		int getCols() const { return m_size; }
+		int size() const { return m_size; }
+		int lowerBandwidth() const { return m_lower; }
+		int upperBandwidth() const { return m_upper; }
+
+		value_type coeff(int i, int j) const
+		{
+			return inBand(i, j) ? m_data[static_cast<std::size_t>(i) * width() + (j - i + m_lower)] : T();
+		}
+
+		bool references(const void *, const void *) const { return false; }
+		void prepare() const {}
+
+		/**
+		 * @brief Reads an element; zero outside the band.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds.
+		 */
+		T operator()(int i, int j) const
+		{
+			detail::checkSquareIndex(i, j, m_size);
+			return coeff(i, j);
+		}
+
+		/**
+		 * @brief Accesses an element of the band.
+		 *
+		 * @throws std::out_of_range If the indices are out of bounds or outside the band.
+		 */
+		T &operator()(int i, int j)
+		{
+			detail::checkSquareIndex(i, j, m_size);
+			if (!inBand(i, j))
+			{
+				throw std::out_of_range("Element is outside the band");
+			}
+			return m_data[static_cast<std::size_t>(i) * width() + (j - i + m_lower)];
+		}
+
+		/**
+		 * @brief Multiplies by a dense matrix in O(n * (kl + ku + 1) * cols), in parallel over rows.
+		 *
+		 * @param b The right operand; must have size() rows.
+		 * @return The product.
+		 * @throws std::invalid_argument If the dimensions do not match.
+		 */
+		Matrix<T> operator*(const Matrix<T> &b) const
+		{
+			if (b.getRows() != m_size)
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			MG_PROFILE_SCOPE(profile::Op::Multiply, m_size, b.getCols(), m_size);
+			const int cols = b.getCols();
+			Matrix<T> c(m_size, cols, T());
+			parallelFor(0, m_size, grainFor(static_cast<std::size_t>(width()) * cols), [&](std::size_t lo, std::size_t hi)
+						{
+							for (int i = static_cast<int>(lo); i < static_cast<int>(hi); i++)
+							{
+								T *ci = c.rowPtr(i);
+								const T *ai = m_data.data() + static_cast<std::size_t>(i) * width() + m_lower - i; // ai[k] is element (i, k)
+								for (int k = std::max(0, i - m_lower); k <= std::min(m_size - 1, i + m_upper); k++)
+								{
+									const T aik = ai[k];
+									const T *bk = b.rowPtr(k);
+									for (int j = 0; j < cols; j++)
+									{
+										ci[j] += aik * bk[j];
+									}
+								}
+							} });
+			return c;
+		}
+
+		/**
+		 * @brief Multiplies by a vector in O(n * (kl + ku + 1)).
+		 *
+		 * @throws std::invalid_argument If x does not have size() entries.
+		 */
+		std::vector<T> operator*(const std::vector<T> &x) const
+		{
+			if (x.size() != static_cast<std::size_t>(m_size))
+			{
+				throw std::invalid_argument("Matrix dimensions must match");
+			}
+			std::vector<T> y(m_size, T());
+			for (int i = 0; i < m_size; i++)
+			{
+				const T *ai = m_data.data() + static_cast<std::size_t>(i) * width() + m_lower - i;
+				T sum = T();
+				for (int k = std::max(0, i - m_lower); k <= std::min(m_size - 1, i + m_upper); k++)
+				{
+					sum += ai[k] * x[k];
+				}
+				y[i] = sum;
+			}
+			return y;
+		}
+
+		/**
+		 * @brief Computes the determinant from a banded LU factorization, in O(n * kl * (kl + ku)).
+		 *
+		 * @return The determinant.
+		 */
+		T determinant() const
+		{
+			MG_PROFILE_SCOPE(profile::Op::Determinant, m_size, m_size);
+			const Factors f = factor();
+			if (f.singular)
+			{
+				return T();
+			}
+			T det = f.negative ? T(-1) : T(1);
+			for (int i = 0; i < m_size; i++)
+			{
+				det *= f.lu[static_cast<std::size_t>(i) * f.stride + m_lower];
+			}
+			return det;
+		}
+
+		/**
+		 * @brief Solves A * X = B with a banded LU factorization, in O(n * (2 * kl + ku) * cols) after factoring.
+		 *
+		 * @param b Right-hand sides, one per column.
+		 * @return The solution X.
+		 * @throws std::invalid_argument If b does not have size() rows.
+		 * @throws std::runtime_error If the matrix is singular.
+		 */
+		Matrix<T> solve(const Matrix<T> &b) const
+		{
+			detail::checkRightHandSide(b.getRows(), m_size);
+			MG_PROFILE_SCOPE(profile::Op::Solve, m_size, b.getCols());
+			const Factors f = factor();
+			if (f.singular)
+			{
+				throw std::runtime_error("Matrix is singular");
+			}
+			const int n = m_size;
+			const int kl = m_lower;
+			const int reach = m_lower + m_upper;
+			const int cols = b.getCols();
+			Matrix<T> x(b);
+			auto lu = [&](int i, int j)
+			{
+				return f.lu[static_cast<std::size_t>(i) * f.stride + (j - i + kl)];
+			};
+			auto axpy = [cols](T *dst, T scale, const T *src)
+			{
+				for (int j = 0; j < cols; j++)
+				{
+					dst[j] -= scale * src[j];
+				}
+			};
+			for (int k = 0; k < n; k++)
+			{
+				if (f.pivots[k] != k)
+				{
+					std::swap_ranges(x.rowPtr(k), x.rowPtr(k) + cols, x.rowPtr(f.pivots[k]));
+				}
+				for (int i = k + 1; i <= std::min(n - 1, k + kl); i++)
+				{
+					axpy(x.rowPtr(i), lu(i, k), x.rowPtr(k));
+				}
+			}
+			for (int i = n - 1; i >= 0; i--)
+			{
+				T *xi = x.rowPtr(i);
+				for (int k = i + 1; k <= std::min(n - 1, i + reach); k++)
+				{
+					axpy(xi, lu(i, k), x.rowPtr(k));
+				}
+				const T pivot = lu(i, i);
+				for (int j = 0; j < cols; j++)
+				{
+					xi[j] /= pivot;
+				}
+			}
+			return x;
+		}
+
+		/**
+		 * @brief Solves A * x = b for one right-hand side.
+		 *
+		 * @throws std::invalid_argument If b does not have size() entries.
+		 * @throws std::runtime_error If the matrix is singular.
+		 */
+		std::vector<T> solve(const std::vector<T> &b) const
+		{
+			Matrix<T> column(static_cast<int>(b.size()), 1);
+			std::copy(b.begin(), b.end(), column.data());
+			const Matrix<T> x = solve(column);
+			return std::vector<T>(x.data(), x.data() + x.getRows());
+		}
+	};
+}
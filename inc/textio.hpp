@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "matrix.hpp"
+#include "matrixview.hpp"
+#include "parallel.hpp"
+
+/**
+ * @brief Text matrix files: CSV, TSV and whitespace-separated values, one row per line.
+ *
+ * Reading splits the text into chunks of about TEXT_CHUNK bytes at line boundaries. A first
+ * parallel pass counts the rows of every chunk, the matrix is allocated once, and a second
+ * parallel pass parses each chunk straight into its rows with std::from_chars. Writing
+ * formats blocks of rows in parallel with std::to_chars and writes them in order, so the
+ * stream sees a few large writes and no flushes.
+ *
+ * Blank lines are skipped, "\r\n" line ends are accepted, and spaces around fields are
+ * ignored. Fields are plain numbers: quoting and missing values are not supported.
+ */
+
+namespace mg
+{
+	/**
+	 * @brief Layout of a text matrix file.
+	 */
+	struct TextFormat
+	{
+		/**
+		 * @brief Field separator; ' ' separates fields by any run of spaces and tabs.
+		 */
+		char delimiter = ' ';
+
+		/**
+		 * @brief Significant digits written for floating-point elements; negative writes the
+		 *        shortest text that reads back to the same value.
+		 */
+		int precision = -1;
+
+		/**
+		 * @brief Whether the first line is a header to skip when reading.
+		 */
+		bool skipHeader = false;
+
+		static TextFormat csv() { return TextFormat{',', -1, false}; }
+		static TextFormat tsv() { return TextFormat{'\t', -1, false}; }
+		static TextFormat whitespace() { return TextFormat{' ', -1, false}; }
+
+		/**
+		 * @brief Picks the format from a file extension: .csv, .tsv, otherwise whitespace.
+		 */
+		static TextFormat forPath(const std::string &path)
+		{
+			auto endsWith = [&](const char *suffix)
+			{
+				const std::size_t n = std::strlen(suffix);
+				return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0;
+			};
+			if (endsWith(".csv"))
+			{
+				return csv();
+			}
+			if (endsWith(".tsv"))
+			{
+				return tsv();
+			}
+			return whitespace();
+		}
+	};
+
+	namespace detail
+	{
+		/**
+		 * @brief Bytes of text parsed or formatted by one task.
+		 */
+		constexpr std::size_t TEXT_CHUNK = std::size_t(1) << 20;
+
+		/**
+		 * @brief Type parsed and formatted for T: T itself for built-in types, float for half and bfloat16.
+		 */
+		template <typename T>
+		using TextValue = typename std::conditional<std::is_arithmetic<T>::value, T, float>::type;
+
+		inline const char *skipBlanks(const char *p, const char *end, char delimiter)
+		{
+			while (p < end && (*p == ' ' || *p == '\r' || (*p == '\t' && delimiter != '\t')))
+			{
+				p++;
+			}
+			return p;
+		}
+
+		inline bool isBlankLine(const char *p, const char *end)
+		{
+			return skipBlanks(p, end, ' ') == end;
+		}
+
+		inline const char *lineEnd(const char *p, const char *end)
+		{
+			const void *newline = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+			return newline != nullptr ? static_cast<const char *>(newline) : end;
+		}
+
+		/**
+		 * @brief Parses the fields of one line into out[0..cols).
+		 *
+		 * @param out Destination, or nullptr to only count the fields.
+		 * @return The number of fields, cols + 1 if there are more than cols, or -1 if a field
+		 *         is not a number.
+		 */
+		template <typename T>
+		int parseLine(const char *p, const char *end, char delimiter, T *out, int cols)
+		{
+			int count = 0;
+			p = skipBlanks(p, end, delimiter);
+			while (p < end)
+			{
+				if (*p == '+' && p + 1 < end && *(p + 1) != '-')
+				{
+					p++; // from_chars does not take an explicit plus sign
+				}
+				TextValue<T> value;
+				const std::from_chars_result result = std::from_chars(p, end, value);
+				if (result.ec != std::errc())
+				{
+					return -1;
+				}
+				if (out != nullptr)
+				{
+					if (count == cols)
+					{
+						return cols + 1;
+					}
+					out[count] = static_cast<T>(value);
+				}
+				count++;
+				p = skipBlanks(result.ptr, end, delimiter);
+				if (p == end)
+				{
+					break;
+				}
+				if (delimiter == ' ')
+				{
+					if (p == result.ptr)
+					{
+						return -1; // Something other than a separator follows the number
+					}
+				}
+				else
+				{
+					if (*p != delimiter)
+					{
+						return -1;
+					}
+					p = skipBlanks(p + 1, end, delimiter);
+					if (p == end)
+					{
+						return -1; // Empty last field
+					}
+				}
+			}
+			return count;
+		}
+
+		/**
+		 * @brief Upper bound on the characters of one formatted element.
+		 */
+		template <typename T>
+		std::size_t textWidth(int precision)
+		{
+			return 32 + static_cast<std::size_t>(std::is_floating_point<TextValue<T>>::value ? std::max(precision, 0) : 0);
+		}
+
+		template <typename T>
+		char *formatValue(char *p, char *end, T value, int precision)
+		{
+			const TextValue<T> v = static_cast<TextValue<T>>(value);
+			std::to_chars_result result;
+			if constexpr (std::is_floating_point<TextValue<T>>::value)
+			{
+				result = precision < 0 ? std::to_chars(p, end, v) : std::to_chars(p, end, v, std::chars_format::general, precision);
+			}
+			else
+			{
+				result = std::to_chars(p, end, v);
+			}
+			if (result.ec != std::errc())
+			{
+				throw std::runtime_error("Cannot format matrix element");
+			}
+			return result.ptr;
+		}
+	}
+
+	/**
+	 * @brief Parses text holding one matrix row per line.
+	 *
+	 * The number of columns is taken from the first row; every other row must have as many
+	 * fields. Chunks of the text are parsed in parallel into a matrix allocated once.
+	 *
+	 * @tparam T The element type.
+	 * @param text The text.
+	 * @param format The field separator and whether to skip a header line.
+	 * @return The matrix; 0 x 0 if the text holds no rows.
+	 * @throws std::runtime_error If a field is not a number or a row has the wrong number of
+	 *         fields; the message names the first such line.
+	 */
+	template <typename T>
+	Matrix<T> parseText(std::string_view text, const TextFormat &format = TextFormat::whitespace())
+	{
+		const char *begin = text.data();
+		const char *end = begin + text.size();
+		std::size_t firstLine = 1;
+		if (format.skipHeader && begin < end)
+		{
+			const char *header = detail::lineEnd(begin, end);
+			begin = header == end ? end : header + 1;
+			firstLine = 2;
+		}
+
+		// Chunks start at line starts, so no line is split between two of them
+		std::vector<const char *> bounds{begin};
+		while (static_cast<std::size_t>(end - bounds.back()) > detail::TEXT_CHUNK)
+		{
+			const char *next = detail::lineEnd(bounds.back() + detail::TEXT_CHUNK, end);
+			if (next == end)
+			{
+				break;
+			}
+			bounds.push_back(next + 1);
+		}
+		bounds.push_back(end);
+		const std::size_t chunks = bounds.size() - 1;
+
+		// First pass: lines and non-blank rows per chunk
+		std::vector<std::size_t> lines(chunks + 1, 0);
+		std::vector<std::size_t> rows(chunks + 1, 0);
+		parallelFor(0, chunks, 1, [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t c = lo; c < hi; c++)
+						{
+							for (const char *p = bounds[c]; p < bounds[c + 1];)
+							{
+								const char *e = detail::lineEnd(p, bounds[c + 1]);
+								lines[c + 1]++;
+								rows[c + 1] += detail::isBlankLine(p, e) ? 0 : 1;
+								p = e == bounds[c + 1] ? e : e + 1;
+							}
+						} });
+		for (std::size_t c = 0; c < chunks; c++)
+		{
+			lines[c + 1] += lines[c];
+			rows[c + 1] += rows[c];
+		}
+		if (rows[chunks] == 0)
+		{
+			return Matrix<T>(0, 0);
+		}
+		if (rows[chunks] > static_cast<std::size_t>(INT_MAX))
+		{
+			throw std::runtime_error("Too many rows in matrix text");
+		}
+
+		// The first row sets the number of columns
+		const char *first = begin;
+		std::size_t firstRowLine = firstLine;
+		while (detail::isBlankLine(first, detail::lineEnd(first, end)))
+		{
+			first = detail::lineEnd(first, end) + 1;
+			firstRowLine++;
+		}
+		const int cols = detail::parseLine<T>(first, detail::lineEnd(first, end), format.delimiter, nullptr, 0);
+		if (cols < 0)
+		{
+			throw std::runtime_error("Malformed number on line " + std::to_string(firstRowLine));
+		}
+
+		// Second pass: each chunk parses into its own rows and records its first error, if any
+		Matrix<T> matrix(static_cast<int>(rows[chunks]), cols);
+		std::vector<std::string> errors(chunks);
+		parallelFor(0, chunks, 1, [&](std::size_t lo, std::size_t hi)
+					{
+						for (std::size_t c = lo; c < hi; c++)
+						{
+							int row = static_cast<int>(rows[c]);
+							std::size_t line = firstLine + lines[c];
+							for (const char *p = bounds[c]; p < bounds[c + 1]; line++)
+							{
+								const char *e = detail::lineEnd(p, bounds[c + 1]);
+								if (!detail::isBlankLine(p, e))
+								{
+									const int count = detail::parseLine<T>(p, e, format.delimiter, matrix.rowPtr(row), cols);
+									if (count < 0)
+									{
+										errors[c] = "Malformed number on line " + std::to_string(line);
+										break;
+									}
+									if (count != cols)
+									{
+										errors[c] = "Line " + std::to_string(line) + " has " + (count > cols ? "more than " + std::to_string(cols) : std::to_string(count)) +
+													" values, expected " + std::to_string(cols);
+										break;
+									}
+									row++;
+								}
+								p = e == bounds[c + 1] ? e : e + 1;
+							}
+						} });
+		for (const std::string &error : errors)
+		{
+			if (!error.empty())
+			{
+				throw std::runtime_error(error);
+			}
+		}
+		return matrix;
+	}
+
+	/**
+	 * @brief Reads a text matrix file (see parseText()).
+	 *
+	 * @tparam T The element type.
+	 * @param path The file to read.
+	 * @param format The field separator and whether to skip a header line.
+	 * @return The matrix.
+	 * @throws std::runtime_error If the file cannot be read or is malformed.
+	 */
+	template <typename T>
+	Matrix<T> loadText(const std::string &path, const TextFormat &format)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			throw std::runtime_error("Cannot open " + path);
+		}
+		std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+		file.seekg(0);
+		if (!file.read(text.data(), static_cast<std::streamsize>(text.size())))
+		{
+			throw std::runtime_error("Cannot read " + path);
+		}
+		try
+		{
+			return parseText<T>(text, format);
+		}
+		catch (const std::runtime_error &e)
+		{
+			throw std::runtime_error(path + ": " + e.what());
+		}
+	}
+
+	/**
+	 * @brief Reads a text matrix file, choosing the format from its extension (see TextFormat::forPath()).
+	 */
+	template <typename T>
+	Matrix<T> loadText(const std::string &path)
+	{
+		return loadText<T>(path, TextFormat::forPath(path));
+	}
+
+	namespace detail
+	{
+		/**
+		 * @brief Formats blocks of rows in parallel and passes each block's text to sink(data, size), in row order.
+		 */
+		template <typename T, typename Sink>
+		void formatBlocks(MatrixView<const T> matrix, const TextFormat &format, Sink &&sink)
+		{
+			const int rows = matrix.getRows();
+			const int cols = matrix.getCols();
+			const std::size_t rowBytes = static_cast<std::size_t>(cols) * (textWidth<T>(format.precision) + 1) + 1;
+			const int blockRows = static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(INT_MAX, TEXT_CHUNK / rowBytes)));
+			const int groupBlocks = 2 * static_cast<int>(ThreadPool::global().concurrency());
+			std::vector<std::string> buffers(groupBlocks);
+			for (int g = 0; g < rows;)
+			{
+				const int groupRows = static_cast<int>(std::min<long long>(rows - g, static_cast<long long>(blockRows) * groupBlocks));
+				const int blocks = (groupRows + blockRows - 1) / blockRows;
+				parallelFor(0, blocks, 1, [&](std::size_t lo, std::size_t hi)
+							{
+								for (std::size_t b = lo; b < hi; b++)
+								{
+									const int r0 = g + static_cast<int>(b) * blockRows;
+									const int r1 = std::min(g + groupRows, r0 + blockRows);
+									std::string &buffer = buffers[b];
+									buffer.resize(static_cast<std::size_t>(r1 - r0) * rowBytes);
+									char *p = buffer.data();
+									char *bufferEnd = p + buffer.size();
+									for (int i = r0; i < r1; i++)
+									{
+										const T *row = matrix.data() + static_cast<std::size_t>(i) * matrix.getStride();
+										for (int j = 0; j < cols; j++)
+										{
+											if (j > 0)
+											{
+												*p++ = format.delimiter;
+											}
+											p = formatValue(p, bufferEnd, row[j], format.precision);
+										}
+										*p++ = '\n';
+									}
+									buffer.resize(static_cast<std::size_t>(p - buffer.data()));
+								} });
+				for (int b = 0; b < blocks; b++)
+				{
+					sink(buffers[b].data(), buffers[b].size());
+				}
+				g += groupRows;
+			}
+		}
+	}
+
+	/**
+	 * @brief Writes a matrix (or any view) as text, one row per line.
+	 *
+	 * Blocks of rows are formatted in parallel into buffers that are then written in order.
+	 *
+	 * @param os The stream to write to; it is not flushed.
+	 * @param matrix The elements to write.
+	 * @param format The field separator and floating-point precision.
+	 */
+	template <typename T>
+	void writeText(std::ostream &os, MatrixView<const T> matrix, const TextFormat &format = TextFormat::whitespace())
+	{
+		detail::formatBlocks<T>(matrix, format, [&](const char *data, std::size_t size)
+								{ os.write(data, static_cast<std::streamsize>(size)); });
+	}
+
+	/**
+	 * @brief Formats a matrix (or any view) as text (see writeText()).
+	 *
+	 * @return The text.
+	 */
+	template <typename T>
+	std::string formatText(MatrixView<const T> matrix, const TextFormat &format = TextFormat::whitespace())
+	{
+		std::string text;
+		detail::formatBlocks<T>(matrix, format, [&](const char *data, std::size_t size)
+								{ text.append(data, size); });
+		return text;
+	}
+
+	/**
+	 * @brief Writes a matrix (or any view) to a text file (see writeText()).
+	 *
+	 * @param matrix The elements to write.
+	 * @param path The file to create or overwrite.
+	 * @param format The field separator and floating-point precision.
+	 * @throws std::runtime_error If the file cannot be written.
+	 */
+	template <typename T>
+	void saveText(MatrixView<const T> matrix, const std::string &path, const TextFormat &format)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		writeText<T>(file, matrix, format);
+		if (!file.flush())
+		{
+			throw std::runtime_error("Cannot write " + path);
+		}
+	}
+
+	/**
+	 * @brief Writes a text file, choosing the format from its extension (see TextFormat::forPath()).
+	 */
+	template <typename T>
+	void saveText(MatrixView<const T> matrix, const std::string &path)
+	{
+		saveText<T>(matrix, path, TextFormat::forPath(path));
+	}
+
+	/**
+	 * @brief Writes a view of a mutable matrix as text (see writeText()).
+	 */
+	template <typename T>
+	void writeText(std::ostream &os, MatrixView<T> matrix, const TextFormat &format = TextFormat::whitespace())
+	{
+		writeText<T>(os, MatrixView<const T>(matrix), format);
+	}
+
+	/**
+	 * @brief Writes a matrix as text (see writeText()).
+	 */
+	template <typename T>
+	void writeText(std::ostream &os, const Matrix<T> &matrix, const TextFormat &format = TextFormat::whitespace())
+	{
+		writeText<T>(os, matrix.view(), format);
+	}
+
+	/**
+	 * @brief Formats a view of a mutable matrix as text (see formatText()).
+	 */
+	template <typename T>
+	std::string formatText(MatrixView<T> matrix, const TextFormat &format = TextFormat::whitespace())
+	{
+		return formatText<T>(MatrixView<const T>(matrix), format);
+	}
+
+	/**
+	 * @brief Formats a matrix as text (see formatText()).
+	 */
+	template <typename T>
+	std::string formatText(const Matrix<T> &matrix, const TextFormat &format = TextFormat::whitespace())
+	{
+		return formatText<T>(matrix.view(), format);
+	}
+
+	/**
+	 * @brief Writes a view of a mutable matrix to a text file (see saveText()).
+	 */
+	template <typename T>
+	void saveText(MatrixView<T> matrix, const std::string &path, const TextFormat &format)
+	{
+		saveText<T>(MatrixView<const T>(matrix), path, format);
+	}
+
+	/**
+	 * @brief Writes a view of a mutable matrix to a text file, choosing the format from its extension.
+	 */
+	template <typename T>
+	void saveText(MatrixView<T> matrix, const std::string &path)
+	{
+		saveText<T>(MatrixView<const T>(matrix), path);
+	}
+
+	/**
+	 * @brief Writes a matrix to a text file (see saveText()).
+	 */
+	template <typename T>
+	void saveText(const Matrix<T> &matrix, const std::string &path, const TextFormat &format)
+	{
+		saveText<T>(matrix.view(), path, format);
+	}
+
+	/**
+	 * @brief Writes a matrix to a text file, choosing the format from its extension.
+	 */
+	template <typename T>
+	void saveText(const Matrix<T> &matrix, const std::string &path)
+	{
+		saveText<T>(matrix.view(), path);
+	}
+}
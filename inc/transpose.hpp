@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel.hpp"
+#include "simd.hpp"
+
+#ifdef MG_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Cache-oblivious out-of-place transpose and in-place transposition kernels.
+ *
+ * The out-of-place transpose halves the longer side recursively until a block fits in L1,
+ * so both the reads and the strided writes stay cache resident at every level of the memory
+ * hierarchy without tuning. Leaf blocks of 4- and 8-byte trivially copyable types are
+ * transposed 8x8 / 4x4 at a time in AVX registers with unpack/shuffle/permute sequences.
+ */
+
+namespace mg
+{
+	namespace detail
+	{
+		/**
+		 * @brief Side length of the leaf blocks of the recursive transpose.
+		 */
+		constexpr int TRANSPOSE_TILE = 32;
+
+		template <typename T>
+		struct HasTransposeKernel : std::integral_constant<bool, std::is_trivially_copyable<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)>
+		{
+		};
+
+		/**
+		 * @brief Scalar leaf: dst(j, i) = src(i, j).
+		 */
+		template <typename T>
+		void transposeTileScalar(const T *src, std::size_t lds, T *dst, std::size_t ldd, int rows, int cols)
+		{
+			for (int i = 0; i < rows; i++)
+			{
+				const T *s = src + i * lds;
+				for (int j = 0; j < cols; j++)
+				{
+					dst[j * ldd + i] = s[j];
+				}
+			}
+		}
+
+#ifdef MG_SIMD_X86
+		/**
+		 * @brief AVX leaf for 4-byte elements: 8x8 blocks through eight ymm registers.
+		 */
+		__attribute__((target("avx2"))) inline void transposeTile32(const void *srcBytes, std::size_t lds, void *dstBytes, std::size_t ldd, int rows, int cols)
+		{
+			const float *src = static_cast<const float *>(srcBytes);
+			float *dst = static_cast<float *>(dstBytes);
+			const int rows8 = rows & ~7;
+			const int cols8 = cols & ~7;
+			for (int i = 0; i < rows8; i += 8)
+			{
+				for (int j = 0; j < cols8; j += 8)
+				{
+					const float *s = src + i * lds + j;
+					__m256 r0 = _mm256_loadu_ps(s);
+					__m256 r1 = _mm256_loadu_ps(s + lds);
+					__m256 r2 = _mm256_loadu_ps(s + 2 * lds);
+					__m256 r3 = _mm256_loadu_ps(s + 3 * lds);
+					__m256 r4 = _mm256_loadu_ps(s + 4 * lds);
+					__m256 r5 = _mm256_loadu_ps(s + 5 * lds);
+					__m256 r6 = _mm256_loadu_ps(s + 6 * lds);
+					__m256 r7 = _mm256_loadu_ps(s + 7 * lds);
+
+					__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+					__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+					__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+					__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+					__m256 t4 = _mm256_unpacklo_ps(r4, r5);
+					__m256 t5 = _mm256_unpackhi_ps(r4, r5);
+					__m256 t6 = _mm256_unpacklo_ps(r6, r7);
+					__m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+					__m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+					__m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+					__m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+					__m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+					__m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+					__m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+					__m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+					__m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+					float *d = dst + j * ldd + i;
+					_mm256_storeu_ps(d, _mm256_permute2f128_ps(u0, u4, 0x20));
+					_mm256_storeu_ps(d + ldd, _mm256_permute2f128_ps(u1, u5, 0x20));
+					_mm256_storeu_ps(d + 2 * ldd, _mm256_permute2f128_ps(u2, u6, 0x20));
+					_mm256_storeu_ps(d + 3 * ldd, _mm256_permute2f128_ps(u3, u7, 0x20));
+					_mm256_storeu_ps(d + 4 * ldd, _mm256_permute2f128_ps(u0, u4, 0x31));
+					_mm256_storeu_ps(d + 5 * ldd, _mm256_permute2f128_ps(u1, u5, 0x31));
+					_mm256_storeu_ps(d + 6 * ldd, _mm256_permute2f128_ps(u2, u6, 0x31));
+					_mm256_storeu_ps(d + 7 * ldd, _mm256_permute2f128_ps(u3, u7, 0x31));
+				}
+			}
+			transposeTileScalar(src + cols8, lds, dst + cols8 * ldd, ldd, rows8, cols - cols8);
+			transposeTileScalar(src + rows8 * lds, lds, dst + rows8, ldd, rows - rows8, cols);
+		}
+
+		/**
+		 * @brief AVX leaf for 8-byte elements: 4x4 blocks through four ymm registers.
+		 */
+		__attribute__((target("avx2"))) inline void transposeTile64(const void *srcBytes, std::size_t lds, void *dstBytes, std::size_t ldd, int rows, int cols)
+		{
+			const double *src = static_cast<const double *>(srcBytes);
+			double *dst = static_cast<double *>(dstBytes);
+			const int rows4 = rows & ~3;
+			const int cols4 = cols & ~3;
+			for (int i = 0; i < rows4; i += 4)
+			{
+				for (int j = 0; j < cols4; j += 4)
+				{
+					const double *s = src + i * lds + j;
+					__m256d r0 = _mm256_loadu_pd(s);
+					__m256d r1 = _mm256_loadu_pd(s + lds);
+					__m256d r2 = _mm256_loadu_pd(s + 2 * lds);
+					__m256d r3 = _mm256_loadu_pd(s + 3 * lds);
+
+					__m256d t0 = _mm256_unpacklo_pd(r0, r1);
+					__m256d t1 = _mm256_unpackhi_pd(r0, r1);
+					__m256d t2 = _mm256_unpacklo_pd(r2, r3);
+					__m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+					double *d = dst + j * ldd + i;
+					_mm256_storeu_pd(d, _mm256_permute2f128_pd(t0, t2, 0x20));
+					_mm256_storeu_pd(d + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+					_mm256_storeu_pd(d + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+					_mm256_storeu_pd(d + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+				}
+			}
+			transposeTileScalar(src + cols4, lds, dst + cols4 * ldd, ldd, rows4, cols - cols4);
+			transposeTileScalar(src + rows4 * lds, lds, dst + rows4, ldd, rows - rows4, cols);
+		}
+#endif
+
+		/**
+		 * @brief Transposes one leaf block, through registers when the type and CPU allow it.
+		 */
+		template <typename T>
+		void transposeTile(const T *src, std::size_t lds, T *dst, std::size_t ldd, int rows, int cols)
+		{
+#ifdef MG_SIMD_X86
+			if constexpr (HasTransposeKernel<T>::value)
+			{
+				if (simd::activeIsa() >= simd::Isa::AVX2)
+				{
+					if constexpr (sizeof(T) == 4)
+					{
+						transposeTile32(src, lds, dst, ldd, rows, cols);
+					}
+					else
+					{
+						transposeTile64(src, lds, dst, ldd, rows, cols);
+					}
+					return;
+				}
+			}
+#endif
+			transposeTileScalar(src, lds, dst, ldd, rows, cols);
+		}
+
+		/**
+		 * @brief Cache-oblivious recursion: halve the longer side until the block is a leaf.
+		 */
+		template <typename T>
+		void transposeRecursive(const T *src, std::size_t lds, T *dst, std::size_t ldd, int rows, int cols)
+		{
+			if (rows <= TRANSPOSE_TILE && cols <= TRANSPOSE_TILE)
+			{
+				transposeTile(src, lds, dst, ldd, rows, cols);
+				return;
+			}
+			if (rows >= cols)
+			{
+				// Split on a multiple of 8 so the register kernels see whole blocks
+				int half = (rows / 2 + 7) & ~7;
+				transposeRecursive(src, lds, dst, ldd, half, cols);
+				transposeRecursive(src + half * lds, lds, dst + half, ldd, rows - half, cols);
+			}
+			else
+			{
+				int half = (cols / 2 + 7) & ~7;
+				transposeRecursive(src, lds, dst, ldd, rows, half);
+				transposeRecursive(src + half, lds, dst + half * ldd, ldd, rows, cols - half);
+			}
+		}
+	}
+
+	/**
+	 * @brief Writes the transpose of a rows x cols block to dst (cols x rows). src and dst must not overlap.
+	 *
+	 * @param src Source block; row i starts at src + i * lds.
+	 * @param lds Leading dimension of the source.
+	 * @param dst Destination block; row j starts at dst + j * ldd.
+	 * @param ldd Leading dimension of the destination.
+	 * @param rows Number of source rows.
+	 * @param cols Number of source columns.
+	 */
+	template <typename T>
+	void transposeCopy(const T *src, std::size_t lds, T *dst, std::size_t ldd, int rows, int cols)
+	{
+		constexpr int TILE = detail::TRANSPOSE_TILE;
+		const int strips = (rows + TILE - 1) / TILE;
+		parallelFor(0, strips, grainFor(static_cast<std::size_t>(TILE) * cols), [&](std::size_t lo, std::size_t hi)
+					{
+						const int first = static_cast<int>(lo) * TILE;
+						const int last = std::min(rows, static_cast<int>(hi) * TILE);
+						detail::transposeRecursive(src + first * lds, lds, dst + first, ldd, last - first, cols); });
+	}
+
+	/**
+	 * @brief Transposes an n x n block in place by swapping mirrored tiles.
+	 *
+	 * @param a The block; row i starts at a + i * lda.
+	 * @param lda Leading dimension.
+	 * @param n Order of the block.
+	 */
+	template <typename T>
+	void transposeSquareInPlace(T *a, std::size_t lda, int n)
+	{
+		constexpr int TILE = detail::TRANSPOSE_TILE;
+		const int tiles = (n + TILE - 1) / TILE;
+		parallelFor(0, tiles, grainFor(static_cast<std::size_t>(TILE) * n), [&](std::size_t lo, std::size_t hi)
+					{
+						for (int bi = static_cast<int>(lo) * TILE; bi < std::min(n, static_cast<int>(hi) * TILE); bi += TILE)
+						{
+							const int iEnd = std::min(n, bi + TILE);
+							// Diagonal tile
+							for (int i = bi; i < iEnd; i++)
+							{
+								for (int j = i + 1; j < iEnd; j++)
+								{
+									std::swap(a[i * lda + j], a[j * lda + i]);
+								}
+							}
+							// Tile (bi, bj) trades places with tile (bj, bi)
+							for (int bj = iEnd; bj < n; bj += TILE)
+							{
+								const int jEnd = std::min(n, bj + TILE);
+								for (int i = bi; i < iEnd; i++)
+								{
+									for (int j = bj; j < jEnd; j++)
+									{
+										std::swap(a[i * lda + j], a[j * lda + i]);
+									}
+								}
+							}
+						} });
+	}
+
+	/**
+	 * @brief Transposes a contiguous rows x cols matrix in place by following permutation cycles.
+	 *
+	 * Element k = i * cols + j moves to j * rows + i = k * rows mod (rows * cols - 1). Each cycle
+	 * is walked once, with one bit per element marking the positions already placed.
+	 *
+	 * @param a The matrix, rows * cols contiguous elements in row-major order.
+	 * @param rows Number of rows before the transpose.
+	 * @param cols Number of columns before the transpose.
+	 */
+	template <typename T>
+	void transposeCycleInPlace(T *a, int rows, int cols)
+	{
+		const std::size_t n = static_cast<std::size_t>(rows) * cols;
+		if (n < 3 || rows == 1 || cols == 1)
+		{
+			return;
+		}
+		const std::size_t modulus = n - 1;
+		std::vector<bool> placed(n, false);
+		for (std::size_t start = 1; start < modulus; start++)
+		{
+			if (placed[start])
+			{
+				continue;
+			}
+			T carried = std::move(a[start]);
+			std::size_t current = start;
+			do
+			{
+				std::size_t next = (current * rows) % modulus;
+				std::swap(carried, a[next]);
+				placed[next] = true;
+				current = next;
+			} while (current != start);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+/*
+ * Minimal assertions for the ctest executables: a failed check prints its location and the
+ * test keeps going; main() returns mgtest::result() so ctest sees the failure.
+ */
+
+namespace mgtest
+{
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void fail(const char *file, int line, const char *expression)
+    {
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        failures()++;
+    }
+
+    inline bool near(double a, double b, double tolerance)
+    {
+        return std::abs(a - b) <= tolerance * (1.0 + std::abs(b));
+    }
+
+    inline int result()
+    {
+        if (failures() != 0)
+        {
+            std::cerr << failures() << " check(s) failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+}
+
+#define MG_CHECK(...)                                         \
+    do                                                        \
+    {                                                         \
+        if (!(__VA_ARGS__))                                   \
+        {                                                     \
+            mgtest::fail(__FILE__, __LINE__, #__VA_ARGS__);   \
+        }                                                     \
+    } while (false)
+
+#define MG_CHECK_NEAR(a, b, tolerance) MG_CHECK(mgtest::near((a), (b), (tolerance)))
+
+#define MG_CHECK_THROWS(expression, exception)                \
+    do                                                        \
+    {                                                         \
+        bool thrown = false;                                  \
+        try                                                   \
+        {                                                     \
+            (void)(expression);                               \
+        }                                                     \
+        catch (const exception &)                             \
+        {                                                     \
+            thrown = true;                                    \
+        }                                                     \
+        if (!thrown)                                          \
+        {                                                     \
+            mgtest::fail(__FILE__, __LINE__, #expression " throws " #exception); \
+        }                                                     \
+    } while (false)
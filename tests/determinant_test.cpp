@@ -0,0 +1,164 @@
+#include "../inc/matrixbatch.hpp"
+#include "../inc/mixedprecision.hpp"
+#include "../inc/squarematrix.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/*
+ * Exact integer determinants (Bareiss elimination) on matrices whose determinant is known by
+ * construction: P * U * L with unit triangular U and L has determinant sign(P). Batches must
+ * agree with the single-matrix routine lane by lane.
+ */
+
+namespace
+{
+    struct Unimodular
+    {
+        mg::Matrix<long long> matrix;
+        int det;
+    };
+
+    // Row-permuted U * L with entries of U and L in {-1, 0, 1}; rows shuffled or reversed
+    Unimodular unimodular(int n, bool shuffle, std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<int> value(-1, 1);
+        mg::Matrix<long long> u(n, n, 0), l(n, n, 0);
+        for (int i = 0; i < n; i++)
+        {
+            u(i, i) = 1;
+            l(i, i) = 1;
+            for (int j = 0; j < i; j++)
+            {
+                l(i, j) = value(rng);
+                u(j, i) = value(rng);
+            }
+        }
+        const mg::Matrix<long long> product = u * l;
+
+        std::vector<int> permutation(n);
+        for (int i = 0; i < n; i++)
+        {
+            permutation[i] = shuffle ? i : n - 1 - i;
+        }
+        if (shuffle)
+        {
+            std::shuffle(permutation.begin(), permutation.end(), rng);
+        }
+        Unimodular result{mg::Matrix<long long>(n, n), 1};
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                result.matrix(i, j) = product(permutation[i], j);
+            }
+        }
+        std::vector<bool> seen(n, false);
+        for (int i = 0; i < n; i++)
+        {
+            int length = 0;
+            for (int j = i; !seen[j]; j = permutation[j], length++)
+            {
+                seen[j] = true;
+            }
+            result.det *= length > 0 && length % 2 == 0 ? -1 : 1;
+        }
+        return result;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(40);
+
+    // Entries up to about 13 in magnitude, and products of minors that overflow 64 bits
+    for (int trial = 0; trial < 6; trial++)
+    {
+        const int n = trial == 0 ? 40 : 30;
+        const Unimodular a = unimodular(n, trial != 0, rng);
+        MG_CHECK(mg::determinantBareiss(a.matrix) == a.det);
+        MG_CHECK(mg::SquareMatrix<long long>(a.matrix).determinant() == a.det);
+
+        mg::Matrix<int> narrow(n, n);
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                narrow(i, j) = static_cast<int>(a.matrix(i, j));
+            }
+        }
+        MG_CHECK(mg::determinantBareiss(narrow) == a.det);
+    }
+
+    // Minors that do not fit in 64 bits are reported, not wrapped around
+    MG_CHECK_THROWS(mg::determinantBareiss(unimodular(200, false, rng).matrix), std::overflow_error);
+
+    // The determinant must fit the element type too
+    const mg::Matrix<int> large({{100000, 1}, {1, 100000}});
+    MG_CHECK_THROWS(mg::determinantBareiss(large), std::overflow_error);
+    MG_CHECK(mg::determinantBareiss(mg::Matrix<long long>({{100000, 1}, {1, 100000}})) == 9999999999LL);
+
+    // So must a triangular one's, which skips elimination
+    const mg::SquareMatrix<int> diagonal({{100000, 1, 0}, {0, 100000, 0}, {0, 0, 100000}});
+    MG_CHECK_THROWS(diagonal.determinant(), std::overflow_error);
+    MG_CHECK(mg::SquareMatrix<int>({{-46340, 7}, {0, 46340}}).determinant() == -46340 * 46340);
+    MG_CHECK(mg::SquareMatrix<int>({{100000, 0, 0}, {3, 100000, 0}, {1, 2, 0}}).determinant() == 0);
+    const mg::SquareMatrix<long long> wideDiagonal({{3037000500LL, 0}, {0, 3037000500LL}});
+    MG_CHECK_THROWS(wideDiagonal.determinant(), std::overflow_error);
+
+    const mg::Matrix<int> singular({{1, 2, 3}, {2, 4, 6}, {0, 1, 1}});
+    MG_CHECK(mg::determinantBareiss(singular) == 0);
+    MG_CHECK(mg::determinantBareiss(mg::Matrix<int>({{0, 1}, {1, 0}})) == -1);
+
+    // Batches: small entries stay on the lane-parallel path, unimodular ones leave it
+    std::uniform_int_distribution<int> value(-20, 20);
+    std::vector<mg::Matrix<long long>> small;
+    for (int b = 0; b < 19; b++)
+    {
+        mg::Matrix<long long> m(5, 5);
+        for (int i = 0; i < 5; i++)
+        {
+            for (int j = 0; j < 5; j++)
+            {
+                m(i, j) = b % 5 == 0 && i == 3 ? m(1, j) * 2 : value(rng);
+            }
+        }
+        small.push_back(m);
+    }
+    const std::vector<long long> smallDets = mg::MatrixBatch<long long>(small).determinants();
+    MG_CHECK(smallDets.size() == small.size());
+    for (std::size_t b = 0; b < small.size(); b++)
+    {
+        MG_CHECK(smallDets[b] == mg::determinantBareiss(small[b]));
+    }
+
+    std::vector<mg::Matrix<long long>> wide;
+    std::vector<int> wideDets;
+    for (int b = 0; b < 10; b++)
+    {
+        const Unimodular a = unimodular(30, true, rng);
+        wide.push_back(a.matrix);
+        wideDets.push_back(a.det);
+    }
+    const std::vector<long long> batchDets = mg::MatrixBatch<long long>(wide).determinants();
+    for (std::size_t b = 0; b < wide.size(); b++)
+    {
+        MG_CHECK(batchDets[b] == wideDets[b]);
+    }
+    std::vector<mg::Matrix<int>> narrowWide;
+    for (const mg::Matrix<long long> &m : wide)
+    {
+        narrowWide.push_back(mg::convertMatrix<int>(m));
+    }
+    const std::vector<int> narrowDets = mg::MatrixBatch<int>(narrowWide).determinants();
+    for (std::size_t b = 0; b < wide.size(); b++)
+    {
+        MG_CHECK(narrowDets[b] == wideDets[b]);
+    }
+
+    MG_CHECK_THROWS(mg::MatrixBatch<long long>(std::vector<mg::Matrix<long long>>(3, unimodular(200, false, rng).matrix)).determinants(), std::overflow_error);
+    MG_CHECK_THROWS(mg::MatrixBatch<int>(std::vector<mg::Matrix<int>>(2, large)).determinants(), std::overflow_error);
+
+    return mgtest::result();
+}
@@ -0,0 +1,154 @@
+#include "../inc/fixedmatrix.hpp"
+#include "check.hpp"
+#include <random>
+#include <vector>
+
+/*
+ * FixedMatrix against cofactor-expansion determinants and triple-loop products, for every
+ * closed-form size (1 to 4) and the run-time fallbacks above it.
+ */
+
+namespace
+{
+    // Laplace expansion along the first row; exact for integers, fine for n <= 6
+    template <typename T>
+    T naiveDeterminant(const std::vector<std::vector<T>> &a)
+    {
+        const int n = static_cast<int>(a.size());
+        if (n == 1)
+        {
+            return a[0][0];
+        }
+        T result = T(0);
+        for (int j = 0; j < n; j++)
+        {
+            std::vector<std::vector<T>> minor;
+            for (int i = 1; i < n; i++)
+            {
+                std::vector<T> row;
+                for (int k = 0; k < n; k++)
+                {
+                    if (k != j)
+                    {
+                        row.push_back(a[i][k]);
+                    }
+                }
+                minor.push_back(row);
+            }
+            const T term = a[0][j] * naiveDeterminant(minor);
+            result += j % 2 == 0 ? term : -term;
+        }
+        return result;
+    }
+
+    template <typename T, int R, int C>
+    mg::FixedMatrix<T, R, C> randomFixed(std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<int> value(-9, 9);
+        mg::FixedMatrix<T, R, C> m;
+        for (int i = 0; i < R; i++)
+        {
+            for (int j = 0; j < C; j++)
+            {
+                m(i, j) = T(value(rng));
+            }
+        }
+        return m;
+    }
+
+    template <typename T, int N>
+    std::vector<std::vector<T>> rowsOf(const mg::FixedMatrix<T, N, N> &m)
+    {
+        std::vector<std::vector<T>> rows(N, std::vector<T>(N));
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+            {
+                rows[i][j] = m(i, j);
+            }
+        }
+        return rows;
+    }
+
+    template <typename T, int R, int K, int C>
+    void checkProduct(std::mt19937 &rng)
+    {
+        const auto a = randomFixed<T, R, K>(rng);
+        const auto b = randomFixed<T, K, C>(rng);
+        const mg::FixedMatrix<T, R, C> c = a * b;
+        for (int i = 0; i < R; i++)
+        {
+            for (int j = 0; j < C; j++)
+            {
+                T expected = T(0);
+                for (int k = 0; k < K; k++)
+                {
+                    expected += a(i, k) * b(k, j);
+                }
+                MG_CHECK(c(i, j) == expected);
+            }
+        }
+        MG_CHECK(mg::FixedMatrix<T, R, C>(a.toMatrix() * b.toMatrix()) == c);
+        MG_CHECK(a.transpose().transpose() == a);
+    }
+
+    template <int N>
+    void checkSquare(std::mt19937 &rng)
+    {
+        for (int trial = 0; trial < 20; trial++)
+        {
+            const auto exact = randomFixed<long long, N, N>(rng);
+            MG_CHECK(exact.determinant() == naiveDeterminant(rowsOf(exact)));
+
+            mg::FixedMatrix<double, N, N> real;
+            for (int i = 0; i < N; i++)
+            {
+                for (int j = 0; j < N; j++)
+                {
+                    real(i, j) = static_cast<double>(exact(i, j));
+                }
+            }
+            const double det = real.determinant();
+            MG_CHECK_NEAR(det, naiveDeterminant(rowsOf(real)), 1e-9);
+            if (std::abs(det) < 1e-6)
+            {
+                continue;
+            }
+            const mg::FixedMatrix<double, N, N> identity = real * real.inverse();
+            for (int i = 0; i < N; i++)
+            {
+                for (int j = 0; j < N; j++)
+                {
+                    MG_CHECK(std::abs(identity(i, j) - (i == j ? 1.0 : 0.0)) < 1e-9);
+                }
+            }
+        }
+        checkProduct<int, N, N, N>(rng);
+        checkProduct<double, N, N + 1, N + 2>(rng);
+    }
+
+    constexpr mg::FixedMatrix<int, 3, 3> compileTime({{2, 0, 1}, {1, 3, 0}, {0, 1, 4}});
+    static_assert(compileTime.determinant() == 25, "3x3 determinant is constexpr");
+    static_assert((compileTime * mg::FixedMatrix<int, 3, 3>::identity()) == compileTime, "Product is constexpr");
+}
+
+int main()
+{
+    std::mt19937 rng(2024);
+    checkSquare<1>(rng);
+    checkSquare<2>(rng);
+    checkSquare<3>(rng);
+    checkSquare<4>(rng);
+    checkSquare<5>(rng);
+    checkSquare<6>(rng);
+
+    const mg::Matrix<float> dynamic(2, 3, 1.5f);
+    const mg::FixedMatrix<float, 2, 3> converted(dynamic);
+    MG_CHECK(converted == (mg::FixedMatrix<float, 2, 3>(1.5f)));
+    MG_CHECK_THROWS((mg::FixedMatrix<float, 3, 2>(dynamic)), std::invalid_argument);
+
+    mg::FixedMatrix<double, 2, 2> singular({{1.0, 2.0}, {2.0, 4.0}});
+    MG_CHECK_THROWS(singular.inverse(), std::runtime_error);
+
+    return mgtest::result();
+}
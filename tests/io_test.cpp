@@ -0,0 +1,90 @@
+#include "../inc/matrixio.hpp"
+#include "../inc/textio.hpp"
+#include "check.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * File round trips: every overload of the writers accepts matrices, mutable views and
+ * read-only views, and reading back gives the same elements.
+ */
+
+namespace
+{
+    // A header followed by zero bytes up to its data offset and then `payload` more
+    void writeFile(const std::string &path, const mg::MatrixFileHeader &header, std::size_t payload)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        const std::vector<char> zeros(header.dataOffset - sizeof(header) + payload, 0);
+        file.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+    }
+}
+
+int main()
+{
+    const std::string path = "io_test.bin";
+    mg::Matrix<double> m(13, 17);
+    for (int i = 0; i < m.getRows(); i++)
+    {
+        for (int j = 0; j < m.getCols(); j++)
+        {
+            m(i, j) = i * 100.0 + j / 8.0;
+        }
+    }
+    const mg::Matrix<double> &constant = m;
+
+    m.save(path);
+    MG_CHECK(mg::loadMatrix<double>(path) == m);
+    mg::saveMatrix(m, path);
+    MG_CHECK(mg::loadMatrix<double>(path) == m);
+    mg::saveMatrix(m.view(), path);
+    MG_CHECK(mg::loadMatrix<double>(path) == m);
+    mg::saveMatrix(constant.view(), path);
+    MG_CHECK(mg::loadMatrix<double>(path) == m);
+    MG_CHECK(mg::Matrix<double>(mg::mapMatrix<double>(path)) == m);
+
+    // A strided block is written compactly
+    mg::saveMatrix<double>(m.block(2, 3, 5, 7), path);
+    MG_CHECK(mg::loadMatrix<double>(path) == mg::Matrix<double>(m.block(2, 3, 5, 7)));
+    MG_CHECK_THROWS(mg::loadMatrix<float>(path), std::runtime_error);
+
+    // Crafted headers: a byte count that wraps around 2^64, and a misaligned data offset
+    mg::MatrixFileHeader header = mg::detail::makeHeader<double>(2, 3);
+    header.rows = (1ULL << 30) + 2;
+    header.stride = (1ULL << 31) - 2;
+    writeFile(path, header, 8);
+    MG_CHECK_THROWS(mg::loadMatrix<double>(path), std::runtime_error);
+    MG_CHECK_THROWS(mg::mapMatrix<double>(path), std::runtime_error);
+    header = mg::detail::makeHeader<double>(1, 1);
+    header.alignment = 4;
+    header.dataOffset = 68;
+    writeFile(path, header, 16);
+    MG_CHECK_THROWS(mg::loadMatrix<double>(path), std::runtime_error);
+    MG_CHECK_THROWS(mg::mapMatrix<double>(path), std::runtime_error);
+    std::remove(path.c_str());
+
+    // Text: eighths are exact in decimal, so the shortest round trip gives the same doubles
+    const std::string text = mg::formatText(m);
+    MG_CHECK(mg::formatText(m.view()) == text);
+    MG_CHECK(mg::formatText(constant.view()) == text);
+    MG_CHECK(mg::parseText<double>(text) == m);
+    std::ostringstream os;
+    mg::writeText(os, m, mg::TextFormat::csv());
+    MG_CHECK(os.str() == mg::formatText(m.view(), mg::TextFormat::csv()));
+    MG_CHECK(mg::parseText<double>(os.str(), mg::TextFormat::csv()) == m);
+
+    const std::string csv = "io_test.csv";
+    mg::saveText(m, csv);
+    MG_CHECK(mg::loadText<double>(csv) == m);
+    mg::saveText(m.view(), csv, mg::TextFormat::tsv());
+    MG_CHECK(mg::loadText<double>(csv, mg::TextFormat::tsv()) == m);
+    mg::saveText(constant.view(), csv);
+    MG_CHECK(mg::loadText<double>(csv, mg::TextFormat::csv()) == m);
+    std::remove(csv.c_str());
+
+    return mgtest::result();
+}
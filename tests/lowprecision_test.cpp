@@ -0,0 +1,181 @@
+#include "../inc/lowprecision.hpp"
+#include "check.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+/*
+ * 16-bit floating-point conversions (round to nearest even at ties, subnormals, infinities
+ * and NaN), saturating narrow(), and widenedGemm() against products summed in 32 bits and
+ * rounded or saturated once.
+ */
+
+namespace
+{
+    float bits(std::uint32_t pattern)
+    {
+        return mg::detail::bitsFloat(pattern);
+    }
+
+    std::uint16_t halfBits(float f)
+    {
+        return mg::half(f).bits;
+    }
+
+    std::uint16_t bfloatBits(float f)
+    {
+        return mg::bfloat16(f).bits;
+    }
+
+    // Hides a constant from the optimizer, which would otherwise fold out-of-range conversions
+    template <typename T>
+    T opaque(T value)
+    {
+        volatile T hidden = value;
+        return hidden;
+    }
+
+    template <typename T, typename Acc>
+    void checkWidenedGemm(int m, int n, int k, int low, int high, bool accumulate)
+    {
+        std::mt19937 rng(m + n + k);
+        std::uniform_int_distribution<int> value(low, high);
+        std::vector<T> a(static_cast<std::size_t>(m) * k), b(static_cast<std::size_t>(k) * n), c(static_cast<std::size_t>(m) * n);
+        for (T &x : a)
+        {
+            x = static_cast<T>(value(rng));
+        }
+        for (T &x : b)
+        {
+            x = static_cast<T>(value(rng));
+        }
+        for (T &x : c)
+        {
+            x = static_cast<T>(value(rng));
+        }
+
+        // Small integers: every sum is exact in Acc, so only the final rounding can differ
+        std::vector<T> expected(c.size());
+        for (int i = 0; i < m; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                Acc sum = accumulate ? static_cast<Acc>(c[static_cast<std::size_t>(i) * n + j]) : Acc();
+                for (int p = 0; p < k; p++)
+                {
+                    sum += static_cast<Acc>(a[static_cast<std::size_t>(i) * k + p]) * static_cast<Acc>(b[static_cast<std::size_t>(p) * n + j]);
+                }
+                expected[static_cast<std::size_t>(i) * n + j] = mg::narrow<T>(sum);
+            }
+        }
+        mg::detail::widenedGemm<Acc>(m, n, k, a.data(), k, b.data(), n, c.data(), n, accumulate);
+        bool same = true;
+        for (std::size_t e = 0; e < c.size(); e++)
+        {
+            same &= std::memcmp(&c[e], &expected[e], sizeof(T)) == 0;
+        }
+        MG_CHECK(same);
+    }
+}
+
+int main()
+{
+    // Every half widens exactly and rounds back to itself; NaNs stay NaN
+    bool roundTrip = true;
+    for (std::uint32_t h = 0; h <= 0xFFFFu; h++)
+    {
+        const float f = mg::half::fromBits(static_cast<std::uint16_t>(h));
+        roundTrip &= std::isnan(f) ? (h & 0x7C00u) == 0x7C00u && (h & 0x03FFu) != 0 && std::isnan(static_cast<float>(mg::half(f)))
+                                   : halfBits(f) == h;
+    }
+    MG_CHECK(roundTrip);
+
+    // half ties round to even, in the normal and the subnormal range
+    MG_CHECK(halfBits(1.0f + std::ldexp(1.0f, -11)) == 0x3C00u);
+    MG_CHECK(halfBits(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3C02u);
+    MG_CHECK(halfBits(std::nextafter(1.0f + std::ldexp(1.0f, -11), 2.0f)) == 0x3C01u);
+    MG_CHECK(halfBits(-(1.0f + std::ldexp(1.0f, -11))) == 0xBC00u);
+    MG_CHECK(halfBits(std::ldexp(1.0f, -24)) == 0x0001u);
+    MG_CHECK(halfBits(std::ldexp(1.0f, -25)) == 0x0000u);
+    MG_CHECK(halfBits(std::nextafter(std::ldexp(1.0f, -25), 1.0f)) == 0x0001u);
+    MG_CHECK(halfBits(3 * std::ldexp(1.0f, -25)) == 0x0002u);
+    MG_CHECK(halfBits(-std::ldexp(1.0f, -26)) == 0x8000u);
+    MG_CHECK(halfBits(std::ldexp(1023.5f, -24)) == 0x0400u); // Largest subnormal rounds up to the smallest normal
+    MG_CHECK(static_cast<float>(mg::half::fromBits(0x03FFu)) == std::ldexp(1023.0f, -24));
+
+    // Overflow: 65504 is the largest half, and the tie above it rounds to infinity
+    MG_CHECK(halfBits(65504.0f) == 0x7BFFu);
+    MG_CHECK(halfBits(65519.0f) == 0x7BFFu);
+    MG_CHECK(halfBits(65520.0f) == 0x7C00u);
+    MG_CHECK(halfBits(-1e10f) == 0xFC00u);
+    MG_CHECK(halfBits(std::numeric_limits<float>::infinity()) == 0x7C00u);
+    MG_CHECK(halfBits(-std::numeric_limits<float>::infinity()) == 0xFC00u);
+    MG_CHECK(std::isnan(static_cast<float>(mg::half(std::numeric_limits<float>::quiet_NaN()))));
+    MG_CHECK(std::isnan(static_cast<float>(mg::half(bits(0x7F800001u)))));
+
+    // The F16C path, where compiled in, rounds exactly like the scalar one
+    std::mt19937 rng(20);
+    std::vector<float> floats(4096);
+    std::uniform_int_distribution<std::uint32_t> exponent(100, 145), mantissa(0, 0x7FFFFFu), sign(0, 1);
+    for (float &f : floats)
+    {
+        // 2^-27 to 2^18: half subnormals, normals and overflow; every other value a normal-range tie
+        const bool tie = sign(rng) != 0;
+        const std::uint32_t low = tie ? (mantissa(rng) & 0x7FE000u) | 0x1000u : mantissa(rng);
+        const std::uint32_t high = (sign(rng) << 31) | (exponent(rng) << 23);
+        f = bits(high | low);
+    }
+    std::vector<mg::half> halves(floats.size());
+    mg::detail::convertElements(floats.data(), halves.data(), floats.size());
+    bool sameAsScalar = true;
+    for (std::size_t i = 0; i < floats.size(); i++)
+    {
+        sameAsScalar &= halves[i].bits == mg::detail::floatToHalf(floats[i]);
+    }
+    MG_CHECK(sameAsScalar);
+
+    // bfloat16 keeps the float exponent: ties to even, subnormals, infinities and NaN
+    MG_CHECK(bfloatBits(1.0f + std::ldexp(1.0f, -8)) == 0x3F80u);
+    MG_CHECK(bfloatBits(1.0f + 3 * std::ldexp(1.0f, -8)) == 0x3F82u);
+    MG_CHECK(bfloatBits(std::nextafter(1.0f + std::ldexp(1.0f, -8), 2.0f)) == 0x3F81u);
+    MG_CHECK(bfloatBits(bits(0x00010000u)) == 0x0001u);
+    MG_CHECK(bfloatBits(bits(0x00008000u)) == 0x0000u);
+    MG_CHECK(bfloatBits(bits(0x00018000u)) == 0x0002u);
+    MG_CHECK(bfloatBits(std::numeric_limits<float>::max()) == 0x7F80u);
+    MG_CHECK(bfloatBits(-std::numeric_limits<float>::infinity()) == 0xFF80u);
+    MG_CHECK(std::isnan(static_cast<float>(mg::bfloat16(bits(0x7F800001u)))));
+    MG_CHECK(std::isnan(static_cast<float>(mg::bfloat16(bits(0xFFFFFFFFu)))));
+    MG_CHECK(static_cast<float>(mg::bfloat16(0.15625f)) == 0.15625f);
+
+    // narrow() saturates at the limits of the target, truncates toward zero, and maps NaN to 0
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(127.0f)) == 127 && mg::narrow<std::int8_t>(opaque(127.9f)) == 127);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(128.0f)) == 127 && mg::narrow<std::int8_t>(opaque(1e30)) == 127);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(-128.0f)) == -128 && mg::narrow<std::int8_t>(opaque(-128.9)) == -128);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(-129.0f)) == -128 && mg::narrow<std::int8_t>(opaque(-1e30f)) == -128);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(3.9f)) == 3 && mg::narrow<std::int8_t>(opaque(-3.9f)) == -3);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(std::numeric_limits<float>::infinity())) == 127);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(-std::numeric_limits<double>::infinity())) == -128);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(std::numeric_limits<float>::quiet_NaN())) == 0);
+    MG_CHECK(mg::narrow<std::int32_t>(opaque(-std::numeric_limits<double>::quiet_NaN())) == 0);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(300)) == 127 && mg::narrow<std::int8_t>(opaque(-300)) == -128);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(127)) == 127 && mg::narrow<std::int8_t>(opaque(-128)) == -128);
+    MG_CHECK(mg::narrow<std::int8_t>(opaque(200u)) == 127 && mg::narrow<std::uint8_t>(opaque(-5)) == 0);
+    MG_CHECK(mg::narrow<std::uint8_t>(opaque(255)) == 255 && mg::narrow<std::uint8_t>(opaque(256)) == 255);
+    MG_CHECK(mg::narrow<std::int32_t>(opaque(1LL << 40)) == std::numeric_limits<std::int32_t>::max());
+    MG_CHECK(mg::narrow<std::int32_t>(opaque(-(1LL << 40))) == std::numeric_limits<std::int32_t>::lowest());
+    MG_CHECK(mg::narrow<std::int8_t>(mg::half(opaque(200.0f))) == 127 && mg::narrow<std::int8_t>(mg::bfloat16(opaque(-1e10f))) == -128);
+    MG_CHECK(mg::narrow<mg::half>(1e6).bits == 0x7C00u && mg::narrow<mg::bfloat16>(1).bits == 0x3F80u);
+
+    // Sums far outside int8 saturate only once, at the end; row and depth blocks are ragged
+    checkWidenedGemm<std::int8_t, std::int32_t>(600, 37, 300, -128, 127, false);
+    checkWidenedGemm<std::int8_t, std::int32_t>(45, 70, 513, -128, 127, true);
+    checkWidenedGemm<std::int8_t, std::int32_t>(30, 20, 40, -3, 3, true);
+    checkWidenedGemm<mg::half, float>(530, 33, 260, -8, 8, false);
+    checkWidenedGemm<mg::half, float>(40, 50, 70, -8, 8, true);
+    checkWidenedGemm<mg::bfloat16, float>(520, 30, 270, -4, 4, true);
+
+    return mgtest::result();
+}
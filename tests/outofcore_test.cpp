@@ -0,0 +1,91 @@
+#include "../inc/outofcore.hpp"
+#include "check.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+
+/*
+ * outOfCoreMultiply() against a triple-loop product, with budgets small enough that the
+ * operands and result are split into many ragged tiles.
+ */
+
+namespace
+{
+    template <typename T>
+    mg::Matrix<T> randomMatrix(int rows, int cols, std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<int> value(-9, 9);
+        mg::Matrix<T> m(rows, cols);
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                m(i, j) = T(value(rng));
+            }
+        }
+        return m;
+    }
+
+    template <typename T>
+    mg::Matrix<T> naiveMultiply(const mg::Matrix<T> &a, const mg::Matrix<T> &b)
+    {
+        mg::Matrix<T> c(a.getRows(), b.getCols(), T(0));
+        for (int i = 0; i < a.getRows(); i++)
+        {
+            for (int k = 0; k < a.getCols(); k++)
+            {
+                for (int j = 0; j < b.getCols(); j++)
+                {
+                    c(i, j) += a(i, k) * b(k, j);
+                }
+            }
+        }
+        return c;
+    }
+
+    template <typename T>
+    void checkMultiply(int m, int k, int n, std::size_t budget, std::mt19937 &rng)
+    {
+        const std::string lhs = "outofcore_test_a.bin";
+        const std::string rhs = "outofcore_test_b.bin";
+        const std::string out = "outofcore_test_c.bin";
+        const mg::Matrix<T> a = randomMatrix<T>(m, k, rng);
+        const mg::Matrix<T> b = randomMatrix<T>(k, n, rng);
+        const mg::Matrix<T> expected = naiveMultiply(a, b);
+
+        // In-memory operands
+        mg::outOfCoreMultiply<T>(a.view(), b.view(), out, budget);
+        mg::Matrix<T> c = mg::loadMatrix<T>(out);
+        MG_CHECK(c.getRows() == m && c.getCols() == n);
+        MG_CHECK(c == expected);
+
+        // File operands, mapped rather than loaded
+        mg::saveMatrix<T>(a.view(), lhs);
+        mg::saveMatrix<T>(b.view(), rhs);
+        mg::outOfCoreMultiply<T>(lhs, rhs, out, budget);
+        c = mg::loadMatrix<T>(out);
+        MG_CHECK(c == expected);
+
+        std::remove(lhs.c_str());
+        std::remove(rhs.c_str());
+        std::remove(out.c_str());
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(7);
+    // Tile orders 1, 4 and 13, against dimensions that are not multiples of them
+    checkMultiply<int>(5, 7, 3, 6 * sizeof(int), rng);
+    checkMultiply<int>(37, 29, 41, 6 * 16 * sizeof(int), rng);
+    checkMultiply<double>(70, 45, 33, 6 * 169 * sizeof(double), rng);
+    // One tile holds everything
+    checkMultiply<double>(20, 20, 20, mg::OUT_OF_CORE_DEFAULT_BUDGET, rng);
+
+    const mg::Matrix<int> a(3, 4, 1), b(5, 2, 1);
+    MG_CHECK_THROWS(mg::outOfCoreMultiply<int>(a.view(), b.view(), "outofcore_test_c.bin"), std::invalid_argument);
+    MG_CHECK_THROWS(mg::outOfCoreMultiply<int>(a.view(), mg::Matrix<int>(4, 3, 1).view(), "outofcore_test_c.bin", sizeof(int)), std::invalid_argument);
+    std::remove("outofcore_test_c.bin");
+
+    return mgtest::result();
+}
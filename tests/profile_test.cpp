@@ -0,0 +1,76 @@
+#include "../inc/matrix.hpp"
+#include "../inc/structuredmatrix.hpp"
+#include "check.hpp"
+#include <thread>
+
+/*
+ * Built with MG_PROFILE=1 whatever the CMake option says: every expression shape must still
+ * compile with the hooks in, and be charged to the right operation.
+ */
+
+namespace
+{
+    std::uint64_t calls(mg::profile::Op op)
+    {
+        for (const mg::profile::OpStats &stats : mg::profile::snapshot())
+        {
+            if (stats.op == op)
+            {
+                return stats.calls;
+            }
+        }
+        return 0;
+    }
+}
+
+int main()
+{
+    static_assert(mg::PROFILE, "profile_test must be built with MG_PROFILE=1");
+    using mg::profile::Op;
+
+    const mg::Matrix<double> a(8, 8, 1.0), b(8, 8, 2.0);
+    mg::profile::reset();
+
+    mg::Matrix<double> sum = a + b;
+    MG_CHECK(calls(Op::Add) == 1);
+    mg::Matrix<double> difference = a - b;
+    MG_CHECK(calls(Op::Subtract) == 1);
+    mg::Matrix<double> scaled = a * 3.0;
+    MG_CHECK(calls(Op::Scale) == 1);
+    mg::Matrix<double> product = a * b;
+    MG_CHECK(calls(Op::Multiply) == 1);
+    mg::Matrix<double> transposed = a.transpose();
+    MG_CHECK(calls(Op::Transpose) == 1);
+
+    // Nodes without an op_type: transposed and nested expressions
+    const std::uint64_t elementwise = calls(Op::Elementwise);
+    mg::Matrix<double> x = (a + b).transpose();
+    mg::Matrix<double> y = (a + b) * 2.0 - a;
+    MG_CHECK(calls(Op::Elementwise) == elementwise + 2);
+    MG_CHECK(x(0, 0) == 3.0 && y(0, 0) == 5.0);
+
+    // Structured matrices densify through the same evaluation path
+    const mg::Matrix<double> diagonal = mg::DiagonalMatrix<double>(8, 2.0);
+    const mg::Matrix<double> lower = mg::TriangularMatrix<double>(8, mg::Triangle::Lower, 1.0);
+    const mg::Matrix<double> symmetric = mg::SymmetricMatrix<double>(a);
+    const mg::Matrix<double> banded = mg::BandedMatrix<double>(8, 1, 1, 1.0);
+    MG_CHECK(calls(Op::Elementwise) == elementwise + 6);
+    MG_CHECK(diagonal(1, 1) == 2.0 && lower(0, 1) == 0.0 && symmetric(0, 7) == 1.0 && banded(0, 2) == 0.0);
+
+    sum += a;
+    difference -= a;
+    MG_CHECK(calls(Op::Add) == 2);
+    MG_CHECK(calls(Op::Subtract) == 2);
+    MG_CHECK(sum(0, 0) == 4.0 && difference(0, 0) == -2.0 && scaled(0, 0) == 3.0 && product(0, 0) == 16.0 && transposed(0, 0) == 1.0);
+
+    // Short-lived threads reuse the counters of the ones that exited, and their calls still count
+    const std::size_t profiles = mg::profile::detail::registry().threads.size();
+    for (int t = 0; t < 100; t++)
+    {
+        std::thread([&] { mg::Matrix<double> c = a + b; }).join();
+    }
+    MG_CHECK(calls(Op::Add) == 102);
+    MG_CHECK(mg::profile::detail::registry().threads.size() <= profiles + 1);
+
+    return mgtest::result();
+}
@@ -0,0 +1,84 @@
+#include "../inc/matrix.hpp"
+#include "check.hpp"
+
+/*
+ * Reproducible fills: every element type stays in range, and long double fills are the double
+ * fills widened (their bit-level kernels only exist for float and double).
+ */
+
+namespace
+{
+    template <typename T>
+    void checkUniform(T low, T high)
+    {
+        mg::Matrix<T> a(61, 67), b(61, 67);
+        mg::fillUniform(a.view(), low, high, 42);
+        mg::fillUniform(b.view(), low, high, 42);
+        MG_CHECK(a == b);
+        double sum = 0;
+        for (int i = 0; i < a.getRows(); i++)
+        {
+            for (int j = 0; j < a.getCols(); j++)
+            {
+                MG_CHECK(a(i, j) >= low && a(i, j) <= high);
+                MG_CHECK(std::is_integral<T>::value || a(i, j) < high);
+                sum += static_cast<double>(a(i, j));
+            }
+        }
+        const double mean = sum / (a.getRows() * a.getCols());
+        MG_CHECK(std::abs(mean - (static_cast<double>(low) + static_cast<double>(high)) / 2) < 0.05 * (static_cast<double>(high) - static_cast<double>(low)));
+    }
+
+    template <typename T>
+    void checkNormal(T mean, T stddev)
+    {
+        mg::Matrix<T> a(61, 67);
+        mg::fillNormal(a.view(), mean, stddev, 7);
+        double sum = 0, squares = 0;
+        for (int i = 0; i < a.getRows(); i++)
+        {
+            for (int j = 0; j < a.getCols(); j++)
+            {
+                const double x = static_cast<double>(a(i, j));
+                MG_CHECK(std::isfinite(x));
+                sum += x;
+                squares += x * x;
+            }
+        }
+        const double count = a.getRows() * a.getCols();
+        const double m = sum / count;
+        MG_CHECK(std::abs(m - static_cast<double>(mean)) < 0.05 * static_cast<double>(stddev));
+        MG_CHECK(std::abs(std::sqrt(squares / count - m * m) - static_cast<double>(stddev)) < 0.05 * static_cast<double>(stddev));
+    }
+}
+
+int main()
+{
+    checkUniform<int>(-5, 12);
+    checkUniform<long long>(-3000000000LL, 3000000000LL);
+    checkUniform<float>(-1.0f, 3.0f);
+    checkUniform<double>(2.0, 4.0);
+    checkUniform<long double>(-1.0L, 1.0L);
+    checkNormal<float>(1.0f, 2.0f);
+    checkNormal<double>(-3.0, 0.5);
+    checkNormal<long double>(10.0L, 4.0L);
+
+    // long double is double widened, element for element, from any starting index
+    mg::Matrix<double> d(33, 45);
+    mg::Matrix<long double> ld(33, 45);
+    mg::fillUniform(d.view(), 0.0, 1.0, 5, 1);
+    mg::fillUniform(ld.view(), 0.0L, 1.0L, 5, 1);
+    mg::fillNormal(d.block(1, 3, 30, 40), 0.0, 1.0, 9);
+    mg::fillNormal(ld.block(1, 3, 30, 40), 0.0L, 1.0L, 9);
+    bool widened = true;
+    for (int i = 0; i < d.getRows(); i++)
+    {
+        for (int j = 0; j < d.getCols(); j++)
+        {
+            widened &= ld(i, j) == static_cast<long double>(d(i, j));
+        }
+    }
+    MG_CHECK(widened);
+
+    return mgtest::result();
+}
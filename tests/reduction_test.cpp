@@ -0,0 +1,136 @@
+#include "../inc/reduction.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/*
+ * Reductions: sums are bitwise identical under exec::seq and exec::par and on strided views
+ * (ctest runs this with MG_NUM_THREADS=4, so exec::par fans out even on one CPU); norms,
+ * trace and extrema match naive loops.
+ */
+
+namespace
+{
+    struct Sums
+    {
+        double sum;
+        double dot;
+        std::vector<double> colSums;
+        double frobenius;
+
+        bool operator==(const Sums &other) const
+        {
+            return sum == other.sum && dot == other.dot && colSums == other.colSums && frobenius == other.frobenius;
+        }
+    };
+
+    Sums sums(mg::MatrixView<const double> a, mg::MatrixView<const double> b, mg::exec::Policy policy)
+    {
+        mg::exec::ScopedPolicy scoped(policy);
+        return {mg::sum(a), mg::dot(a, b), mg::colSums(a), mg::frobeniusNorm(a)};
+    }
+
+    template <typename T>
+    void checkNaive(const mg::Matrix<T> &m)
+    {
+        double norm1 = 0, normInf = 0, trace = 0;
+        double low = static_cast<double>(m(0, 0)), high = low;
+        for (int j = 0; j < m.getCols(); j++)
+        {
+            double column = 0;
+            for (int i = 0; i < m.getRows(); i++)
+            {
+                column += std::abs(static_cast<double>(m(i, j)));
+            }
+            norm1 = std::max(norm1, column);
+        }
+        for (int i = 0; i < m.getRows(); i++)
+        {
+            double row = 0;
+            for (int j = 0; j < m.getCols(); j++)
+            {
+                row += std::abs(static_cast<double>(m(i, j)));
+                low = std::min(low, static_cast<double>(m(i, j)));
+                high = std::max(high, static_cast<double>(m(i, j)));
+            }
+            normInf = std::max(normInf, row);
+            trace += i < m.getCols() ? static_cast<double>(m(i, i)) : 0;
+        }
+        // Integer sums are exact in double, so the naive loops must agree exactly
+        MG_CHECK(mg::norm1(m) == norm1);
+        MG_CHECK(mg::normInf(m) == normInf);
+        MG_CHECK(mg::minCoeff(m) == low);
+        MG_CHECK(mg::maxCoeff(m) == high);
+        if (m.getRows() == m.getCols())
+        {
+            MG_CHECK(static_cast<double>(mg::trace(m)) == trace);
+        }
+    }
+}
+
+int main()
+{
+    // Enough rows and columns that every reduction splits into several parallel chunks
+    const int rows = 1037, cols = 711;
+    mg::Matrix<double> padded(rows + 3, cols + 5);
+    mg::fillNormal(padded.view(), 1.0, 3.0, 11);
+    const mg::MatrixView<double> a = padded.block(2, 3, rows, cols);
+    const mg::Matrix<double> compact(a);
+    mg::Matrix<double> b(rows, cols);
+    mg::fillUniform(b.view(), -1.0, 1.0, 12);
+
+    const Sums serial = sums(compact.view(), b.view(), mg::exec::seq);
+    MG_CHECK(sums(compact.view(), b.view(), mg::exec::par) == serial);
+    MG_CHECK(sums(a, b.view(), mg::exec::par) == serial);
+    MG_CHECK(sums(a, b.view(), mg::exec::seq) == serial);
+    double naive = 0;
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            naive += compact(i, j);
+        }
+    }
+    MG_CHECK_NEAR(serial.sum, naive, 1e-9);
+
+    // Mutable views deduce T like matrices do
+    MG_CHECK(mg::sum(a) == serial.sum && mg::sum(padded.block(2, 3, rows, cols)) == serial.sum);
+    MG_CHECK(mg::dot(a, b.view()) == serial.dot);
+    MG_CHECK(mg::colSums(a) == serial.colSums);
+    MG_CHECK(mg::frobeniusNorm(a) == serial.frobenius);
+    MG_CHECK(mg::rowSums(a) == mg::rowSums(compact));
+
+    mg::Matrix<int> integers(301, 301);
+    mg::fillUniform(integers.view(), -1000, 1000, 13);
+    checkNaive(integers);
+    checkNaive(mg::Matrix<int>(integers.block(0, 0, 120, 301)));
+    mg::Matrix<double> wide(40, 9000);
+    mg::fillUniform(wide.view(), -50.0, 50.0, 14);
+    double low = wide(0, 0), high = wide(0, 0);
+    for (int i = 0; i < wide.getRows(); i++)
+    {
+        for (int j = 0; j < wide.getCols(); j++)
+        {
+            low = std::min(low, wide(i, j));
+            high = std::max(high, wide(i, j));
+        }
+    }
+    MG_CHECK(mg::minCoeff(wide) == low);
+    MG_CHECK(mg::maxCoeff(wide.view()) == high);
+
+    // A NaN anywhere makes both extrema NaN, wherever the scan for it happens to start
+    for (const int position : {0, 17, 40 * 9000 - 1})
+    {
+        mg::Matrix<double> poisoned = wide;
+        poisoned(position / 9000, position % 9000) = std::numeric_limits<double>::quiet_NaN();
+        MG_CHECK(std::isnan(mg::minCoeff(poisoned)));
+        MG_CHECK(std::isnan(mg::maxCoeff(poisoned)));
+    }
+    MG_CHECK_THROWS(mg::minCoeff(mg::Matrix<double>(0, 3)), std::invalid_argument);
+    MG_CHECK_THROWS(mg::trace(wide), std::invalid_argument);
+    MG_CHECK(mg::norm1(mg::Matrix<double>(0, 0)) == 0.0 && mg::sum(mg::Matrix<double>(0, 5)) == 0.0);
+
+    return mgtest::result();
+}
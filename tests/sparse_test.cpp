@@ -0,0 +1,174 @@
+#include "../inc/sparsematrix.hpp"
+#include "check.hpp"
+#include <random>
+#include <vector>
+
+/*
+ * SparseMatrix (CSR and CSC) against dense reference arithmetic on the same elements.
+ */
+
+namespace
+{
+    template <typename T>
+    mg::Matrix<T> denseFrom(int rows, int cols, const std::vector<mg::Triplet<T>> &triplets)
+    {
+        mg::Matrix<T> dense(rows, cols, T(0));
+        for (const auto &t : triplets)
+        {
+            dense(t.row, t.col) += t.value;
+        }
+        return dense;
+    }
+
+    template <typename T>
+    std::vector<mg::Triplet<T>> randomTriplets(int rows, int cols, int count, std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<int> row(0, rows - 1);
+        std::uniform_int_distribution<int> col(0, cols - 1);
+        std::uniform_int_distribution<int> value(-9, 9);
+        std::vector<mg::Triplet<T>> triplets;
+        for (int k = 0; k < count; k++)
+        {
+            triplets.push_back({row(rng), col(rng), T(value(rng))});
+        }
+        return triplets;
+    }
+
+    template <typename T>
+    mg::Matrix<T> randomDense(int rows, int cols, std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<int> value(-9, 9);
+        mg::Matrix<T> m(rows, cols);
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                m(i, j) = T(value(rng));
+            }
+        }
+        return m;
+    }
+
+    template <typename T>
+    mg::Matrix<T> naiveMultiply(const mg::Matrix<T> &a, const mg::Matrix<T> &b)
+    {
+        mg::Matrix<T> c(a.getRows(), b.getCols(), T(0));
+        for (int i = 0; i < a.getRows(); i++)
+        {
+            for (int k = 0; k < a.getCols(); k++)
+            {
+                for (int j = 0; j < b.getCols(); j++)
+                {
+                    c(i, j) += a(i, k) * b(k, j);
+                }
+            }
+        }
+        return c;
+    }
+
+    template <typename T>
+    bool sameElements(const mg::Matrix<T> &a, const mg::Matrix<T> &b)
+    {
+        if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+        {
+            return false;
+        }
+        for (int i = 0; i < a.getRows(); i++)
+        {
+            for (int j = 0; j < a.getCols(); j++)
+            {
+                if (a(i, j) != b(i, j))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    void checkLayout(mg::SparseLayout layout, std::mt19937 &rng)
+    {
+        const int rows = 37, cols = 53;
+        const auto triplets = randomTriplets<T>(rows, cols, 300, rng);
+        const mg::Matrix<T> dense = denseFrom(rows, cols, triplets);
+        const mg::SparseMatrix<T> sparse(rows, cols, triplets, layout);
+
+        MG_CHECK(sparse.getLayout() == layout);
+        MG_CHECK(sameElements(sparse.toDense(), dense));
+
+        int nonZeros = 0;
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                nonZeros += dense(i, j) != T(0);
+                MG_CHECK(sparse(i, j) == dense(i, j));
+            }
+        }
+        MG_CHECK(sparse.nonZeros() == static_cast<std::size_t>(nonZeros));
+        MG_CHECK(sparse.offsets().back() == static_cast<std::size_t>(nonZeros));
+
+        const mg::SparseMatrix<T> compressed(dense, layout);
+        MG_CHECK(compressed == sparse);
+        MG_CHECK(sparse.toLayout(mg::SparseLayout::CSR) == sparse);
+        MG_CHECK(sparse.toLayout(mg::SparseLayout::CSC) == sparse);
+        MG_CHECK(sameElements(sparse.transpose().toDense(), mg::Matrix<T>(dense.transpose())));
+
+        // SpMV
+        std::vector<T> x(cols);
+        for (int j = 0; j < cols; j++)
+        {
+            x[j] = T(j % 7 - 3);
+        }
+        const std::vector<T> y = sparse * x;
+        MG_CHECK(static_cast<int>(y.size()) == rows);
+        for (int i = 0; i < rows; i++)
+        {
+            T expected = T(0);
+            for (int j = 0; j < cols; j++)
+            {
+                expected += dense(i, j) * x[j];
+            }
+            MG_CHECK(y[i] == expected);
+        }
+
+        // SpMM on both sides, including an expression operand
+        const mg::Matrix<T> right = randomDense<T>(cols, 11, rng);
+        const mg::Matrix<T> left = randomDense<T>(9, rows, rng);
+        MG_CHECK(sameElements(sparse * right, naiveMultiply(dense, right)));
+        MG_CHECK(sameElements(sparse * (right + right), naiveMultiply(dense, mg::Matrix<T>(right + right))));
+        MG_CHECK(sameElements(left * sparse, naiveMultiply(left, dense)));
+
+        // Sums, differences and scalars; operands in mixed layouts
+        const auto otherTriplets = randomTriplets<T>(rows, cols, 200, rng);
+        const mg::Matrix<T> otherDense = denseFrom(rows, cols, otherTriplets);
+        const mg::SparseMatrix<T> other(rows, cols, otherTriplets, mg::SparseLayout::CSC);
+        MG_CHECK(sameElements((sparse + other).toDense(), mg::Matrix<T>(dense + otherDense)));
+        MG_CHECK(sameElements((sparse - other).toDense(), mg::Matrix<T>(dense - otherDense)));
+        MG_CHECK((sparse - sparse).nonZeros() == 0);
+        MG_CHECK(sameElements((sparse * T(3)).toDense(), mg::Matrix<T>(dense * T(3))));
+
+        MG_CHECK_THROWS(sparse * std::vector<T>(rows + 1), std::invalid_argument);
+        MG_CHECK_THROWS(sparse * left, std::invalid_argument);
+        MG_CHECK_THROWS(sparse + mg::SparseMatrix<T>(rows + 1, cols), std::invalid_argument);
+        MG_CHECK_THROWS(sparse(rows, 0), std::out_of_range);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(12345);
+    checkLayout<int>(mg::SparseLayout::CSR, rng);
+    checkLayout<int>(mg::SparseLayout::CSC, rng);
+    checkLayout<double>(mg::SparseLayout::CSR, rng);
+    checkLayout<double>(mg::SparseLayout::CSC, rng);
+
+    // Duplicates are summed and cancelled entries dropped
+    const mg::SparseMatrix<int> cancelled(2, 2, {{0, 0, 4}, {0, 0, -4}, {1, 1, 2}, {1, 1, 3}});
+    MG_CHECK(cancelled.nonZeros() == 1);
+    MG_CHECK(cancelled(1, 1) == 5);
+    MG_CHECK_THROWS((mg::SparseMatrix<int>(2, 2, {{2, 0, 1}})), std::out_of_range);
+
+    return mgtest::result();
+}
@@ -0,0 +1,78 @@
+#include "../inc/squarematrix.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Strassen-Winograd against the classic product, within the normwise bound of strassen.hpp:
+ * odd and non-power-of-two orders above the crossover (one and two levels of recursion, each
+ * peeling a row, column and inner index), and small crossovers that recurse deeply through
+ * rectangular, odd-sized operands.
+ */
+
+namespace
+{
+    template <typename T>
+    mg::Matrix<T> uniform(int rows, int cols, std::uint64_t seed)
+    {
+        mg::Matrix<T> m(rows, cols);
+        mg::fillUniform(m.view(), T(-1), T(1), seed);
+        return m;
+    }
+
+    // max |C - reference| / (k max |A| max |B|), where |A|, |B| <= 1
+    template <typename T>
+    double normwiseError(const mg::Matrix<T> &c, const mg::Matrix<T> &reference, int k)
+    {
+        double error = 0;
+        for (int i = 0; i < c.getRows(); i++)
+        {
+            for (int j = 0; j < c.getCols(); j++)
+            {
+                error = std::max(error, std::abs(static_cast<double>(c(i, j)) - static_cast<double>(reference(i, j))));
+            }
+        }
+        return error / k;
+    }
+
+    void checkSquare(int n)
+    {
+        const mg::SquareMatrix<double> a(uniform<double>(n, n, n));
+        const mg::SquareMatrix<double> b(uniform<double>(n, n, n + 1));
+        const mg::SquareMatrix<double> classic = a.multiply(b, mg::MultiplyAlgorithm::Classic);
+        const mg::SquareMatrix<double> strassen = a.multiply(b, mg::MultiplyAlgorithm::Strassen);
+        MG_CHECK(normwiseError<double>(strassen, classic, n) < 1e-14);
+    }
+
+    template <typename T>
+    void checkRectangular(int m, int n, int k, int crossover, double tolerance)
+    {
+        const mg::Matrix<T> a = uniform<T>(m, k, m);
+        const mg::Matrix<T> b = uniform<T>(k, n, n);
+        const mg::Matrix<T> start = uniform<T>(m, n, k);
+        mg::Matrix<T> reference = start, c = start;
+        mg::gemm(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), reference.data(), reference.getStride(), true);
+        mg::strassenGemm(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), c.data(), c.getStride(), true, crossover);
+        MG_CHECK(normwiseError(c, reference, k) <= tolerance);
+
+        mg::gemm(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), reference.data(), reference.getStride(), false);
+        mg::strassenGemm(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), c.data(), c.getStride(), false, crossover);
+        MG_CHECK(normwiseError(c, reference, k) <= tolerance);
+    }
+}
+
+int main()
+{
+    checkSquare(513);
+    checkSquare(1031);
+
+    checkRectangular<double>(101, 77, 59, 8, 1e-14);
+    checkRectangular<double>(64, 96, 128, 4, 1e-14);
+    checkRectangular<double>(35, 200, 17, 1, 1e-14);
+    checkRectangular<float>(99, 131, 75, 8, 1e-5);
+    checkRectangular<long long>(45, 37, 29, 4, 0.0);
+
+    return mgtest::result();
+}
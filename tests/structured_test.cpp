@@ -0,0 +1,107 @@
+#include "../inc/lu.hpp"
+#include "../inc/structuredmatrix.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Structured solvers against dense LU<T> on the same elements: banded LU with row exchanges
+ * (kl != ku), triangular solves across several SOLVE_BLOCK blocks from either end, and the
+ * blocked symmetric rank-k update against A * A^T.
+ */
+
+namespace
+{
+    // max |x - reference| / max |reference|
+    double relativeError(const mg::Matrix<double> &x, const mg::Matrix<double> &reference)
+    {
+        double error = 0, scale = 0;
+        for (int i = 0; i < reference.getRows(); i++)
+        {
+            for (int j = 0; j < reference.getCols(); j++)
+            {
+                error = std::max(error, std::abs(x(i, j) - reference(i, j)));
+                scale = std::max(scale, std::abs(reference(i, j)));
+            }
+        }
+        return error / scale;
+    }
+
+    mg::Matrix<double> uniform(int rows, int cols, double low, double high, std::uint64_t seed)
+    {
+        mg::Matrix<double> m(rows, cols);
+        mg::fillUniform(m.view(), low, high, seed);
+        return m;
+    }
+
+    void checkBanded(int n, int kl, int ku, std::uint64_t seed)
+    {
+        // Diagonal elements of magnitude 1.5 among ones up to 1: partial pivoting exchanges rows,
+        // so U fills the widened band, yet the system stays well conditioned
+        mg::Matrix<double> elements = uniform(n, n, -1.0, 1.0, seed);
+        for (int i = 0; i < n; i++)
+        {
+            elements(i, i) = elements(i, i) < 0 ? -1.5 : 1.5;
+        }
+        const mg::BandedMatrix<double> band(elements, kl, ku);
+        const mg::Matrix<double> dense(band);
+        const mg::LU<double> lu(dense);
+        for (const int cols : {1, 3, 8})
+        {
+            const mg::Matrix<double> b = uniform(n, cols, -1.0, 1.0, seed + cols);
+            MG_CHECK(relativeError(band.solve(b), lu.solve(b)) < 1e-10);
+        }
+        MG_CHECK(std::abs(band.determinant() - lu.determinant()) <= 1e-10 * std::abs(lu.determinant()));
+    }
+
+    void checkTriangular(int n, mg::Triangle triangle, std::uint64_t seed)
+    {
+        // Off-diagonal elements of order 1 / n keep the solve well conditioned
+        mg::Matrix<double> elements = uniform(n, n, -1.0 / n, 1.0 / n, seed);
+        for (int i = 0; i < n; i++)
+        {
+            elements(i, i) = 1.0 + i % 3;
+        }
+        const mg::TriangularMatrix<double> t(elements, triangle);
+        const mg::LU<double> lu{mg::Matrix<double>(t)};
+        for (const int cols : {1, 7, 131})
+        {
+            const mg::Matrix<double> b = uniform(n, cols, -1.0, 1.0, seed + cols);
+            MG_CHECK(relativeError(t.solve(b), lu.solve(b)) < 1e-12);
+        }
+        const std::vector<double> x = t.solve(std::vector<double>(n, 1.0));
+        mg::Matrix<double> column(n, 1);
+        std::copy(x.begin(), x.end(), column.data());
+        MG_CHECK(relativeError(column, lu.solve(mg::Matrix<double>(n, 1, 1.0))) < 1e-12);
+    }
+}
+
+int main()
+{
+    checkBanded(300, 3, 5, 1);
+    checkBanded(300, 6, 2, 2);
+    checkBanded(257, 2, 1, 3);
+    checkBanded(257, 0, 4, 4);
+    checkBanded(257, 5, 0, 5);
+
+    // One partial block, exactly one block, and several blocks with a ragged last one
+    for (const int n : {100, 128, 300})
+    {
+        checkTriangular(n, mg::Triangle::Lower, 10 + n);
+        checkTriangular(n, mg::Triangle::Upper, 20 + n);
+    }
+
+    // The update spans three row blocks of 128
+    const mg::Matrix<double> a = uniform(300, 37, -1.0, 1.0, 30);
+    const mg::Matrix<double> gram = a * a.transpose();
+    mg::SymmetricMatrix<double> updated(300, 0.5);
+    updated.rankUpdate(a, 2.0, 3.0);
+    MG_CHECK(relativeError(mg::Matrix<double>(updated), gram * 2.0 + mg::Matrix<double>(300, 300, 1.5)) < 1e-12);
+    mg::SymmetricMatrix<double> replaced(300, 7.0);
+    replaced.rankUpdate(a, 1.0, 0.0);
+    MG_CHECK(relativeError(mg::Matrix<double>(replaced), gram) < 1e-12);
+
+    return mgtest::result();
+}